@@ -39,10 +39,32 @@ struct INIT_PARAMS
 extern void Initialize( INIT_PARAMS *params = NULL );
 
 /** Shuts down the logog system and frees all memory allocated by logog.  Memory still allocated by the logog system after Shutdown() indicates
- ** a bug.  This function is not thread safe.  Call it once at the conclusion of your program.
+ ** a bug.  Messages waiting in delivery queues are delivered first.  This function is not thread safe.  Call it once
+ ** at the conclusion of your program.
  **/
 extern void Shutdown( );
 
+/** Shuts down logog in an orderly way, so that no output is lost, taking no more than about fTimeout seconds.
+ ** Call it at the conclusion of your program instead of Shutdown(), or before restarting a service.  This function
+ ** is not thread safe, but other threads may still be logging while it runs, as long as none of them logs after it
+ ** returns.
+ **
+ ** First it stops messages from reaching any target; messages logged from now on are dropped.  Then it waits for
+ ** messages that other threads are already transmitting to reach their targets, then for targets with delivery
+ ** queues to deliver what is waiting in them, then calls Flush() on every target, so that everything held in
+ ** buffers and queues reaches the operating system, and then Sync() on every target, so that it reaches the disk.
+ ** Buffering targets, such as LogBuffer, pass their output on to the targets they feed before those are flushed.
+ ** Finally it calls Shutdown().
+ **
+ ** The deadline is checked before each target is flushed or synced.  Once it has passed, the remaining targets are
+ ** not synced, and not flushed except by their destructors, and messages still waiting in delivery queues are
+ ** dropped.  A single flush, sync or delivery is not interrupted, and messages that were already being transmitted
+ ** are still waited for, since their targets can't be destroyed while they are in use.
+ ** \param fTimeout The number of seconds to allow for flushing and syncing.
+ ** \return true if every target was flushed and synced without error before the deadline.
+ **/
+extern bool Shutdown( LOGOG_TIME fTimeout );
+
 }
 
 #endif // __LOGOG_API_HPP
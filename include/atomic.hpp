@@ -0,0 +1,51 @@
+/**
+ * \file atomic.hpp Atomic operations on 64-bit counters for the current platform.
+ */
+
+#ifndef __LOGOG_ATOMIC_HPP__
+#define __LOGOG_ATOMIC_HPP__
+
+/* These macros operate on LOGOG_UINT64 values only.  They impose no ordering on surrounding memory
+ * operations (they are "relaxed" in C++11 terms), so they are suitable for statistics counters but
+ * not for publishing data to other threads.  To publish data, write it and then store a cursor with
+ * LOGOG_ATOMIC_STORE_RELEASE; a reader that sees the cursor through LOGOG_ATOMIC_LOAD_ACQUIRE also
+ * sees the data.  LOGOG_ATOMIC_ADD_ACQ_REL is an addition that is both, for reference counts: the thread that
+ * drops the last reference sees everything the other holders did before dropping theirs.
+ * LOGOG_ATOMIC_LOAD_POINTER and LOGOG_ATOMIC_CAS_POINTER operate on pointers instead, and are
+ * full barriers or acquire loads.
+ */
+//! [Atomic]
+#ifndef LOGOG_ATOMIC_ADD
+
+#ifdef LOGOG_FLAVOR_WINDOWS
+#define LOGOG_ATOMIC_ADD(p, v)       InterlockedExchangeAdd64( (volatile LONG64 *)(p), (LONG64)(v) )
+#define LOGOG_ATOMIC_LOAD(p)         ( (LOGOG_UINT64)InterlockedCompareExchange64( (volatile LONG64 *)(p), 0, 0 ) )
+#define LOGOG_ATOMIC_STORE(p, v)     InterlockedExchange64( (volatile LONG64 *)(p), (LONG64)(v) )
+/* The Interlocked functions are full barriers. */
+#define LOGOG_ATOMIC_LOAD_ACQUIRE(p)     LOGOG_ATOMIC_LOAD(p)
+#define LOGOG_ATOMIC_STORE_RELEASE(p, v) LOGOG_ATOMIC_STORE(p, v)
+#define LOGOG_ATOMIC_ADD_ACQ_REL(p, v)   LOGOG_ATOMIC_ADD(p, v)
+#define LOGOG_ATOMIC_LOAD_POINTER(p)     InterlockedCompareExchangePointer( (PVOID volatile *)(p), NULL, NULL )
+#define LOGOG_ATOMIC_CAS_POINTER(p, e, v) \
+	( InterlockedCompareExchangePointer( (PVOID volatile *)(p), (PVOID)(v), (PVOID)(e) ) == (PVOID)(e) )
+#endif // LOGOG_FLAVOR_WINDOWS
+
+#ifdef LOGOG_FLAVOR_POSIX
+#define LOGOG_ATOMIC_ADD(p, v)       __atomic_fetch_add( (p), (LOGOG_UINT64)(v), __ATOMIC_RELAXED )
+#define LOGOG_ATOMIC_LOAD(p)         __atomic_load_n( (p), __ATOMIC_RELAXED )
+#define LOGOG_ATOMIC_STORE(p, v)     __atomic_store_n( (p), (LOGOG_UINT64)(v), __ATOMIC_RELAXED )
+#define LOGOG_ATOMIC_LOAD_ACQUIRE(p)     __atomic_load_n( (p), __ATOMIC_ACQUIRE )
+#define LOGOG_ATOMIC_STORE_RELEASE(p, v) __atomic_store_n( (p), (LOGOG_UINT64)(v), __ATOMIC_RELEASE )
+#define LOGOG_ATOMIC_ADD_ACQ_REL(p, v)   __atomic_fetch_add( (p), (LOGOG_UINT64)(v), __ATOMIC_ACQ_REL )
+#define LOGOG_ATOMIC_LOAD_POINTER(p)     __atomic_load_n( (p), __ATOMIC_ACQUIRE )
+#define LOGOG_ATOMIC_CAS_POINTER(p, e, v) __sync_bool_compare_and_swap( (p), (e), (v) )
+#endif // LOGOG_FLAVOR_POSIX
+
+#endif // LOGOG_ATOMIC_ADD
+
+#ifndef LOGOG_ATOMIC_ADD
+#error You need to define atomic macros for your platform; please see atomic.hpp
+#endif
+//! [Atomic]
+
+#endif // __LOGOG_ATOMIC_HPP__
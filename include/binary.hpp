@@ -0,0 +1,254 @@
+/**
+ * \file binary.hpp A compact binary log format, with a formatter and a target that write it and a reader that
+ * reads it back.
+ */
+
+#ifndef __LOGOG_BINARY_HPP__
+#define __LOGOG_BINARY_HPP__
+
+namespace logog
+{
+
+/** The eight bytes that begin every binary log stream.  As with PNG, the first byte is not ASCII and the line
+ ** endings catch files that have been mangled by text-mode transfers.
+ **/
+#define LOGOG_BINARY_MAGIC "\x89LGB\r\n\x1a\n"
+/** The length of LOGOG_BINARY_MAGIC. */
+#define LOGOG_BINARY_MAGIC_LENGTH 8
+/** The version of the binary log format written by this release. */
+#define LOGOG_BINARY_VERSION 1
+
+/** The binary log format is a sequence of records, each introduced by one of these bytes.  All integers are
+ ** LEB128 varints: seven bits at a time, least significant group first, with the high bit set on every byte
+ ** but the last.  Signed integers are zigzag encoded first.  Strings are a varint byte count followed by that
+ ** many bytes of UTF-8, without a terminator.
+ **
+ ** - BINARY_RECORD_HEADER: the rest of the magic, a version byte, and the wall clock time in nanoseconds since
+ **   1970 UTC that the first time delta is relative to.  A header starts a new stream and forgets all call
+ **   sites, so files that have been appended to by several runs read correctly.
+ ** - BINARY_RECORD_SITE: a call site, written the first time a stream sees a message: site id, level, line
+ **   number, then the file name, group, category and format string.
+ ** - BINARY_RECORD_MESSAGE: site id, signed time delta in nanoseconds from the previous message (or the
+ **   header), thread id, the rendered message, then a count of key/value fields and the fields themselves.
+ **   Each field is a key string, a FieldType byte and the value: a signed varint, a varint, eight bytes of
+ **   IEEE double in little endian order, a byte, or a string.
+ ** - BINARY_RECORD_PADDING: ignored.  Records are padded to a multiple of sizeof( LOGOG_CHAR ).
+ **/
+enum BinaryRecordType
+{
+	BINARY_RECORD_PADDING = 0x00,
+	BINARY_RECORD_SITE = 0x01,
+	BINARY_RECORD_MESSAGE = 0x02,
+	BINARY_RECORD_HEADER = 0x89
+};
+
+/** Renders topics in the binary log format.  Each formatter writes a single stream: it writes a header before
+ ** its first record, and describes each call site once, the first time that site logs.  So a BinaryFormatter
+ ** should only be used by one target at a time; BinaryLogFile creates its own.  The bytes are packed into the
+ ** returned string sizeof( LOGOG_CHAR ) at a time, so that a target writing the string's raw contents writes
+ ** exactly these bytes on Unicode builds too.
+ **
+ ** A call site is a topic's address, level and line number.  A topic whose level or line changes is described
+ ** again under a new id, and so is a topic created where another was freed, unless it has the freed topic's
+ ** level and line: it is then read back with the freed topic's file name, group, category and format string.
+ **/
+class BinaryFormatter : public Formatter
+{
+public:
+	BinaryFormatter();
+
+	virtual LOGOG_STRING &Format( const Topic &topic, const Target &target );
+
+	/** Forgets all call sites, so that the next record starts a new stream with a header. */
+	void Reset();
+
+protected:
+	typedef LOGOG_VECTOR< unsigned char, Allocator< unsigned char > > BytesType;
+
+	/** Associates a call site with the id it was given in this stream.  A site is a topic at a given level and
+	 ** line number.
+	 **/
+	struct SiteEntry
+	{
+		const Topic *m_pTopic;
+		LOGOG_LEVEL_TYPE m_nLevel;
+		int m_nLineNumber;
+		LOGOG_UINT64 m_nId;
+	};
+
+	typedef LOGOG_VECTOR< SiteEntry, Allocator< SiteEntry > > SitesType;
+
+	/** Returns the id of the call site of topic, and sets bIsNew if it hasn't been seen before. */
+	LOGOG_UINT64 FindSite( const Topic &topic, bool &bIsNew );
+	/** Does site sort before the site of pTopic at nLevel and nLineNumber? */
+	static bool SiteBefore( const SiteEntry &site, const Topic *pTopic, LOGOG_LEVEL_TYPE nLevel, int nLineNumber );
+
+	void PutByte( unsigned char c );
+	void PutVarint( LOGOG_UINT64 nValue );
+	void PutSignedVarint( LOGOG_INT64 nValue );
+	/** Writes nCount characters as a length-prefixed UTF-8 string. */
+	void PutString( const LOGOG_CHAR *pChars, size_t nCount );
+	void PutString( const LOGOG_STRING &s );
+	void PutDouble( double dValue );
+
+	/** The record being rendered. */
+	BytesType m_vBytes;
+	/** The call sites seen in this stream, sorted by address, level and line number. */
+	SitesType m_vSites;
+	/** True once the stream header has been written. */
+	bool m_bStarted;
+	/** The time of the previous message, or of the header. */
+	LOGOG_UINT64 m_nPreviousTime;
+};
+
+/** A log file in the binary log format.  Writing a binary record takes a few varints and a copy of the message,
+ ** so this is both much faster and much denser than writing text; use BinaryLogReader or the logog-cat tool to
+ ** read the file.  Like LogFile, BinaryLogFile appends to an existing file.
+ **/
+class BinaryLogFile : public LogFile
+{
+public:
+	/** Creates a BinaryLogFile.  \sa LogFile::LogFile */
+	BinaryLogFile( const char *sFileName, bool bEnableOutputBuffering = true );
+
+	/** Opens the file for appending in binary mode, without a byte order mark. */
+	virtual int Open();
+
+protected:
+	BinaryFormatter m_BinaryFormatter;
+
+private:
+	BinaryLogFile();
+};
+
+/** A call site as read from a binary log.  The strings are UTF-8 and null-terminated. */
+struct BinaryLogSite
+{
+	LOGOG_UINT64 m_nId;
+	int m_nLevel;
+	int m_nLineNumber;
+	const char *m_sFileName;
+	const char *m_sGroup;
+	const char *m_sCategory;
+	const char *m_sFormat;
+};
+
+/** A key/value field as read from a binary log.  The value member that m_Type selects is valid. */
+struct BinaryLogField
+{
+	const char *m_sKey;
+	FieldType m_Type;
+	LOGOG_INT64 m_nInteger;
+	LOGOG_UINT64 m_nUnsigned;
+	double m_dFloat;
+	bool m_bBoolean;
+	/** The string value, null-terminated, and its length in bytes. */
+	const char *m_sString;
+	size_t m_nStringLength;
+};
+
+/** A message as read from a binary log.  The pointers are owned by the reader, and are valid until its next
+ ** call to Next(), Open() or Close().
+ **/
+struct BinaryLogRecord
+{
+	BinaryLogSite m_Site;
+	/** The wall clock time of the message in nanoseconds since 1970 UTC. */
+	LOGOG_UINT64 m_nTime;
+	LOGOG_UINT64 m_nThread;
+	/** The rendered message, null-terminated, and its length in bytes. */
+	const char *m_sMessage;
+	size_t m_nMessageLength;
+	size_t m_nFieldCount;
+	BinaryLogField m_vFields[ LOGOG_MAX_FIELDS ];
+};
+
+/** Reads the messages in a binary log file, in order. */
+class BinaryLogReader : public Object
+{
+public:
+	BinaryLogReader();
+	virtual ~BinaryLogReader();
+
+	/** Opens a binary log file.  \return true if the file was opened and starts with a binary log header. */
+	bool Open( const char *sFileName );
+
+	/** Closes the file, if one is open. */
+	void Close();
+
+	/** Reads the next message into record.
+	 ** \return true if a message was read; false at the end of the file, or if the file is malformed or ends
+	 ** part way through a record, in which case IsCorrupt() returns true.
+	 **/
+	bool Next( BinaryLogRecord &record );
+
+	/** Did reading stop at a malformed or truncated record? */
+	bool IsCorrupt() const;
+
+	/** Reads from nLength bytes in memory instead of from a file.  Unlike Open(), this keeps the call sites and
+	 ** the time already read, so that a stream arriving in pieces, such as from a socket, can be read one piece
+	 ** at a time: call Next() until it returns false, then pass the bytes from GetBufferPosition() onward again
+	 ** along with whatever arrives next.  A record cut off at the end of the buffer is not an error.  The bytes
+	 ** must stay valid until Next() returns false.  \sa SocketServer
+	 **/
+	void SetBuffer( const void *pData, size_t nLength );
+
+	/** Returns the offset in the buffer of the first byte not yet read as part of a whole record. */
+	size_t GetBufferPosition() const;
+
+	/** Returns the number of headers read.  Each header forgets the call sites, so site ids seen before it may
+	 ** now refer to different sites.
+	 **/
+	LOGOG_UINT64 GetHeaderCount() const;
+
+	/** Returns the number of messages skipped because they came before any header, and so have no time. */
+	LOGOG_UINT64 GetSkippedCount() const;
+
+protected:
+	typedef LOGOG_VECTOR< char, Allocator< char > > TextType;
+
+	/** Where a call site's strings are in m_vSiteText. */
+	struct SiteEntry
+	{
+		bool m_bDefined;
+		int m_nLevel;
+		int m_nLineNumber;
+		size_t m_vOffsets[ 4 ];
+	};
+
+	typedef LOGOG_VECTOR< SiteEntry, Allocator< SiteEntry > > SitesType;
+
+	bool ReadByte( unsigned char &c );
+	bool ReadBytes( void *pOut, size_t nCount );
+	bool ReadVarint( LOGOG_UINT64 &nValue );
+	bool ReadSignedVarint( LOGOG_INT64 &nValue );
+	/** Reads a string and appends it, null-terminated, to text.  Sets nOffset to where it starts. */
+	bool ReadString( TextType &text, size_t &nOffset, size_t *pnLength = NULL );
+	bool ReadHeader();
+	bool ReadSite();
+	/** Reads a message.  Sets bSkipped, and leaves record alone, if the message came before any header. */
+	bool ReadMessage( BinaryLogRecord &record, bool &bSkipped );
+
+	FILE *m_pFile;
+	bool m_bCorrupt;
+	LOGOG_UINT64 m_nPreviousTime;
+	/** The buffer given to SetBuffer(), if the reader is reading from memory rather than from m_pFile. */
+	const unsigned char *m_pBuffer;
+	size_t m_nBufferLength;
+	size_t m_nBufferPosition;
+	/** Set when a read from the buffer ran past its end. */
+	bool m_bBufferEnded;
+	LOGOG_UINT64 m_nHeaders;
+	LOGOG_UINT64 m_nSkipped;
+	SitesType m_vSites;
+	TextType m_vSiteText;
+	TextType m_vRecordText;
+
+private:
+	BinaryLogReader( const BinaryLogReader & );
+	BinaryLogReader &operator=( const BinaryLogReader & );
+};
+
+}
+
+#endif // __LOGOG_BINARY_HPP_
@@ -0,0 +1,187 @@
+/**
+ * \file compress.hpp A log file that compresses its output in blocks on a background thread, and a reader for it.
+ */
+
+#ifndef __LOGOG_COMPRESS_HPP__
+#define __LOGOG_COMPRESS_HPP__
+
+namespace logog
+{
+
+/** \def LOGOG_ZLIB
+ ** Define this macro, and link with zlib, to let CompressedLogFile compress with deflate as well as with the
+ ** built-in LZ4 codec.  The CMake option LOGOG_ZLIB does both if zlib can be found.
+ **/
+
+/** The eight bytes that begin every run of a compressed log file. */
+#define LOGOG_COMPRESSED_MAGIC "\x89LGZ\r\n\x1a\n"
+/** The length of LOGOG_COMPRESSED_MAGIC. */
+#define LOGOG_COMPRESSED_MAGIC_LENGTH 8
+/** The length of the header that precedes each block. */
+#define LOGOG_COMPRESSED_BLOCK_HEADER_LENGTH 13
+
+/** The ways that a block of a compressed log can be stored.  A compressed log file is a sequence of runs, one
+ ** per time the file was opened for appending.  Each run is LOGOG_COMPRESSED_MAGIC followed by blocks.  Each
+ ** block is a one-byte CompressionCodec, then the uncompressed size, the stored size and a 32-bit FNV-1a hash
+ ** of the uncompressed bytes, each four bytes little endian, and then the stored bytes.  A block is only
+ ** written once it is complete, so a file cut short by a crash can be read up to its last whole block.
+ **/
+enum CompressionCodec
+{
+	/** The block is stored as is; used when compressing doesn't make it smaller. */
+	COMPRESSION_STORED = 0x00,
+	/** The block is in the LZ4 block format, compressed by logog's built-in compressor. */
+	COMPRESSION_LZ4 = 0x01,
+	/** The block is a zlib stream.  Only available if logog was compiled with LOGOG_ZLIB. */
+	COMPRESSION_ZLIB = 0x02
+};
+
+/** Returns the largest size that CompressBlockLZ4() can produce for nSize bytes of input. */
+extern size_t CompressBoundLZ4( size_t nSize );
+
+/** Compresses nSize bytes in the LZ4 block format.  pOut must have room for CompressBoundLZ4( nSize ) bytes.
+ ** \return The number of bytes written to pOut.
+ **/
+extern size_t CompressBlockLZ4( const unsigned char *pIn, size_t nSize, unsigned char *pOut );
+
+/** Decompresses an LZ4 block of nSize bytes, which must expand to exactly nOutSize bytes.
+ ** \return true if the block was well formed.
+ **/
+extern bool DecompressBlockLZ4( const unsigned char *pIn, size_t nSize, unsigned char *pOut, size_t nOutSize );
+
+/** A log file that stores its output compressed.  Messages are collected in memory until a block of about
+ ** LOGOG_DEFAULT_COMPRESSED_BLOCK_SIZE bytes is full; the block is then handed to a background thread, which
+ ** compresses and writes it while the next block fills.  Repetitive logs typically shrink several times over,
+ ** and the file sees one write per block.  If the background thread falls a whole block behind, the logging
+ ** thread waits for it.
+ **
+ ** Messages in the block being filled reach the disk only when the block fills, when Flush() is called, or when
+ ** the target is destroyed, so a crash loses the last partial block.  Use CompressedLogReader or logog-cat to
+ ** read the file.  The stored bytes are the formatter's output as is, so a BinaryFormatter may be used too.
+ ** A compressed log can't be indexed, since an index holds offsets into the uncompressed output.
+ **/
+class CompressedLogFile : public LogFile
+{
+public:
+	/** Creates a CompressedLogFile.
+	 ** \param sFileName The name of the file to append to.
+	 ** \param codec The codec to compress with.  COMPRESSION_ZLIB falls back to COMPRESSION_LZ4 if logog was
+	 ** compiled without LOGOG_ZLIB.
+	 ** \param nBlockSize The number of bytes of output to collect before compressing.
+	 **/
+	CompressedLogFile( const char *sFileName,
+		CompressionCodec codec = COMPRESSION_LZ4,
+		size_t nBlockSize = LOGOG_DEFAULT_COMPRESSED_BLOCK_SIZE );
+
+	/** Compresses and writes any remaining output, stops the background thread, and closes the file. */
+	virtual ~CompressedLogFile();
+
+	/** Opens the file for appending in binary mode and writes the start of a new run. */
+	virtual int Open();
+
+	/** Adds the message to the current block, handing the block to the background thread once it is full. */
+	virtual int Output( const LOGOG_STRING &data );
+
+	/** Compresses and writes the current partial block, and waits until everything received so far is in the
+	 ** file.  \return Zero if all blocks were written; -1 if a write has failed.
+	 **/
+	virtual int Flush();
+
+	/** Writes the uncompressed output not yet handed to the background thread to the emergency descriptors, as
+	 ** plain text.  A block that the background thread is already compressing is not included.
+	 **/
+	virtual void EmergencyDump();
+
+	/** Refuses: the offsets in an index would count uncompressed bytes, which can't be sought to in the file.
+	 ** \return false.
+	 **/
+	virtual bool EnableIndex( size_t nIntervalBytes = LOGOG_DEFAULT_INDEX_INTERVAL, size_t nIntervalRecords = 0 );
+
+protected:
+	/** Compresses and writes the current partial block, and waits for the background thread to write it.  The
+	 ** caller must hold m_MutexReceive.
+	 **/
+	virtual int FlushOutput();
+
+	typedef LOGOG_VECTOR< unsigned char, Allocator< unsigned char > > BytesType;
+
+	/** Hands the current block to the background thread, waiting if it is still busy with the previous one.
+	 ** The caller must hold m_MutexReceive.  \return Zero, or -1 if a block has failed to be written.
+	 **/
+	int QueueBlock();
+
+	/** Compresses a block and writes it to the file.  Called on the background thread. */
+	void WriteBlock( const BytesType &vBlock );
+
+	/** The entry point of the background thread. */
+	static void *CompressThread( void *pvParams );
+
+	CompressionCodec m_Codec;
+	size_t m_nBlockSize;
+	/** The block being filled.  Guarded by m_MutexReceive. */
+	BytesType m_vFilling;
+	/** The block waiting for the background thread, if m_bPending.  Guarded by m_Condition. */
+	BytesType m_vPending;
+	/** The block being compressed.  Only used by the background thread. */
+	BytesType m_vWorking;
+	/** Where blocks are compressed to.  Only used by the background thread. */
+	BytesType m_vCompressed;
+	/** Signals changes to m_bPending, m_bBusy and m_bStop. */
+	Condition m_Condition;
+	bool m_bPending;
+	bool m_bBusy;
+	bool m_bStop;
+	/** Set by the background thread if a write fails. */
+	bool m_bWriteFailed;
+	Thread m_Thread;
+	bool m_bThreadStarted;
+
+private:
+	CompressedLogFile();
+	CompressedLogFile( const CompressedLogFile & );
+	CompressedLogFile &operator=( const CompressedLogFile & );
+};
+
+/** Reads back the bytes written to a CompressedLogFile, decompressing them a block at a time. */
+class CompressedLogReader : public Object
+{
+public:
+	CompressedLogReader();
+	virtual ~CompressedLogReader();
+
+	/** Opens a compressed log file.  \return true if the file was opened and starts with LOGOG_COMPRESSED_MAGIC. */
+	bool Open( const char *sFileName );
+
+	/** Closes the file, if one is open. */
+	void Close();
+
+	/** Reads up to nSize decompressed bytes into pBuffer.
+	 ** \return The number of bytes read; zero at the end of the file, or if a block is truncated, malformed or
+	 ** fails its checksum, in which case IsCorrupt() returns true.
+	 **/
+	size_t Read( void *pBuffer, size_t nSize );
+
+	/** Did reading stop at a damaged block? */
+	bool IsCorrupt() const;
+
+protected:
+	typedef LOGOG_VECTOR< unsigned char, Allocator< unsigned char > > BytesType;
+
+	/** Reads and decompresses the next block into m_vBlock. */
+	bool ReadBlock();
+
+	FILE *m_pFile;
+	bool m_bCorrupt;
+	BytesType m_vBlock;
+	BytesType m_vStored;
+	/** The number of bytes of m_vBlock already returned by Read(). */
+	size_t m_nOffset;
+
+private:
+	CompressedLogReader( const CompressedLogReader & );
+	CompressedLogReader &operator=( const CompressedLogReader & );
+};
+
+}
+
+#endif // __LOGOG_COMPRESS_HPP_
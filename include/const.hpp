@@ -10,11 +10,161 @@
 #define LOGOG_FORMATTER_MAX_LENGTH ( 1024 * 16 )
 #endif
 
+#ifndef LOGOG_FORMAT_INITIAL_LENGTH
+/** The initial size of a message buffer that is rendered in place, in LOGOG_CHAR units.  The buffer grows as
+ ** needed.  \sa Topic::BeginFormat */
+#define LOGOG_FORMAT_INITIAL_LENGTH 256
+#endif
+
+#ifndef LOGOG_FORMAT_MEMO_SIZE
+/** The most formatters whose output for one transmission of a message is kept and shared between targets.
+ ** Targets using any further formatter format the message themselves.  \sa Topic::GetFormatted */
+#define LOGOG_FORMAT_MEMO_SIZE 4
+#endif
+
+#ifndef LOGOG_DEFAULT_DELIVERY_QUEUE_SIZE
+/** The default number of messages that may wait in a target's delivery queue.  \sa Target::SetDeliveryQueue */
+#define LOGOG_DEFAULT_DELIVERY_QUEUE_SIZE 4096
+#endif
+
 #ifndef LOGOG_DEFAULT_LOG_BUFFER_SIZE
 /** The default size of a RingBuffer object for buffering outputs. */
 #define LOGOG_DEFAULT_LOG_BUFFER_SIZE ( 4 * 1024 * 1024 )
 #endif
 
+#ifndef LOGOG_DEFAULT_MEMORY_TARGET_SIZE
+/** The default initial size of the arena of a MemoryTarget, in LOGOG_CHAR units.  \sa MemoryTarget */
+#define LOGOG_DEFAULT_MEMORY_TARGET_SIZE ( 64 * 1024 )
+#endif
+
+#ifndef LOGOG_DEFAULT_COMPRESSED_BLOCK_SIZE
+/** The default number of bytes of output that a CompressedLogFile collects before compressing them as a block.
+ ** \sa CompressedLogFile */
+#define LOGOG_DEFAULT_COMPRESSED_BLOCK_SIZE ( 64 * 1024 )
+#endif
+
+#ifndef LOGOG_DEFAULT_DESCRIPTOR_BUFFER_SIZE
+/** The default size in bytes of the buffer in which a DescriptorLogFile collects output before writing it.
+ ** \sa DescriptorLogFile */
+#define LOGOG_DEFAULT_DESCRIPTOR_BUFFER_SIZE ( 64 * 1024 )
+#endif
+
+#ifndef LOGOG_DIRECT_BLOCK_SIZE
+/** The alignment, in bytes, of the offsets, lengths and buffers of a DirectLogFile's writes.  4096 satisfies
+ ** O_DIRECT on every common file system and device.  \sa DirectLogFile */
+#define LOGOG_DIRECT_BLOCK_SIZE 4096
+#endif
+
+#ifndef LOGOG_DEFAULT_DIRECT_BUFFER_SIZE
+/** The default size in bytes of each of the buffers of a DirectLogFile.  \sa DirectLogFile */
+#define LOGOG_DEFAULT_DIRECT_BUFFER_SIZE ( 256 * 1024 )
+#endif
+
+#ifndef LOGOG_DEFAULT_DIRECT_BUFFERS
+/** The default number of buffers of a DirectLogFile; one is filled while the others are written.
+ ** \sa DirectLogFile */
+#define LOGOG_DEFAULT_DIRECT_BUFFERS 4
+#endif
+
+#ifndef LOGOG_DEFAULT_SOCKET_QUEUE_SIZE
+/** The default number of bytes of messages that a Socket queues while its collector can't keep up.  \sa Socket */
+#define LOGOG_DEFAULT_SOCKET_QUEUE_SIZE ( 1024 * 1024 )
+#endif
+
+#ifndef LOGOG_SOCKET_BATCH
+/** The most messages that a Socket sends with one system call.  \sa Socket */
+#define LOGOG_SOCKET_BATCH 64
+#endif
+
+#ifndef LOGOG_SOCKET_RETRY_MIN
+/** The milliseconds that a Socket waits before connecting again after its first failure.  \sa Socket */
+#define LOGOG_SOCKET_RETRY_MIN 100
+#endif
+
+#ifndef LOGOG_SOCKET_RETRY_MAX
+/** The most milliseconds that a Socket waits before connecting again.  \sa Socket */
+#define LOGOG_SOCKET_RETRY_MAX 30000
+#endif
+
+#ifndef LOGOG_DEFAULT_SOCKET_FLUSH_TIMEOUT
+/** The milliseconds that Socket::Flush() waits for its collector to take the queue.  \sa Socket */
+#define LOGOG_DEFAULT_SOCKET_FLUSH_TIMEOUT 1000
+#endif
+
+#ifndef LOGOG_DEFAULT_SERVER_MERGE_WINDOW
+/** The milliseconds that SocketServer holds a message back while it waits for older ones from other
+ ** connections.  \sa SocketServer::SetMergeWindow */
+#define LOGOG_DEFAULT_SERVER_MERGE_WINDOW 100
+#endif
+
+#ifndef LOGOG_SERVER_READ_SIZE
+/** The most bytes that SocketServer reads from a connection at a time.  \sa SocketServer */
+#define LOGOG_SERVER_READ_SIZE 65536
+#endif
+
+#ifndef LOGOG_SERVER_MAX_EVENTS
+/** The most ready sockets that SocketServer handles each time it waits.  \sa SocketServer */
+#define LOGOG_SERVER_MAX_EVENTS 64
+#endif
+
+#ifndef LOGOG_SYSLOG_PATH
+/** The local syslog socket that a Syslog target sends to by default.  \sa Syslog */
+#define LOGOG_SYSLOG_PATH "/dev/log"
+#endif
+
+#ifndef LOGOG_SYSLOG_PORT
+/** The UDP port that a Syslog target sends to, if it is given a host rather than a path.  \sa Syslog */
+#define LOGOG_SYSLOG_PORT 514
+#endif
+
+#ifndef LOGOG_SYSLOG_FACILITY
+/** The default syslog facility: 1, for user-level messages.  \sa FormatterSyslog */
+#define LOGOG_SYSLOG_FACILITY 1
+#endif
+
+#ifndef LOGOG_SYSLOG_SD_ID
+/** The id of the structured data element in which FormatterSyslog sends the group, category, file and line.
+ ** 32473 is the private enterprise number that RFC 5612 reserves for documentation and examples.
+ ** \sa FormatterSyslog */
+#define LOGOG_SYSLOG_SD_ID "logog@32473"
+#endif
+
+#ifndef LOGOG_DEFAULT_INDEX_INTERVAL
+/** The default number of bytes of a log file covered by each entry in its index.  \sa LogFile::EnableIndex */
+#define LOGOG_DEFAULT_INDEX_INTERVAL ( 64 * 1024 )
+#endif
+
+#ifndef LOGOG_DEFAULT_FLIGHT_RECORDER_SIZE
+/** The default size in bytes of the ring of records kept by a FlightRecorder.  \sa FlightRecorder */
+#define LOGOG_DEFAULT_FLIGHT_RECORDER_SIZE ( 4 * 1024 * 1024 )
+#endif
+
+/** Added to the count of messages being transmitted once Shutdown( LOGOG_TIME ) has closed logog to new ones; far
+ ** above any count of transmissions.  \sa Statics::s_nTransmitting */
+#define LOGOG_TRANSMIT_CLOSED ( (LOGOG_UINT64)1 << 62 )
+
+#ifndef LOGOG_EMERGENCY_MESSAGE_SIZE
+/** The size in bytes of the stack buffer in which an EmergencyMessage is built.  Longer messages are
+ ** truncated.  \sa EmergencyMessage */
+#define LOGOG_EMERGENCY_MESSAGE_SIZE 512
+#endif
+
+#ifndef LOGOG_EMERGENCY_MAX_DESCRIPTORS
+/** The most file descriptors that emergency messages can be written to.  \sa SetEmergencyDescriptors */
+#define LOGOG_EMERGENCY_MAX_DESCRIPTORS 8
+#endif
+
+#ifndef LOGOG_EMERGENCY_MAX_TARGETS
+/** The most targets whose buffers are written out by EmergencyFlush().  \sa AddEmergencyTarget */
+#define LOGOG_EMERGENCY_MAX_TARGETS 32
+#endif
+
+#ifndef LOGOG_MAX_FIELDS
+/** The maximum number of key/value fields that can be attached to a single message.  Further fields are
+ ** dropped.  \sa FieldSet */
+#define LOGOG_MAX_FIELDS 16
+#endif
+
 #ifndef LOGOG_TIME_STRING_MAX
 /** The maximum length of a char string containing a text representation of time. \sa TimeStamp */
 #define LOGOG_TIME_STRING_MAX 256
@@ -25,6 +175,12 @@
 #define LOGOG_TIME_FORMAT_MAX 128
 #endif 
 
+#ifndef LOGOG_STATISTICS_LATENCY_BUCKETS
+/** The number of buckets in the output latency histogram kept for each target.  Bucket n counts outputs that
+ ** took between 2^n and 2^(n+1) nanoseconds; the last bucket also counts everything slower.  \sa Statistics */
+#define LOGOG_STATISTICS_LATENCY_BUCKETS 32
+#endif
+
 #ifndef LOGOG_DEFAULT_TIME_FORMAT
 /** The default format for time output.  \sa Formatter::SetTimeOfDayFormat */
 #define LOGOG_DEFAULT_TIME_FORMAT "%c"
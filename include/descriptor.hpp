@@ -0,0 +1,82 @@
+/**
+ * \file descriptor.hpp A log file that writes through a POSIX file descriptor instead of stdio.
+ */
+
+#ifndef __LOGOG_DESCRIPTOR_HPP__
+#define __LOGOG_DESCRIPTOR_HPP__
+
+#ifdef LOGOG_FLAVOR_POSIX
+
+namespace logog
+{
+
+/** A LogFile that writes with write(2) from a buffer of its own, rather than through stdio.  It behaves like
+ ** LogFile, including indexing and durable messages, but skips the work that stdio adds: opening the file takes one
+ ** open() and one fstat(), rather than a probe with fopen() followed by the real fopen(), and output is copied once
+ ** into a page-aligned buffer, without stdio's per-call locking, which only repeats what the target's own mutex
+ ** already does.  The file is opened with O_APPEND and O_CLOEXEC, so that it doesn't leak into child processes.
+ **
+ ** The file must have only one writer.  The file size, the offsets written to the index and the ranges passed to
+ ** sync_file_range() and posix_fadvise() are all counted from this object's own writes, so they are wrong if another
+ ** process or another DescriptorLogFile appends to the same file.
+ **
+ ** Only available on POSIX systems.
+ **/
+class DescriptorLogFile : public LogFile
+{
+public:
+	/** Creates a DescriptorLogFile.
+	 ** \param sFileName The name of the file to append to.
+	 ** \param bEnableOutputBuffering If false, every message is written as soon as it is received.
+	 ** \param nBufferSize The size of the buffer in bytes.
+	 ** \param bDropCache If true, posix_fadvise() is used to drop the log's pages from the page cache once they
+	 ** have been written back, so that a busy log doesn't push more useful data out of memory.
+	 **/
+	DescriptorLogFile( const char *sFileName,
+		bool bEnableOutputBuffering = true,
+		size_t nBufferSize = LOGOG_DEFAULT_DESCRIPTOR_BUFFER_SIZE,
+		bool bDropCache = false );
+
+	/** Writes any buffered output and closes the file. */
+	virtual ~DescriptorLogFile();
+
+	/** Opens the file, and writes a byte order mark if it was empty and one is wanted. */
+	virtual int Open();
+
+protected:
+	/** Copies output into the buffer, writing the buffer out when it fills. */
+	virtual int InternalOutput( size_t nSize, const LOGOG_CHAR *pData );
+
+	/** Writes the buffer to the file. */
+	virtual int FlushOutput();
+
+	virtual int SyncOutput( bool bDataOnly );
+	virtual LOGOG_UINT64 GetOutputSize();
+
+	/** Writes bytes to the file, retrying after short writes and interruptions. */
+	int WriteAll( const unsigned char *pData, size_t nLength );
+
+	int m_nDescriptor;
+	/** The allocation holding the buffer; the buffer itself starts at the next page boundary. */
+	void *m_pAllocation;
+	unsigned char *m_pBuffer;
+	size_t m_nBufferSize;
+	/** The number of bytes in the buffer. */
+	size_t m_nBuffered;
+	/** The size of the file, not counting the buffer. */
+	LOGOG_UINT64 m_nFileSize;
+	/** The offset up to which the page cache has been dropped, or from which it will be next time. */
+	LOGOG_UINT64 m_nDropFrom;
+	bool m_bDropCache;
+
+private:
+	DescriptorLogFile();
+	DescriptorLogFile( const DescriptorLogFile & );
+	DescriptorLogFile &operator=( const DescriptorLogFile & );
+};
+
+}
+
+#endif // LOGOG_FLAVOR_POSIX
+
+#endif // __LOGOG_DESCRIPTOR_HPP_
@@ -0,0 +1,152 @@
+/**
+ * \file direct.hpp A log file that writes aligned blocks with O_DIRECT, bypassing the page cache.
+ */
+
+#ifndef __LOGOG_DIRECT_HPP__
+#define __LOGOG_DIRECT_HPP__
+
+#ifdef LOGOG_FLAVOR_POSIX
+
+namespace logog
+{
+
+/** \def LOGOG_IO_URING
+ ** Define this macro to let DirectLogFile submit its writes through io_uring on Linux.  No library is needed;
+ ** the ring is driven with raw system calls.  The CMake option LOGOG_IO_URING defines it.
+ **/
+
+/** The state of an io_uring, private to direct.cpp. */
+struct DirectRing;
+
+/** A LogFile for logs written at hundreds of megabytes a second, which would otherwise fill the page cache and
+ ** push the application's own data out of memory.  The file is opened with O_DIRECT, or with F_NOCACHE where
+ ** there is no O_DIRECT, and output is collected into a few buffers whose addresses, sizes and file offsets are
+ ** all multiples of LOGOG_DIRECT_BLOCK_SIZE.  While one buffer fills, the full ones are written in the background,
+ ** so logging only waits for the disk once every buffer is in flight.
+ **
+ ** If logog is built with LOGOG_IO_URING on Linux, full buffers are submitted to an io_uring, and completions are
+ ** reaped as later buffers are queued, so that neither the logging thread nor any other blocks in write(), and a
+ ** single log can keep a fast drive busy.  Where the kernel has no io_uring, or refuses one, as it may under a
+ ** seccomp filter or with kernel.io_uring_disabled set, a thread of the target's own writes the full buffers
+ ** instead, gathering all those waiting into one pwritev().
+ **
+ ** Flush() writes the partly filled block at the end of the log padded with zeros, then truncates the file back
+ ** to the length of the log, and keeps that block in memory so that it can be written again, whole, once more
+ ** output arrives.  A reader may glimpse the padding between the two calls.  On opening, the partial block at the
+ ** end of an existing file is read back in the same way, so a DirectLogFile appends to a log like LogFile does;
+ ** but only one process may write to the file at a time.  Indexing and durable messages work as for LogFile.
+ ** Feeding a DirectLogFile from a LogBuffer suits it well, since each dump arrives as one long run of output.
+ **
+ ** File systems that refuse O_DIRECT, such as tmpfs, are written through the page cache instead, with the same
+ ** aligned writes.  Only available on POSIX systems.
+ **/
+class DirectLogFile : public LogFile
+{
+public:
+	/** Creates a DirectLogFile.
+	 ** \param sFileName The name of the file to append to.
+	 ** \param nBufferSize The size of each buffer in bytes.  It is rounded up to a multiple of
+	 ** LOGOG_DIRECT_BLOCK_SIZE.
+	 ** \param nBuffers The number of buffers.  One is filled while the rest are written; with a single buffer,
+	 ** every write waits for the disk.
+	 ** \param bUseRing If false, the writing thread is used even where io_uring is available.
+	 **/
+	DirectLogFile( const char *sFileName,
+		size_t nBufferSize = LOGOG_DEFAULT_DIRECT_BUFFER_SIZE,
+		size_t nBuffers = LOGOG_DEFAULT_DIRECT_BUFFERS,
+		bool bUseRing = true );
+
+	/** Writes any buffered output, waits for the writing thread and closes the file. */
+	virtual ~DirectLogFile();
+
+	/** Opens the file, reads back its partial last block, and sets up the io_uring or starts the writing thread. */
+	virtual int Open();
+
+	/** Is the file open with O_DIRECT or F_NOCACHE, rather than through the page cache? */
+	bool IsDirect() const;
+
+	/** Are writes submitted through io_uring, rather than by the writing thread? */
+	bool IsUsingRing() const;
+
+protected:
+	/** A full buffer waiting to be written. */
+	struct Block
+	{
+		unsigned char *m_pData;
+		LOGOG_UINT64 m_nOffset;
+		size_t m_nLength;
+	};
+
+	/** Copies output into the current buffer, queueing it for the writing thread each time it fills. */
+	virtual int InternalOutput( size_t nSize, const LOGOG_CHAR *pData );
+
+	/** Waits for the queued buffers, then writes the partial block and truncates the padding away. */
+	virtual int FlushOutput();
+
+	virtual int SyncOutput( bool bDataOnly );
+	virtual LOGOG_UINT64 GetOutputSize();
+
+	/** Returns the buffer being filled. */
+	unsigned char *GetBuffer();
+	/** Queues the current buffer, which must be full, and waits until the next one is free. */
+	void QueueBuffer();
+	/** Waits until every queued buffer has been written. */
+	void WaitForQueue();
+	/** Writes nLength bytes at nOffset, retrying after short writes and interruptions. */
+	int WriteBlocks( const unsigned char *pData, size_t nLength, LOGOG_UINT64 nOffset );
+	/** Stops the writing thread, once it has written every queued buffer. */
+	void StopWriter();
+
+	/** Sets up the io_uring.  \return false if io_uring is unavailable, or logog was built without it. */
+	bool OpenRing();
+	/** Submits the queued block for buffer nBuffer to the io_uring.  \return false if it couldn't be submitted. */
+	bool SubmitToRing( size_t nBuffer );
+	/** Handles the completions that the io_uring has posted.  If bWait is true and there are none, waits for one. */
+	void ReapRing( bool bWait );
+	void CloseRing();
+
+	/** The entry point of the writing thread, which writes every block in the queue, oldest first. */
+	static void *WriterThread( void *pvParams );
+
+	int m_nDescriptor;
+	bool m_bDirect;
+	/** The allocation holding the buffers; the first starts at the next block boundary. */
+	void *m_pAllocation;
+	size_t m_nBufferSize;
+	size_t m_nBuffers;
+	/** The index of the buffer being filled. */
+	size_t m_nCurrent;
+	/** The number of bytes in the buffer being filled. */
+	size_t m_nBuffered;
+	/** The offset in the file of the start of the buffer being filled; always a multiple of the block size. */
+	LOGOG_UINT64 m_nBufferOffset;
+
+	/** Guards the queue and the flags below, and wakes both the writing thread and the threads waiting for it. */
+	Condition m_QueueCondition;
+	/** A ring of m_nBuffers blocks, of which m_nQueued starting at m_nQueueHead are waiting to be written.  The
+	 ** block for a buffer is always at the buffer's own index.  With io_uring, blocks complete in any order, and a
+	 ** block's length is zero once it has been written.
+	 **/
+	Block *m_pQueue;
+	size_t m_nQueueHead;
+	size_t m_nQueued;
+	/** True once a write has failed.  Later flushes report the failure. */
+	bool m_bWriteFailed;
+	bool m_bWriterStop;
+	Thread m_WriterThread;
+	bool m_bWriterStarted;
+	bool m_bUseRing;
+	/** The io_uring, or NULL if the writing thread is used instead. */
+	DirectRing *m_pRing;
+
+private:
+	DirectLogFile();
+	DirectLogFile( const DirectLogFile & );
+	DirectLogFile &operator=( const DirectLogFile & );
+};
+
+}
+
+#endif // LOGOG_FLAVOR_POSIX
+
+#endif // __LOGOG_DIRECT_HPP_
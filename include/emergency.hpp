@@ -0,0 +1,84 @@
+/**
+ * \file emergency.hpp Logging that is safe to call from a signal handler, for reporting crashes.
+ */
+
+#ifndef __LOGOG_EMERGENCY_HPP__
+#define __LOGOG_EMERGENCY_HPP__
+
+namespace logog
+{
+
+class Target;
+
+/** Sets the file descriptors that emergency messages are written to, replacing the previous ones.  By default they
+ ** go to standard error only.  Open the descriptors ahead of time; a crash is no time to open files.  This function
+ ** is not signal safe, so call it at startup.
+ ** \param pDescriptors The descriptors.  Only the first LOGOG_EMERGENCY_MAX_DESCRIPTORS are used.
+ ** \param nCount The number of descriptors.
+ **/
+extern void SetEmergencyDescriptors( const int *pDescriptors, size_t nCount );
+
+/** Writes bytes to every emergency descriptor with write(2), retrying after short writes and interruptions.  Safe
+ ** to call from a signal handler.
+ **/
+extern void EmergencyWrite( const void *pData, size_t nLength );
+
+/** Adds a target to those whose buffered output is written out by EmergencyFlush().  Targets that hold output in
+ ** memory, such as LogBuffer and CompressedLogFile, add themselves when they are created and remove themselves when
+ ** they are destroyed.  Lock free.
+ ** \return false if LOGOG_EMERGENCY_MAX_TARGETS targets have already been added.
+ **/
+extern bool AddEmergencyTarget( Target *pTarget );
+
+/** Removes a target added by AddEmergencyTarget().  Lock free. */
+extern void RemoveEmergencyTarget( Target *pTarget );
+
+/** Writes the output held in memory by every target added with AddEmergencyTarget() to the emergency descriptors,
+ ** so that it is not lost when the process dies.  Safe to call from a signal handler.  The output is written as it
+ ** stands, even if another thread is in the middle of changing it, so the last message may be cut short.
+ **/
+extern void EmergencyFlush();
+
+/** Writes "emergency: " and the message, and a new line, to the emergency descriptors, and then calls
+ ** EmergencyFlush().  Safe to call from a signal handler.
+ **/
+extern void EmergencyLog( const char *sMessage );
+
+/** Builds a message for the emergency descriptors in a fixed buffer, without allocating memory, taking locks or
+ ** calling the printf family.  Construct it on the stack, in a signal handler for instance:
+ ** \code
+ ** EmergencyMessage msg;
+ ** msg.Append( "caught signal " ).AppendInteger( nSignal ).Append( " at " ).AppendHex( nAddress );
+ ** msg.Write();
+ ** \endcode
+ ** Text beyond LOGOG_EMERGENCY_MESSAGE_SIZE bytes is dropped.
+ **/
+class EmergencyMessage
+{
+public:
+	/** Starts a message with "emergency: ". */
+	EmergencyMessage();
+
+	/** Appends a string. */
+	EmergencyMessage &Append( const char *sText );
+	/** Appends a signed decimal integer. */
+	EmergencyMessage &AppendInteger( LOGOG_INT64 nValue );
+	/** Appends an unsigned hexadecimal integer, with a leading 0x. */
+	EmergencyMessage &AppendHex( LOGOG_UINT64 nValue );
+
+	/** Returns the message built so far.  It is always null terminated. */
+	const char *c_str() const;
+	/** Returns the length of the message built so far. */
+	size_t size() const;
+
+	/** Writes the message and a new line to the emergency descriptors.  It does not call EmergencyFlush(). */
+	void Write() const;
+
+protected:
+	char m_vBuffer[ LOGOG_EMERGENCY_MESSAGE_SIZE ];
+	size_t m_nLength;
+};
+
+}
+
+#endif // __LOGOG_EMERGENCY_HPP_
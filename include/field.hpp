@@ -0,0 +1,239 @@
+/**
+ * \file field.hpp Structured key/value fields attached to messages.
+ */
+
+#ifndef __LOGOG_FIELD_HPP__
+#define __LOGOG_FIELD_HPP__
+
+namespace logog
+{
+
+/** The type of value held by a Field. */
+enum FieldType
+{
+	FIELD_INTEGER,
+	FIELD_UNSIGNED,
+	FIELD_FLOAT,
+	FIELD_BOOLEAN,
+	FIELD_STRING
+};
+
+/** A string value of a Field.  The characters are not copied, and need not be null-terminated. */
+struct FieldString
+{
+	const LOGOG_CHAR *m_pChars;
+	size_t m_nLength;
+};
+
+/** One typed key/value pair.  Only the union member selected by m_Type is valid. */
+struct Field
+{
+	const LOGOG_CHAR *m_sKey;
+	FieldType m_Type;
+	union
+	{
+		LOGOG_INT64 m_nInteger;
+		LOGOG_UINT64 m_nUnsigned;
+		double m_dFloat;
+		bool m_bBoolean;
+		FieldString m_String;
+	};
+};
+
+/** A compact record of up to LOGOG_MAX_FIELDS typed key/value pairs, attached to a message for the duration of
+ ** a single logging call.  Adding a field stores its key, its type and its value, and nothing else: no text is
+ ** rendered unless a formatter asks for it, and nothing is allocated.  The record refers to its keys and to its
+ ** string values without copying them, so they need only stay valid until the logging call returns.
+ **
+ ** Fields are normally attached with the *_KV macros, such as
+ ** \code INFO_KV( _LG("request done"), _LG("latency_us"), nLatency, _LG("status"), nCode ); \endcode
+ ** Values may be of any integer, floating point or boolean type, a LOGOG_CHAR string, or a LOGOG_STRING.
+ ** \sa Topic::Fields, FieldFilter
+ **/
+class FieldSet : public Object
+{
+public:
+	FieldSet();
+
+	/** Returns the number of fields in this record. */
+	size_t Count() const;
+
+	/** Returns the field at nIndex, which must be less than Count(). */
+	const Field &Get( size_t nIndex ) const;
+
+	/** Returns the first field with the given key, or NULL if there is none. */
+	const Field *Find( const LOGOG_CHAR *sKey ) const;
+
+	/** Adds one field; if the record is already full, the field is dropped. */
+	void AddValue( const LOGOG_CHAR *sKey, int nValue );
+	void AddValue( const LOGOG_CHAR *sKey, unsigned int nValue );
+	void AddValue( const LOGOG_CHAR *sKey, long nValue );
+	void AddValue( const LOGOG_CHAR *sKey, unsigned long nValue );
+	void AddValue( const LOGOG_CHAR *sKey, long long nValue );
+	void AddValue( const LOGOG_CHAR *sKey, unsigned long long nValue );
+	void AddValue( const LOGOG_CHAR *sKey, double dValue );
+	void AddValue( const LOGOG_CHAR *sKey, long double dValue );
+	void AddValue( const LOGOG_CHAR *sKey, bool bValue );
+	void AddValue( const LOGOG_CHAR *sKey, const LOGOG_CHAR *sValue );
+	void AddValue( const LOGOG_CHAR *sKey, const LOGOG_STRING &sValue );
+
+	/** Adds key/value pairs in order.  These overloads take from one to eight pairs, so that the *_KV macros
+	 ** can pass their arguments straight through.
+	 **/
+	template < class T1 >
+	void Add( const LOGOG_CHAR *sKey1, const T1 &value1 )
+	{
+		AddValue( sKey1, value1 );
+	}
+
+	template < class T1, class T2 >
+	void Add( const LOGOG_CHAR *sKey1, const T1 &value1,
+		const LOGOG_CHAR *sKey2, const T2 &value2 )
+	{
+		AddValue( sKey1, value1 );
+		AddValue( sKey2, value2 );
+	}
+
+	template < class T1, class T2, class T3 >
+	void Add( const LOGOG_CHAR *sKey1, const T1 &value1,
+		const LOGOG_CHAR *sKey2, const T2 &value2,
+		const LOGOG_CHAR *sKey3, const T3 &value3 )
+	{
+		AddValue( sKey1, value1 );
+		AddValue( sKey2, value2 );
+		AddValue( sKey3, value3 );
+	}
+
+	template < class T1, class T2, class T3, class T4 >
+	void Add( const LOGOG_CHAR *sKey1, const T1 &value1,
+		const LOGOG_CHAR *sKey2, const T2 &value2,
+		const LOGOG_CHAR *sKey3, const T3 &value3,
+		const LOGOG_CHAR *sKey4, const T4 &value4 )
+	{
+		AddValue( sKey1, value1 );
+		AddValue( sKey2, value2 );
+		AddValue( sKey3, value3 );
+		AddValue( sKey4, value4 );
+	}
+
+	template < class T1, class T2, class T3, class T4, class T5 >
+	void Add( const LOGOG_CHAR *sKey1, const T1 &value1,
+		const LOGOG_CHAR *sKey2, const T2 &value2,
+		const LOGOG_CHAR *sKey3, const T3 &value3,
+		const LOGOG_CHAR *sKey4, const T4 &value4,
+		const LOGOG_CHAR *sKey5, const T5 &value5 )
+	{
+		AddValue( sKey1, value1 );
+		AddValue( sKey2, value2 );
+		AddValue( sKey3, value3 );
+		AddValue( sKey4, value4 );
+		AddValue( sKey5, value5 );
+	}
+
+	template < class T1, class T2, class T3, class T4, class T5, class T6 >
+	void Add( const LOGOG_CHAR *sKey1, const T1 &value1,
+		const LOGOG_CHAR *sKey2, const T2 &value2,
+		const LOGOG_CHAR *sKey3, const T3 &value3,
+		const LOGOG_CHAR *sKey4, const T4 &value4,
+		const LOGOG_CHAR *sKey5, const T5 &value5,
+		const LOGOG_CHAR *sKey6, const T6 &value6 )
+	{
+		AddValue( sKey1, value1 );
+		AddValue( sKey2, value2 );
+		AddValue( sKey3, value3 );
+		AddValue( sKey4, value4 );
+		AddValue( sKey5, value5 );
+		AddValue( sKey6, value6 );
+	}
+
+	template < class T1, class T2, class T3, class T4, class T5, class T6, class T7 >
+	void Add( const LOGOG_CHAR *sKey1, const T1 &value1,
+		const LOGOG_CHAR *sKey2, const T2 &value2,
+		const LOGOG_CHAR *sKey3, const T3 &value3,
+		const LOGOG_CHAR *sKey4, const T4 &value4,
+		const LOGOG_CHAR *sKey5, const T5 &value5,
+		const LOGOG_CHAR *sKey6, const T6 &value6,
+		const LOGOG_CHAR *sKey7, const T7 &value7 )
+	{
+		AddValue( sKey1, value1 );
+		AddValue( sKey2, value2 );
+		AddValue( sKey3, value3 );
+		AddValue( sKey4, value4 );
+		AddValue( sKey5, value5 );
+		AddValue( sKey6, value6 );
+		AddValue( sKey7, value7 );
+	}
+
+	template < class T1, class T2, class T3, class T4, class T5, class T6, class T7, class T8 >
+	void Add( const LOGOG_CHAR *sKey1, const T1 &value1,
+		const LOGOG_CHAR *sKey2, const T2 &value2,
+		const LOGOG_CHAR *sKey3, const T3 &value3,
+		const LOGOG_CHAR *sKey4, const T4 &value4,
+		const LOGOG_CHAR *sKey5, const T5 &value5,
+		const LOGOG_CHAR *sKey6, const T6 &value6,
+		const LOGOG_CHAR *sKey7, const T7 &value7,
+		const LOGOG_CHAR *sKey8, const T8 &value8 )
+	{
+		AddValue( sKey1, value1 );
+		AddValue( sKey2, value2 );
+		AddValue( sKey3, value3 );
+		AddValue( sKey4, value4 );
+		AddValue( sKey5, value5 );
+		AddValue( sKey6, value6 );
+		AddValue( sKey7, value7 );
+		AddValue( sKey8, value8 );
+	}
+
+protected:
+	/** Claims the next free field, or returns NULL if the record is full. */
+	Field *Next( const LOGOG_CHAR *sKey, FieldType type );
+
+	Field m_vFields[ LOGOG_MAX_FIELDS ];
+	size_t m_nCount;
+};
+
+/** A filter that forwards only the messages that carry a particular field, and optionally only those whose value
+ ** for that field matches.  Messages are routed to filters when they are first created, before they carry any
+ ** fields, so this filter subscribes to all messages and checks their fields as each one passes through, as
+ ** FilterDefault does with levels.  As with any other filter, targets receive its messages in addition to the
+ ** messages of the default filter; unsubscribe a target from the default filter if it should receive only
+ ** these.
+ **/
+class FieldFilter : public Filter
+{
+	typedef Filter super;
+public:
+	/** Creates a filter that forwards messages carrying a field named sKey.  The key is copied. */
+	FieldFilter( const LOGOG_CHAR *sKey );
+
+	/** Forwards only messages whose field is a string equal to sValue.  The value is copied. */
+	void MatchString( const LOGOG_CHAR *sValue );
+
+	/** Forwards only messages whose field is an integer, unsigned or boolean field equal to nValue. */
+	void MatchInteger( LOGOG_INT64 nValue );
+
+	/** Forwards messages carrying the field, whatever its value.  This is the default. */
+	void MatchAny();
+
+	virtual int Receive( const Topic &node );
+
+protected:
+	/** Returns true if the field satisfies this filter. */
+	bool Matches( const Field &field ) const;
+
+	enum MatchType
+	{
+		MATCH_ANY,
+		MATCH_STRING,
+		MATCH_INTEGER
+	};
+
+	LOGOG_STRING m_sKey;
+	MatchType m_Match;
+	LOGOG_STRING m_sValue;
+	LOGOG_INT64 m_nValue;
+};
+
+}
+
+#endif // __LOGOG_FIELD_HPP_
@@ -0,0 +1,151 @@
+/**
+ * \file flight.hpp A target that keeps the most recent records in a memory-mapped file, so that they survive a
+ * crash, and a reader that recovers them.
+ */
+
+#ifndef __LOGOG_FLIGHT_HPP__
+#define __LOGOG_FLIGHT_HPP__
+
+namespace logog
+{
+
+/** The eight bytes that begin a flight recorder file. */
+#define LOGOG_FLIGHT_MAGIC "\x89LGF\r\n\x1a\n"
+/** The length of LOGOG_FLIGHT_MAGIC. */
+#define LOGOG_FLIGHT_MAGIC_LENGTH 8
+/** The version of the flight recorder layout written by this release. */
+#define LOGOG_FLIGHT_VERSION 1
+/** The value that begins the header of every record in the ring. */
+#define LOGOG_FLIGHT_RECORD_MARKER 0x4c47d52aU
+
+/** The start of a flight recorder file.  The ring of records follows immediately after it.  The header and the
+ ** records are in the byte order of the machine that wrote them.
+ **/
+struct FlightRecorderHeader
+{
+	char m_vMagic[ LOGOG_FLIGHT_MAGIC_LENGTH ];
+	unsigned int m_nVersion;
+	/** The size of this header, and so the offset of the ring in the file. */
+	unsigned int m_nHeaderSize;
+	/** The size of the ring in bytes; a multiple of eight. */
+	LOGOG_UINT64 m_nRingSize;
+	/** The number of bytes ever written to the ring.  The ring holds the bytes from m_nCursor - m_nRingSize up to
+	 ** m_nCursor, at offsets taken modulo m_nRingSize.  Stored with release semantics after each record is
+	 ** complete.
+	 **/
+	LOGOG_UINT64 m_nCursor;
+	/** The number of records ever written. */
+	LOGOG_UINT64 m_nRecords;
+	LOGOG_UINT64 m_vReserved[ 3 ];
+};
+
+/** A target that keeps the last few megabytes of records in a ring inside a shared, file-backed memory mapping.
+ ** The operating system owns the mapped pages, so whatever was written is still in the file after the process
+ ** crashes, even though nothing was ever flushed.  Writing a record is a memcpy into the mapping and a store of
+ ** the cursor; there are no system calls.  Each record in the ring is an eight byte header, holding
+ ** LOGOG_FLIGHT_RECORD_MARKER and the record's length, followed by the record, padded to a multiple of eight.
+ **
+ ** An existing recorder file of the same size is continued rather than cleared, so the records of a crashed run
+ ** are kept until they are overwritten.  Use FlightRecorderReader or logog-cat to recover the records.  Only the
+ ** file survives a crash of the whole machine, and then only as far as the kernel had written it back.
+ **/
+class FlightRecorder : public Target
+{
+public:
+	/** Creates a FlightRecorder.
+	 ** \param sFileName The name of the file to map.  It is created if it doesn't exist.
+	 ** \param nSize The size of the ring in bytes.  It is rounded up to a multiple of eight.
+	 **/
+	FlightRecorder( const char *sFileName, size_t nSize = LOGOG_DEFAULT_FLIGHT_RECORDER_SIZE );
+
+	/** Unmaps the file. */
+	virtual ~FlightRecorder();
+
+	/** Copies the message into the ring, overwriting the oldest records.  Messages longer than the ring are
+	 ** truncated.
+	 **/
+	virtual int Output( const LOGOG_STRING &data );
+
+	/** Waits for the mapped pages to be written back to the file.  Not needed for the records to survive a crash
+	 ** of the process, only of the machine.
+	 **/
+	virtual int Sync();
+
+	/** Was the file created and mapped successfully? */
+	bool IsOpen() const;
+
+protected:
+	/** Creates and maps the file, and initializes the header unless the file already holds a ring of this size. */
+	bool Map( const char *sFileName );
+	void Unmap();
+
+	/** The mapping; the header, followed by the ring. */
+	unsigned char *m_pMapping;
+	size_t m_nMappingSize;
+	FlightRecorderHeader *m_pHeader;
+	unsigned char *m_pRing;
+	size_t m_nRingSize;
+	/** A private copy of the header's cursor, so that the hot path never reads the shared mapping. */
+	LOGOG_UINT64 m_nCursor;
+#ifdef LOGOG_FLAVOR_WINDOWS
+	HANDLE m_hFile;
+	HANDLE m_hMapping;
+#else // LOGOG_FLAVOR_WINDOWS
+	int m_nFile;
+#endif // LOGOG_FLAVOR_WINDOWS
+
+private:
+	FlightRecorder();
+	FlightRecorder( const FlightRecorder & );
+	FlightRecorder &operator=( const FlightRecorder & );
+};
+
+/** Recovers the records in a flight recorder file, oldest first.  It can also search a core dump for the mapping,
+ ** so long as the core includes shared file mappings; on Linux, that needs bit 3 of /proc/PID/coredump_filter.
+ **/
+class FlightRecorderReader : public Object
+{
+public:
+	FlightRecorderReader();
+
+	/** Reads a flight recorder file.
+	 ** \param sFileName The file to read.
+	 ** \param bSearch If false, the recorder must start at the beginning of the file.  If true, the file is
+	 ** searched for a recorder at any page-aligned offset, as in a core dump.
+	 ** \return true if a recorder was found.
+	 **/
+	bool Open( const char *sFileName, bool bSearch = false );
+
+	/** Forgets the records read by Open(). */
+	void Close();
+
+	/** Returns the next record, oldest first.  The pointer is valid until the next call.
+	 ** \return false when there are no more records.
+	 **/
+	bool Next( const unsigned char *&pData, size_t &nLength );
+
+	/** Returns the number of records ever written to the recorder, including those that have been overwritten. */
+	LOGOG_UINT64 GetRecordsWritten() const;
+
+protected:
+	typedef LOGOG_VECTOR< unsigned char, Allocator< unsigned char > > BytesType;
+
+	/** Copies nLength bytes from the ring, starting at stream position nPosition, into pOut. */
+	void CopyFromRing( LOGOG_UINT64 nPosition, unsigned char *pOut, size_t nLength ) const;
+	/** Reads the record header at stream position nPosition.  \return false if it isn't a plausible record. */
+	bool ReadRecordHeader( LOGOG_UINT64 nPosition, size_t &nLength ) const;
+	/** Finds the oldest complete record in the ring, by finding the first record header from which the chain of
+	 ** records ends exactly at the cursor.  The oldest records may have been partly overwritten.
+	 **/
+	LOGOG_UINT64 FindOldestRecord() const;
+
+	BytesType m_vRing;
+	BytesType m_vRecord;
+	LOGOG_UINT64 m_nCursor;
+	LOGOG_UINT64 m_nPosition;
+	LOGOG_UINT64 m_nRecordsWritten;
+};
+
+}
+
+#endif // __LOGOG_FLIGHT_HPP_
@@ -0,0 +1,556 @@
+/**
+ * \file format.hpp Rendering of printf-style messages, and a type-checked front end that parses format strings
+ * at compile time.
+ */
+
+#ifndef __LOGOG_FORMAT_HPP__
+#define __LOGOG_FORMAT_HPP__
+
+namespace logog
+{
+
+/** \def LOGOG_TYPED_FORMAT
+ ** Define this macro to route the arguments of the logging macros through TypedFormat() instead of a C varargs
+ ** call to Topic::Format().  The format string of each call is then parsed by the compiler, a mismatch between
+ ** the format string and the arguments is a compile-time error, and each argument is rendered by code specific
+ ** to its type, without a run-time parse of the format string.  Format strings must then be string literals.
+ ** Requires a C++14 compiler.
+ **/
+
+/** Flags that may precede the width of a conversion in a format string. */
+enum
+{
+	FORMAT_FLAG_LEFT = 1,		/**< '-' */
+	FORMAT_FLAG_PLUS = 2,		/**< '+' */
+	FORMAT_FLAG_SPACE = 4,		/**< ' ' */
+	FORMAT_FLAG_ALTERNATE = 8,	/**< '#' */
+	FORMAT_FLAG_ZERO = 16		/**< '0' */
+};
+
+/** The argument index of a conversion that consumes no argument, i.e. "%%". */
+#define LOGOG_FORMAT_NO_ARGUMENT ((size_t)-1)
+
+/** One conversion, such as "%-8.3f", within a format string. */
+struct FormatSpec
+{
+	/** The offset of the '%' that begins this conversion. */
+	size_t m_nStart;
+	/** The offset of the first character after this conversion. */
+	size_t m_nEnd;
+	/** The index of the argument that this conversion renders, or LOGOG_FORMAT_NO_ARGUMENT. */
+	size_t m_nArgument;
+	/** A logical OR of the FORMAT_FLAG_* values. */
+	int m_nFlags;
+	/** The minimum field width, or -1 if none was given. */
+	int m_nWidth;
+	/** The precision, or -1 if none was given. */
+	int m_nPrecision;
+	/** The conversion character, such as 'd' or 's'.  Length modifiers are not recorded, since arguments are
+	 ** rendered according to their actual types.  Zero if the conversion is incomplete.
+	 **/
+	LOGOG_CHAR m_cConversion;
+};
+
+/** Appends rendered text to a string, growing the string as needed.  The string remains null-terminated after
+ ** every call.
+ **/
+class FormatWriter
+{
+public:
+	/** Creates a writer that appends to s. */
+	FormatWriter( LOGOG_STRING &s );
+
+	/** Appends nCount characters. */
+	void Put( const LOGOG_CHAR *pChars, size_t nCount )
+	{
+		if ( m_String.size() + nCount >= m_String.capacity() )
+			Reserve( nCount );
+
+		m_String.append( pChars, nCount );
+	}
+
+	/** Appends one character. */
+	void Put( LOGOG_CHAR c )
+	{
+		Put( &c, 1 );
+	}
+
+	/** Appends a null-terminated string. */
+	void Put( const LOGOG_CHAR *sChars );
+
+	/** Appends nCount copies of c. */
+	void PutRepeated( LOGOG_CHAR c, size_t nCount );
+
+	/** Appends an unsigned integer in decimal. */
+	void PutDecimal( LOGOG_UINT64 nValue );
+
+	/** Appends nCount characters as a quoted JSON string, escaping quotes, backslashes and control characters.
+	 ** Runs of characters that need no escaping are found with a vectorized scan where one is available, and
+	 ** copied in bulk.
+	 **/
+	void PutJSONString( const LOGOG_CHAR *pChars, size_t nCount );
+
+	/** Appends nCount characters as a logfmt value.  The value is copied as is unless it is empty or contains
+	 ** a space, an '=', a quote, a backslash or a control character, in which case it is quoted and escaped as
+	 ** a JSON string.
+	 **/
+	void PutLogfmtValue( const LOGOG_CHAR *pChars, size_t nCount );
+
+	/** Appends nCount narrow characters, widening them if LOGOG_CHAR is wide. */
+	void PutNarrow( const char *pChars, size_t nCount );
+
+	/** Appends nCount wide characters, narrowing them if LOGOG_CHAR is narrow.  Characters that do not fit are
+	 ** replaced by '?'.
+	 **/
+	void PutWide( const wchar_t *pChars, size_t nCount );
+
+	/** Renders an integer of the given magnitude and sign according to spec.  The base and case are taken from
+	 ** the conversion character.
+	 **/
+	void PutInteger( LOGOG_UINT64 nMagnitude, bool bNegative, const FormatSpec &spec );
+
+	/** Renders a floating point value according to spec. */
+	void PutFloat( double dValue, const FormatSpec &spec );
+	void PutFloat( long double dValue, const FormatSpec &spec );
+
+	/** Renders a pointer according to spec. */
+	void PutPointer( const void *pValue, const FormatSpec &spec );
+
+	/** Renders a character according to spec. */
+	void PutCharacter( LOGOG_CHAR c, const FormatSpec &spec );
+
+	/** Renders a null-terminated string according to spec.  A NULL pointer is rendered as "(null)". */
+	void PutString( const char *pString, const FormatSpec &spec );
+	void PutString( const wchar_t *pString, const FormatSpec &spec );
+	void PutString( const LOGOG_STRING &s, const FormatSpec &spec );
+
+protected:
+	/** Grows the string so that at least nCount more characters and a null fit. */
+	void Reserve( size_t nCount );
+
+	/** Adds padding around nLength characters of a field, according to spec.  Call with bBefore true before
+	 ** the field is written and with bBefore false afterwards.
+	 **/
+	void Pad( size_t nLength, const FormatSpec &spec, bool bBefore );
+
+	/** Appends nCount characters with JSON escaping, but without surrounding quotes. */
+	void PutEscaped( const LOGOG_CHAR *pChars, size_t nCount );
+
+	/** Renders a value with snprintf, using a conversion rebuilt from spec. */
+	void PutSnprintf( const FormatSpec &spec, const char *sModifier, char cConversion, ... );
+
+	LOGOG_STRING &m_String;
+
+private:
+	FormatWriter( const FormatWriter & );
+	FormatWriter &operator=( const FormatWriter & );
+};
+
+}
+
+#if defined( LOGOG_TYPED_FORMAT ) || defined( LOGOG_DOXYGEN )
+#if ( __cplusplus < 201402L ) && !( defined( _MSC_VER ) && ( _MSC_VER >= 1910 ))
+#error "LOGOG_TYPED_FORMAT requires a C++14 compiler"
+#endif
+#endif // LOGOG_TYPED_FORMAT
+
+#if ( __cplusplus >= 201402L ) || ( defined( _MSC_VER ) && ( _MSC_VER >= 1910 ))
+/** Defined if this compiler can use TypedFormat(). */
+#define LOGOG_HAS_TYPED_FORMAT 1
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace logog
+{
+
+/** The kinds of argument that a conversion may accept. */
+enum
+{
+	FORMAT_KIND_NONE = 0,
+	FORMAT_KIND_INTEGER = 1,
+	FORMAT_KIND_FLOAT = 2,
+	FORMAT_KIND_STRING = 4,
+	FORMAT_KIND_POINTER = 8
+};
+
+/** Returns the length of a null-terminated format string. */
+constexpr size_t FormatLength( const LOGOG_CHAR *s )
+{
+	size_t n = 0;
+	while ( s[ n ] != 0 )
+		n++;
+	return n;
+}
+
+/** Returns the kinds of argument accepted by a conversion character, or FORMAT_KIND_NONE if the conversion
+ ** is not supported.  "%n" is deliberately not supported.
+ **/
+constexpr int FormatConversionKinds( LOGOG_CHAR c )
+{
+	switch ( c )
+	{
+	case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+		return FORMAT_KIND_INTEGER;
+	case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+		return FORMAT_KIND_FLOAT;
+	case 's':
+		return FORMAT_KIND_STRING;
+	case 'p':
+		return FORMAT_KIND_POINTER;
+	default:
+		return FORMAT_KIND_NONE;
+	}
+}
+
+/** Parses the conversion that begins at s[ nStart ], which must be a '%'. */
+constexpr FormatSpec FormatParseSpecAt( const LOGOG_CHAR *s, size_t nStart, size_t nArgument )
+{
+	FormatSpec spec = { nStart, nStart + 1, nArgument, 0, -1, -1, 0 };
+	size_t i = nStart + 1;
+
+	for ( ; ; i++ )
+	{
+		if ( s[ i ] == '-' )
+			spec.m_nFlags |= FORMAT_FLAG_LEFT;
+		else if ( s[ i ] == '+' )
+			spec.m_nFlags |= FORMAT_FLAG_PLUS;
+		else if ( s[ i ] == ' ' )
+			spec.m_nFlags |= FORMAT_FLAG_SPACE;
+		else if ( s[ i ] == '#' )
+			spec.m_nFlags |= FORMAT_FLAG_ALTERNATE;
+		else if ( s[ i ] == '0' )
+			spec.m_nFlags |= FORMAT_FLAG_ZERO;
+		else
+			break;
+	}
+
+	if ( s[ i ] >= '0' && s[ i ] <= '9' )
+	{
+		spec.m_nWidth = 0;
+		while ( s[ i ] >= '0' && s[ i ] <= '9' )
+			spec.m_nWidth = spec.m_nWidth * 10 + ( s[ i++ ] - '0' );
+	}
+
+	if ( s[ i ] == '.' )
+	{
+		i++;
+		spec.m_nPrecision = 0;
+		while ( s[ i ] >= '0' && s[ i ] <= '9' )
+			spec.m_nPrecision = spec.m_nPrecision * 10 + ( s[ i++ ] - '0' );
+	}
+
+	while ( s[ i ] == 'h' || s[ i ] == 'l' || s[ i ] == 'L' || s[ i ] == 'q' || s[ i ] == 'j' ||
+			s[ i ] == 'z' || s[ i ] == 't' )
+		i++;
+
+	/* A '*' width or precision is left here, and so is reported as an unsupported conversion. */
+	spec.m_cConversion = s[ i ];
+	spec.m_nEnd = ( s[ i ] != 0 ) ? i + 1 : i;
+
+	if ( spec.m_cConversion == '%' )
+		spec.m_nArgument = LOGOG_FORMAT_NO_ARGUMENT;
+
+	return spec;
+}
+
+/** Returns conversion number nSpec within a format string, counting "%%" as a conversion. */
+constexpr FormatSpec FormatParseSpec( const LOGOG_CHAR *s, size_t nSpec )
+{
+	size_t nArgument = 0;
+	size_t i = 0;
+
+	for ( ; ; )
+	{
+		while ( s[ i ] != 0 && s[ i ] != '%' )
+			i++;
+
+		FormatSpec spec = FormatParseSpecAt( s, i, nArgument );
+
+		if ( nSpec-- == 0 || s[ i ] == 0 )
+			return spec;
+
+		if ( spec.m_nArgument != LOGOG_FORMAT_NO_ARGUMENT )
+			nArgument++;
+
+		i = spec.m_nEnd;
+	}
+}
+
+/** Returns the number of conversions in a format string, counting "%%" as a conversion. */
+constexpr size_t FormatSpecCount( const LOGOG_CHAR *s )
+{
+	size_t nCount = 0;
+
+	for ( size_t i = 0; s[ i ] != 0; )
+	{
+		if ( s[ i ] == '%' )
+		{
+			i = FormatParseSpecAt( s, i, 0 ).m_nEnd;
+			nCount++;
+		}
+		else
+			i++;
+	}
+
+	return nCount;
+}
+
+/** Returns the number of arguments consumed by a format string. */
+constexpr size_t FormatArgumentCount( const LOGOG_CHAR *s )
+{
+	size_t nCount = 0;
+
+	for ( size_t k = 0; k < FormatSpecCount( s ); k++ )
+		if ( FormatParseSpec( s, k ).m_nArgument != LOGOG_FORMAT_NO_ARGUMENT )
+			nCount++;
+
+	return nCount;
+}
+
+/** Returns true iff every conversion in a format string is complete and supported. */
+constexpr bool FormatIsValid( const LOGOG_CHAR *s )
+{
+	for ( size_t k = 0; k < FormatSpecCount( s ); k++ )
+	{
+		LOGOG_CHAR c = FormatParseSpec( s, k ).m_cConversion;
+		if ( c != '%' && FormatConversionKinds( c ) == FORMAT_KIND_NONE )
+			return false;
+	}
+
+	return true;
+}
+
+/** The kind of argument that a type represents. */
+template< class T, class Enable = void >
+struct FormatArgumentKind
+{
+	static constexpr int value = FORMAT_KIND_NONE;
+};
+
+template< class T >
+struct FormatArgumentKind< T, typename std::enable_if< std::is_integral< T >::value || std::is_enum< T >::value >::type >
+{
+	static constexpr int value = FORMAT_KIND_INTEGER;
+};
+
+template< class T >
+struct FormatArgumentKind< T, typename std::enable_if< std::is_floating_point< T >::value >::type >
+{
+	static constexpr int value = FORMAT_KIND_FLOAT;
+};
+
+template< class T >
+struct FormatArgumentKind< T *, void >
+{
+	static constexpr int value = FORMAT_KIND_POINTER;
+};
+
+template<> struct FormatArgumentKind< char *, void > { static constexpr int value = FORMAT_KIND_STRING | FORMAT_KIND_POINTER; };
+template<> struct FormatArgumentKind< const char *, void > { static constexpr int value = FORMAT_KIND_STRING | FORMAT_KIND_POINTER; };
+template<> struct FormatArgumentKind< wchar_t *, void > { static constexpr int value = FORMAT_KIND_STRING | FORMAT_KIND_POINTER; };
+template<> struct FormatArgumentKind< const wchar_t *, void > { static constexpr int value = FORMAT_KIND_STRING | FORMAT_KIND_POINTER; };
+template<> struct FormatArgumentKind< std::nullptr_t, void > { static constexpr int value = FORMAT_KIND_POINTER; };
+template<> struct FormatArgumentKind< LOGOG_STRING, void > { static constexpr int value = FORMAT_KIND_STRING; };
+
+/** Returns true iff the type of every argument that a format string consumes is one that its conversion accepts.
+ ** An integer is not accepted for a floating point conversion, nor a floating point value for an integer one,
+ ** since printf would read either as the wrong type.  Missing arguments are not checked here.
+ **/
+template< class... Args >
+constexpr bool FormatArgumentsMatch( const LOGOG_CHAR *s )
+{
+	const int vKinds[] = { FormatArgumentKind< typename std::decay< Args >::type >::value..., FORMAT_KIND_NONE };
+
+	for ( size_t k = 0; k < FormatSpecCount( s ); k++ )
+	{
+		FormatSpec spec = FormatParseSpec( s, k );
+
+		if (( spec.m_nArgument != LOGOG_FORMAT_NO_ARGUMENT ) && ( spec.m_nArgument < sizeof...( Args )) &&
+			(( FormatConversionKinds( spec.m_cConversion ) & vKinds[ spec.m_nArgument ] ) == 0 ))
+			return false;
+	}
+
+	return true;
+}
+
+/** Renders an argument of integral type. */
+template< class T >
+inline typename std::enable_if< std::is_integral< T >::value >::type
+FormatArgument( FormatWriter &writer, const FormatSpec &spec, T value )
+{
+	/* Render the value as printf would, after the default argument promotions. */
+	typedef decltype( +value ) Promoted;
+	typedef typename std::make_signed< Promoted >::type Signed;
+	typedef typename std::make_unsigned< Promoted >::type Unsigned;
+
+	switch ( spec.m_cConversion )
+	{
+	case 'c':
+		writer.PutCharacter( (LOGOG_CHAR)value, spec );
+		break;
+	case 'd':
+	case 'i':
+		{
+			Signed nValue = (Signed)value;
+			if ( nValue < 0 )
+				writer.PutInteger( (LOGOG_UINT64)0 - (LOGOG_UINT64)(long long)nValue, true, spec );
+			else
+				writer.PutInteger( (LOGOG_UINT64)nValue, false, spec );
+		}
+		break;
+	default:
+		writer.PutInteger( (LOGOG_UINT64)(Unsigned)value, false, spec );
+		break;
+	}
+}
+
+/** Renders an argument of enumerated type as its underlying integer. */
+template< class T >
+inline typename std::enable_if< std::is_enum< T >::value >::type
+FormatArgument( FormatWriter &writer, const FormatSpec &spec, T value )
+{
+	FormatArgument( writer, spec, (typename std::underlying_type< T >::type)value );
+}
+
+inline void FormatArgument( FormatWriter &writer, const FormatSpec &spec, double value )
+{
+	writer.PutFloat( value, spec );
+}
+
+inline void FormatArgument( FormatWriter &writer, const FormatSpec &spec, long double value )
+{
+	writer.PutFloat( value, spec );
+}
+
+inline void FormatArgument( FormatWriter &writer, const FormatSpec &spec, const char *value )
+{
+	if ( spec.m_cConversion == 's' )
+		writer.PutString( value, spec );
+	else
+		writer.PutPointer( value, spec );
+}
+
+inline void FormatArgument( FormatWriter &writer, const FormatSpec &spec, const wchar_t *value )
+{
+	if ( spec.m_cConversion == 's' )
+		writer.PutString( value, spec );
+	else
+		writer.PutPointer( value, spec );
+}
+
+inline void FormatArgument( FormatWriter &writer, const FormatSpec &spec, const LOGOG_STRING &value )
+{
+	writer.PutString( value, spec );
+}
+
+inline void FormatArgument( FormatWriter &writer, const FormatSpec &spec, const void *value )
+{
+	writer.PutPointer( value, spec );
+}
+
+inline void FormatArgument( FormatWriter &writer, const FormatSpec &spec, std::nullptr_t )
+{
+	writer.PutPointer( NULL, spec );
+}
+
+/** Passes arguments through unchanged, except that arrays decay to pointers. */
+template< class T >
+inline const T &FormatDecay( const T &value )
+{
+	return value;
+}
+
+template< class T, size_t N >
+inline const T *FormatDecay( const T ( &value )[ N ] )
+{
+	return value;
+}
+
+/** Renders the conversion of a format string that consumes argument A, or a '%' for "%%".  Conversions whose
+ ** argument is missing render nothing; they have already been reported by a static_assert.
+ **/
+template< size_t A, class Tuple, bool bHasArgument = ( A < std::tuple_size< Tuple >::value ) >
+struct FormatSlot
+{
+	static void Render( FormatWriter &writer, const FormatSpec &spec, const Tuple &args )
+	{
+		FormatArgument( writer, spec, FormatDecay( std::get< A >( args )));
+	}
+};
+
+template< size_t A, class Tuple >
+struct FormatSlot< A, Tuple, false >
+{
+	static void Render( FormatWriter &writer, const FormatSpec &spec, const Tuple & )
+	{
+		if ( spec.m_nArgument == LOGOG_FORMAT_NO_ARGUMENT )
+			writer.Put( (LOGOG_CHAR)'%' );
+	}
+};
+
+/** Renders conversion K of format F, preceded by the literal text between it and the previous conversion. */
+template< class F, size_t K, class Tuple >
+inline void FormatRenderSegment( FormatWriter &writer, const Tuple &args )
+{
+	constexpr FormatSpec spec = FormatParseSpec( F::Get(), K );
+	constexpr size_t nPrevious = ( K == 0 ) ? 0 : FormatParseSpec( F::Get(), K - 1 ).m_nEnd;
+
+	if ( spec.m_nStart > nPrevious )
+		writer.Put( F::Get() + nPrevious, spec.m_nStart - nPrevious );
+
+	FormatSlot< spec.m_nArgument, Tuple >::Render( writer, spec, args );
+}
+
+template< class F, class Tuple, size_t... K >
+inline void FormatRenderSegments( FormatWriter &writer, const Tuple &args, std::index_sequence< K... > )
+{
+	int vUnused[] = { 0, ( FormatRenderSegment< F, K >( writer, args ), 0 )... };
+	(void)vUnused;
+}
+
+/** Renders a format string and its arguments, appending them to out.  F is a type with a constexpr static
+ ** member function Get() that returns the format string.  The format string is parsed at compile time, and the
+ ** number and types of the arguments are checked against it there.  Each argument is rendered according to its
+ ** actual type, so length modifiers such as "l" and "ll" are accepted but not needed.  "*" widths and
+ ** precisions, and "%n", are not supported.
+ **/
+template< class F, class... Args >
+inline void TypedFormat( LOGOG_STRING &out, const Args &... args )
+{
+	static_assert( FormatIsValid( F::Get() ), "logog: the format string contains an incomplete or unsupported conversion" );
+	static_assert( FormatArgumentCount( F::Get() ) == sizeof...( Args ),
+		"logog: the number of arguments does not match the format string" );
+	static_assert( FormatArgumentsMatch< Args... >( F::Get() ),
+		"logog: an argument's type does not match its conversion in the format string" );
+
+	constexpr size_t nSpecs = FormatSpecCount( F::Get() );
+	constexpr size_t nEnd = ( nSpecs == 0 ) ? 0 : FormatParseSpec( F::Get(), nSpecs - 1 ).m_nEnd;
+	constexpr size_t nLength = FormatLength( F::Get() );
+
+	FormatWriter writer( out );
+
+	FormatRenderSegments< F >( writer, std::tuple< const Args &... >( args... ), std::make_index_sequence< nSpecs >() );
+
+	if ( nLength > nEnd )
+		writer.Put( F::Get() + nEnd, nLength - nEnd );
+}
+
+/** Renders a format string and its arguments as the message of topic.  \sa TypedFormat, Topic::BeginFormat */
+template< class F, class... Args >
+inline void TypedFormat( Topic &topic, const Args &... args )
+{
+	topic.FormatString( F::Get() );
+	TypedFormat< F >( topic.BeginFormat(), args... );
+}
+
+}
+
+/** Declares a type named name whose Get() returns the format string s, for use with TypedFormat(). */
+#define LOGOG_FORMAT_STRING( name, s ) \
+	struct name { static constexpr const LOGOG_CHAR *Get() { return s; } }
+
+#endif // __cplusplus >= 201402L
+
+#endif // __LOGOG_FORMAT_HPP__
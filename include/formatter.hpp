@@ -21,20 +21,43 @@ protected:
 	char cTimeString[ LOGOG_TIME_STRING_MAX ]; 
 };
 
-/** Converts a topic into a human-readable string for printing or otherwise rendering to a target. */
+/** Converts a topic into a human-readable string for printing or otherwise rendering to a target.
+ **
+ ** Targets call FormatTo(), which renders into a buffer that the caller provides.  By default it calls Format()
+ ** under the formatter's lock, and copies m_sMessageBuffer, so that a subclass may override Format() as it always
+ ** could.  The formatters here do their rendering in Render(), which writes nothing but the buffer it is given; a
+ ** formatter whose IsReentrant() returns true has FormatTo() call Render() directly, without the lock, so that one
+ ** formatter may format on several threads at once, and targets format before taking their own lock.  Format() is
+ ** never called on such a formatter.
+ **/
 class Formatter : public Object
 {
 public:
 	Formatter();
 
+	/** Renders a topic into sOutput, replacing what it held, and growing it as needed.  Safe to call on several
+	 ** threads at once, with different buffers.
+	 **/
+	void FormatTo( LOGOG_STRING &sOutput, const Topic &topic, const Target &target );
+
     /** Causes this formatter to format a topic into its own m_sMessageBuffer field, and thence to
      ** return a reference to that string.  This function must be written to be efficient; it will be called
      ** for every logging operation.  It is strongly recommended not to allocate or free memory in this function.
+     ** Not reentrant, since every call shares m_sMessageBuffer.  The default calls Render().
      **/
-    virtual LOGOG_STRING &Format( const Topic &topic, const Target &target ) = 0;
+    virtual LOGOG_STRING &Format( const Topic &topic, const Target &target );
 
-	/** Causes the time of day to be rendered, if it needs to be rendered.  This function is only supported on
-	 ** ANSI builds, not Unicode, as the underlying functions are ANSI only.
+	/** May FormatTo() call Render() on several threads at once, without a lock, rather than calling Format()?
+	 ** False here, and in FormatterGCC and FormatterMSVC, so that their subclasses may override Format().
+	 ** ReentrantFormatterGCC, ReentrantFormatterMSVC and the formatters that have no Format() of their own to
+	 ** override, such as PatternFormatter, return true.
+	 **/
+	virtual bool IsReentrant() const;
+
+	/** Causes the time of day to be rendered, if it needs to be rendered, by appending it to m_sMessageBuffer.
+	 ** The formatters here call this under the formatter's lock, even when they are otherwise reentrant, so
+	 ** that it may be overridden.  This function is only supported on ANSI builds, not Unicode, as
+	 ** the underlying functions are ANSI only.
 	 */
 	virtual void RenderTimeOfDay();
 
@@ -67,8 +90,24 @@ public:
 #endif
 
 protected:
+	/** Appends the topic, formatted, to sOutput, which is empty.  Must write nothing but sOutput, since it may
+	 ** run on several threads at once.  The default renders nothing.
+	 **/
+	virtual void Render( LOGOG_STRING &sOutput, const Topic &topic, const Target &target );
+
+	/** Appends the time of day, as rendered by RenderTimeOfDay(), if the time of day is shown.  writer appends to
+	 ** sOutput.
+	 **/
+	void PutTimeOfDay( FormatWriter &writer, const LOGOG_STRING &sOutput );
+
     const LOGOG_CHAR *ErrorDescription( const LOGOG_LEVEL_TYPE level );
 
+	/** Appends the key/value fields attached to the topic, if there are any.  In logfmt style each field is
+	 ** rendered as a space followed by key=value; in JSON style, as a comma followed by "key":value.
+	 ** \sa FieldSet
+	 **/
+	void PutFields( FormatWriter &writer, const Topic &topic, bool bJSON );
+
     LOGOG_STRING m_sMessageBuffer;
     LOGOG_STRING m_sIntBuffer;
 
@@ -78,19 +117,260 @@ protected:
     char m_TimeOfDayFormat[LOGOG_TIME_FORMAT_MAX];
 #endif
 
+	/** Serializes the use of m_sMessageBuffer: calls to Format() from FormatTo(), and to RenderTimeOfDay(). */
+	Mutex m_MutexFormat;
 };
 
-class FormatterGCC : public Formatter
+/** The output of a formatter for one transmission of a topic, shared by every target that renders the topic with
+ ** the same formatter and the same choice of null termination.  Reference counted, since a target may hold on to
+ ** the output after the transmission: whoever is given one must Release() it.  \sa Topic::GetFormatted
+ **/
+class FormattedMessage : public Object
 {
 public:
-    virtual LOGOG_STRING &Format( const Topic &topic, const Target &target );
+	FormattedMessage();
+
+	/** Renders topic with formatter for target. */
+	void Format( Formatter &formatter, const Topic &topic, const Target &target );
+
+	/** Adds a reference. */
+	void AddReference();
+	/** Drops a reference, and deletes this output when none are left. */
+	void Release();
+	/** Does anyone other than the holder of one reference hold this output? */
+	bool IsShared() const;
+
+	/** Does this output come from formatter, with the given choice of null termination? */
+	bool Matches( const Formatter &formatter, bool bNullTerminated ) const
+	{
+		return ( m_pFormatter == &formatter ) && ( m_bNullTerminated == bNullTerminated );
+	}
+
+	/** Returns the output. */
+	const LOGOG_STRING &Get() const { return m_sOutput; }
+
+protected:
+	/** Only Release() deletes an output. */
+	virtual ~FormattedMessage();
+
+	const Formatter *m_pFormatter;
+	bool m_bNullTerminated;
+	LOGOG_STRING m_sOutput;
+	LOGOG_UINT64 m_nReferences;
+
+private:
+	FormattedMessage( const FormattedMessage & );
+	FormattedMessage &operator=( const FormattedMessage & );
+};
 
+class FormatterGCC : public Formatter
+{
+protected:
+	virtual void Render( LOGOG_STRING &sOutput, const Topic &topic, const Target &target );
 };
 
 class FormatterMSVC : public Formatter
 {
+protected:
+	virtual void Render( LOGOG_STRING &sOutput, const Topic &topic, const Target &target );
+};
+
+/** Renders what FormatterGCC renders, without taking the formatter's lock.  The default formatter is one of these
+ ** on systems other than Windows.  Since Format() is never called on it, a subclass changes its output by
+ ** overriding Render(), which must write nothing but the buffer it is given; or it derives from FormatterGCC.
+ **/
+class ReentrantFormatterGCC : public FormatterGCC
+{
 public:
-    virtual LOGOG_STRING &Format( const Topic &topic, const Target &target );
+	virtual bool IsReentrant() const;
+};
+
+/** Renders what FormatterMSVC renders, without taking the formatter's lock.  The default formatter is one of these
+ ** on Windows.  \sa ReentrantFormatterGCC
+ **/
+class ReentrantFormatterMSVC : public FormatterMSVC
+{
+public:
+	virtual bool IsReentrant() const;
+};
+
+/** A formatter whose layout is described by a pattern string, such as "%T %L [%g/%c] %f:%n %m".  The pattern
+ ** is compiled once into a flat list of render operations -- copy a literal, copy a field, render the line
+ ** number, render the time -- so that formatting a message only runs the operations that the pattern uses.
+ ** The fields are:
+ ** - %f The file name
+ ** - %n The line number
+ ** - %L The level, such as "warning"
+ ** - %g The group
+ ** - %c The category
+ ** - %m The message
+ ** - %F The key/value fields attached to the message, each preceded by a space, as in " status=200"
+ ** - %T The time of day, in the format given to SetTimeOfDayFormat().  Each thread renders the time again at
+ **   most once a second.
+ ** - %% A percent sign
+ **
+ ** Any other character following a % is copied as is.  A line ending is appended to each message, as with
+ ** the other formatters.  Fields are rendered whether or not the topic's flags mark them as set; an unset
+ ** field renders as an empty string.
+ **/
+class PatternFormatter : public Formatter
+{
+public:
+	PatternFormatter( const LOGOG_CHAR *sPattern );
+
+	/** Replaces the pattern and compiles it.  This function does no locking; don't call it while the
+	 ** formatter is in use.
+	 **/
+	void SetPattern( const LOGOG_CHAR *sPattern );
+
+	virtual bool IsReentrant() const;
+
+protected:
+	virtual void Render( LOGOG_STRING &sOutput, const Topic &topic, const Target &target );
+
+	/** The kinds of render operation. */
+	enum PatternOpType
+	{
+		PATTERN_LITERAL,
+		PATTERN_FILE_NAME,
+		PATTERN_LINE_NUMBER,
+		PATTERN_LEVEL,
+		PATTERN_GROUP,
+		PATTERN_CATEGORY,
+		PATTERN_MESSAGE,
+		PATTERN_FIELDS,
+		PATTERN_TIME_OF_DAY
+	};
+
+	/** One render operation.  Literal operations copy m_nLength characters from m_sLiterals, starting at
+	 ** m_nOffset.
+	 **/
+	struct PatternOp
+	{
+		PatternOpType m_Type;
+		size_t m_nOffset;
+		size_t m_nLength;
+	};
+
+	typedef LOGOG_VECTOR< PatternOp, Allocator< PatternOp > > PatternOpsType;
+
+	/** Adds an operation to the program, merging adjacent literals. */
+	void AddOp( PatternOpType type, const LOGOG_CHAR *pLiteral = NULL, size_t nLength = 0 );
+
+	/** Appends the current time of day.  The time is kept for each thread, and rendered again only when the
+	 ** second changes, or when the thread last rendered it for another formatter.
+	 **/
+	void AppendTimeOfDay( FormatWriter &writer );
+
+	/** The compiled pattern. */
+	PatternOpsType m_vOps;
+	/** The literal text of the pattern, referred to by PATTERN_LITERAL operations. */
+	LOGOG_STRING m_sLiterals;
+};
+
+/** A base for formatters that write one machine-readable record per line, such as FormatterJSON and
+ ** FormatterLogfmt.  Records are rendered through a FormatWriter, which grows the message buffer as needed, so
+ ** long messages are never truncated into an unparseable record.  Every record carries these fields, in this
+ ** order; the fields in parentheses are only present when the topic's flags say they are set:
+ ** - timestamp The wall clock time in UTC, as in 2026-10-18T09:30:15.123456Z
+ ** - (level) The level, such as "warning"
+ ** - (file) The file name
+ ** - (line) The line number
+ ** - (group) The group
+ ** - (category) The category
+ ** - thread The id of the logging thread; see GetCurrentThreadIdentifier()
+ ** - (message) The message
+ ** - Any key/value fields attached to the message, under their own keys.  Integers, floating point values and
+ **   booleans are rendered as numbers and booleans, and strings as strings.
+ **
+ ** Records always end in a single '\n', on every platform, so that they can be split on line breaks; a line
+ ** break inside a field is escaped.
+ **/
+class StructuredFormatter : public Formatter
+{
+public:
+	virtual bool IsReentrant() const;
+
+protected:
+	/** Appends the current time, formatted as an RFC 3339 time stamp in UTC with microseconds.  Each thread
+	 ** renders the date and time of day again only when the second changes.
+	 **/
+	void PutTimestamp( FormatWriter &writer );
+
+	/** Appends the line ending, and a NULL if the target wants one. */
+	void PutEnd( FormatWriter &writer, const Target &target );
+};
+
+/** Renders each topic as a JSON object on a single line, so that the output can be read by tools that expect
+ ** JSON Lines.  Strings are escaped per RFC 8259; characters outside ASCII are copied through unchanged.
+ ** \sa StructuredFormatter for the fields.
+ **/
+class FormatterJSON : public StructuredFormatter
+{
+protected:
+	virtual void Render( LOGOG_STRING &sOutput, const Topic &topic, const Target &target );
+};
+
+/** Renders each topic as a line of logfmt key=value pairs, such as
+ ** \code timestamp=2026-10-18T09:30:15.123456Z level=info line=42 thread=1234 message="hello world" \endcode
+ ** Values are quoted only if they need to be; quoted values are escaped as in FormatterJSON.
+ ** \sa StructuredFormatter for the fields.
+ **/
+class FormatterLogfmt : public StructuredFormatter
+{
+protected:
+	virtual void Render( LOGOG_STRING &sOutput, const Topic &topic, const Target &target );
+};
+
+/** Renders each topic as an RFC 5424 syslog message, such as
+ ** \code <14>1 2026-10-18T09:30:15.123456Z myhost myapp 4242 - [logog@32473 group="Graphics" line="42"] hello \endcode
+ ** The priority combines the facility with the severity that GetSeverity() maps the level to.  The host name,
+ ** application name and process id are found once, when the formatter is created.  The group, category, file and
+ ** line, where the topic's flags say they are set, are sent as parameters of a structured data element with the
+ ** id LOGOG_SYSLOG_SD_ID; if none is set, the structured data is "-".  There is no message id, and no line
+ ** ending, since each message is sent as a datagram of its own.
+ **/
+class FormatterSyslog : public StructuredFormatter
+{
+public:
+	/** Creates a syslog formatter.
+	 ** \param nFacility The facility, from 0 to 23, as numbered in RFC 5424: 1 for user-level messages, 3 for
+	 ** system daemons, 16 to 23 for local0 to local7.
+	 ** \param sAppName The application name.  If NULL, the name of the program is used where it can be found.
+	 **/
+	FormatterSyslog( int nFacility = LOGOG_SYSLOG_FACILITY, const char *sAppName = NULL );
+
+	/** Returns the syslog severity, from 0 for emergencies to 7 for debugging, of a logog level.  Each level
+	 ** from LOGOG_LEVEL_EMERGENCY to LOGOG_LEVEL_WARN has a severity of the same name; the levels between
+	 ** LOGOG_LEVEL_WARN and LOGOG_LEVEL_INFO are notices.
+	 **/
+	static int GetSeverity( LOGOG_LEVEL_TYPE level );
+
+protected:
+	virtual void Render( LOGOG_STRING &sOutput, const Topic &topic, const Target &target );
+
+	/** Appends the name of a structured data parameter and its opening quote, first opening the element if
+	 ** bOpen is false.
+	 **/
+	static void PutParameterName( FormatWriter &writer, bool &bOpen, const LOGOG_CHAR *sName );
+
+	/** Appends a parameter value, escaping the quotes, backslashes and closing brackets that RFC 5424 requires,
+	 ** followed by the closing quote.
+	 **/
+	static void PutParameterValue( FormatWriter &writer, const LOGOG_CHAR *pValue, size_t nValue );
+
+	/** Copies sField into pOut as a header field of at most nMax characters, replacing anything other than
+	 ** printable ASCII with '_'.  Empty fields become "-", the nil value.  \return The length of the field.
+	 **/
+	static size_t CopyHeaderField( char *pOut, size_t nMax, const char *sField );
+
+	int m_nFacility;
+	/** The host name, application name and process id, as they appear in the header. */
+	char m_vHostName[ 256 ];
+	size_t m_nHostName;
+	char m_vAppName[ 49 ];
+	size_t m_nAppName;
+	LOGOG_UINT64 m_nProcessId;
 };
 
 extern Formatter &GetDefaultFormatter();
@@ -0,0 +1,97 @@
+/**
+ * \file index.hpp A sidecar index that maps times and levels to byte ranges of a log file, and a reader for it.
+ */
+
+#ifndef __LOGOG_INDEX_HPP__
+#define __LOGOG_INDEX_HPP__
+
+namespace logog
+{
+
+/** The eight bytes that begin an index file. */
+#define LOGOG_INDEX_MAGIC "\x89LGI\r\n\x1a\n"
+/** The length of LOGOG_INDEX_MAGIC. */
+#define LOGOG_INDEX_MAGIC_LENGTH 8
+/** The length of an index entry in an index file. */
+#define LOGOG_INDEX_ENTRY_LENGTH 40
+/** The suffix appended to the name of a log file to get the name of its index. */
+#define LOGOG_INDEX_SUFFIX ".idx"
+
+/** Describes a run of consecutive records in a log file, called a bucket.  An index file is LOGOG_INDEX_MAGIC
+ ** followed by one entry per bucket: the six members in order, the first four as eight bytes and the last two as
+ ** four bytes, all little endian.  \sa LogFile::EnableIndex
+ **/
+struct LogIndexEntry
+{
+	/** The wall clock time of the first record in the bucket, in nanoseconds since 1970 UTC. */
+	LOGOG_UINT64 m_nFirstTime;
+	/** The wall clock time of the last record in the bucket. */
+	LOGOG_UINT64 m_nLastTime;
+	/** The offset in the log file of the first byte of the bucket. */
+	LOGOG_UINT64 m_nOffset;
+	/** The length of the bucket in bytes. */
+	LOGOG_UINT64 m_nLength;
+	/** The number of records in the bucket. */
+	unsigned int m_nRecords;
+	/** The most severe (numerically lowest) level of any record in the bucket. */
+	unsigned int m_nLevel;
+};
+
+/** A range of bytes in a log file. */
+struct LogIndexRange
+{
+	LOGOG_UINT64 m_nOffset;
+	LOGOG_UINT64 m_nLength;
+};
+
+/** Appends an entry to an index file.  \return true if it was written. */
+extern bool WriteLogIndexEntry( FILE *fp, const LogIndexEntry &entry );
+
+/** Seeks to a byte offset in a file, which may be beyond 2 GB.  \return true if successful. */
+extern bool SeekLogFile( FILE *fp, LOGOG_UINT64 nOffset );
+
+/** Seeks to the end of a file and returns its size, which may be beyond 2 GB. */
+extern LOGOG_UINT64 SeekLogFileEnd( FILE *fp );
+
+/** Reads the index of a log file, so that the parts of the log written during some period can be found without
+ ** reading the whole log.  The index is read into memory when it is opened; it is small, at one entry for every
+ ** bucket of the log.
+ **/
+class LogIndex : public Object
+{
+public:
+	typedef LOGOG_VECTOR< LogIndexEntry, Allocator< LogIndexEntry > > EntriesType;
+	typedef LOGOG_VECTOR< LogIndexRange, Allocator< LogIndexRange > > RangesType;
+
+	LogIndex();
+
+	/** Reads the index of a log file.  An index entry cut short by a crash is ignored.
+	 ** \param sLogFileName The name of the log file, not of the index.
+	 ** \return true if the index exists and starts with LOGOG_INDEX_MAGIC.
+	 **/
+	bool Open( const char *sLogFileName );
+
+	/** Returns the entries read by Open(), in the order they were written. */
+	const EntriesType &GetEntries() const;
+
+	/** Finds the parts of the log that may hold records written between nFrom and nTo, inclusive, at level or
+	 ** more severe.  Whole buckets are returned, so the ranges may include some records outside the period.
+	 ** Adjacent buckets are merged into one range.  Any part of the log after the last indexed bucket, such as the
+	 ** records of a run that crashed or is still writing, is included too, since nothing is known about it.
+	 ** \param nFrom The start of the period, in nanoseconds since 1970 UTC.
+	 ** \param nTo The end of the period.
+	 ** \param level The least severe level of interest; LOGOG_LEVEL_ALL includes every record.
+	 ** \param vRanges Receives the ranges, in file order.
+	 ** \return The number of ranges found.
+	 **/
+	size_t Find( LOGOG_UINT64 nFrom, LOGOG_UINT64 nTo, LOGOG_LEVEL_TYPE level, RangesType &vRanges ) const;
+
+protected:
+	EntriesType m_vEntries;
+	/** The size of the log file when the index was opened. */
+	LOGOG_UINT64 m_nLogSize;
+};
+
+}
+
+#endif // __LOGOG_INDEX_HPP_
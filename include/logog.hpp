@@ -13,21 +13,34 @@
 
 #include "const.hpp"
 #include "platform.hpp"
+#include "atomic.hpp"
 #include "statics.hpp"
 #include "object.hpp"
 #include "timer.hpp"
 #include "mutex.hpp"
+#include "thread.hpp"
 #include "string.hpp"
+#include "stats.hpp"
 #include "node.hpp"
 #include "topic.hpp"
+#include "field.hpp"
+#include "format.hpp"
 #include "formatter.hpp"
+#include "index.hpp"
+#include "emergency.hpp"
 #include "target.hpp"
-// #include "socket.hpp"
+#include "binary.hpp"
+#include "descriptor.hpp"
+#include "direct.hpp"
+#include "socket.hpp"
+#include "syslog.hpp"
+#include "server.hpp"
 #include "checkpoint.hpp"
 #include "api.hpp"
 #include "message.hpp"
 #include "macro.hpp"
-#include "thread.hpp"
+#include "compress.hpp"
+#include "flight.hpp"
 #include "unittest.hpp"
 
 #endif // __LOGOG_HPP_
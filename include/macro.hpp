@@ -34,6 +34,21 @@ namespace logog
 /** \sa TOKENPASTE2(x, y) */
 #define TOKENPASTE(x, y) TOKENPASTE2(x, y)
 
+#ifdef LOGOG_TYPED_FORMAT
+/** Renders a format string and its arguments as the message of a topic.  The format string is parsed and
+ ** checked against the arguments at compile time.  \sa TypedFormat
+ **/
+#define LOGOG_FORMAT_TOPIC( topic, formatstring, ... ) \
+{ \
+	LOGOG_FORMAT_STRING( _logog_format_string, formatstring ); \
+	::logog::TypedFormat< _logog_format_string >( topic, ##__VA_ARGS__ ); \
+}
+#else // LOGOG_TYPED_FORMAT
+/** Renders a format string and its arguments as the message of a topic, using Topic::Format(). */
+#define LOGOG_FORMAT_TOPIC( topic, formatstring, ... ) \
+	( topic ).Format( formatstring, ##__VA_ARGS__ )
+#endif // LOGOG_TYPED_FORMAT
+
 /** This macro is used when a message is instantiated without any varargs
   * provided by the user.  It locks a global mutex, creates the message,
   * locks it, transmits it, and releases all locks.
@@ -97,12 +112,55 @@ do \
 	___pMCM->MutexUnlock(); \
 	/* A race condition could theoretically occur here if you are shutting down at the same instant as sending log messages. */ \
 	TOKENPASTE(_logog_,__LINE__)->m_Transmitting.MutexLock(); \
-	TOKENPASTE(_logog_,__LINE__)->Format( formatstring, ##__VA_ARGS__ ); \
+	LOGOG_FORMAT_TOPIC( *TOKENPASTE(_logog_,__LINE__), formatstring, ##__VA_ARGS__ ); \
+	TOKENPASTE(_logog_,__LINE__)->Transmit(); \
+	TOKENPASTE(_logog_,__LINE__)->m_Transmitting.MutexUnlock(); \
+} while (false) \
+LOGOG_MICROSOFT_PRAGMA_IN_MACRO(warning(pop))
+
+/** Like LOGOG_LEVEL_GROUP_CATEGORY_MESSAGE, but attaches key/value fields to the message instead of formatting
+  * arguments into it.  The arguments after the message are one to eight pairs of a key, which is a LOGOG_CHAR
+  * string, and a value; see FieldSet for the value types.  The message is a format string without arguments.
+  * The fields are collected before any lock is taken, and are attached to the message only while it is being
+  * transmitted.
+  */
+#define LOGOG_LEVEL_GROUP_CATEGORY_MESSAGE_KV( level, group, cat, formatstring, ... ) \
+LOGOG_MICROSOFT_PRAGMA_IN_MACRO(warning(push)) \
+LOGOG_MICROSOFT_PRAGMA_IN_MACRO(warning(disable : 4127 )) \
+do \
+{ \
+	::logog::FieldSet _logog_fields; \
+	_logog_fields.Add( __VA_ARGS__ ); \
+	::logog::Mutex *___pMCM = &::logog::GetMessageCreationMutex(); \
+	___pMCM->MutexLock(); \
+	static bool TOKENPASTE(_logog_static_bool_,__LINE__) = false; \
+	static logog::Message * TOKENPASTE(_logog_,__LINE__); \
+	if ( TOKENPASTE(_logog_static_bool_,__LINE__) == false ) \
+	{ \
+		TOKENPASTE(_logog_,__LINE__) = \
+			new logog::Message( level, \
+				LOGOG_CONST_STRING( __FILE__ ), \
+				__LINE__ , \
+				LOGOG_CONST_STRING( group ), \
+				LOGOG_CONST_STRING( cat ), \
+				LOGOG_CONST_STRING( "" ), \
+				0.0f, \
+				& (TOKENPASTE(_logog_static_bool_,__LINE__)) ); \
+	} \
+	___pMCM->MutexUnlock(); \
+	TOKENPASTE(_logog_,__LINE__)->m_Transmitting.MutexLock(); \
+	LOGOG_FORMAT_TOPIC( *TOKENPASTE(_logog_,__LINE__), formatstring ); \
+	TOKENPASTE(_logog_,__LINE__)->Fields( &_logog_fields ); \
 	TOKENPASTE(_logog_,__LINE__)->Transmit(); \
+	TOKENPASTE(_logog_,__LINE__)->Fields( NULL ); \
 	TOKENPASTE(_logog_,__LINE__)->m_Transmitting.MutexUnlock(); \
 } while (false) \
 LOGOG_MICROSOFT_PRAGMA_IN_MACRO(warning(pop))
 
+/** Calls LOGOG_LEVEL_GROUP_CATEGORY_MESSAGE_KV with the current LOGOG_GROUP and LOGOG_CATEGORY setting. */
+#define LOGOG_LEVEL_MESSAGE_KV( level, formatstring, ... ) \
+	LOGOG_LEVEL_GROUP_CATEGORY_MESSAGE_KV( level, LOGOG_GROUP, LOGOG_CATEGORY, formatstring, __VA_ARGS__ )
+
 /** Calls LOGOG_LEVEL_GROUP_CATEGORY_MESSAGE with the current LOGOG_GROUP and
   * LOGOG_CATEGORY setting.
   */
@@ -194,6 +252,86 @@ LOGOG_MICROSOFT_PRAGMA_IN_MACRO(warning(pop))
 #define LOGOG_EMERGENCY( formatstring, ... ) do {} while (false)
 #endif
 
+#if LOGOG_LEVEL >= LOGOG_LEVEL_DEBUG
+/** Logs a message with key/value fields at the DEBUG reporting level.  \sa LOGOG_LEVEL_GROUP_CATEGORY_MESSAGE_KV */
+#define LOGOG_DEBUG_KV( formatstring, ... ) \
+	LOGOG_LEVEL_MESSAGE_KV( LOGOG_LEVEL_DEBUG, formatstring, __VA_ARGS__ )
+#else
+#define LOGOG_DEBUG_KV( formatstring, ... ) do {} while (false)
+#endif
+
+#if LOGOG_LEVEL >= LOGOG_LEVEL_INFO
+/** Logs a message with key/value fields at the INFO reporting level.  \sa LOGOG_LEVEL_GROUP_CATEGORY_MESSAGE_KV */
+#define LOGOG_INFO_KV( formatstring, ... ) \
+	LOGOG_LEVEL_MESSAGE_KV( LOGOG_LEVEL_INFO, formatstring, __VA_ARGS__ )
+#else
+#define LOGOG_INFO_KV( formatstring, ... ) do {} while (false)
+#endif
+
+#if LOGOG_LEVEL >= LOGOG_LEVEL_WARN3
+/** Logs a message with key/value fields at the WARN3 reporting level.  \sa LOGOG_LEVEL_GROUP_CATEGORY_MESSAGE_KV */
+#define LOGOG_WARN3_KV( formatstring, ... ) \
+	LOGOG_LEVEL_MESSAGE_KV( LOGOG_LEVEL_WARN3, formatstring, __VA_ARGS__ )
+#else
+#define LOGOG_WARN3_KV( formatstring, ... ) do {} while (false)
+#endif
+
+#if LOGOG_LEVEL >= LOGOG_LEVEL_WARN2
+/** Logs a message with key/value fields at the WARN2 reporting level.  \sa LOGOG_LEVEL_GROUP_CATEGORY_MESSAGE_KV */
+#define LOGOG_WARN2_KV( formatstring, ... ) \
+	LOGOG_LEVEL_MESSAGE_KV( LOGOG_LEVEL_WARN2, formatstring, __VA_ARGS__ )
+#else
+#define LOGOG_WARN2_KV( formatstring, ... ) do {} while (false)
+#endif
+
+#if LOGOG_LEVEL >= LOGOG_LEVEL_WARN1
+/** Logs a message with key/value fields at the WARN1 reporting level.  \sa LOGOG_LEVEL_GROUP_CATEGORY_MESSAGE_KV */
+#define LOGOG_WARN1_KV( formatstring, ... ) \
+	LOGOG_LEVEL_MESSAGE_KV( LOGOG_LEVEL_WARN1, formatstring, __VA_ARGS__ )
+#else
+#define LOGOG_WARN1_KV( formatstring, ... ) do {} while (false)
+#endif
+
+#if LOGOG_LEVEL >= LOGOG_LEVEL_WARN
+/** Logs a message with key/value fields at the WARN reporting level.  \sa LOGOG_LEVEL_GROUP_CATEGORY_MESSAGE_KV */
+#define LOGOG_WARN_KV( formatstring, ... ) \
+	LOGOG_LEVEL_MESSAGE_KV( LOGOG_LEVEL_WARN, formatstring, __VA_ARGS__ )
+#else
+#define LOGOG_WARN_KV( formatstring, ... ) do {} while (false)
+#endif
+
+#if LOGOG_LEVEL >= LOGOG_LEVEL_ERROR
+/** Logs a message with key/value fields at the ERROR reporting level.  \sa LOGOG_LEVEL_GROUP_CATEGORY_MESSAGE_KV */
+#define LOGOG_ERROR_KV( formatstring, ... ) \
+	LOGOG_LEVEL_MESSAGE_KV( LOGOG_LEVEL_ERROR, formatstring, __VA_ARGS__ )
+#else
+#define LOGOG_ERROR_KV( formatstring, ... ) do {} while (false)
+#endif
+
+#if LOGOG_LEVEL >= LOGOG_LEVEL_CRITICAL
+/** Logs a message with key/value fields at the CRITICAL reporting level.  \sa LOGOG_LEVEL_GROUP_CATEGORY_MESSAGE_KV */
+#define LOGOG_CRITICAL_KV( formatstring, ... ) \
+	LOGOG_LEVEL_MESSAGE_KV( LOGOG_LEVEL_CRITICAL, formatstring, __VA_ARGS__ )
+#else
+#define LOGOG_CRITICAL_KV( formatstring, ... ) do {} while (false)
+#endif
+
+#if LOGOG_LEVEL >= LOGOG_LEVEL_ALERT
+/** Logs a message with key/value fields at the ALERT reporting level.  \sa LOGOG_LEVEL_GROUP_CATEGORY_MESSAGE_KV */
+#define LOGOG_ALERT_KV( formatstring, ... ) \
+	LOGOG_LEVEL_MESSAGE_KV( LOGOG_LEVEL_ALERT, formatstring, __VA_ARGS__ )
+#else
+#define LOGOG_ALERT_KV( formatstring, ... ) do {} while (false)
+#endif
+
+#if LOGOG_LEVEL >= LOGOG_LEVEL_EMERGENCY
+/** Logs a message with key/value fields at the EMERGENCY reporting level.  \sa LOGOG_LEVEL_GROUP_CATEGORY_MESSAGE_KV */
+#define LOGOG_EMERGENCY_KV( formatstring, ... ) \
+	LOGOG_LEVEL_MESSAGE_KV( LOGOG_LEVEL_EMERGENCY, formatstring, __VA_ARGS__ )
+#else
+#define LOGOG_EMERGENCY_KV( formatstring, ... ) do {} while (false)
+#endif
+
 #define LOGOG_SET_LEVEL( level ) \
 	::logog::SetDefaultLevel( level );
 
@@ -226,6 +364,26 @@ LOGOG_MICROSOFT_PRAGMA_IN_MACRO(warning(pop))
 #define CRITICAL(...) LOGOG_CRITICAL( __VA_ARGS__ )
 /** \sa LOGOG_EMERGENCY */
 #define EMERGENCY(...) LOGOG_EMERGENCY( __VA_ARGS__ )
+/** \sa LOGOG_DEBUG_KV */
+#define DBUG_KV(...) LOGOG_DEBUG_KV( __VA_ARGS__ )
+/** \sa LOGOG_INFO_KV */
+#define INFO_KV(...) LOGOG_INFO_KV( __VA_ARGS__ )
+/** \sa LOGOG_WARN3_KV */
+#define WARN3_KV(...) LOGOG_WARN3_KV( __VA_ARGS__ )
+/** \sa LOGOG_WARN2_KV */
+#define WARN2_KV(...) LOGOG_WARN2_KV( __VA_ARGS__ )
+/** \sa LOGOG_WARN1_KV */
+#define WARN1_KV(...) LOGOG_WARN1_KV( __VA_ARGS__ )
+/** \sa LOGOG_WARN_KV */
+#define WARN_KV(...) LOGOG_WARN_KV( __VA_ARGS__ )
+/** \sa LOGOG_ERROR_KV */
+#define ERR_KV(...) LOGOG_ERROR_KV( __VA_ARGS__ )
+/** \sa LOGOG_CRITICAL_KV */
+#define CRITICAL_KV(...) LOGOG_CRITICAL_KV( __VA_ARGS__ )
+/** \sa LOGOG_ALERT_KV */
+#define ALERT_KV(...) LOGOG_ALERT_KV( __VA_ARGS__ )
+/** \sa LOGOG_EMERGENCY_KV */
+#define EMERGENCY_KV(...) LOGOG_EMERGENCY_KV( __VA_ARGS__ )
 //! [Shorthand]
 #endif
 
@@ -32,10 +32,26 @@ public:
       */
     virtual bool Republish();
 
+	/** Publishes this message to all its subscribers.  Counts the call if LOGOG_STATISTICS is defined. */
+	virtual int Transmit();
+
+	/** Copies this call site's counters and lock statistics into entry.  \sa GetStats */
+	void GetStatistics( Statistics::MessageEntry &entry ) const;
+
 	Mutex m_Transmitting;
 	bool *m_pbIsCreated;
+
+#ifdef LOGOG_STATISTICS
+	/** The number of times this message has been transmitted. */
+	LOGOG_UINT64 m_nHits;
+#endif // LOGOG_STATISTICS
 };
 
+/** Returns a reference to the group of all Message objects.  This group is only maintained if LOGOG_STATISTICS
+ ** is defined; otherwise it is always empty.
+ */
+extern LockableNodesType &AllMessages();
+
 extern Mutex &GetMessageCreationMutex();
 extern void DestroyMessageCreationMutex();
 
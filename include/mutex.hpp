@@ -12,6 +12,46 @@
 namespace logog
 {
 
+/** \def LOGOG_FUTEX_MUTEX
+ ** Define this macro on Linux to replace the pthread mutex behind every logog Mutex with a futex-based lock.
+ ** The futex lock spins briefly before sleeping in the kernel.  The number of spins is adapted per mutex to the
+ ** recently observed lock hold times, so that the short critical sections inside logog rarely cause a thread
+ ** to sleep.
+ **/
+#ifdef LOGOG_FUTEX_MUTEX
+#ifndef LOGOG_MUTEX
+#ifdef __linux__
+
+#ifndef LOGOG_FUTEX_MAX_SPIN
+/** The upper bound on the number of times a futex mutex polls the lock before sleeping. */
+#define LOGOG_FUTEX_MAX_SPIN 100
+#endif // LOGOG_FUTEX_MAX_SPIN
+
+/** The state of a futex-based lock.  Do not access these fields directly; use the LOGOG_MUTEX_* macros. */
+struct FutexMutex
+{
+	/** 0 if unlocked, 1 if locked, 2 if locked and other threads may be sleeping on the lock. */
+	int m_nState;
+	/** A running average of the number of spins needed to acquire this lock recently. */
+	int m_nSpinEstimate;
+};
+
+extern void FutexMutexInit( FutexMutex *pMutex );
+extern void FutexMutexLock( FutexMutex *pMutex );
+extern int FutexMutexTryLock( FutexMutex *pMutex );
+extern void FutexMutexUnlock( FutexMutex *pMutex );
+
+#define LOGOG_MUTEX(x)           ::logog::FutexMutex x;
+#define LOGOG_MUTEX_INIT(x)      ::logog::FutexMutexInit (x)
+#define LOGOG_MUTEX_DELETE(x)
+#define LOGOG_MUTEX_LOCK(x)      ::logog::FutexMutexLock (x)
+#define LOGOG_MUTEX_TRYLOCK(x)   ::logog::FutexMutexTryLock (x)
+#define LOGOG_MUTEX_UNLOCK(x)    ::logog::FutexMutexUnlock (x)
+#define LOGOG_MUTEX_CTOR(x)
+#endif // __linux__
+#endif // LOGOG_MUTEX
+#endif // LOGOG_FUTEX_MUTEX
+
 //! [Mutex]
 #ifndef LOGOG_MUTEX
 
@@ -20,15 +60,17 @@ namespace logog
 #define LOGOG_MUTEX_INIT(x)      InitializeCriticalSection (x)
 #define LOGOG_MUTEX_DELETE(x)    DeleteCriticalSection (x)
 #define LOGOG_MUTEX_LOCK(x)      EnterCriticalSection (x)
+#define LOGOG_MUTEX_TRYLOCK(x)   ( TryEnterCriticalSection (x) ? 0 : 1 )
 #define LOGOG_MUTEX_UNLOCK(x)    LeaveCriticalSection (x)
 #define LOGOG_MUTEX_CTOR(x)
 #endif // LOGOG_FLAVOR_WINDOWS
 
 #ifdef LOGOG_FLAVOR_POSIX
-#define LOGOG_MUTEX(x)           pthread_mutex_t (x);
+#define LOGOG_MUTEX(x)           pthread_mutex_t x;
 #define LOGOG_MUTEX_INIT(x)      pthread_mutex_init(x, 0)
 #define LOGOG_MUTEX_DELETE(x)    pthread_mutex_destroy (x)
 #define LOGOG_MUTEX_LOCK(x)      pthread_mutex_lock (x)
+#define LOGOG_MUTEX_TRYLOCK(x)   pthread_mutex_trylock (x)
 #define LOGOG_MUTEX_UNLOCK(x)    pthread_mutex_unlock (x)
 #define LOGOG_MUTEX_CTOR(x)
 #endif // LOGOG_FLAVOR_POSIX
@@ -40,6 +82,30 @@ namespace logog
 
 //! [Mutex]
 
+/** \def LOGOG_MUTEX_STATISTICS
+ ** Define this macro to make every Mutex count its acquisitions, the acquisitions that had to wait for another
+ ** thread, and the total time spent waiting.  An uncontended lock costs one extra try-lock; only contended locks
+ ** read the clock.  This requires a LOGOG_MUTEX_TRYLOCK macro for your platform.
+ **/
+
+/* Statistics about logog's own locks are part of the statistics surface. */
+#ifdef LOGOG_STATISTICS
+#ifndef LOGOG_MUTEX_STATISTICS
+#define LOGOG_MUTEX_STATISTICS 1
+#endif // LOGOG_MUTEX_STATISTICS
+#endif // LOGOG_STATISTICS
+
+/** Contention statistics for a single Mutex.  \sa Mutex::GetStatistics */
+struct MutexStatistics
+{
+	/** The number of times the mutex was locked. */
+	LOGOG_UINT64 m_nAcquisitions;
+	/** The number of times the mutex was already held by another thread when a lock was requested. */
+	LOGOG_UINT64 m_nContendedAcquisitions;
+	/** The total time, in nanoseconds, that threads spent waiting to acquire the mutex. */
+	LOGOG_UINT64 m_nWaitNanoseconds;
+};
+
 /** An object that can only be locked by one thread at a time.  Implement the LOGOG_MUTEX_* functions for your platform
  * to support the Mutex object.
  * A mutex is intended to be used with the ScopedLock object to implement critical sections within logog.
@@ -55,11 +121,26 @@ public:
     /** Releases the lock on the mutex. */
 	void MutexUnlock();
 
+	/** Copies the contention statistics for this mutex into stats.
+	 ** \return true if statistics are available; false if logog was compiled without LOGOG_MUTEX_STATISTICS, in
+	 ** which case stats is zeroed.
+	 **/
+	bool GetStatistics( MutexStatistics &stats ) const;
+
+	/** Zeroes the contention statistics for this mutex. */
+	void ResetStatistics();
+
 protected:
     Mutex(const Mutex &);
     Mutex & operator = (const Mutex &);
 
     LOGOG_MUTEX( m_Mutex )
+
+#ifdef LOGOG_MUTEX_STATISTICS
+	/** Contention statistics.  These are only updated while the mutex is held, but are read and reset atomically
+	 ** without it. */
+	MutexStatistics m_Statistics;
+#endif // LOGOG_MUTEX_STATISTICS
 };
 
 /** Asserts a lock while this object exists and is in scope.  A ScopedLock should be
@@ -84,6 +165,78 @@ private:
     ScopedLock( const ScopedLock &other );
 };
 
+//! [Condition]
+#ifndef LOGOG_CONDITION
+
+#ifdef LOGOG_FLAVOR_POSIX
+/** Waits on a condition variable for up to nMilliseconds; the implementation of LOGOG_CONDITION_WAIT_FOR. */
+extern void PosixConditionWaitFor( pthread_cond_t *pCondition, pthread_mutex_t *pMutex, unsigned int nMilliseconds );
+#endif // LOGOG_FLAVOR_POSIX
+
+#ifdef LOGOG_FLAVOR_WINDOWS
+#define LOGOG_CONDITION(x)           CONDITION_VARIABLE x; CRITICAL_SECTION x##Lock;
+#define LOGOG_CONDITION_INIT(x)      ( InitializeConditionVariable( &x ), InitializeCriticalSection( &x##Lock ))
+#define LOGOG_CONDITION_DELETE(x)    DeleteCriticalSection( &x##Lock )
+#define LOGOG_CONDITION_LOCK(x)      EnterCriticalSection( &x##Lock )
+#define LOGOG_CONDITION_UNLOCK(x)    LeaveCriticalSection( &x##Lock )
+#define LOGOG_CONDITION_WAIT(x)      SleepConditionVariableCS( &x, &x##Lock, INFINITE )
+#define LOGOG_CONDITION_WAIT_FOR(x, ms) SleepConditionVariableCS( &x, &x##Lock, ( ms ))
+#define LOGOG_CONDITION_SIGNAL(x)    WakeConditionVariable( &x )
+#define LOGOG_CONDITION_BROADCAST(x) WakeAllConditionVariable( &x )
+#endif // LOGOG_FLAVOR_WINDOWS
+
+#ifdef LOGOG_FLAVOR_POSIX
+#define LOGOG_CONDITION(x)           pthread_cond_t x; pthread_mutex_t x##Lock;
+#define LOGOG_CONDITION_INIT(x)      ( pthread_cond_init( &x, 0 ), pthread_mutex_init( &x##Lock, 0 ))
+#define LOGOG_CONDITION_DELETE(x)    ( pthread_cond_destroy( &x ), pthread_mutex_destroy( &x##Lock ))
+#define LOGOG_CONDITION_LOCK(x)      pthread_mutex_lock( &x##Lock )
+#define LOGOG_CONDITION_UNLOCK(x)    pthread_mutex_unlock( &x##Lock )
+#define LOGOG_CONDITION_WAIT(x)      pthread_cond_wait( &x, &x##Lock )
+#define LOGOG_CONDITION_WAIT_FOR(x, ms) PosixConditionWaitFor( &x, &x##Lock, ( ms ))
+#define LOGOG_CONDITION_SIGNAL(x)    pthread_cond_signal( &x )
+#define LOGOG_CONDITION_BROADCAST(x) pthread_cond_broadcast( &x )
+#endif // LOGOG_FLAVOR_POSIX
+#endif // LOGOG_CONDITION
+
+#ifndef LOGOG_CONDITION
+#error You need to define condition variable macros for your platform; please see mutex.hpp
+#endif
+//! [Condition]
+
+/** A condition variable together with the lock that guards the state it signals about.  Threads that wait for
+ ** some state take the lock with Lock(), test the state, and call Wait() until it changes; threads that change
+ ** the state do so while holding the lock, then call Signal() or Broadcast().  The lock is a platform lock and
+ ** not a Mutex, because waiting must release it atomically, so it keeps no contention statistics.
+ **/
+class Condition : public Object
+{
+public:
+    Condition();
+    ~Condition();
+
+    /** Acquires the lock. */
+    void Lock();
+    /** Releases the lock. */
+    void Unlock();
+    /** Releases the lock, waits until signalled, and acquires the lock again.  The caller must hold the lock.
+     ** Wakeups may be spurious, so always retest the state being waited for.
+     **/
+    void Wait();
+    /** Like Wait(), but gives up after about nMilliseconds. */
+    void Wait( unsigned int nMilliseconds );
+    /** Wakes one waiting thread. */
+    void Signal();
+    /** Wakes all waiting threads. */
+    void Broadcast();
+
+protected:
+    LOGOG_CONDITION( m_Condition )
+
+private:
+    Condition( const Condition & );
+    Condition & operator = ( const Condition & );
+};
+
 #ifdef LOGOG_LEAK_DETECTION
 extern Mutex s_AllocationsMutex;
 extern void LockAllocationsMutex();
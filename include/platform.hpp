@@ -197,6 +197,31 @@ extern int vsnprintf(char *str, size_t size, const char *format, va_list ap);
 /** We use va_list for formatting messages. */
 #include <cstdarg>
 
+/** An unsigned 64-bit integer type, used for counters and nanosecond time values. */
+#ifdef LOGOG_FLAVOR_WINDOWS
+typedef unsigned __int64 LOGOG_UINT64;
+#else // LOGOG_FLAVOR_WINDOWS
+typedef uint64_t LOGOG_UINT64;
+#endif // LOGOG_FLAVOR_WINDOWS
+
+/** A signed 64-bit integer type. */
+#ifdef LOGOG_FLAVOR_WINDOWS
+typedef __int64 LOGOG_INT64;
+#else // LOGOG_FLAVOR_WINDOWS
+typedef int64_t LOGOG_INT64;
+#endif // LOGOG_FLAVOR_WINDOWS
+
+/** Declares a variable of plain old data with a separate instance for each thread, where the compiler supports
+ ** it.  Code that uses it must also work when it is not defined.
+ **/
+#ifndef LOGOG_THREAD_LOCAL
+#if defined( _MSC_VER )
+#define LOGOG_THREAD_LOCAL __declspec( thread )
+#elif defined( __GNUC__ )
+#define LOGOG_THREAD_LOCAL __thread
+#endif
+#endif // LOGOG_THREAD_LOCAL
+
 
 
 #endif // __LOGOG_PLATFORM_HPP
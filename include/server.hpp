@@ -0,0 +1,162 @@
+/**
+ * \file server.hpp A server that merges the binary log streams of other processes into this one, and the target
+ * that sends them.
+ */
+
+#ifndef __LOGOG_SERVER_HPP_
+#define __LOGOG_SERVER_HPP_
+
+namespace logog
+{
+/** A target that sends messages in the binary log format to a SocketServer, down a Unix domain stream or a TCP
+ ** connection.  Like any Socket, it never blocks the thread that logs: messages wait in a bounded queue while the
+ ** server is slow or away, and the target reconnects when it can.  Each connection starts a new stream with a
+ ** header, so the server can read it from the start.  Messages queued while the server was away are kept if none
+ ** of their stream was sent on an earlier connection, since they still begin with its header; otherwise they
+ ** continue a stream the server has lost, so they are dropped when the target reconnects, and counted in
+ ** GetDroppedCount().
+ **/
+class BinarySocket : public Socket
+{
+public:
+    /** Creates a binary socket target.
+     ** \param sAddress The path of the server's Unix domain socket, if it contains a slash; otherwise its host.
+     ** \param port The server's TCP port.  Ignored for Unix domain sockets.
+     **/
+    BinarySocket( const char *sAddress, int port = LOGOG_DEFAULT_PORT );
+
+protected:
+    /** Starts a new binary stream, with a header and fresh call sites, unless nothing of the current one has been
+     ** sent yet.
+     **/
+    virtual void Connected();
+
+    BinaryFormatter m_BinaryFormatter;
+    /** The value of m_nStreamSent when the current binary stream started. */
+    LOGOG_UINT64 m_nStreamStart;
+
+private:
+    BinarySocket( const BinarySocket & );
+    BinarySocket &operator=( const BinarySocket & );
+};
+
+#ifdef LOGOG_FLAVOR_POSIX
+
+/** A connection, or a socket listening for them, private to server.cpp. */
+struct ServerConnection;
+/** A call site that some connection has described, private to server.cpp. */
+struct ServerSite;
+
+/** Collects the binary log streams of many processes, such as those sent by BinarySocket targets, and logs
+ ** their messages again in this process, so that the filters and targets here see them as if they had been logged
+ ** locally.  Each call site described by any stream becomes a Message here, shared by every connection that
+ ** describes the same site; so a group, category or level given to a Filter matches remote messages too, and
+ ** their fields reach a FieldFilter.  The thread identifiers and times that formatters render are this process's
+ ** own.
+ **
+ ** A single thread serves every connection, waiting with epoll on Linux and with poll() elsewhere, and reading
+ ** whatever each socket has ready without blocking.  Messages are transmitted in the order of the times their
+ ** producers logged them, not the order they arrive: each stream is already in order, so the oldest waiting
+ ** message is sent as soon as every connected stream has a message waiting, or once it has waited for the merge
+ ** window, in case a quiet stream sends an older one late.  A stream that turns out not to be a binary log is
+ ** closed.
+ **
+ ** Either call Start() to serve from a thread of the server's own, or call Poll() from a loop of your own; not
+ ** both.  Destroy the server before calling LOGOG_SHUTDOWN().  Only available on POSIX systems.
+ **/
+class SocketServer : public Object
+{
+public:
+    SocketServer();
+
+    /** Stops the serving thread, transmits every message still waiting, and closes every socket. */
+    virtual ~SocketServer();
+
+    /** Listens for streams.  May be called more than once, to listen in several places.
+     ** \param sAddress The path of a Unix domain socket to create, if it contains a slash, replacing any socket
+     ** already there; otherwise the host name or address to listen on for TCP connections.
+     ** \param port The TCP port.  Ignored for Unix domain sockets.
+     ** \return Zero, or -1 if the socket could not be created.
+     **/
+    int Listen( const char *sAddress, int port = LOGOG_DEFAULT_PORT );
+
+    /** Starts a thread that serves the connections until Stop() is called.  \return Zero, or -1. */
+    int Start();
+
+    /** Stops the thread that Start() started, and waits for it. */
+    void Stop();
+
+    /** Waits up to nMilliseconds for any socket to be ready, then accepts new connections, reads from those with
+     ** data, and transmits every message that is due.  Returns sooner if a waiting message falls due.
+     ** \return The number of messages transmitted.
+     **/
+    int Poll( unsigned int nMilliseconds );
+
+    /** Transmits every waiting message now, without waiting out the merge window.
+     ** \return The number of messages transmitted.
+     **/
+    int Flush();
+
+    /** Sets how long a message may wait for older messages from quiet streams.  The default is
+     ** LOGOG_DEFAULT_SERVER_MERGE_WINDOW milliseconds; zero transmits messages as soon as they arrive.
+     **/
+    void SetMergeWindow( unsigned int nMilliseconds );
+
+    /** Returns the number of producers connected. */
+    size_t GetConnectionCount();
+
+    /** Returns the number of messages transmitted. */
+    LOGOG_UINT64 GetMessageCount();
+
+    /** Returns the number of messages skipped because they were sent before a stream's header. */
+    LOGOG_UINT64 GetSkippedCount();
+
+protected:
+    typedef LOGOG_VECTOR< ServerConnection *, Allocator< ServerConnection * > > ConnectionsType;
+    typedef LOGOG_VECTOR< ServerSite *, Allocator< ServerSite * > > SitesType;
+
+    /** Creates the epoll instance and the pipe that wakes the serving thread, if they don't exist yet. */
+    int Open();
+    /** Adds a socket to the connections, and to the epoll instance. */
+    void AddConnection( ServerConnection *pConnection );
+    /** Closes a socket.  A producer's connection stays in the list until its waiting messages are transmitted. */
+    void CloseConnection( ServerConnection *pConnection );
+    /** Accepts every connection waiting on a listening socket. */
+    void Accept( ServerConnection *pListener );
+    /** Reads what a connection has ready, and queues the messages in it. */
+    void Read( ServerConnection *pConnection );
+    /** Returns the shared message for a call site, creating it the first time the site is seen. */
+    ServerSite *FindSite( const BinaryLogSite &site );
+    /** Transmits waiting messages in order of time: all of them if bAll, otherwise those that are due. */
+    int TransmitDue( bool bAll );
+    /** Returns the milliseconds until the oldest waiting message is due, or nMilliseconds if that is sooner. */
+    unsigned int GetWaitTime( unsigned int nMilliseconds );
+
+    /** The entry point of the serving thread. */
+    static void *ServeThread( void *pvServer );
+
+    /** Guards everything below.  Held by Poll(), except while it waits. */
+    Mutex m_Mutex;
+    ConnectionsType m_vConnections;
+    SitesType m_vSites;
+    /** The epoll instance, or -1 where poll() is used. */
+    int m_nPoller;
+    /** The pipe that Stop() writes to, to wake the serving thread. */
+    int m_vWake[ 2 ];
+    LOGOG_UINT64 m_nMergeWindow;
+    LOGOG_UINT64 m_nMessages;
+    LOGOG_UINT64 m_nSkipped;
+
+    Thread m_ServeThread;
+    bool m_bStarted;
+    bool m_bStop;
+
+private:
+    SocketServer( const SocketServer & );
+    SocketServer &operator=( const SocketServer & );
+};
+
+#endif // LOGOG_FLAVOR_POSIX
+}
+
+#endif // __LOGOG_SERVER_HPP_
@@ -2,10 +2,6 @@
  * \file socket.hpp Cross-platform socket abstractions
  */
 
-/**
- * \todo Socket support is unfinished and is not working yet.  Please review socket.hpp if you'd like to implement
- * a cross-platform socket abstraction.
- */
 #ifndef __LOGOG_SOCKET_HPP_
 #define __LOGOG_SOCKET_HPP_
 
@@ -13,138 +9,184 @@
 #pragma comment(lib, "wsock32.lib")
 #endif
 
+#ifdef LOGOG_FLAVOR_POSIX
+#include <sys/types.h>
+#include <sys/socket.h>
+#endif
+
 #include <memory.h>
 
 namespace logog
 {
-/** A sending or receiving socket to be used as a target. */
+/** A target that sends each message to a collector over a socket, without ever blocking the thread that logs.
+ ** It can send datagrams or a stream, to a Unix domain socket or to a host and port:
+ **
+ ** - Socket( "/run/collector.sock", SOCK_DGRAM ) sends one datagram per message to a local Unix domain socket;
+ ** - Socket( "/run/collector.sock", SOCK_STREAM ) writes the messages one after another down a Unix domain stream;
+ ** - Socket( "127.0.0.1", SOCK_DGRAM, 514 ) sends one UDP datagram per message;
+ ** - Socket( "collector", SOCK_STREAM, 9987 ) writes to a TCP connection.
+ **
+ ** An address containing a slash is the path of a Unix domain socket, so write ./name for one in the current directory;
+ ** anything else is a host name or a numeric address.  The socket is non-blocking.  Messages go into a queue in memory,
+ ** and as much of the queue as the socket will take is sent after each message, several messages at a time; with
+ ** sendmmsg() for datagrams on Linux, and with a gathering sendmsg() for streams.  If the collector falls behind, the
+ ** queue grows, up to a limit set by SetQueueLimit(), beyond which new messages are dropped and counted.  If the
+ ** collector goes away, or isn't there yet, the socket is closed and connected again later, waiting twice as long after
+ ** each failure, from LOGOG_SOCKET_RETRY_MIN up to LOGOG_SOCKET_RETRY_MAX milliseconds; the queue waits meanwhile.
+ **
+ ** Queued messages are only sent when another message arrives, or when Flush() is called.  The destructor calls
+ ** Flush().  Unix domain sockets are not available on Windows.
+ **/
 class Socket : public Target
 {
 public:
-    static int Initialize()
-    {
-        static bool bInitialized = false;
-
-        if ( !bInitialized )
-        {
-#ifdef LOGOG_FLAVOR_WINDOWS
-            WORD wVersionRequested;
-            WSADATA wsaData;
-            int err;
-            wVersionRequested = MAKEWORD( 2, 2 );
+    /** Prepares the platform's socket library, if it needs it.  Called for each Socket created.  Not named
+     ** Initialize(), which would hide TopicSink::Initialize().
+     **/
+    static int InitializeSockets();
 
-            err = WSAStartup( wVersionRequested, &wsaData );
-
-            if ( err != 0 )
-            {
-#ifdef LOGOG_INTERNAL_DEBUGGING
-                LOGOG_COUT << _LG("WSAStartup failed with error: ") <<  err << endl;
-#endif
-                return 1;
-            }
-
-#endif
-        }
-
-        bInitialized = true;
-
-        return 0;
-    }
-
-    static void Shutdown()
-    {
-#ifdef LOGOG_FLAVOR_WINDOWS
-        WSACleanup();
-#endif
-    }
+    /** Releases the platform's socket library, once every Socket that called InitializeSockets() has called this.
+     **/
+    static void ShutdownSockets();
 
     static const int MAXHOSTNAME = 255;
 
+    /** Creates a socket target that sends to a port on this machine.
+     ** \param type SOCK_STREAM for TCP, or SOCK_DGRAM for UDP.
+     ** \param port The port to send to.
+     **/
     Socket(
         int type = SOCK_STREAM,
         int port = LOGOG_DEFAULT_PORT
-    )
-    {
-        m_Socket = -1;
-        m_nType = type;
-        m_nPort = port;
-    }
+    );
 
-    virtual void Close()
-    {
-#ifdef LOGOG_FLAVOR_WINDOWS
-        closesocket( m_Socket );
-#endif
-#ifdef LOGOG_FLAVOR_POSIX
-        close( m_Socket );
-#endif
-    }
+    /** Creates a socket target.
+     ** \param sAddress The path of a Unix domain socket, if it contains a slash; otherwise a host name or address.
+     ** \param type SOCK_DGRAM to send each message as a datagram, or SOCK_STREAM to send a stream.
+     ** \param port The port to send to.  Ignored for Unix domain sockets.
+     **/
+    Socket(
+        const char *sAddress,
+        int type = SOCK_DGRAM,
+        int port = LOGOG_DEFAULT_PORT
+    );
 
-#ifdef NYI
-    virtual int Create( int type,
-                        int port )
-    {
-        char myname[MAXHOSTNAME+1];
-        int err;
-        struct sockaddr_in sa;
-        struct hostent *hp;
+    /** Tries for a while to send whatever is queued, then closes the socket. */
+    virtual ~Socket();
 
-        memset( &sa, 0, sizeof( struct sockaddr_in ) ); /* clear our address */
-        gethostname( myname, MAXHOSTNAME );         /* who are we? */
-        hp= gethostbyname( myname );                /* get our address info */
+    /** Closes the socket, if it is open.  Queued messages are kept. */
+    virtual void Close();
 
-        if ( hp == NULL )                           /* we don't exist !? */
-            return -1;
+    /** Resolves the address, creates a non-blocking socket and starts connecting it.  Called as needed by
+     ** Output() and Flush().
+     ** \return Zero if the socket is connected or connecting, or -1.
+     **/
+    virtual int Create();
 
-        sa.sin_family= hp->h_addrtype;              /* this is our host address */
-        sa.sin_port= (u_short)htons( (u_short)port );                /* this is our port number */
+    virtual int SetNonBlocking();
 
-        if (( m_Socket = socket( AF_INET, type, 0 ) ) < 0 ) /* create socket */
-            return -1;
+    /** Queues the message, then sends as much of the queue as the socket will take.
+     ** \return Zero, or -1 if the queue is full and the message was dropped.
+     **/
+    virtual int Output( const LOGOG_STRING &output );
 
-        if ( bind( m_Socket,  (struct sockaddr*) &sa, sizeof( struct sockaddr_in ) ) < 0 )
-        {
-            Close();
-            return -1;
-        }
+    /** Sends the queue, waiting up to LOGOG_DEFAULT_SOCKET_FLUSH_TIMEOUT milliseconds for the collector to take it.
+     ** Connects first if the socket is closed, and no retry is pending.
+     ** \return Zero if the queue is empty, or -1.
+     **/
+    virtual int Flush();
 
-        if (( err = SetNonBlocking() ) != 0 )
-            return err;
-    }
+    /** Sets the most bytes of messages that may wait in the queue.  The default is
+     ** LOGOG_DEFAULT_SOCKET_QUEUE_SIZE.
+     **/
+    void SetQueueLimit( size_t nBytes );
 
-#endif // NYI
+    /** Returns the number of messages dropped because the queue was full, or because they were too big to send. */
+    LOGOG_UINT64 GetDroppedCount();
 
-    virtual int SetNonBlocking()
-    {
-        int err;
+    /** Returns the number of bytes of messages waiting in the queue. */
+    size_t GetQueuedBytes();
 
-#ifdef LOGOG_FLAVOR_POSIX
-        int flags;
-        flags = socket_fcntl( m_Socket, F_GETFL, 0 );
-        flags |= O_NONBLOCK;
-        err = socket_fcntl( m_Socket, F_SETFL, flags );
-#endif
+    /** Is the socket connected? */
+    bool IsConnected();
 
-#ifdef LOGOG_FLAVOR_WINDOWS
-        unsigned long parg;
-        parg = 1;
-        err = ioctlsocket( m_Socket, FIONBIO, &parg );
-#endif
-        return err;
-    }
+protected:
+    typedef LOGOG_VECTOR< unsigned char, Allocator< unsigned char > > BytesType;
 
-    virtual int Output( const LOGOG_STRING &output ) = 0;
+    /** The states of the connection. */
+    enum State
+    {
+        STATE_CLOSED,
+        STATE_CONNECTING,
+        STATE_CONNECTED
+    };
+
+    /** Sets up the members; shared by the constructors. */
+    void Construct( const char *sAddress, int type, int port );
+
+    /** Queues nLength bytes as one message, then sends as much of the queue as the socket will take.  The caller
+     ** must hold m_MutexReceive.
+     ** \return Zero, or -1 if the queue is full and the message was dropped.
+     **/
+    int Enqueue( const unsigned char *pData, size_t nLength );
+
+    /** Sends as much of the queue as the socket will take without blocking, connecting first if it is time to.
+     ** The caller must hold m_MutexReceive.
+     **/
+    void SendQueue();
+    /** Sends queued messages as datagrams.  \return false if the socket failed and was closed. */
+    bool SendDatagrams();
+    /** Sends queued messages down the stream.  \return false if the socket failed and was closed. */
+    bool SendStream();
+    /** Checks whether a connection in progress has finished.  \return false if it failed and was closed. */
+    bool FinishConnecting();
+    /** Called with m_MutexReceive held each time the socket connects, before anything is sent.  Does nothing
+     ** here; a target whose stream must begin with a header, such as BinarySocket, starts its stream again.
+     **/
+    virtual void Connected();
+    /** Waits until the socket can be written, or nMilliseconds pass. */
+    void WaitForWritable( unsigned int nMilliseconds );
+
+    /** Closes the socket after a failure, and schedules the next attempt to connect. */
+    void Disconnect();
+
+    /** Drops the first message in the queue. */
+    void PopMessage();
+    /** Drops every message in the queue, and counts them as dropped. */
+    void DropQueue();
+    /** Returns the message whose length is at nPosition in the queue, and sets nLength to its length. */
+    const unsigned char *PeekMessage( size_t nPosition, size_t &nLength ) const;
 
-protected:
     int m_Socket;
     int m_nType;
     int m_nPort;
-};
-
-class SocketServer : Socket
-{
 
+    /** The address given to the constructor. */
+    char *m_pAddress;
+    State m_nState;
+
+    /** The queue: each message is its length, as an unsigned int, followed by its bytes.  The messages before
+     ** m_nQueueHead are gone, and the first m_nQueueSent bytes of the message at m_nQueueHead are already sent.
+     **/
+    BytesType m_vQueue;
+    size_t m_nQueueHead;
+    size_t m_nQueueSent;
+    /** The bytes of messages in the queue, not counting their lengths. */
+    size_t m_nQueuedBytes;
+    size_t m_nQueueLimit;
+    LOGOG_UINT64 m_nDropped;
+    /** The number of bytes sent down the stream, over every connection. */
+    LOGOG_UINT64 m_nStreamSent;
+
+    /** The time, from GetMonotonicNanoseconds(), before which no attempt to connect is made. */
+    LOGOG_UINT64 m_nRetryTime;
+    /** How long to wait after the next failure, in milliseconds. */
+    unsigned int m_nRetryDelay;
+
+private:
+    Socket( const Socket & );
+    Socket &operator=( const Socket & );
 };
 }
 
-#endif // __LOGOG_CHECKPOINT_HPP_
+#endif // __LOGOG_SOCKET_HPP_
@@ -40,6 +40,8 @@ public:
     void *s_pAllFilterNodes;
     /** Pointers to the group of all valid targets. */
     void *s_pAllTargets;
+    /** Pointers to all messages; only maintained if LOGOG_STATISTICS is defined. */
+    void *s_pAllMessages;
     /** Pointer to the default filter, if any. */
     void *s_pDefaultFilter;
     /** The default global shared timer.  All events are generally in reference to this timer, though yoy may create your own timers. */
@@ -52,6 +54,11 @@ public:
     Formatter *s_pDefaultFormatter;
     /** The number of sockets created. */
     int s_nSockets;
+    /** The number of messages being transmitted, plus LOGOG_TRANSMIT_CLOSED once Shutdown() has started draining
+     ** the targets and no more messages are transmitted.  Kept in one word, so that a message either sees that
+     ** logog is closed or is counted before Shutdown() waits for the count.  Read and written with the
+     ** LOGOG_ATOMIC macros. */
+    LOGOG_UINT64 s_nTransmitting;
     /** A pointer to this object; used for final destruction. */
     Statics *s_pSelf;
 
@@ -0,0 +1,151 @@
+/**
+ * \file stats.hpp Counters describing where logog spends its time, and a snapshot API for reading them.
+ */
+
+#ifndef __LOGOG_STATS_HPP__
+#define __LOGOG_STATS_HPP__
+
+namespace logog
+{
+
+/** \def LOGOG_STATISTICS
+ ** Define this macro to compile logog's instrumentation into the library.  When it is not defined, none of the
+ ** counters exist and GetStats() returns an empty snapshot.  When it is defined, the cost on the logging path is
+ ** a handful of relaxed atomic increments per message and two clock reads around each call to Target::Output().
+ ** Defining LOGOG_STATISTICS also defines LOGOG_MUTEX_STATISTICS.
+ **/
+
+/** The live counters kept for each target.  These are updated by the target as it outputs; read them through
+ ** GetStats() rather than directly.
+ **/
+struct TargetStatistics
+{
+	/** The number of strings passed to Output(). */
+	LOGOG_UINT64 m_nMessages;
+	/** The number of bytes passed to Output(). */
+	LOGOG_UINT64 m_nBytes;
+	/** The number of calls to Output() that returned an error. */
+	LOGOG_UINT64 m_nErrors;
+	/** A histogram of the time taken by each call to Output().  \sa LOGOG_STATISTICS_LATENCY_BUCKETS */
+	LOGOG_UINT64 m_vOutputLatency[ LOGOG_STATISTICS_LATENCY_BUCKETS ];
+	/** The number of messages put in the target's delivery queue.  \sa Target::SetDeliveryQueue */
+	LOGOG_UINT64 m_nQueued;
+	/** The number of messages dropped because the delivery queue was full, or was stopped at a deadline. */
+	LOGOG_UINT64 m_nDropped;
+	/** The total time that delivered messages waited in the queue, in nanoseconds. */
+	LOGOG_UINT64 m_nLagNanoseconds;
+	/** The longest time that any delivered message waited in the queue, in nanoseconds. */
+	LOGOG_UINT64 m_nMaxLagNanoseconds;
+};
+
+/** Clears a set of target counters. */
+extern void ResetTargetStatistics( TargetStatistics &stats );
+
+/** Adds a single output of nBytes bytes, taking nNanoseconds, to a set of target counters. */
+extern void RecordTargetOutput( TargetStatistics &stats, size_t nBytes, LOGOG_UINT64 nNanoseconds, int nError );
+
+#ifdef LOGOG_STATISTICS
+/** The number of calls to Object::Allocate() since the program started. */
+extern LOGOG_UINT64 s_nStatisticsAllocations;
+/** The number of calls to Object::Deallocate() since the program started. */
+extern LOGOG_UINT64 s_nStatisticsDeallocations;
+/** The total number of bytes requested from Object::Allocate() since the program started. */
+extern LOGOG_UINT64 s_nStatisticsBytesAllocated;
+#endif // LOGOG_STATISTICS
+
+/** A point-in-time copy of every counter that logog keeps about itself.  Fill one in with GetStats(), then read
+ ** its fields or render it as text or JSON.  The snapshot holds pointers to the names of targets and source files;
+ ** these remain valid while the corresponding Target and Message objects exist.
+ **/
+class Statistics : public Object
+{
+public:
+	/** The counters for a single target. */
+	struct TargetEntry
+	{
+		/** The name of the target.  \sa Target::GetName */
+		const LOGOG_CHAR *m_sName;
+		/** The address of the target, to tell apart targets of the same name. */
+		const void *m_pTarget;
+		/** The counters for this target at the time of the snapshot. */
+		TargetStatistics m_Counters;
+		/** Contention on the mutex that serializes Receive() for this target. */
+		MutexStatistics m_ReceiveLock;
+		/** The number of messages waiting in the target's delivery queue at the time of the snapshot. */
+		size_t m_nWaiting;
+		/** How long the oldest of those messages had waited, in nanoseconds. */
+		LOGOG_UINT64 m_nLag;
+
+		/** Estimates the given percentile (0.0 to 1.0) of the output latency in nanoseconds, using the upper
+		 ** bound of the histogram bucket that contains it.  Returns zero if no outputs have been recorded.
+		 **/
+		LOGOG_UINT64 OutputLatencyPercentile( double dPercentile ) const;
+	};
+
+	/** The counters for a single logging call site, i.e. the static Message behind one INFO(), WARN() etc. */
+	struct MessageEntry
+	{
+		/** The source file of the call site. */
+		const LOGOG_CHAR *m_sFileName;
+		/** The line number of the call site. */
+		int m_nLineNumber;
+		/** The level of the call site. */
+		LOGOG_LEVEL_TYPE m_nLevel;
+		/** The number of times the call site has transmitted a message. */
+		LOGOG_UINT64 m_nHits;
+		/** Contention on the mutex that serializes formatting and transmitting this message. */
+		MutexStatistics m_TransmitLock;
+	};
+
+	typedef LOGOG_VECTOR< TargetEntry, Allocator< TargetEntry > > TargetEntriesType;
+	typedef LOGOG_VECTOR< MessageEntry, Allocator< MessageEntry > > MessageEntriesType;
+
+	Statistics();
+
+	/** Discards the contents of this snapshot. */
+	void Clear();
+
+	/** Returns the target furthest behind: the one whose oldest queued message has waited longest, or, if no
+	 ** messages are waiting, the one whose messages waited longest before.  Returns NULL if no target has ever
+	 ** kept a message waiting.  \sa Target::SetDeliveryQueue
+	 **/
+	const TargetEntry *GetSlowestTarget() const;
+
+	/** Renders a human-readable, null-terminated description of this snapshot into out, one line per counter
+	 ** group.  The previous contents of out are discarded.
+	 **/
+	void RenderText( LOGOG_STRING &out ) const;
+
+	/** Renders a null-terminated JSON object describing this snapshot into out.  The previous contents of out
+	 ** are discarded.
+	 **/
+	void RenderJSON( LOGOG_STRING &out ) const;
+
+	/** True iff logog was compiled with LOGOG_STATISTICS.  All counters are zero otherwise. */
+	bool m_bEnabled;
+
+	/** The number of calls to the logog allocator. */
+	LOGOG_UINT64 m_nAllocations;
+	/** The number of calls to the logog deallocator. */
+	LOGOG_UINT64 m_nDeallocations;
+	/** The number of bytes requested from the logog allocator. */
+	LOGOG_UINT64 m_nBytesAllocated;
+
+	/** Contention on the mutex held while call sites create their Message objects. */
+	MutexStatistics m_MessageCreationLock;
+
+	/** One entry per existing target. */
+	TargetEntriesType m_vTargets;
+
+	/** One entry per existing call site. */
+	MessageEntriesType m_vMessages;
+};
+
+/** Takes a snapshot of all logog counters into stats.  Any previous contents of stats are discarded.  This
+ ** function locks the global target and message lists, so avoid calling it at a high rate.
+ **/
+extern void GetStats( Statistics &stats );
+
+}
+
+#endif // __LOGOG_STATS_HPP__
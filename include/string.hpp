@@ -65,6 +65,14 @@ namespace logog
 		virtual ~String();
 		virtual void Free();
 		static size_t Length( const LOGOG_CHAR *chars );
+		/** Returns the number of bytes that EncodeUTF8() writes for nCount characters. */
+		static size_t UTF8Length( const LOGOG_CHAR *pChars, size_t nCount );
+		/** Encodes nCount characters as UTF-8 into pOut, which must hold UTF8Length() bytes, and returns the end
+		 ** of what was written.  In Unicode builds wchar_t is read as UTF-16 where it is two bytes wide, as on
+		 ** Windows, and as UTF-32 elsewhere; unpaired surrogates and values past U+10FFFF become U+FFFD.  Narrow
+		 ** characters are taken to be UTF-8 already, and are copied.
+		 **/
+		static unsigned char *EncodeUTF8( const LOGOG_CHAR *pChars, size_t nCount, unsigned char *pOut );
 
 		String( const String &other );
 		String( const LOGOG_CHAR *pstr );
@@ -74,10 +82,23 @@ namespace logog
 		virtual void clear();
 		virtual size_t reserve( size_t nSize );
 		virtual size_t reserve_for_int();
+		/** Enlarges this string's buffer to hold at least nSize LOGOG_CHARs, keeping the current contents.
+		 ** Unlike reserve(), this never shrinks the buffer or discards what has been written.
+		 ** \return The new capacity of the buffer in LOGOG_CHARs.
+		 **/
+		virtual size_t grow( size_t nSize );
+		/** Returns the number of LOGOG_CHARs that this string can hold without reallocating. */
+		size_t capacity() const;
 		virtual operator const LOGOG_CHAR *() const;
 		virtual size_t assign( const String &other );
 		virtual size_t append( const String &other );
 		virtual size_t append( const LOGOG_CHAR *other );
+		/** Appends up to nCount LOGOG_CHARs from other, which need not be null-terminated.  If there is room
+		 ** left in the buffer afterwards, a null is written after the last character without being counted
+		 ** in size(), so that the buffer may still be read as a C string.
+		 ** \return The new size of the string.
+		 **/
+		virtual size_t append( const LOGOG_CHAR *other, size_t nCount );
 		virtual void reverse( LOGOG_CHAR* pStart, LOGOG_CHAR* pEnd);
 		virtual size_t assign( const int value );
 		virtual size_t append( const LOGOG_CHAR c );
@@ -0,0 +1,53 @@
+/**
+ * \file syslog.hpp A target that sends RFC 5424 messages to the system logger.
+ */
+
+#ifndef __LOGOG_SYSLOG_HPP_
+#define __LOGOG_SYSLOG_HPP_
+
+namespace logog
+{
+/** A target that sends each message to the system logger as an RFC 5424 datagram, formatted by a
+ ** FormatterSyslog; so the levels become syslog severities, and the group, category, file and line arrive as
+ ** structured data.  By default it writes straight to the local logger's Unix domain socket at LOGOG_SYSLOG_PATH,
+ ** without going through syslog(3), which takes a lock and makes a blocking call for every message.  Given a host
+ ** name instead of a path, it sends UDP datagrams to LOGOG_SYSLOG_PORT on that host.
+ **
+ ** Sending works as for Socket: the socket is non-blocking, messages that the logger can't take yet wait in a
+ ** bounded queue and go out several at a time once it catches up, and if the logger isn't running, the target keeps
+ ** trying to reach it.  In Unicode builds the messages are sent as UTF-8.
+ **/
+class Syslog : public Socket
+{
+public:
+    /** Creates a syslog target.
+     ** \param sAddress The path of the logger's socket, or the name of a host to send UDP datagrams to.
+     ** \param nFacility The syslog facility.  \sa FormatterSyslog
+     ** \param sAppName The application name.  If NULL, the name of the program is used where it can be found.
+     ** \param port The UDP port to send to.  Ignored for Unix domain sockets.
+     **/
+    Syslog(
+        const char *sAddress = LOGOG_SYSLOG_PATH,
+        int nFacility = LOGOG_SYSLOG_FACILITY,
+        const char *sAppName = NULL,
+        int port = LOGOG_SYSLOG_PORT
+    );
+
+    /** Queues the message, converting it to UTF-8 first in Unicode builds, then sends what the socket will take. */
+    virtual int Output( const LOGOG_STRING &output );
+
+protected:
+    FormatterSyslog m_Formatter;
+
+#ifdef LOGOG_UNICODE
+    /** The message being converted to UTF-8. */
+    BytesType m_vUTF8;
+#endif // LOGOG_UNICODE
+
+private:
+    Syslog( const Syslog & );
+    Syslog &operator=( const Syslog & );
+};
+}
+
+#endif // __LOGOG_SYSLOG_HPP_
@@ -7,6 +7,14 @@
 
 namespace logog
 {
+/** The delivery queue of a target, private to target.cpp.  \sa Target::SetDeliveryQueue */
+struct DeliveryQueue;
+
+/** Stops the delivery queues of all targets.  Called during shutdown.
+ ** \param bDiscard If true, messages still waiting are dropped rather than delivered.
+ **/
+extern void StopDeliveryQueues( bool bDiscard );
+
 /** A target is abstraction representing an output stream from logog.  cerr, cout, and syslog, and other logging formats are supported.
  ** Targets do not validate their received data.  Their only job is to render it on a call to Receive() to their supported target
  ** type.  Targets should generally make sure to handle calls on multiple threads -- they should make sure to avoid overlapping
@@ -16,11 +24,14 @@ namespace logog
 class Target : public TopicSink
 {
     friend class LogBuffer;
+    friend void StopDeliveryQueues( bool bDiscard );
 public :
     Target();
 	virtual ~Target();
 
-    /** Sets the current formatter for this target. */
+    /** Sets the current formatter for this target.  If the target has a delivery queue, first waits for the
+     ** messages already in it, which the old formatter rendered, to be delivered.
+     **/
     void SetFormatter( Formatter &formatter );
 
     /** Returns a reference to the current formatter for this target. */
@@ -40,14 +51,99 @@ public :
      */
     virtual int Receive( const Topic &topic );
 
+	/** Passes the topic to Receive(), or, if this target has a delivery queue, formats it and queues it.
+	 ** \return Zero if the topic was received or queued; an error code otherwise.  Errors in delivering queued
+	 ** topics are only counted in this target's statistics.
+	 **/
+	virtual int Deliver( const Topic &topic );
+
+	/** Gives this target a delivery queue and a thread of its own, so that a slow target holds up neither the
+	 ** threads that log nor the other targets.  Each message is still formatted on the thread that logs it,
+	 ** sharing its output with the other targets as usual; the output is then queued, and this target's thread
+	 ** passes the queued messages to Receive() in order.  The topic it passes carries the level, line number,
+	 ** time, file name, group, category and message of the original, as well as its output.
+	 **
+	 ** Once nMessages messages are waiting, a thread that logs waits for room, or drops its message if
+	 ** bDropWhenFull.  Zero delivers whatever is waiting, stops the thread, and makes delivery synchronous again.
+	 ** Call this before other threads log to the target.  Since the target's thread calls its virtual functions,
+	 ** call this with zero before destroying the target yourself; LOGOG_SHUTDOWN() stops every queue for you.
+	 **/
+	void SetDeliveryQueue( size_t nMessages = LOGOG_DEFAULT_DELIVERY_QUEUE_SIZE, bool bDropWhenFull = false );
+
+	/** Waits until every queued message has been delivered, or until nDeadline, a time from
+	 ** GetMonotonicNanoseconds(), has passed.  \return true if no messages are waiting.
+	 **/
+	bool WaitForDelivery( LOGOG_UINT64 nDeadline );
+
+	/** Returns the number of messages waiting in the delivery queue, counting the one being delivered. */
+	size_t GetQueuedMessages() const;
+
+	/** Returns how long the oldest message in the delivery queue has waited, in nanoseconds, or zero. */
+	LOGOG_UINT64 GetDeliveryLag() const;
+
 	/** Does this target want its formatter to null terminate its strings? */
 	bool GetNullTerminatesStrings() const { return m_bNullTerminatesStrings; }
 
 	/** Tells this target whether to request its formatter to null terminate its strings. */
 	void SetNullTerminatesStrings(bool val) { m_bNullTerminatesStrings = val; }
 
+	/** Returns a short name for this target, used to identify it in statistics. */
+	const LOGOG_CHAR *GetName() const { return m_sName; }
+
+	/** Sets the name of this target.  The string is not copied, so it must outlive the target. */
+	void SetName( const LOGOG_CHAR *sName ) { m_sName = sName; }
+
+	/** Copies this target's counters and lock statistics into entry.  \sa GetStats */
+	void GetStatistics( Statistics::TargetEntry &entry ) const;
+
+	/** Writes any output this target holds in memory to the emergency descriptors with EmergencyWrite().  Called
+	 ** by EmergencyFlush(), possibly from a signal handler, so it must not lock, allocate or call stdio.  The
+	 ** default does nothing.  \sa AddEmergencyTarget
+	 **/
+	virtual void EmergencyDump() {}
+
+	/** Passes any output this target is holding on to wherever it is going, such as the operating system.  The
+	 ** default does nothing.  \return Zero, or an error code if the output could not be written.
+	 **/
+	virtual int Flush() { return 0; }
+
+	/** Flushes, and then waits until the output is on stable storage.  The default just flushes.
+	 ** \return Zero, or an error code if the output could not be written.
+	 **/
+	virtual int Sync() { return Flush(); }
 
 protected:
+	/** Calls Output(), and records the call in this target's statistics if LOGOG_STATISTICS is defined.
+	 ** The caller must hold m_MutexReceive.
+	 **/
+	int TimedOutput( const LOGOG_STRING &data );
+
+	/** Formats the topic before m_MutexReceive is taken, if the formatter is reentrant and the topic is being
+	 ** transmitted, so that only Output() is serialized.  The output is shared with the other targets that use the
+	 ** same formatter, so that it is formatted once.  \sa Topic::GetFormatted, Formatter::IsReentrant
+	 ** \return The output, to be passed to FormatAndOutput(), or NULL.
+	 **/
+	FormattedMessage *PrepareOutput( const Topic &topic );
+
+	/** Passes pFormatted to TimedOutput(), and releases it.  If pFormatted is NULL, formats the topic first.  The
+	 ** caller must hold m_MutexReceive.
+	 **/
+	int FormatAndOutput( const Topic &topic, FormattedMessage *pFormatted = NULL );
+
+	/** Formats the topic, and queues it for this target's delivery thread.  \sa SetDeliveryQueue */
+	int Enqueue( const Topic &topic );
+
+	/** Returns the topic's output for this target, formatting it if no other target has.  The caller must
+	 ** Release() it.
+	 **/
+	FormattedMessage *FormatForQueue( const Topic &topic );
+
+	/** Stops the delivery thread, once it has delivered every message waiting, or dropped them if bDiscard. */
+	void StopDelivery( bool bDiscard );
+
+	/** The entry point of the delivery thread. */
+	static void *DeliveryThread( void *pvTarget );
+
     /** A pointer to the formatter used for this output. */
     Formatter *m_pFormatter;
     /** A mutex on the Receive() function. */
@@ -56,17 +152,34 @@ protected:
 	 ** don't require null terminated strings, but line outputs do.
 	 **/
 	bool m_bNullTerminatesStrings;
+	/** The name of this target.  \sa GetName */
+	const LOGOG_CHAR *m_sName;
+	/** The output of topics that are formatted for this target alone.  Guarded by m_MutexReceive. */
+	LOGOG_STRING m_sOutputBuffer;
+	/** The delivery queue, or NULL if this target has never had one.  Kept until the target is destroyed. */
+	DeliveryQueue *m_pDelivery;
+
+#ifdef LOGOG_STATISTICS
+	/** Counters for this target.  Updated with relaxed atomic operations by TimedOutput(). */
+	TargetStatistics m_Statistics;
+#endif // LOGOG_STATISTICS
 };
 
 /** A target representing the cerr stream. */
 class Cerr : public Target
 {
+public:
+	Cerr();
+private:
     virtual int Output( const LOGOG_STRING &data );
 };
 
 /** A target representing the cout stream. */
 class Cout : public Target
 {
+public:
+	Cout();
+private:
     virtual int Output( const LOGOG_STRING &data );
 };
 
@@ -75,9 +188,100 @@ class Cout : public Target
   */
 class OutputDebug : public Target
 {
+public:
+	OutputDebug();
+private:
     virtual int Output( const LOGOG_STRING &data );
 };
 
+/** A target that discards everything it receives.  Use it to measure the cost of routing and formatting
+ ** messages without the cost of any I/O.  If formatting is skipped, the target does not call its formatter at
+ ** all, and Output() is called with an empty string; this isolates the cost of routing alone.
+ **/
+class NullTarget : public Target
+{
+public:
+	NullTarget( bool bSkipFormatting = false );
+
+	/** Receives a topic, formatting it only if formatting is not skipped. */
+	virtual int Receive( const Topic &topic );
+
+	/** Discards the data. */
+	virtual int Output( const LOGOG_STRING &data );
+
+	/** Does this target skip formatting of the topics it receives? */
+	bool GetSkipFormatting() const { return m_bSkipFormatting; }
+
+	/** Tells this target whether to skip formatting of the topics it receives. */
+	void SetSkipFormatting( bool val ) { m_bSkipFormatting = val; }
+
+protected:
+	bool m_bSkipFormatting;
+	/** The string passed to Output() when formatting is skipped. */
+	LOGOG_STRING m_sEmpty;
+};
+
+/** A target that captures formatted messages in memory, so that they can be inspected afterwards.  Each message
+ ** is appended to a single arena, which is preallocated and doubles in size whenever it fills up; no allocation
+ ** occurs per message except when the arena or the record index grows.  Each record is stored null-terminated,
+ ** so GetRecord() may be treated as an ordinary C string.  The queries take the same lock as Receive(), so they
+ ** may be called while other threads are logging.  MemoryTarget is intended for tests and benchmarks; nothing is
+ ** ever discarded until Clear() is called.
+ **/
+class MemoryTarget : public Target
+{
+public:
+	/** Creates a MemoryTarget.
+	 ** \param nSize The initial size of the arena in LOGOG_CHAR units.
+	 **/
+	MemoryTarget( size_t nSize = LOGOG_DEFAULT_MEMORY_TARGET_SIZE );
+	virtual ~MemoryTarget();
+
+	/** Appends the message to the arena. */
+	virtual int Output( const LOGOG_STRING &data );
+
+	/** Returns the number of records captured since creation or the last call to Clear(). */
+	size_t GetRecordCount() const;
+
+	/** Returns a pointer to the null-terminated text of record nRecord, or NULL if there is no such record.
+	 ** The pointer is invalidated by the next message received or by Clear().
+	 **/
+	const LOGOG_CHAR *GetRecord( size_t nRecord ) const;
+
+	/** Returns the length of record nRecord in LOGOG_CHAR units, not counting the null terminator, or zero if
+	 ** there is no such record.
+	 **/
+	size_t GetRecordLength( size_t nRecord ) const;
+
+	/** Returns the number of records that contain sText. */
+	size_t CountRecordsContaining( const LOGOG_CHAR *sText ) const;
+
+	/** Returns the total number of LOGOG_CHAR units in use in the arena, including null terminators. */
+	size_t GetUsed() const;
+
+	/** Discards all captured records.  The arena is kept for reuse. */
+	void Clear();
+
+protected:
+	typedef LOGOG_VECTOR< size_t, Allocator< size_t > > OffsetsType;
+
+	/** Makes room for at least nSize more LOGOG_CHAR units in the arena.  Returns false if memory is exhausted. */
+	bool Reserve( size_t nSize );
+
+	/** The arena. */
+	LOGOG_CHAR *m_pArena;
+	/** The number of LOGOG_CHAR units allocated in the arena. */
+	size_t m_nSize;
+	/** The number of LOGOG_CHAR units used in the arena. */
+	size_t m_nUsed;
+	/** The offset of the start of each record in the arena. */
+	OffsetsType m_vOffsets;
+
+private:
+	MemoryTarget( const MemoryTarget & );
+	MemoryTarget &operator=( const MemoryTarget & );
+};
+
 /** A LogFile renders received messages to a file.  Provide the name of the file to be rendered to as
  * a parameter to the construction of the LogFile() object.  Destroying a LogFile object will cause the
  * output file to be closed.  LogFile objects always append to the output file; they do not delete the previous
@@ -112,6 +316,36 @@ public:
     /** Writes the message to the log file. */
     virtual int Output( const LOGOG_STRING &data );
 
+	/** Receives a topic, noting its level for the index.  \sa EnableIndex */
+	virtual int Receive( const Topic &topic );
+
+	/** Writes the stdio buffers of the log and its index to the operating system. */
+	virtual int Flush();
+
+	/** Flushes, then waits for the log and its index to reach the disk with fsync(). */
+	virtual int Sync();
+
+	/** Makes messages at level or more severe durable: Receive() does not return until the message is on disk,
+	 ** as far as fdatasync() can tell.  Messages logged by several threads at once are group committed, so that one
+	 ** fdatasync() covers every message written while the previous one was running, and the cost per message
+	 ** falls as the load rises.  Less severe messages are buffered as usual, but reach the disk with the next
+	 ** durable one.  Once an fdatasync() has failed, every later durable message reports an error, since the
+	 ** kernel may have dropped the pages that failed.  LOGOG_LEVEL_NONE, the default, makes nothing durable.
+	 **/
+	void SetDurableLevel( LOGOG_LEVEL_TYPE level );
+
+	/** Returns the number of fdatasync() calls made for durable messages. */
+	LOGOG_UINT64 GetCommitCount();
+
+	/** Makes this log file keep a sidecar index, named by appending LOGOG_INDEX_SUFFIX to the log's file name.
+	 ** Records are grouped into buckets of about nIntervalBytes bytes or nIntervalRecords records, whichever
+	 ** comes first, and the index gets an entry for each bucket with its time span, byte range and most severe
+	 ** level.  Use LogIndex or logog-cat to find the parts of the log written during some period.  Call this
+	 ** before the first message is written.  Zero for either interval disables that limit.
+	 ** \return true, or false if this kind of log file can't be indexed, in which case no index is kept.
+	 **/
+	virtual bool EnableIndex( size_t nIntervalBytes = LOGOG_DEFAULT_INDEX_INTERVAL, size_t nIntervalRecords = 0 );
+
 	/** Should a Unicode BOM be written to the beginning of this log file, if the log file
 	 * was previously empty?  By default a BOM is written to a log file if LOGOG_UNICODE
 	 * is enabled. */
@@ -127,6 +361,58 @@ protected:
 	/** Does the actual fwrite to the file.  Call Output() instead to handle error conditions better. */
 	virtual int InternalOutput( size_t nSize, const LOGOG_CHAR *pData );
 
+	/** Writes everything output so far to the operating system.  The caller must hold m_MutexReceive. */
+	virtual int FlushOutput();
+
+	/** Waits for everything flushed so far to reach the disk.  A thread leading a group commit calls this without
+	 ** holding m_MutexReceive, so it must not depend on anything that Output() changes.
+	 ** \param bDataOnly If true, only the data and the metadata needed to read it back need reach the disk.
+	 **/
+	virtual int SyncOutput( bool bDataOnly );
+
+	/** Returns the size of the log, including output not flushed yet.  Called once the log is open. */
+	virtual LOGOG_UINT64 GetOutputSize();
+
+	/** Waits until commit number nCommit is on disk, running fdatasync() itself if no other thread is.
+	 ** \return Zero, or -1 if an fdatasync() has failed.
+	 **/
+	int WaitForCommit( LOGOG_UINT64 nCommit );
+
+	/** Opens the index file, if an index was requested, once the log file is open. */
+	void OpenIndex();
+	/** Adds a record of nBytes bytes to the current bucket, writing the bucket's entry once it is full. */
+	void IndexRecord( size_t nBytes );
+	/** Writes the entry for the current bucket, if it has any records. */
+	void WriteIndexBucket();
+
+	/** The size of an index bucket in bytes and in records, or zero if there is no such limit. */
+	size_t m_nIndexIntervalBytes;
+	size_t m_nIndexIntervalRecords;
+	/** True if EnableIndex() has been called. */
+	bool m_bIndexEnabled;
+	FILE *m_pIndexFile;
+	/** The bucket being filled. */
+	LogIndexEntry m_IndexBucket;
+	/** The offset in the log file at which the next record will be written. */
+	LOGOG_UINT64 m_nIndexOffset;
+	/** The level of the topic being written, or LOGOG_LEVEL_ALL if it isn't known. */
+	LOGOG_LEVEL_TYPE m_nOutputLevel;
+
+	/** The least severe level that is committed to disk.  \sa SetDurableLevel */
+	LOGOG_LEVEL_TYPE m_nDurableLevel;
+	/** Guards the commit counters below, and wakes threads waiting for a commit. */
+	Condition m_CommitCondition;
+	/** The number of durable messages written to the operating system. */
+	LOGOG_UINT64 m_nCommitQueued;
+	/** The number of durable messages known to be on disk. */
+	LOGOG_UINT64 m_nCommitDone;
+	/** The number of fdatasync() calls made. */
+	LOGOG_UINT64 m_nCommits;
+	/** True while a thread is running fdatasync() on behalf of the others. */
+	bool m_bCommitting;
+	/** True once an fdatasync() has failed. */
+	bool m_bCommitFailed;
+
 private:
     LogFile();
 };
@@ -135,6 +421,11 @@ private:
   * target.  Can be used for buffering log output in memory and then storing it to a log file upon program completion.
   * To use, create another target (such as a LogFile) and then create a LogBuffer, providing the other target
   * as a parameter to the creation function.
+  *
+  * By default the buffer is only dumped when it is full or when Dump() is called.  SetFlushInterval(),
+  * SetFlushThreshold() and SetFlushLevel() dump it automatically as well, so that a large buffer gives the
+  * throughput of large writes while its output is never more than a little stale.  An automatic dump also flushes
+  * the output target.
   */
 class LogBuffer : public Target
 {
@@ -158,7 +449,44 @@ public:
 
     virtual int Output( const LOGOG_STRING &data );
 
+    /** Writes the messages in the buffer to the emergency descriptors, without emptying it. */
+    virtual void EmergencyDump();
+
+    /** Dumps the buffer to the output target, and then flushes the output target. */
+    virtual int Flush();
+
+    /** Dumps the buffer to the output target, and then syncs the output target. */
+    virtual int Sync();
+
+    /** Receives a topic, and dumps the buffer afterwards if the flush policy calls for it. */
+    virtual int Receive( const Topic &topic );
+
+    /** Dumps the buffer from a background thread every nMilliseconds, if it holds anything.  Zero, the default,
+     ** stops the background thread.
+     **/
+    void SetFlushInterval( unsigned int nMilliseconds );
+
+    /** Dumps the buffer once it holds nBytes bytes or nRecords messages, whichever comes first.  Zero for either
+     ** disables that limit; both are zero by default.
+     **/
+    void SetFlushThreshold( size_t nBytes, size_t nRecords = 0 );
+
+    /** Dumps the buffer as soon as a message at level or more severe is received, on the thread that logged it,
+     ** so that errors reach the output before the call that logged them returns.  LOGOG_LEVEL_NONE, the default,
+     ** disables this.
+     **/
+    void SetFlushLevel( LOGOG_LEVEL_TYPE level );
+
 protected:
+    /** Dumps the buffer and flushes the output target.  The caller must hold m_MutexReceive. */
+    int DumpAndFlush();
+
+    /** Stops the background thread started by SetFlushInterval(), if it is running. */
+    void StopFlushThread();
+
+    /** The entry point of the background thread. */
+    static void *FlushThread( void *pvParams );
+
     virtual void Allocate( size_t size );
 
     virtual void Deallocate();
@@ -173,6 +501,19 @@ protected:
     size_t m_nSize;
     /** A pointer to the target to which the buffer will be rendered upon calling Dump(). */
     Target *m_pOutputTarget;
+    /** The number of messages in the buffer. */
+    size_t m_nRecords;
+    /** The flush policy.  \sa SetFlushThreshold SetFlushLevel */
+    size_t m_nFlushBytes;
+    size_t m_nFlushRecords;
+    LOGOG_LEVEL_TYPE m_nFlushLevel;
+    /** The period of the background thread in milliseconds.  Guarded by m_FlushCondition. */
+    unsigned int m_nFlushInterval;
+    /** Wakes the background thread when the interval changes or it should stop. */
+    Condition m_FlushCondition;
+    bool m_bFlushStop;
+    Thread m_FlushThread;
+    bool m_bFlushThreadStarted;
 };
 
 }
@@ -79,7 +79,7 @@ public:
     {
         m_pFnThreadStart = fnThreadStart;
         m_pvThreadParams = pvParams;
-        m_Thread = nullptr;
+        m_Thread = LOGOG_THREAD();
     }
 
     /** Cause the created thread to commence execution asynchronously. */
@@ -125,6 +125,13 @@ private:
     /** An arbitrary argument to the thread entry point. */
     void* m_pvThreadParams;
 };
+
+/** Returns a number identifying the calling thread, suitable for printing.  On Linux this is the kernel
+ ** thread id, as shown by ps and top; on Windows it is the thread id; elsewhere it is derived from
+ ** LOGOG_THREAD_SELF.  The value is cached per thread where the compiler supports thread-local storage, so
+ ** calling this for every message is cheap.
+ **/
+extern LOGOG_UINT64 GetCurrentThreadIdentifier();
 }
 
 #endif // __LOGOG_THREAD_HPP_
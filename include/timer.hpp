@@ -37,6 +37,17 @@ protected:
 extern Timer &GetGlobalTimer();
 extern void DestroyGlobalTimer();
 
+/** Returns the value of a monotonic clock in nanoseconds.  The starting point of this clock is arbitrary, so it is
+ ** only useful for measuring intervals.  Unlike Timer, this function does not allocate and does not depend on
+ ** logog::Initialize() having been called.
+ **/
+extern LOGOG_UINT64 GetMonotonicNanoseconds();
+
+/** Returns the wall clock time in nanoseconds since the start of 1970, UTC.  Unlike GetMonotonicNanoseconds(), this
+ ** clock may jump if the system time is changed, so use it for time stamps rather than intervals.
+ **/
+extern LOGOG_UINT64 GetRealtimeNanoseconds();
+
 }
 
 #endif // __LOGOG_TIMER_HPP_
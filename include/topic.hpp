@@ -9,6 +9,11 @@
 namespace logog
 {
 
+class FieldSet;
+class Formatter;
+class FormattedMessage;
+class Target;
+
 /** A subject that nodes can choose to discuss with one another.
  ** Subscribers generally have very general topics, while publishers generally have very specific topics.
  **/
@@ -30,6 +35,9 @@ public:
            const LOGOG_CHAR *sMessage = NULL,
            const double dTimestamp = 0.0f );
 
+    /** Releases the formatted output kept from the last transmission. */
+    virtual ~Topic();
+
     /** Topics are always topics.  We use this to avoid any RTTI dependence. */
     virtual bool IsTopic() const;
 
@@ -37,7 +45,9 @@ public:
      ** \return 0 if successful, non-zero if this topic failed to send the publication to all subscribers */
     virtual int Send( const Topic &node );
 
-    /** Causes this topic to publish itself to all its subscribers. */
+    /** Causes this topic to publish itself to all its subscribers.  While it does, each formatter renders the
+     ** topic at most once; see GetFormatted().
+     **/
     virtual int Transmit();
 
     /** Permits this node to receive a publication from another node, and act upon it.
@@ -46,6 +56,12 @@ public:
      **/
     virtual int Receive( const Topic &node );
 
+    /** Called by Send() for each subscriber.  Passes the publication to Receive(); a target with a delivery queue
+     ** queues it instead.  \sa Target::SetDeliveryQueue
+     ** \return 0 if successful, non-zero if this node failed to process the publication
+     **/
+    virtual int Deliver( const Topic &node );
+
     /** Is this topic interested in receiving notifications from another topic?  This function implements
      ** a generic (slow) test that should work for all topic types.  This function only checks fields
      ** that have previously been set on this topic -- fields that have not been set will not limit this
@@ -79,6 +95,11 @@ public:
      **/
     virtual void Format( const LOGOG_CHAR *cFormatMessage, ... );
 
+    /** Empties the message in this topic and returns it, so that it can be rendered in place without allocating
+     ** a new string for every message.  The buffer is kept between calls.  \sa TypedFormat
+     **/
+    LOGOG_STRING &BeginFormat();
+
     const LOGOG_STRING &FileName() const;
     void FileName( const LOGOG_STRING &s );
 
@@ -102,6 +123,34 @@ public:
 
     TOPIC_FLAGS GetTopicFlags() const;
 
+    /** Returns the key/value fields attached to the message currently being transmitted, or NULL if it has
+     ** none.  The fields are only valid while the message is being transmitted.  \sa FieldSet
+     **/
+    const FieldSet *Fields() const;
+    /** Attaches key/value fields to this topic, or detaches them if pFields is NULL.  The *_KV macros attach
+     ** their fields just before transmitting a message and detach them just after.
+     **/
+    void Fields( const FieldSet *pFields );
+
+    /** Returns the format string that the current message was last rendered from, or NULL if it was not
+     ** rendered from one.  Like the fields, this is only valid while the message is being transmitted, since
+     ** the string belongs to the caller.
+     **/
+    const LOGOG_CHAR *FormatString() const;
+    /** Records the format string that the message is being rendered from.  Format() and TypedFormat() call
+     ** this for you.
+     **/
+    void FormatString( const LOGOG_CHAR *sFormat );
+
+    /** Returns this topic as rendered by formatter for target, during Transmit().  The first target to ask for a
+     ** given formatter, and a given choice of null termination, renders the topic; every later target asking for
+     ** the same gets the same output, without formatting it again.  The output holds a reference for the caller,
+     ** who must Release() it.
+     ** \return The output, or NULL if the topic is not being transmitted, or if LOGOG_FORMAT_MEMO_SIZE other
+     ** formatters have already rendered this transmission; the caller should then call the formatter itself.
+     **/
+    FormattedMessage *GetFormatted( Formatter &formatter, const Target &target ) const;
+
 protected:
     /** An array (not an STL vector) of string properties for this topic. */
     LOGOG_STRING m_vStringProps[ TOPIC_STRING_COUNT ];
@@ -116,6 +165,21 @@ protected:
      ** \sa TopicBitsType
      **/
     TOPIC_FLAGS m_TopicFlags;
+    /** The key/value fields of the message being transmitted, if any.  Not owned by this topic. */
+    const FieldSet *m_pFields;
+    /** The format string of the message being transmitted, if any.  Not owned by this topic. */
+    const LOGOG_CHAR *m_sFormat;
+    /** The outputs of this transmission, in the first m_nFormatted entries.  The rest are left from earlier
+     ** transmissions, and are reused when no target holds them any longer, so that their buffers are kept.
+     **/
+    mutable FormattedMessage *m_vFormatted[ LOGOG_FORMAT_MEMO_SIZE ];
+    mutable size_t m_nFormatted;
+    /** Is this topic being transmitted? */
+    bool m_bTransmitting;
+
+private:
+    Topic( const Topic & );
+    Topic &operator=( const Topic & );
 };
 
 /** A topic that permits both publishing as well as subscribing.  This class is functionally same as a Topic; we've added it
@@ -133,6 +197,9 @@ public:
             const LOGOG_CHAR *sCategory = NULL,
             const LOGOG_CHAR *sMessage = NULL,
             const double dTimestamp = 0.0f );
+
+    /** Detaches this filter from its messages and targets, so that a filter may go out of scope before they do. */
+    virtual ~Filter();
 };
 
 /** A FilterDefault represents a singleton filter whose level may be changed dynamically
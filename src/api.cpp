@@ -35,8 +35,6 @@ void Initialize( INIT_PARAMS *params )
 
 		// Let's allocate a default filter here.
 		GetFilterDefault();
-
-		// Socket::Initialize();
 	}
 }
 
@@ -44,8 +42,6 @@ void Shutdown( )
 {
 	if ( --s_nInitializations == 0 )
 	{
-		// Socket::Shutdown();
-
 #ifdef LOGOG_DESTROY_STATIC_AREA
 		delete &( Static() );
 #else
@@ -57,5 +53,102 @@ void Shutdown( )
 #endif
 	}
 }
+
+/** Waits for every target's delivery queue to empty, then flushes, then syncs, every target, stopping once the
+ ** deadline has passed.  \return true if all succeeded.
+ **/
+/* Waits until no message is being transmitted, or the deadline passes.  Called once logog is closed, so that the
+ * count only falls. */
+static bool WaitForTransmissions( LOGOG_UINT64 nDeadline )
+{
+	Condition sleeper;
+	bool bFinished = true;
+
+	sleeper.Lock();
+
+	while ( LOGOG_ATOMIC_LOAD_ACQUIRE( &Static().s_nTransmitting ) != LOGOG_TRANSMIT_CLOSED )
+	{
+		if ( GetMonotonicNanoseconds() >= nDeadline )
+		{
+			bFinished = false;
+			break;
+		}
+
+		sleeper.Wait( 1 );
+	}
+
+	sleeper.Unlock();
+
+	return bFinished;
+}
+
+static bool DrainTargets( LOGOG_UINT64 nDeadline )
+{
+	LOGOG_VECTOR< Target *, Allocator< Target * > > vTargets;
+
+	{
+		LockableNodesType *pAllTargets = &AllTargets();
+		ScopedLock sl( *pAllTargets );
+
+		for ( LockableNodesType::iterator it = pAllTargets->begin(); it != pAllTargets->end(); ++it )
+			vTargets.push_back( ( Target * )*it );
+	}
+
+	bool bDrained = true;
+
+	for ( size_t t = 0; t < vTargets.size(); t++ )
+	{
+		if ( !vTargets[ t ]->WaitForDelivery( nDeadline ))
+			return false;
+	}
+
+	/* Everything reaches the operating system before anything waits for the disk, so that a deadline that passes
+	 * during the slow part loses as little as possible. */
+	for ( size_t t = 0; t < vTargets.size(); t++ )
+	{
+		if ( GetMonotonicNanoseconds() >= nDeadline )
+			return false;
+
+		if ( vTargets[ t ]->Flush() != 0 )
+			bDrained = false;
+	}
+
+	for ( size_t t = 0; t < vTargets.size(); t++ )
+	{
+		if ( GetMonotonicNanoseconds() >= nDeadline )
+			return false;
+
+		if ( vTargets[ t ]->Sync() != 0 )
+			bDrained = false;
+	}
+
+	return bDrained;
+}
+
+bool Shutdown( LOGOG_TIME fTimeout )
+{
+	bool bDrained = true;
+
+	if ( s_nInitializations == 1 )
+	{
+		LOGOG_UINT64 nDeadline = GetMonotonicNanoseconds() + (LOGOG_UINT64)(( fTimeout > 0 ? fTimeout : 0 ) * 1e9 );
+
+		LOGOG_ATOMIC_ADD_ACQ_REL( &Static().s_nTransmitting, LOGOG_TRANSMIT_CLOSED );
+		bDrained = WaitForTransmissions( nDeadline ) && DrainTargets( nDeadline );
+
+		/* Don't let the delivery queues hold up the rest of the shutdown past the deadline.  A thread still
+		 * transmitting may be waiting for room in one of them; the targets can't be destroyed under it, so it is
+		 * waited for even so. */
+		if ( !bDrained )
+		{
+			StopDeliveryQueues( true );
+			WaitForTransmissions( ~(LOGOG_UINT64)0 );
+		}
+	}
+
+	Shutdown();
+
+	return bDrained;
+}
 }
 
@@ -0,0 +1,665 @@
+/*
+ * \file binary.cpp
+ */
+
+#include "logog.hpp"
+
+#include <cstring>
+
+namespace logog {
+
+	BinaryFormatter::BinaryFormatter() :
+		m_bStarted( false ),
+		m_nPreviousTime( 0 )
+	{
+	}
+
+	void BinaryFormatter::Reset()
+	{
+		m_vSites.clear();
+		m_bStarted = false;
+	}
+
+	bool BinaryFormatter::SiteBefore( const SiteEntry &site, const Topic *pTopic, LOGOG_LEVEL_TYPE nLevel,
+		int nLineNumber )
+	{
+		if ( site.m_pTopic != pTopic )
+			return site.m_pTopic < pTopic;
+
+		if ( site.m_nLevel != nLevel )
+			return site.m_nLevel < nLevel;
+
+		return site.m_nLineNumber < nLineNumber;
+	}
+
+	LOGOG_UINT64 BinaryFormatter::FindSite( const Topic &topic, bool &bIsNew )
+	{
+		/* Binary search for the topic; sites are only added the first time they log, so insertion is rare.  The
+		 * level and line are part of the key, so that a topic whose level changes, or another topic at the address
+		 * of one that has been freed, is described again under a new id. */
+		LOGOG_LEVEL_TYPE nLevel = topic.Level();
+		int nLineNumber = topic.LineNumber();
+		size_t nLow = 0;
+		size_t nHigh = m_vSites.size();
+
+		while ( nLow < nHigh )
+		{
+			size_t nMiddle = ( nLow + nHigh ) / 2;
+
+			if ( SiteBefore( m_vSites[ nMiddle ], &topic, nLevel, nLineNumber ))
+				nLow = nMiddle + 1;
+			else
+				nHigh = nMiddle;
+		}
+
+		if (( nLow < m_vSites.size() ) && ( m_vSites[ nLow ].m_pTopic == &topic ) &&
+			( m_vSites[ nLow ].m_nLevel == nLevel ) && ( m_vSites[ nLow ].m_nLineNumber == nLineNumber ))
+		{
+			bIsNew = false;
+			return m_vSites[ nLow ].m_nId;
+		}
+
+		SiteEntry entry;
+		entry.m_pTopic = &topic;
+		entry.m_nLevel = nLevel;
+		entry.m_nLineNumber = nLineNumber;
+		entry.m_nId = m_vSites.size();
+		m_vSites.insert( m_vSites.begin() + nLow, entry );
+
+		bIsNew = true;
+		return entry.m_nId;
+	}
+
+	void BinaryFormatter::PutByte( unsigned char c )
+	{
+		m_vBytes.push_back( c );
+	}
+
+	void BinaryFormatter::PutVarint( LOGOG_UINT64 nValue )
+	{
+		while ( nValue >= 0x80 )
+		{
+			m_vBytes.push_back( (unsigned char)( nValue | 0x80 ));
+			nValue >>= 7;
+		}
+
+		m_vBytes.push_back( (unsigned char)nValue );
+	}
+
+	void BinaryFormatter::PutSignedVarint( LOGOG_INT64 nValue )
+	{
+		/* Zigzag encoding maps 0, -1, 1, -2 ... to 0, 1, 2, 3 ... so that small magnitudes stay short. */
+		PutVarint(( (LOGOG_UINT64)nValue << 1 ) ^ (LOGOG_UINT64)( nValue >> 63 ));
+	}
+
+	void BinaryFormatter::PutString( const LOGOG_CHAR *pChars, size_t nCount )
+	{
+		if ( pChars == NULL )
+			nCount = 0;
+
+#ifdef LOGOG_UNICODE
+		/* Wide characters are stored as UTF-8. */
+		size_t nBytes = String::UTF8Length( pChars, nCount );
+
+		PutVarint( nBytes );
+
+		size_t nStart = m_vBytes.size();
+		m_vBytes.resize( nStart + nBytes );
+
+		if ( nBytes > 0 )
+			String::EncodeUTF8( pChars, nCount, &m_vBytes[ nStart ] );
+#else // LOGOG_UNICODE
+		PutVarint( nCount );
+		m_vBytes.insert( m_vBytes.end(), (const unsigned char *)pChars, (const unsigned char *)pChars + nCount );
+#endif // LOGOG_UNICODE
+	}
+
+	void BinaryFormatter::PutString( const LOGOG_STRING &s )
+	{
+		/* Strings assigned from constants count their trailing null in size(), so stop at the first null. */
+		const LOGOG_CHAR *pChars = s.c_str();
+		size_t nSize = ( pChars == NULL ) ? 0 : s.size();
+		size_t nLength = 0;
+
+		while (( nLength < nSize ) && ( pChars[ nLength ] != (LOGOG_CHAR)NULL ))
+			nLength++;
+
+		PutString( pChars, nLength );
+	}
+
+	void BinaryFormatter::PutDouble( double dValue )
+	{
+		LOGOG_UINT64 nBits;
+		memcpy( &nBits, &dValue, sizeof( nBits ));
+
+		for ( int t = 0; t < 8; t++ )
+		{
+			PutByte( (unsigned char)nBits );
+			nBits >>= 8;
+		}
+	}
+
+	LOGOG_STRING &BinaryFormatter::Format( const Topic &topic, const Target &target )
+	{
+		LOGOG_UINT64 nNow = GetRealtimeNanoseconds();
+
+		m_vBytes.clear();
+
+		if ( !m_bStarted )
+		{
+			m_vBytes.insert( m_vBytes.end(), (const unsigned char *)LOGOG_BINARY_MAGIC,
+				(const unsigned char *)LOGOG_BINARY_MAGIC + LOGOG_BINARY_MAGIC_LENGTH );
+			PutByte( LOGOG_BINARY_VERSION );
+			PutVarint( nNow );
+
+			m_nPreviousTime = nNow;
+			m_bStarted = true;
+		}
+
+		bool bIsNew;
+		LOGOG_UINT64 nSite = FindSite( topic, bIsNew );
+
+		if ( bIsNew )
+		{
+			const LOGOG_CHAR *sFormat = topic.FormatString();
+
+			PutByte( BINARY_RECORD_SITE );
+			PutVarint( nSite );
+			PutVarint( (LOGOG_UINT64)topic.Level() );
+			PutVarint( (LOGOG_UINT64)topic.LineNumber() );
+			PutString( topic.FileName() );
+			PutString( topic.Group() );
+			PutString( topic.Category() );
+			PutString( sFormat, ( sFormat == NULL ) ? 0 : String::Length( sFormat ));
+		}
+
+		PutByte( BINARY_RECORD_MESSAGE );
+		PutVarint( nSite );
+		PutSignedVarint( (LOGOG_INT64)( nNow - m_nPreviousTime ));
+		PutVarint( GetCurrentThreadIdentifier() );
+		PutString( topic.Message() );
+		m_nPreviousTime = nNow;
+
+		const FieldSet *pFields = topic.Fields();
+		size_t nFields = ( pFields == NULL ) ? 0 : pFields->Count();
+
+		PutVarint( nFields );
+
+		for ( size_t t = 0; t < nFields; t++ )
+		{
+			const Field &field = pFields->Get( t );
+
+			PutString( field.m_sKey, String::Length( field.m_sKey ));
+			PutByte( (unsigned char)field.m_Type );
+
+			switch ( field.m_Type )
+			{
+			case FIELD_INTEGER:
+				PutSignedVarint( field.m_nInteger );
+				break;
+			case FIELD_UNSIGNED:
+				PutVarint( field.m_nUnsigned );
+				break;
+			case FIELD_FLOAT:
+				PutDouble( field.m_dFloat );
+				break;
+			case FIELD_BOOLEAN:
+				PutByte( field.m_bBoolean ? 1 : 0 );
+				break;
+			case FIELD_STRING:
+				PutString( field.m_String.m_pChars, field.m_String.m_nLength );
+				break;
+			}
+		}
+
+		while (( m_vBytes.size() % sizeof( LOGOG_CHAR )) != 0 )
+			PutByte( BINARY_RECORD_PADDING );
+
+		/* Pack the bytes into the message buffer as they are; the target writes the buffer's raw contents. */
+		size_t nChars = m_vBytes.size() / sizeof( LOGOG_CHAR );
+
+		m_sMessageBuffer.clear();
+		m_sMessageBuffer.grow( nChars + 1 );
+		m_sMessageBuffer.append( (const LOGOG_CHAR *)&m_vBytes[ 0 ], nChars );
+
+		/* A binary target has no use for a terminator, but honor the request anyway. */
+		if ( target.GetNullTerminatesStrings() )
+			m_sMessageBuffer.append( (LOGOG_CHAR)NULL );
+
+		return m_sMessageBuffer;
+	}
+
+	BinaryLogFile::BinaryLogFile( const char *sFileName, bool bEnableOutputBuffering ) :
+		LogFile( sFileName, bEnableOutputBuffering )
+	{
+		m_bWriteUnicodeBOM = false;
+		SetName( LOGOG_CONST_STRING( "binary" ));
+		SetFormatter( m_BinaryFormatter );
+	}
+
+	int BinaryLogFile::Open()
+	{
+#ifdef LOGOG_FLAVOR_WINDOWS
+		m_pFile = _fsopen( m_pFileName, "ab", _SH_DENYWR );
+#else // LOGOG_FLAVOR_WINDOWS
+		m_pFile = fopen( m_pFileName, "ab" );
+#endif // LOGOG_FLAVOR_WINDOWS
+
+		if ( m_pFile == NULL )
+		{
+			m_bOpenFailed = true;
+			return -1;
+		}
+
+		if ( !m_bEnableOutputBuffering )
+			setvbuf( m_pFile, NULL, _IONBF, 0 );
+
+		return 0;
+	}
+
+	BinaryLogReader::BinaryLogReader() :
+		m_pFile( NULL ),
+		m_bCorrupt( false ),
+		m_nPreviousTime( 0 ),
+		m_pBuffer( NULL ),
+		m_nBufferLength( 0 ),
+		m_nBufferPosition( 0 ),
+		m_bBufferEnded( false ),
+		m_nHeaders( 0 ),
+		m_nSkipped( 0 )
+	{
+	}
+
+	BinaryLogReader::~BinaryLogReader()
+	{
+		Close();
+	}
+
+	bool BinaryLogReader::Open( const char *sFileName )
+	{
+		Close();
+
+#ifdef LOGOG_FLAVOR_WINDOWS
+		if ( fopen_s( &m_pFile, sFileName, "rb" ) != 0 )
+			m_pFile = NULL;
+#else // LOGOG_FLAVOR_WINDOWS
+		m_pFile = fopen( sFileName, "rb" );
+#endif // LOGOG_FLAVOR_WINDOWS
+
+		if ( m_pFile == NULL )
+			return false;
+
+		/* A binary log always begins with a header. */
+		unsigned char c;
+		if ( !ReadByte( c ) || ( c != BINARY_RECORD_HEADER ) || !ReadHeader() )
+		{
+			Close();
+			return false;
+		}
+
+		return true;
+	}
+
+	void BinaryLogReader::Close()
+	{
+		if ( m_pFile != NULL )
+		{
+			fclose( m_pFile );
+			m_pFile = NULL;
+		}
+
+		m_bCorrupt = false;
+		m_nPreviousTime = 0;
+		m_pBuffer = NULL;
+		m_nBufferLength = 0;
+		m_nBufferPosition = 0;
+		m_nHeaders = 0;
+		m_nSkipped = 0;
+		m_vSites.clear();
+		m_vSiteText.clear();
+		m_vRecordText.clear();
+	}
+
+	bool BinaryLogReader::IsCorrupt() const
+	{
+		return m_bCorrupt;
+	}
+
+	void BinaryLogReader::SetBuffer( const void *pData, size_t nLength )
+	{
+		if ( m_pFile != NULL )
+		{
+			fclose( m_pFile );
+			m_pFile = NULL;
+		}
+
+		m_pBuffer = (const unsigned char *)pData;
+		m_nBufferLength = nLength;
+		m_nBufferPosition = 0;
+	}
+
+	size_t BinaryLogReader::GetBufferPosition() const
+	{
+		return m_nBufferPosition;
+	}
+
+	LOGOG_UINT64 BinaryLogReader::GetHeaderCount() const
+	{
+		return m_nHeaders;
+	}
+
+	LOGOG_UINT64 BinaryLogReader::GetSkippedCount() const
+	{
+		return m_nSkipped;
+	}
+
+	bool BinaryLogReader::ReadByte( unsigned char &c )
+	{
+		if ( m_pFile == NULL )
+			return ReadBytes( &c, 1 );
+
+		int nChar = getc( m_pFile );
+
+		if ( nChar == EOF )
+			return false;
+
+		c = (unsigned char)nChar;
+		return true;
+	}
+
+	bool BinaryLogReader::ReadBytes( void *pOut, size_t nCount )
+	{
+		if ( m_pFile != NULL )
+			return ( fread( pOut, 1, nCount, m_pFile ) == nCount );
+
+		if ( nCount > m_nBufferLength - m_nBufferPosition )
+		{
+			m_bBufferEnded = true;
+			return false;
+		}
+
+		memcpy( pOut, m_pBuffer + m_nBufferPosition, nCount );
+		m_nBufferPosition += nCount;
+		return true;
+	}
+
+	bool BinaryLogReader::ReadVarint( LOGOG_UINT64 &nValue )
+	{
+		nValue = 0;
+
+		for ( int nShift = 0; nShift < 64; nShift += 7 )
+		{
+			unsigned char c;
+
+			if ( !ReadByte( c ))
+				return false;
+
+			nValue |= (LOGOG_UINT64)( c & 0x7f ) << nShift;
+
+			if (( c & 0x80 ) == 0 )
+				return true;
+		}
+
+		return false;
+	}
+
+	bool BinaryLogReader::ReadSignedVarint( LOGOG_INT64 &nValue )
+	{
+		LOGOG_UINT64 nZigzag;
+
+		if ( !ReadVarint( nZigzag ))
+			return false;
+
+		nValue = (LOGOG_INT64)( nZigzag >> 1 ) ^ -(LOGOG_INT64)( nZigzag & 1 );
+		return true;
+	}
+
+	bool BinaryLogReader::ReadString( TextType &text, size_t &nOffset, size_t *pnLength )
+	{
+		LOGOG_UINT64 nLength;
+
+		/* No single string can be longer than a gigabyte; anything larger is corruption. */
+		if ( !ReadVarint( nLength ) || ( nLength > ( 1 << 30 )))
+			return false;
+
+		nOffset = text.size();
+		text.resize( nOffset + (size_t)nLength + 1 );
+
+		if (( nLength > 0 ) && !ReadBytes( &text[ nOffset ], (size_t)nLength ))
+			return false;
+
+		text[ nOffset + (size_t)nLength ] = '\0';
+
+		if ( pnLength != NULL )
+			*pnLength = (size_t)nLength;
+
+		return true;
+	}
+
+	bool BinaryLogReader::ReadHeader()
+	{
+		/* The first byte of the magic has already been read as the record type. */
+		char vMagic[ LOGOG_BINARY_MAGIC_LENGTH - 1 ];
+		unsigned char nVersion;
+		LOGOG_UINT64 nTime;
+
+		if ( !ReadBytes( vMagic, sizeof( vMagic )) ||
+			( memcmp( vMagic, LOGOG_BINARY_MAGIC + 1, sizeof( vMagic )) != 0 ) ||
+			!ReadByte( nVersion ) || ( nVersion != LOGOG_BINARY_VERSION ) ||
+			!ReadVarint( nTime ))
+			return false;
+
+		m_nPreviousTime = nTime;
+		m_nHeaders++;
+		m_vSites.clear();
+		m_vSiteText.clear();
+		return true;
+	}
+
+	bool BinaryLogReader::ReadSite()
+	{
+		LOGOG_UINT64 nId, nLevel, nLine;
+
+		if ( !ReadVarint( nId ) || !ReadVarint( nLevel ) || !ReadVarint( nLine ))
+			return false;
+
+		/* Writers number their sites from zero, so a new site is never far past the last one. */
+		if ( nId > m_vSites.size() + 0x10000 )
+			return false;
+
+		/* Read into a copy, so that a record cut off part way, whose text Next() discards, leaves the site as it
+		 * was, rather than defined with offsets past the end of the text. */
+		SiteEntry site;
+		site.m_bDefined = true;
+		site.m_nLevel = (int)nLevel;
+		site.m_nLineNumber = (int)nLine;
+
+		for ( int t = 0; t < 4; t++ )
+			if ( !ReadString( m_vSiteText, site.m_vOffsets[ t ] ))
+				return false;
+
+		if ( nId >= m_vSites.size() )
+		{
+			SiteEntry empty;
+			memset( &empty, 0, sizeof( empty ));
+			m_vSites.resize( (size_t)nId + 1, empty );
+		}
+
+		m_vSites[ (size_t)nId ] = site;
+		return true;
+	}
+
+	bool BinaryLogReader::ReadMessage( BinaryLogRecord &record, bool &bSkipped )
+	{
+		LOGOG_UINT64 nSite;
+		LOGOG_INT64 nDelta;
+		LOGOG_UINT64 nFields;
+		size_t nMessageOffset;
+
+		m_vRecordText.clear();
+
+		if ( !ReadVarint( nSite ) || !ReadSignedVarint( nDelta ) || !ReadVarint( record.m_nThread ) ||
+			!ReadString( m_vRecordText, nMessageOffset, &record.m_nMessageLength ) ||
+			!ReadVarint( nFields ) || ( nFields > LOGOG_MAX_FIELDS ))
+			return false;
+
+		/* Strings are stored as offsets until the record is complete, since the text buffer may move. */
+		size_t vKeyOffsets[ LOGOG_MAX_FIELDS ];
+		size_t vStringOffsets[ LOGOG_MAX_FIELDS ];
+
+		record.m_nFieldCount = (size_t)nFields;
+
+		for ( size_t t = 0; t < record.m_nFieldCount; t++ )
+		{
+			BinaryLogField &field = record.m_vFields[ t ];
+			unsigned char nType;
+
+			memset( &field, 0, sizeof( field ));
+			vStringOffsets[ t ] = (size_t)-1;
+
+			if ( !ReadString( m_vRecordText, vKeyOffsets[ t ] ) || !ReadByte( nType ))
+				return false;
+
+			field.m_Type = (FieldType)nType;
+
+			switch ( nType )
+			{
+			case FIELD_INTEGER:
+				if ( !ReadSignedVarint( field.m_nInteger ))
+					return false;
+				break;
+			case FIELD_UNSIGNED:
+				if ( !ReadVarint( field.m_nUnsigned ))
+					return false;
+				break;
+			case FIELD_FLOAT:
+				{
+					LOGOG_UINT64 nBits = 0;
+					unsigned char c;
+
+					for ( int nByte = 0; nByte < 8; nByte++ )
+					{
+						if ( !ReadByte( c ))
+							return false;
+						nBits |= (LOGOG_UINT64)c << ( 8 * nByte );
+					}
+
+					memcpy( &field.m_dFloat, &nBits, sizeof( nBits ));
+				}
+				break;
+			case FIELD_BOOLEAN:
+				{
+					unsigned char c;
+					if ( !ReadByte( c ))
+						return false;
+					field.m_bBoolean = ( c != 0 );
+				}
+				break;
+			case FIELD_STRING:
+				if ( !ReadString( m_vRecordText, vStringOffsets[ t ], &field.m_nStringLength ))
+					return false;
+				break;
+			default:
+				return false;
+			}
+		}
+
+		/* Without a header there is no time to add the delta to, and the sites belong to an earlier stream. */
+		bSkipped = ( m_nHeaders == 0 );
+		if ( bSkipped )
+			return true;
+
+		if (( nSite >= m_vSites.size() ) || !m_vSites[ (size_t)nSite ].m_bDefined )
+			return false;
+
+		const char *pText = &m_vRecordText[ 0 ];
+		record.m_sMessage = pText + nMessageOffset;
+
+		for ( size_t t = 0; t < record.m_nFieldCount; t++ )
+		{
+			record.m_vFields[ t ].m_sKey = pText + vKeyOffsets[ t ];
+			if ( vStringOffsets[ t ] != (size_t)-1 )
+				record.m_vFields[ t ].m_sString = pText + vStringOffsets[ t ];
+		}
+
+		const SiteEntry &site = m_vSites[ (size_t)nSite ];
+		const char *pSiteText = &m_vSiteText[ 0 ];
+
+		record.m_Site.m_nId = nSite;
+		record.m_Site.m_nLevel = site.m_nLevel;
+		record.m_Site.m_nLineNumber = site.m_nLineNumber;
+		record.m_Site.m_sFileName = pSiteText + site.m_vOffsets[ 0 ];
+		record.m_Site.m_sGroup = pSiteText + site.m_vOffsets[ 1 ];
+		record.m_Site.m_sCategory = pSiteText + site.m_vOffsets[ 2 ];
+		record.m_Site.m_sFormat = pSiteText + site.m_vOffsets[ 3 ];
+
+		m_nPreviousTime += (LOGOG_UINT64)nDelta;
+		record.m_nTime = m_nPreviousTime;
+
+		return true;
+	}
+
+	bool BinaryLogReader::Next( BinaryLogRecord &record )
+	{
+		if ((( m_pFile == NULL ) && ( m_pBuffer == NULL )) || m_bCorrupt )
+			return false;
+
+		unsigned char nType;
+		size_t nRecordStart = m_nBufferPosition;
+		size_t nSiteTextSize = m_vSiteText.size();
+		LOGOG_UINT64 nPreviousTime = m_nPreviousTime;
+
+		m_bBufferEnded = false;
+
+		while ( ReadByte( nType ))
+		{
+			bool bOk;
+			bool bSkipped = false;
+
+			switch ( nType )
+			{
+			case BINARY_RECORD_PADDING:
+				bOk = true;
+				break;
+			case BINARY_RECORD_HEADER:
+				bOk = ReadHeader();
+				break;
+			case BINARY_RECORD_SITE:
+				bOk = ReadSite();
+				break;
+			case BINARY_RECORD_MESSAGE:
+				bOk = ReadMessage( record, bSkipped );
+				if ( bOk && !bSkipped )
+					return true;
+				if ( bSkipped )
+					m_nSkipped++;
+				break;
+			default:
+				bOk = false;
+				break;
+			}
+
+			if ( !bOk && m_bBufferEnded )
+			{
+				/* The rest of the record hasn't arrived yet; read it again from the start next time. */
+				m_nBufferPosition = nRecordStart;
+				if ( m_vSiteText.size() > nSiteTextSize )
+					m_vSiteText.resize( nSiteTextSize );
+				m_nPreviousTime = nPreviousTime;
+				return false;
+			}
+
+			if ( !bOk )
+			{
+				m_bCorrupt = true;
+				return false;
+			}
+
+			nRecordStart = m_nBufferPosition;
+			nSiteTextSize = m_vSiteText.size();
+			nPreviousTime = m_nPreviousTime;
+		}
+
+		return false;
+	}
+}
@@ -0,0 +1,665 @@
+/*
+ * \file compress.cpp
+ */
+
+#include "logog.hpp"
+
+#include <cstring>
+
+#ifdef LOGOG_ZLIB
+#include <zlib.h>
+#endif // LOGOG_ZLIB
+
+namespace logog {
+
+	/* The LZ4 block format is a series of sequences.  Each sequence is a token byte whose high nibble is a count
+	 * of literal bytes and whose low nibble is a match length less four; a nibble of 15 continues in following
+	 * bytes, each adding up to 255.  Then come the literals, a two-byte little endian offset back to the match,
+	 * and the rest of the match length.  The last sequence has literals only.  The last five bytes of a block are
+	 * always literals, and no match starts in its last twelve.
+	 */
+	static const size_t LZ4_MIN_MATCH = 4;
+	static const size_t LZ4_LAST_LITERALS = 5;
+	static const size_t LZ4_MATCH_FIND_LIMIT = 12;
+	static const size_t LZ4_MAX_OFFSET = 65535;
+	static const int LZ4_HASH_BITS = 12;
+
+	static inline unsigned int Read32( const unsigned char *p )
+	{
+		unsigned int n;
+		memcpy( &n, p, sizeof( n ));
+		return n;
+	}
+
+	static inline unsigned int HashLZ4( unsigned int nSequence )
+	{
+		return ( nSequence * 2654435761U ) >> ( 32 - LZ4_HASH_BITS );
+	}
+
+	static inline unsigned char *PutLength( unsigned char *pOut, size_t nLength )
+	{
+		while ( nLength >= 255 )
+		{
+			*pOut++ = 255;
+			nLength -= 255;
+		}
+
+		*pOut++ = (unsigned char)nLength;
+		return pOut;
+	}
+
+	static unsigned char *PutSequence( unsigned char *pOut, const unsigned char *pLiterals, size_t nLiterals,
+		size_t nOffset, size_t nMatch )
+	{
+		unsigned char *pToken = pOut++;
+
+		if ( nLiterals >= 15 )
+		{
+			*pToken = 15 << 4;
+			pOut = PutLength( pOut, nLiterals - 15 );
+		}
+		else
+			*pToken = (unsigned char)( nLiterals << 4 );
+
+		memcpy( pOut, pLiterals, nLiterals );
+		pOut += nLiterals;
+
+		/* The last sequence has no match. */
+		if ( nMatch == 0 )
+			return pOut;
+
+		*pOut++ = (unsigned char)nOffset;
+		*pOut++ = (unsigned char)( nOffset >> 8 );
+
+		nMatch -= LZ4_MIN_MATCH;
+
+		if ( nMatch >= 15 )
+		{
+			*pToken |= 15;
+			pOut = PutLength( pOut, nMatch - 15 );
+		}
+		else
+			*pToken |= (unsigned char)nMatch;
+
+		return pOut;
+	}
+
+	size_t CompressBoundLZ4( size_t nSize )
+	{
+		return nSize + nSize / 255 + 16;
+	}
+
+	size_t CompressBlockLZ4( const unsigned char *pIn, size_t nSize, unsigned char *pOut )
+	{
+		unsigned char *pOutStart = pOut;
+		const unsigned char *pAnchor = pIn;
+
+		if ( nSize > LZ4_MATCH_FIND_LIMIT )
+		{
+			/* Positions of recently seen four-byte sequences, relative to pIn. */
+			size_t vTable[ 1 << LZ4_HASH_BITS ];
+			memset( vTable, 0, sizeof( vTable ));
+
+			const unsigned char *pEnd = pIn + nSize;
+			const unsigned char *pFindLimit = pEnd - LZ4_MATCH_FIND_LIMIT;
+			const unsigned char *pMatchLimit = pEnd - LZ4_LAST_LITERALS;
+			const unsigned char *p = pIn + 1;
+			unsigned int nMisses = 0;
+
+			while ( p < pFindLimit )
+			{
+				unsigned int nSequence = Read32( p );
+				unsigned int nHash = HashLZ4( nSequence );
+				const unsigned char *pCandidate = pIn + vTable[ nHash ];
+				vTable[ nHash ] = p - pIn;
+
+				if (( pCandidate >= p ) || ( (size_t)( p - pCandidate ) > LZ4_MAX_OFFSET ) ||
+					( Read32( pCandidate ) != nSequence ))
+				{
+					/* Step faster through data that doesn't compress. */
+					p += 1 + ( nMisses++ >> 6 );
+					continue;
+				}
+
+				nMisses = 0;
+
+				while (( p > pAnchor ) && ( pCandidate > pIn ) && ( p[ -1 ] == pCandidate[ -1 ] ))
+				{
+					p--;
+					pCandidate--;
+				}
+
+				size_t nMatch = LZ4_MIN_MATCH;
+				while (( p + nMatch < pMatchLimit ) && ( p[ nMatch ] == pCandidate[ nMatch ] ))
+					nMatch++;
+
+				pOut = PutSequence( pOut, pAnchor, p - pAnchor, p - pCandidate, nMatch );
+
+				p += nMatch;
+				pAnchor = p;
+
+				/* Remember a position inside the match, which helps with runs of similar lines. */
+				if ( p < pFindLimit )
+					vTable[ HashLZ4( Read32( p - 2 )) ] = p - 2 - pIn;
+			}
+		}
+
+		pOut = PutSequence( pOut, pAnchor, pIn + nSize - pAnchor, 0, 0 );
+
+		return pOut - pOutStart;
+	}
+
+	static inline bool GetLength( const unsigned char *&p, const unsigned char *pEnd, size_t &nLength )
+	{
+		unsigned char c;
+
+		do
+		{
+			if ( p >= pEnd )
+				return false;
+
+			c = *p++;
+			nLength += c;
+		}
+		while ( c == 255 );
+
+		return true;
+	}
+
+	bool DecompressBlockLZ4( const unsigned char *pIn, size_t nSize, unsigned char *pOut, size_t nOutSize )
+	{
+		const unsigned char *pEnd = pIn + nSize;
+		unsigned char *pOutStart = pOut;
+		unsigned char *pOutEnd = pOut + nOutSize;
+
+		while ( pIn < pEnd )
+		{
+			unsigned char nToken = *pIn++;
+			size_t nLiterals = nToken >> 4;
+
+			if (( nLiterals == 15 ) && !GetLength( pIn, pEnd, nLiterals ))
+				return false;
+
+			if (( nLiterals > (size_t)( pEnd - pIn )) || ( nLiterals > (size_t)( pOutEnd - pOut )))
+				return false;
+
+			memcpy( pOut, pIn, nLiterals );
+			pIn += nLiterals;
+			pOut += nLiterals;
+
+			if ( pIn == pEnd )
+				break;
+
+			if ( pEnd - pIn < 2 )
+				return false;
+
+			size_t nOffset = pIn[ 0 ] | ( pIn[ 1 ] << 8 );
+			pIn += 2;
+
+			if (( nOffset == 0 ) || ( nOffset > (size_t)( pOut - pOutStart )))
+				return false;
+
+			size_t nMatch = nToken & 15;
+
+			if (( nMatch == 15 ) && !GetLength( pIn, pEnd, nMatch ))
+				return false;
+
+			nMatch += LZ4_MIN_MATCH;
+
+			if ( nMatch > (size_t)( pOutEnd - pOut ))
+				return false;
+
+			/* The match may overlap the bytes it produces, so copy forwards a byte at a time. */
+			const unsigned char *pMatch = pOut - nOffset;
+			while ( nMatch-- )
+				*pOut++ = *pMatch++;
+		}
+
+		return ( pOut == pOutEnd );
+	}
+
+	static unsigned int HashFNV1a( const unsigned char *p, size_t nSize )
+	{
+		unsigned int nHash = 2166136261U;
+
+		while ( nSize-- )
+		{
+			nHash ^= *p++;
+			nHash *= 16777619U;
+		}
+
+		return nHash;
+	}
+
+	static inline void Put32( unsigned char *p, size_t n )
+	{
+		p[ 0 ] = (unsigned char)n;
+		p[ 1 ] = (unsigned char)( n >> 8 );
+		p[ 2 ] = (unsigned char)( n >> 16 );
+		p[ 3 ] = (unsigned char)( n >> 24 );
+	}
+
+	static inline size_t Get32( const unsigned char *p )
+	{
+		return (size_t)p[ 0 ] | ( (size_t)p[ 1 ] << 8 ) | ( (size_t)p[ 2 ] << 16 ) | ( (size_t)p[ 3 ] << 24 );
+	}
+
+	CompressedLogFile::CompressedLogFile( const char *sFileName, CompressionCodec codec, size_t nBlockSize ) :
+		LogFile( sFileName ),
+		m_Codec( codec ),
+		m_nBlockSize( nBlockSize ),
+		m_bPending( false ),
+		m_bBusy( false ),
+		m_bStop( false ),
+		m_bWriteFailed( false ),
+		m_Thread( CompressThread, this ),
+		m_bThreadStarted( false )
+	{
+		m_bWriteUnicodeBOM = false;
+		SetName( LOGOG_CONST_STRING( "compressed" ));
+
+#ifndef LOGOG_ZLIB
+		if ( m_Codec == COMPRESSION_ZLIB )
+			m_Codec = COMPRESSION_LZ4;
+#endif // LOGOG_ZLIB
+
+		m_vFilling.reserve( m_nBlockSize );
+
+		/* Without a background thread, blocks are compressed on the logging thread instead. */
+		m_bThreadStarted = ( m_Thread.Start() == 0 );
+
+		AddEmergencyTarget( this );
+	}
+
+	CompressedLogFile::~CompressedLogFile()
+	{
+		RemoveEmergencyTarget( this );
+		Flush();
+
+		if ( m_bThreadStarted )
+		{
+			m_Condition.Lock();
+			m_bStop = true;
+			m_Condition.Broadcast();
+			m_Condition.Unlock();
+
+			Thread::WaitFor( m_Thread );
+			m_bThreadStarted = false;
+		}
+	}
+
+	void CompressedLogFile::EmergencyDump()
+	{
+		/* Oldest first: the block waiting for the background thread, then the one being filled. */
+		if ( m_bPending && !m_vPending.empty() )
+			EmergencyWrite( &m_vPending[ 0 ], m_vPending.size() );
+
+		if ( !m_vFilling.empty() )
+			EmergencyWrite( &m_vFilling[ 0 ], m_vFilling.size() );
+	}
+
+	bool CompressedLogFile::EnableIndex( size_t, size_t )
+	{
+		return false;
+	}
+
+	int CompressedLogFile::Open()
+	{
+#ifdef LOGOG_FLAVOR_WINDOWS
+		m_pFile = _fsopen( m_pFileName, "ab", _SH_DENYWR );
+#else // LOGOG_FLAVOR_WINDOWS
+		m_pFile = fopen( m_pFileName, "ab" );
+#endif // LOGOG_FLAVOR_WINDOWS
+
+		if (( m_pFile == NULL ) ||
+			( fwrite( LOGOG_COMPRESSED_MAGIC, 1, LOGOG_COMPRESSED_MAGIC_LENGTH, m_pFile ) != LOGOG_COMPRESSED_MAGIC_LENGTH ))
+		{
+			m_bOpenFailed = true;
+			return -1;
+		}
+
+		return 0;
+	}
+
+	int CompressedLogFile::Output( const LOGOG_STRING &data )
+	{
+		if ( m_bOpenFailed )
+			return -1;
+
+		if ( m_bFirstTime )
+		{
+			int result = Open();
+			if ( result != 0 )
+				return result;
+
+			m_bFirstTime = false;
+		}
+
+		size_t nBytes = data.size() * sizeof( LOGOG_CHAR );
+
+		if ( nBytes > 0 )
+		{
+			const unsigned char *pData = (const unsigned char *)data.c_str();
+			m_vFilling.insert( m_vFilling.end(), pData, pData + nBytes );
+		}
+
+		if ( m_vFilling.size() >= m_nBlockSize )
+			return QueueBlock();
+
+		return 0;
+	}
+
+	int CompressedLogFile::Flush()
+	{
+		ScopedLock sl( m_MutexReceive );
+
+		return FlushOutput();
+	}
+
+	int CompressedLogFile::FlushOutput()
+	{
+		if ( m_pFile == NULL )
+			return 0;
+
+		QueueBlock();
+
+		m_Condition.Lock();
+		while ( m_bPending || m_bBusy )
+			m_Condition.Wait();
+		bool bFailed = m_bWriteFailed;
+		m_Condition.Unlock();
+
+		return bFailed ? -1 : 0;
+	}
+
+	int CompressedLogFile::QueueBlock()
+	{
+		if ( !m_vFilling.empty() && !m_bThreadStarted )
+		{
+			WriteBlock( m_vFilling );
+			m_vFilling.clear();
+		}
+
+		m_Condition.Lock();
+
+		if ( !m_vFilling.empty() )
+		{
+			while ( m_bPending )
+				m_Condition.Wait();
+
+			/* Swapping passes the block without copying it; the three buffers are recycled between the threads. */
+			m_vPending.swap( m_vFilling );
+			m_bPending = true;
+			m_Condition.Broadcast();
+		}
+
+		bool bFailed = m_bWriteFailed;
+		m_Condition.Unlock();
+
+		m_vFilling.clear();
+
+		return bFailed ? -1 : 0;
+	}
+
+	void *CompressedLogFile::CompressThread( void *pvParams )
+	{
+		CompressedLogFile *pThis = (CompressedLogFile *)pvParams;
+		Condition &condition = pThis->m_Condition;
+
+		condition.Lock();
+
+		for ( ;; )
+		{
+			while ( !pThis->m_bPending && !pThis->m_bStop )
+				condition.Wait();
+
+			if ( !pThis->m_bPending )
+				break;
+
+			pThis->m_vWorking.swap( pThis->m_vPending );
+			pThis->m_bPending = false;
+			pThis->m_bBusy = true;
+			condition.Broadcast();
+			condition.Unlock();
+
+			pThis->WriteBlock( pThis->m_vWorking );
+			pThis->m_vWorking.clear();
+
+			condition.Lock();
+			pThis->m_bBusy = false;
+			condition.Broadcast();
+		}
+
+		condition.Unlock();
+
+		return NULL;
+	}
+
+	void CompressedLogFile::WriteBlock( const BytesType &vBlock )
+	{
+		size_t nSize = vBlock.size();
+		const unsigned char *pStored = NULL;
+		size_t nStored = nSize;
+		CompressionCodec codec = m_Codec;
+
+		if ( codec == COMPRESSION_LZ4 )
+		{
+			m_vCompressed.resize( CompressBoundLZ4( nSize ));
+			nStored = CompressBlockLZ4( &vBlock[ 0 ], nSize, &m_vCompressed[ 0 ] );
+			pStored = &m_vCompressed[ 0 ];
+		}
+#ifdef LOGOG_ZLIB
+		else if ( codec == COMPRESSION_ZLIB )
+		{
+			uLongf nCompressed = compressBound( (uLong)nSize );
+			m_vCompressed.resize( nCompressed );
+
+			if ( compress2( &m_vCompressed[ 0 ], &nCompressed, &vBlock[ 0 ], (uLong)nSize,
+				Z_DEFAULT_COMPRESSION ) == Z_OK )
+			{
+				nStored = nCompressed;
+				pStored = &m_vCompressed[ 0 ];
+			}
+		}
+#endif // LOGOG_ZLIB
+
+		if (( pStored == NULL ) || ( nStored >= nSize ))
+		{
+			codec = COMPRESSION_STORED;
+			pStored = &vBlock[ 0 ];
+			nStored = nSize;
+		}
+
+		unsigned char vHeader[ LOGOG_COMPRESSED_BLOCK_HEADER_LENGTH ];
+		vHeader[ 0 ] = (unsigned char)codec;
+		Put32( vHeader + 1, nSize );
+		Put32( vHeader + 5, nStored );
+		Put32( vHeader + 9, HashFNV1a( &vBlock[ 0 ], nSize ));
+
+		/* Each block is flushed whole, so that a crash leaves only complete blocks behind. */
+		bool bFailed = ( fwrite( vHeader, 1, sizeof( vHeader ), m_pFile ) != sizeof( vHeader )) ||
+			( fwrite( pStored, 1, nStored, m_pFile ) != nStored ) ||
+			( fflush( m_pFile ) != 0 );
+
+		if ( bFailed )
+		{
+			m_Condition.Lock();
+			m_bWriteFailed = true;
+			m_Condition.Unlock();
+		}
+	}
+
+	CompressedLogReader::CompressedLogReader() :
+		m_pFile( NULL ),
+		m_bCorrupt( false ),
+		m_nOffset( 0 )
+	{
+	}
+
+	CompressedLogReader::~CompressedLogReader()
+	{
+		Close();
+	}
+
+	bool CompressedLogReader::Open( const char *sFileName )
+	{
+		Close();
+
+#ifdef LOGOG_FLAVOR_WINDOWS
+		if ( fopen_s( &m_pFile, sFileName, "rb" ) != 0 )
+			m_pFile = NULL;
+#else // LOGOG_FLAVOR_WINDOWS
+		m_pFile = fopen( sFileName, "rb" );
+#endif // LOGOG_FLAVOR_WINDOWS
+
+		if ( m_pFile == NULL )
+			return false;
+
+		char vMagic[ LOGOG_COMPRESSED_MAGIC_LENGTH ];
+
+		if (( fread( vMagic, 1, sizeof( vMagic ), m_pFile ) != sizeof( vMagic )) ||
+			( memcmp( vMagic, LOGOG_COMPRESSED_MAGIC, sizeof( vMagic )) != 0 ))
+		{
+			Close();
+			return false;
+		}
+
+		return true;
+	}
+
+	void CompressedLogReader::Close()
+	{
+		if ( m_pFile != NULL )
+		{
+			fclose( m_pFile );
+			m_pFile = NULL;
+		}
+
+		m_bCorrupt = false;
+		m_vBlock.clear();
+		m_nOffset = 0;
+	}
+
+	bool CompressedLogReader::IsCorrupt() const
+	{
+		return m_bCorrupt;
+	}
+
+	bool CompressedLogReader::ReadBlock()
+	{
+		unsigned char vHeader[ LOGOG_COMPRESSED_BLOCK_HEADER_LENGTH ];
+		int nChar = getc( m_pFile );
+
+		if ( nChar == EOF )
+			return false;
+
+		vHeader[ 0 ] = (unsigned char)nChar;
+
+		/* Another run begins where the file was appended to. */
+		if ( vHeader[ 0 ] == (unsigned char)LOGOG_COMPRESSED_MAGIC[ 0 ] )
+		{
+			char vMagic[ LOGOG_COMPRESSED_MAGIC_LENGTH - 1 ];
+
+			if (( fread( vMagic, 1, sizeof( vMagic ), m_pFile ) != sizeof( vMagic )) ||
+				( memcmp( vMagic, LOGOG_COMPRESSED_MAGIC + 1, sizeof( vMagic )) != 0 ))
+			{
+				m_bCorrupt = true;
+				return false;
+			}
+
+			m_vBlock.clear();
+			m_nOffset = 0;
+			return true;
+		}
+
+		if ( fread( vHeader + 1, 1, sizeof( vHeader ) - 1, m_pFile ) != sizeof( vHeader ) - 1 )
+		{
+			m_bCorrupt = true;
+			return false;
+		}
+
+		size_t nSize = Get32( vHeader + 1 );
+		size_t nStored = Get32( vHeader + 5 );
+
+		/* No block is larger than a gigabyte; anything larger is corruption. */
+		bool bOk = ( nSize <= ( 1 << 30 )) && ( nStored <= ( 1 << 30 ));
+
+		if ( bOk )
+		{
+			m_vStored.resize( nStored );
+			m_vBlock.resize( nSize );
+
+			bOk = ( nStored == 0 ) || ( fread( &m_vStored[ 0 ], 1, nStored, m_pFile ) == nStored );
+		}
+
+		if ( bOk && ( nSize > 0 ))
+		{
+			switch ( vHeader[ 0 ] )
+			{
+			case COMPRESSION_STORED:
+				bOk = ( nStored == nSize );
+				if ( bOk )
+					memcpy( &m_vBlock[ 0 ], &m_vStored[ 0 ], nSize );
+				break;
+
+			case COMPRESSION_LZ4:
+				bOk = ( nStored > 0 ) && DecompressBlockLZ4( &m_vStored[ 0 ], nStored, &m_vBlock[ 0 ], nSize );
+				break;
+
+#ifdef LOGOG_ZLIB
+			case COMPRESSION_ZLIB:
+				{
+					uLongf nDecompressed = (uLongf)nSize;
+					bOk = ( nStored > 0 ) &&
+						( uncompress( &m_vBlock[ 0 ], &nDecompressed, &m_vStored[ 0 ], (uLong)nStored ) == Z_OK ) &&
+						( nDecompressed == nSize );
+				}
+				break;
+#endif // LOGOG_ZLIB
+
+			default:
+				bOk = false;
+				break;
+			}
+
+			bOk = bOk && ( HashFNV1a( &m_vBlock[ 0 ], nSize ) == Get32( vHeader + 9 ));
+		}
+
+		if ( !bOk )
+		{
+			m_vBlock.clear();
+			m_bCorrupt = true;
+			return false;
+		}
+
+		m_nOffset = 0;
+		return true;
+	}
+
+	size_t CompressedLogReader::Read( void *pBuffer, size_t nSize )
+	{
+		unsigned char *pOut = (unsigned char *)pBuffer;
+		size_t nRead = 0;
+
+		while ( nRead < nSize )
+		{
+			if ( m_nOffset == m_vBlock.size() )
+			{
+				if (( m_pFile == NULL ) || m_bCorrupt || !ReadBlock() )
+					break;
+
+				continue;
+			}
+
+			size_t nCopy = m_vBlock.size() - m_nOffset;
+			if ( nCopy > nSize - nRead )
+				nCopy = nSize - nRead;
+
+			memcpy( pOut + nRead, &m_vBlock[ m_nOffset ], nCopy );
+			m_nOffset += nCopy;
+			nRead += nCopy;
+		}
+
+		return nRead;
+	}
+}
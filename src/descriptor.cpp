@@ -0,0 +1,177 @@
+/*
+ * \file descriptor.cpp
+ */
+
+#include "logog.hpp"
+
+#ifdef LOGOG_FLAVOR_POSIX
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+namespace logog {
+
+	/** The alignment of the buffer; a page on every system that matters. */
+	static const size_t DESCRIPTOR_BUFFER_ALIGNMENT = 4096;
+
+	DescriptorLogFile::DescriptorLogFile( const char *sFileName, bool bEnableOutputBuffering, size_t nBufferSize,
+		bool bDropCache ) :
+		LogFile( sFileName, bEnableOutputBuffering ),
+		m_nDescriptor( -1 ),
+		m_pAllocation( NULL ),
+		m_pBuffer( NULL ),
+		m_nBufferSize( nBufferSize ),
+		m_nBuffered( 0 ),
+		m_nFileSize( 0 ),
+		m_nDropFrom( 0 ),
+		m_bDropCache( bDropCache )
+	{
+		SetName( LOGOG_CONST_STRING( "descriptor" ));
+	}
+
+	DescriptorLogFile::~DescriptorLogFile()
+	{
+		/* LogFile's destructor writes the last index entry, so the log must be complete before then. */
+		FlushOutput();
+
+		if ( m_nDescriptor >= 0 )
+			close( m_nDescriptor );
+
+		if ( m_pAllocation != NULL )
+			Object::Deallocate( m_pAllocation );
+	}
+
+	int DescriptorLogFile::Open()
+	{
+		m_nDescriptor = open( m_pFileName, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644 );
+
+		struct stat st;
+
+		if (( m_nDescriptor < 0 ) || ( fstat( m_nDescriptor, &st ) != 0 ))
+		{
+			m_bOpenFailed = true;
+			return -1;
+		}
+
+		m_nFileSize = (LOGOG_UINT64)st.st_size;
+		m_nDropFrom = m_nFileSize;
+
+		if ( m_bEnableOutputBuffering && m_nBufferSize > 0 )
+		{
+			m_pAllocation = Object::Allocate( m_nBufferSize + DESCRIPTOR_BUFFER_ALIGNMENT );
+			m_pBuffer = (unsigned char *)((( (size_t)m_pAllocation ) + DESCRIPTOR_BUFFER_ALIGNMENT - 1 ) &
+				~( DESCRIPTOR_BUFFER_ALIGNMENT - 1 ));
+		}
+
+#ifdef LOGOG_UNICODE
+		if ( m_nFileSize == 0 && m_bWriteUnicodeBOM )
+			WriteUnicodeBOM();
+#endif // LOGOG_UNICODE
+
+		return 0;
+	}
+
+	int DescriptorLogFile::WriteAll( const unsigned char *pData, size_t nLength )
+	{
+		while ( nLength > 0 )
+		{
+			ssize_t nWritten = write( m_nDescriptor, pData, nLength );
+
+			if ( nWritten < 0 )
+			{
+				if ( errno == EINTR )
+					continue;
+				return -1;
+			}
+
+			pData += nWritten;
+			nLength -= (size_t)nWritten;
+			m_nFileSize += (LOGOG_UINT64)nWritten;
+		}
+
+		return 0;
+	}
+
+	int DescriptorLogFile::InternalOutput( size_t nSize, const LOGOG_CHAR *pData )
+	{
+		const unsigned char *pBytes = (const unsigned char *)pData;
+		size_t nLength = nSize * sizeof( LOGOG_CHAR );
+
+		if ( m_pBuffer == NULL )
+			return WriteAll( pBytes, nLength );
+
+		if ( nLength > m_nBufferSize - m_nBuffered )
+		{
+			if ( FlushOutput() != 0 )
+				return -1;
+
+			/* Too big to be worth copying. */
+			if ( nLength >= m_nBufferSize )
+				return WriteAll( pBytes, nLength );
+		}
+
+		memcpy( m_pBuffer + m_nBuffered, pBytes, nLength );
+		m_nBuffered += nLength;
+
+		return 0;
+	}
+
+	int DescriptorLogFile::FlushOutput()
+	{
+		if ( m_nBuffered == 0 )
+			return 0;
+
+		LOGOG_UINT64 nStart = m_nFileSize;
+		size_t nBuffered = m_nBuffered;
+
+		m_nBuffered = 0;
+
+		if ( WriteAll( m_pBuffer, nBuffered ) != 0 )
+			return -1;
+
+		if ( m_bDropCache )
+		{
+#ifdef __linux__
+			/* Start writing this block back now, so that by the next flush its pages are clean and can be
+			 * dropped; dirty pages are not dropped by POSIX_FADV_DONTNEED. */
+			sync_file_range( m_nDescriptor, (off_t)nStart, (off_t)nBuffered, SYNC_FILE_RANGE_WRITE );
+#endif // __linux__
+#ifdef POSIX_FADV_DONTNEED
+			if ( nStart > m_nDropFrom )
+				posix_fadvise( m_nDescriptor, (off_t)m_nDropFrom, (off_t)( nStart - m_nDropFrom ), POSIX_FADV_DONTNEED );
+#endif // POSIX_FADV_DONTNEED
+			m_nDropFrom = nStart;
+		}
+
+		return 0;
+	}
+
+	int DescriptorLogFile::SyncOutput( bool bDataOnly )
+	{
+		if ( m_nDescriptor < 0 )
+			return 0;
+
+#if defined( __linux__ )
+		int nResult = bDataOnly ? fdatasync( m_nDescriptor ) : fsync( m_nDescriptor );
+#else
+		(void)bDataOnly;
+		int nResult = fsync( m_nDescriptor );
+#endif
+
+		return ( nResult == 0 ) ? 0 : -1;
+	}
+
+	LOGOG_UINT64 DescriptorLogFile::GetOutputSize()
+	{
+		return m_nFileSize + m_nBuffered;
+	}
+}
+
+#endif // LOGOG_FLAVOR_POSIX
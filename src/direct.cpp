@@ -0,0 +1,705 @@
+/*
+ * \file direct.cpp
+ */
+
+#include "logog.hpp"
+
+#ifdef LOGOG_FLAVOR_POSIX
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined( LOGOG_IO_URING ) && defined( __linux__ )
+#define LOGOG_DIRECT_RING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif // LOGOG_IO_URING && __linux__
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+/** The most blocks that the writing thread gathers into one pwritev(). */
+#define LOGOG_DIRECT_MAX_GATHER 16
+
+namespace logog {
+
+	/** Rounds n up to a multiple of the block size. */
+	static size_t RoundUpToBlock( size_t n )
+	{
+		return ( n + LOGOG_DIRECT_BLOCK_SIZE - 1 ) & ~( (size_t)LOGOG_DIRECT_BLOCK_SIZE - 1 );
+	}
+
+	/** Writes nCount buffers to consecutive offsets, starting at nOffset, retrying after short writes and
+	 ** interruptions.  The vectors are consumed.
+	 **/
+	static int WriteVector( int nDescriptor, struct iovec *pVectors, int nCount, LOGOG_UINT64 nOffset )
+	{
+		while ( nCount > 0 )
+		{
+			ssize_t nWritten = pwritev( nDescriptor, pVectors, nCount, (off_t)nOffset );
+
+			if ( nWritten < 0 )
+			{
+				if ( errno == EINTR )
+					continue;
+				return -1;
+			}
+
+			nOffset += (LOGOG_UINT64)nWritten;
+
+			while (( nCount > 0 ) && ( (size_t)nWritten >= pVectors->iov_len ))
+			{
+				nWritten -= (ssize_t)pVectors->iov_len;
+				pVectors++;
+				nCount--;
+			}
+
+			if ( nCount > 0 )
+			{
+				pVectors->iov_base = (unsigned char *)pVectors->iov_base + nWritten;
+				pVectors->iov_len -= (size_t)nWritten;
+			}
+		}
+
+		return 0;
+	}
+
+	DirectLogFile::DirectLogFile( const char *sFileName, size_t nBufferSize, size_t nBuffers, bool bUseRing ) :
+		LogFile( sFileName, true ),
+		m_nDescriptor( -1 ),
+		m_bDirect( false ),
+		m_pAllocation( NULL ),
+		m_nBufferSize( RoundUpToBlock( nBufferSize > 0 ? nBufferSize : 1 )),
+		m_nBuffers( nBuffers > 0 ? nBuffers : 1 ),
+		m_nCurrent( 0 ),
+		m_nBuffered( 0 ),
+		m_nBufferOffset( 0 ),
+		m_pQueue( NULL ),
+		m_nQueueHead( 0 ),
+		m_nQueued( 0 ),
+		m_bWriteFailed( false ),
+		m_bWriterStop( false ),
+		m_WriterThread( WriterThread, this ),
+		m_bWriterStarted( false ),
+		m_bUseRing( bUseRing ),
+		m_pRing( NULL )
+	{
+		SetName( LOGOG_CONST_STRING( "direct" ));
+	}
+
+	DirectLogFile::~DirectLogFile()
+	{
+		/* LogFile's destructor writes the last index entry, so the log must be complete before then. */
+		FlushOutput();
+		StopWriter();
+		CloseRing();
+
+		if ( m_nDescriptor >= 0 )
+			close( m_nDescriptor );
+
+		if ( m_pAllocation != NULL )
+			Object::Deallocate( m_pAllocation );
+
+		if ( m_pQueue != NULL )
+			Object::Deallocate( m_pQueue );
+	}
+
+	int DirectLogFile::Open()
+	{
+		int nFlags = O_RDWR | O_CREAT | O_CLOEXEC;
+
+#ifdef O_DIRECT
+		m_nDescriptor = open( m_pFileName, nFlags | O_DIRECT, 0644 );
+		m_bDirect = ( m_nDescriptor >= 0 );
+
+		/* Some file systems, tmpfs among them, don't do direct I/O at all. */
+		if (( m_nDescriptor < 0 ) && ( errno == EINVAL ))
+			m_nDescriptor = open( m_pFileName, nFlags, 0644 );
+#else // O_DIRECT
+		m_nDescriptor = open( m_pFileName, nFlags, 0644 );
+#ifdef F_NOCACHE
+		m_bDirect = ( m_nDescriptor >= 0 ) && ( fcntl( m_nDescriptor, F_NOCACHE, 1 ) == 0 );
+#endif // F_NOCACHE
+#endif // O_DIRECT
+
+		struct stat st;
+
+		if (( m_nDescriptor < 0 ) || ( fstat( m_nDescriptor, &st ) != 0 ))
+		{
+			m_bOpenFailed = true;
+			return -1;
+		}
+
+		m_pAllocation = Object::Allocate( m_nBufferSize * m_nBuffers + LOGOG_DIRECT_BLOCK_SIZE );
+		m_pQueue = (Block *)Object::Allocate( sizeof( Block ) * m_nBuffers );
+		memset( m_pQueue, 0, sizeof( Block ) * m_nBuffers );
+
+		LOGOG_UINT64 nFileSize = (LOGOG_UINT64)st.st_size;
+
+		/* Continue the file from its last whole block, so that every write starts on a block boundary. */
+		m_nBufferOffset = nFileSize & ~( (LOGOG_UINT64)LOGOG_DIRECT_BLOCK_SIZE - 1 );
+		m_nBuffered = (size_t)( nFileSize - m_nBufferOffset );
+
+		if ( m_nBuffered > 0 )
+		{
+			ssize_t nRead;
+
+			do
+				nRead = pread( m_nDescriptor, GetBuffer(), LOGOG_DIRECT_BLOCK_SIZE, (off_t)m_nBufferOffset );
+			while (( nRead < 0 ) && ( errno == EINTR ));
+
+			if ( nRead != (ssize_t)m_nBuffered )
+			{
+				m_bOpenFailed = true;
+				return -1;
+			}
+		}
+
+		if ( !m_bUseRing || !OpenRing() )
+		{
+			m_bWriterStop = false;
+			m_bWriterStarted = ( m_WriterThread.Start() == 0 );
+		}
+
+#ifdef LOGOG_UNICODE
+		if ( nFileSize == 0 && m_bWriteUnicodeBOM )
+			WriteUnicodeBOM();
+#endif // LOGOG_UNICODE
+
+		return 0;
+	}
+
+	bool DirectLogFile::IsDirect() const
+	{
+		return m_bDirect;
+	}
+
+	bool DirectLogFile::IsUsingRing() const
+	{
+		return ( m_pRing != NULL );
+	}
+
+	unsigned char *DirectLogFile::GetBuffer()
+	{
+		unsigned char *pFirst = (unsigned char *)((( (size_t)m_pAllocation ) + LOGOG_DIRECT_BLOCK_SIZE - 1 ) &
+			~( (size_t)LOGOG_DIRECT_BLOCK_SIZE - 1 ));
+
+		return pFirst + m_nCurrent * m_nBufferSize;
+	}
+
+	int DirectLogFile::InternalOutput( size_t nSize, const LOGOG_CHAR *pData )
+	{
+		const unsigned char *pBytes = (const unsigned char *)pData;
+		size_t nLength = nSize * sizeof( LOGOG_CHAR );
+
+		while ( nLength > 0 )
+		{
+			size_t nCopy = m_nBufferSize - m_nBuffered;
+
+			if ( nCopy > nLength )
+				nCopy = nLength;
+
+			memcpy( GetBuffer() + m_nBuffered, pBytes, nCopy );
+			m_nBuffered += nCopy;
+			pBytes += nCopy;
+			nLength -= nCopy;
+
+			if ( m_nBuffered == m_nBufferSize )
+				QueueBuffer();
+		}
+
+		m_QueueCondition.Lock();
+		bool bFailed = m_bWriteFailed;
+		m_QueueCondition.Unlock();
+
+		return bFailed ? -1 : 0;
+	}
+
+	void DirectLogFile::QueueBuffer()
+	{
+		unsigned char *pData = GetBuffer();
+		LOGOG_UINT64 nOffset = m_nBufferOffset;
+		size_t nBuffer = m_nCurrent;
+
+		m_nBufferOffset += m_nBufferSize;
+		m_nCurrent = ( m_nCurrent + 1 ) % m_nBuffers;
+		m_nBuffered = 0;
+
+		if ( m_pRing != NULL )
+		{
+			Block &block = m_pQueue[ nBuffer ];
+			block.m_pData = pData;
+			block.m_nOffset = nOffset;
+			block.m_nLength = m_nBufferSize;
+
+			if ( SubmitToRing( nBuffer ))
+				m_nQueued++;
+			else
+			{
+				block.m_nLength = 0;
+
+				if ( WriteBlocks( pData, m_nBufferSize, nOffset ) != 0 )
+				{
+					m_QueueCondition.Lock();
+					m_bWriteFailed = true;
+					m_QueueCondition.Unlock();
+				}
+			}
+
+			/* Reap whatever has finished, and wait only if the next buffer is still being written. */
+			ReapRing( false );
+
+			while ( m_pQueue[ m_nCurrent ].m_nLength != 0 )
+				ReapRing( true );
+
+			return;
+		}
+
+		m_QueueCondition.Lock();
+
+		if ( !m_bWriterStarted )
+		{
+			if ( WriteBlocks( pData, m_nBufferSize, nOffset ) != 0 )
+				m_bWriteFailed = true;
+
+			m_QueueCondition.Unlock();
+			return;
+		}
+
+		Block &block = m_pQueue[ ( m_nQueueHead + m_nQueued ) % m_nBuffers ];
+		block.m_pData = pData;
+		block.m_nOffset = nOffset;
+		block.m_nLength = m_nBufferSize;
+		m_nQueued++;
+		m_QueueCondition.Broadcast();
+
+		/* Once every buffer is queued, the next one to fill is the one being written. */
+		while ( m_nQueued == m_nBuffers )
+			m_QueueCondition.Wait();
+
+		m_QueueCondition.Unlock();
+	}
+
+	void DirectLogFile::WaitForQueue()
+	{
+		if ( m_pRing != NULL )
+		{
+			while ( m_nQueued > 0 )
+				ReapRing( true );
+
+			return;
+		}
+
+		m_QueueCondition.Lock();
+
+		while ( m_nQueued > 0 )
+			m_QueueCondition.Wait();
+
+		m_QueueCondition.Unlock();
+	}
+
+	int DirectLogFile::WriteBlocks( const unsigned char *pData, size_t nLength, LOGOG_UINT64 nOffset )
+	{
+		while ( nLength > 0 )
+		{
+			ssize_t nWritten = pwrite( m_nDescriptor, pData, nLength, (off_t)nOffset );
+
+			if ( nWritten < 0 )
+			{
+				if ( errno == EINTR )
+					continue;
+				return -1;
+			}
+
+			pData += nWritten;
+			nLength -= (size_t)nWritten;
+			nOffset += (LOGOG_UINT64)nWritten;
+		}
+
+		return 0;
+	}
+
+	int DirectLogFile::FlushOutput()
+	{
+		if ( m_pAllocation == NULL )
+			return 0;
+
+		WaitForQueue();
+
+		bool bFailed = false;
+
+		if ( m_nBuffered > 0 )
+		{
+			unsigned char *pData = GetBuffer();
+			size_t nPadded = RoundUpToBlock( m_nBuffered );
+
+			memset( pData + m_nBuffered, 0, nPadded - m_nBuffered );
+
+			if ( WriteBlocks( pData, nPadded, m_nBufferOffset ) != 0 )
+				bFailed = true;
+			else if (( nPadded != m_nBuffered ) &&
+				( ftruncate( m_nDescriptor, (off_t)( m_nBufferOffset + m_nBuffered )) != 0 ))
+				bFailed = true;
+
+			/* Carry the partial block over, to be written again in full; the whole blocks before it are done. */
+			size_t nWhole = m_nBuffered & ~( (size_t)LOGOG_DIRECT_BLOCK_SIZE - 1 );
+
+			if ( nWhole > 0 )
+			{
+				memmove( pData, pData + nWhole, m_nBuffered - nWhole );
+				m_nBufferOffset += nWhole;
+				m_nBuffered -= nWhole;
+			}
+		}
+
+		m_QueueCondition.Lock();
+		if ( bFailed )
+			m_bWriteFailed = true;
+		bFailed = m_bWriteFailed;
+		m_QueueCondition.Unlock();
+
+		return bFailed ? -1 : 0;
+	}
+
+	int DirectLogFile::SyncOutput( bool bDataOnly )
+	{
+		if ( m_nDescriptor < 0 )
+			return 0;
+
+#if defined( __linux__ )
+		int nResult = bDataOnly ? fdatasync( m_nDescriptor ) : fsync( m_nDescriptor );
+#else
+		(void)bDataOnly;
+		int nResult = fsync( m_nDescriptor );
+#endif
+
+		return ( nResult == 0 ) ? 0 : -1;
+	}
+
+	LOGOG_UINT64 DirectLogFile::GetOutputSize()
+	{
+		return m_nBufferOffset + m_nBuffered;
+	}
+
+	void DirectLogFile::StopWriter()
+	{
+		if ( !m_bWriterStarted )
+			return;
+
+		m_QueueCondition.Lock();
+		m_bWriterStop = true;
+		m_QueueCondition.Broadcast();
+		m_QueueCondition.Unlock();
+
+		Thread::WaitFor( m_WriterThread );
+		m_bWriterStarted = false;
+	}
+
+	void *DirectLogFile::WriterThread( void *pvParams )
+	{
+		DirectLogFile *pThis = ( DirectLogFile * )pvParams;
+
+		pThis->m_QueueCondition.Lock();
+
+		for ( ;; )
+		{
+			while (( pThis->m_nQueued == 0 ) && !pThis->m_bWriterStop )
+				pThis->m_QueueCondition.Wait();
+
+			if ( pThis->m_nQueued == 0 )
+				break;
+
+			/* Gather every block waiting into one write.  The blocks stay queued while they are written, so that
+			 * their buffers aren't reused meanwhile. */
+			struct iovec vVectors[ LOGOG_DIRECT_MAX_GATHER ];
+			LOGOG_UINT64 nOffset = pThis->m_pQueue[ pThis->m_nQueueHead ].m_nOffset;
+			LOGOG_UINT64 nEnd = nOffset;
+			int nCount = 0;
+
+			while (( nCount < LOGOG_DIRECT_MAX_GATHER ) && ( (size_t)nCount < pThis->m_nQueued ))
+			{
+				const Block &block = pThis->m_pQueue[ ( pThis->m_nQueueHead + nCount ) % pThis->m_nBuffers ];
+
+				if ( block.m_nOffset != nEnd )
+					break;
+
+				vVectors[ nCount ].iov_base = block.m_pData;
+				vVectors[ nCount ].iov_len = block.m_nLength;
+				nEnd += block.m_nLength;
+				nCount++;
+			}
+
+			pThis->m_QueueCondition.Unlock();
+
+			bool bFailed = ( WriteVector( pThis->m_nDescriptor, vVectors, nCount, nOffset ) != 0 );
+
+			pThis->m_QueueCondition.Lock();
+			if ( bFailed )
+				pThis->m_bWriteFailed = true;
+			pThis->m_nQueueHead = ( pThis->m_nQueueHead + (size_t)nCount ) % pThis->m_nBuffers;
+			pThis->m_nQueued -= (size_t)nCount;
+			pThis->m_QueueCondition.Broadcast();
+		}
+
+		pThis->m_QueueCondition.Unlock();
+
+		return NULL;
+	}
+
+#ifdef LOGOG_DIRECT_RING
+	/** An io_uring: the submission and completion rings, and the array of submission entries, as mapped from the
+	 ** kernel.  Only the thread that holds the target's m_MutexReceive touches it.
+	 **/
+	struct DirectRing
+	{
+		int m_nRing;
+		void *m_pRings;
+		size_t m_nRingsSize;
+		void *m_pCompletionRing;
+		size_t m_nCompletionRingSize;
+		struct io_uring_sqe *m_pEntries;
+		size_t m_nEntriesSize;
+
+		unsigned *m_pSubmitHead;
+		unsigned *m_pSubmitTail;
+		unsigned *m_pSubmitMask;
+		unsigned *m_pSubmitArray;
+		unsigned m_nSubmitEntries;
+
+		unsigned *m_pCompleteHead;
+		unsigned *m_pCompleteTail;
+		unsigned *m_pCompleteMask;
+		struct io_uring_cqe *m_pCompletions;
+
+		/** One vector for each buffer, which must stay put until its write completes. */
+		struct iovec *m_pVectors;
+	};
+
+	static int RingEnter( int nRing, unsigned nSubmit, unsigned nWait, unsigned nFlags )
+	{
+		return (int)syscall( __NR_io_uring_enter, nRing, nSubmit, nWait, nFlags, NULL, 0 );
+	}
+
+	bool DirectLogFile::OpenRing()
+	{
+		struct io_uring_params params;
+		memset( &params, 0, sizeof( params ));
+
+		int nRing = (int)syscall( __NR_io_uring_setup, (unsigned)m_nBuffers, &params );
+
+		/* ENOSYS, EPERM and the like: no io_uring here, so the writing thread takes over. */
+		if ( nRing < 0 )
+			return false;
+
+		DirectRing *pRing = (DirectRing *)Object::Allocate( sizeof( DirectRing ));
+		memset( pRing, 0, sizeof( DirectRing ));
+		pRing->m_nRing = nRing;
+
+		pRing->m_nRingsSize = params.sq_off.array + params.sq_entries * sizeof( unsigned );
+		pRing->m_nCompletionRingSize = params.cq_off.cqes + params.cq_entries * sizeof( struct io_uring_cqe );
+
+		/* Newer kernels map both rings at once. */
+		if (( params.features & IORING_FEAT_SINGLE_MMAP ) && ( pRing->m_nCompletionRingSize > pRing->m_nRingsSize ))
+			pRing->m_nRingsSize = pRing->m_nCompletionRingSize;
+
+		pRing->m_pRings = mmap( NULL, pRing->m_nRingsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			nRing, IORING_OFF_SQ_RING );
+
+		if ( pRing->m_pRings != MAP_FAILED )
+		{
+			if ( params.features & IORING_FEAT_SINGLE_MMAP )
+			{
+				pRing->m_pCompletionRing = pRing->m_pRings;
+				pRing->m_nCompletionRingSize = 0;
+			}
+			else
+				pRing->m_pCompletionRing = mmap( NULL, pRing->m_nCompletionRingSize, PROT_READ | PROT_WRITE,
+					MAP_SHARED | MAP_POPULATE, nRing, IORING_OFF_CQ_RING );
+		}
+
+		pRing->m_nEntriesSize = params.sq_entries * sizeof( struct io_uring_sqe );
+		pRing->m_pEntries = (struct io_uring_sqe *)mmap( NULL, pRing->m_nEntriesSize, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, nRing, IORING_OFF_SQES );
+
+		if (( pRing->m_pRings == MAP_FAILED ) || ( pRing->m_pCompletionRing == MAP_FAILED ) ||
+			( pRing->m_pEntries == MAP_FAILED ))
+		{
+			if ( pRing->m_pEntries != MAP_FAILED )
+				munmap( pRing->m_pEntries, pRing->m_nEntriesSize );
+			if (( pRing->m_nCompletionRingSize != 0 ) && ( pRing->m_pCompletionRing != MAP_FAILED ))
+				munmap( pRing->m_pCompletionRing, pRing->m_nCompletionRingSize );
+			if ( pRing->m_pRings != MAP_FAILED )
+				munmap( pRing->m_pRings, pRing->m_nRingsSize );
+
+			close( nRing );
+			Object::Deallocate( pRing );
+			return false;
+		}
+
+		unsigned char *pSubmit = (unsigned char *)pRing->m_pRings;
+		pRing->m_pSubmitHead = (unsigned *)( pSubmit + params.sq_off.head );
+		pRing->m_pSubmitTail = (unsigned *)( pSubmit + params.sq_off.tail );
+		pRing->m_pSubmitMask = (unsigned *)( pSubmit + params.sq_off.ring_mask );
+		pRing->m_pSubmitArray = (unsigned *)( pSubmit + params.sq_off.array );
+		pRing->m_nSubmitEntries = params.sq_entries;
+
+		unsigned char *pComplete = (unsigned char *)pRing->m_pCompletionRing;
+		pRing->m_pCompleteHead = (unsigned *)( pComplete + params.cq_off.head );
+		pRing->m_pCompleteTail = (unsigned *)( pComplete + params.cq_off.tail );
+		pRing->m_pCompleteMask = (unsigned *)( pComplete + params.cq_off.ring_mask );
+		pRing->m_pCompletions = (struct io_uring_cqe *)( pComplete + params.cq_off.cqes );
+
+		pRing->m_pVectors = (struct iovec *)Object::Allocate( sizeof( struct iovec ) * m_nBuffers );
+
+		m_pRing = pRing;
+		return true;
+	}
+
+	bool DirectLogFile::SubmitToRing( size_t nBuffer )
+	{
+		DirectRing *pRing = m_pRing;
+		unsigned nTail = *pRing->m_pSubmitTail;
+
+		/* The kernel consumes entries as they are submitted, and no more buffers than entries are ever in flight,
+		 * so this is only a precaution. */
+		if ( nTail - __atomic_load_n( pRing->m_pSubmitHead, __ATOMIC_ACQUIRE ) >= pRing->m_nSubmitEntries )
+			return false;
+
+		const Block &block = m_pQueue[ nBuffer ];
+		struct iovec *pVector = &pRing->m_pVectors[ nBuffer ];
+		pVector->iov_base = block.m_pData;
+		pVector->iov_len = block.m_nLength;
+
+		unsigned nIndex = nTail & *pRing->m_pSubmitMask;
+		struct io_uring_sqe *pEntry = &pRing->m_pEntries[ nIndex ];
+
+		/* IORING_OP_WRITEV is the oldest write operation, so any kernel with io_uring at all has it. */
+		memset( pEntry, 0, sizeof( *pEntry ));
+		pEntry->opcode = IORING_OP_WRITEV;
+		pEntry->fd = m_nDescriptor;
+		pEntry->addr = (LOGOG_UINT64)(size_t)pVector;
+		pEntry->len = 1;
+		pEntry->off = block.m_nOffset;
+		pEntry->user_data = nBuffer;
+
+		pRing->m_pSubmitArray[ nIndex ] = nIndex;
+		__atomic_store_n( pRing->m_pSubmitTail, nTail + 1, __ATOMIC_RELEASE );
+
+		int nSubmitted;
+
+		do
+			nSubmitted = RingEnter( pRing->m_nRing, 1, 0, 0 );
+		while (( nSubmitted < 0 ) && ( errno == EINTR ));
+
+		if ( nSubmitted == 1 )
+			return true;
+
+		/* Take the entry back, so that the kernel never sees it. */
+		__atomic_store_n( pRing->m_pSubmitTail, nTail, __ATOMIC_RELEASE );
+		return false;
+	}
+
+	void DirectLogFile::ReapRing( bool bWait )
+	{
+		DirectRing *pRing = m_pRing;
+		bool bFailed = false;
+
+		for ( ;; )
+		{
+			unsigned nHead = *pRing->m_pCompleteHead;
+			unsigned nTail = __atomic_load_n( pRing->m_pCompleteTail, __ATOMIC_ACQUIRE );
+
+			if ( nHead == nTail )
+			{
+				if ( !bWait || ( m_nQueued == 0 ))
+					break;
+
+				if (( RingEnter( pRing->m_nRing, 0, 1, IORING_ENTER_GETEVENTS ) < 0 ) && ( errno != EINTR ))
+				{
+					/* The ring is broken; nothing more will complete, so give up on what is in flight. */
+					for ( size_t t = 0; t < m_nBuffers; t++ )
+						m_pQueue[ t ].m_nLength = 0;
+					m_nQueued = 0;
+					bFailed = true;
+					break;
+				}
+
+				continue;
+			}
+
+			for ( ; nHead != nTail; nHead++ )
+			{
+				const struct io_uring_cqe &completion = pRing->m_pCompletions[ nHead & *pRing->m_pCompleteMask ];
+				Block &block = m_pQueue[ (size_t)completion.user_data ];
+
+				if ( completion.res < 0 )
+					bFailed = true;
+				else if ( (size_t)completion.res < block.m_nLength )
+				{
+					/* A short write; finish it here. */
+					if ( WriteBlocks( block.m_pData + completion.res, block.m_nLength - (size_t)completion.res,
+						block.m_nOffset + (LOGOG_UINT64)completion.res ) != 0 )
+						bFailed = true;
+				}
+
+				block.m_nLength = 0;
+				m_nQueued--;
+			}
+
+			__atomic_store_n( pRing->m_pCompleteHead, nHead, __ATOMIC_RELEASE );
+			bWait = false;
+		}
+
+		if ( bFailed )
+		{
+			m_QueueCondition.Lock();
+			m_bWriteFailed = true;
+			m_QueueCondition.Unlock();
+		}
+	}
+
+	void DirectLogFile::CloseRing()
+	{
+		DirectRing *pRing = m_pRing;
+
+		if ( pRing == NULL )
+			return;
+
+		munmap( pRing->m_pEntries, pRing->m_nEntriesSize );
+		if ( pRing->m_nCompletionRingSize != 0 )
+			munmap( pRing->m_pCompletionRing, pRing->m_nCompletionRingSize );
+		munmap( pRing->m_pRings, pRing->m_nRingsSize );
+		close( pRing->m_nRing );
+
+		Object::Deallocate( pRing->m_pVectors );
+		Object::Deallocate( pRing );
+		m_pRing = NULL;
+	}
+#else // LOGOG_DIRECT_RING
+	bool DirectLogFile::OpenRing()
+	{
+		return false;
+	}
+
+	bool DirectLogFile::SubmitToRing( size_t )
+	{
+		return false;
+	}
+
+	void DirectLogFile::ReapRing( bool )
+	{
+	}
+
+	void DirectLogFile::CloseRing()
+	{
+	}
+#endif // LOGOG_DIRECT_RING
+}
+
+#endif // LOGOG_FLAVOR_POSIX
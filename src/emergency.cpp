@@ -0,0 +1,194 @@
+/*
+ * \file emergency.cpp
+ */
+
+#include "logog.hpp"
+
+#include <cerrno>
+
+#ifdef LOGOG_FLAVOR_WINDOWS
+#include <io.h>
+#else // LOGOG_FLAVOR_WINDOWS
+#include <unistd.h>
+#endif // LOGOG_FLAVOR_WINDOWS
+
+namespace logog {
+
+	/* Everything here may run in a signal handler, so it uses only static storage, the stack, atomic operations
+	 * and write(). */
+
+	static int s_vEmergencyDescriptors[ LOGOG_EMERGENCY_MAX_DESCRIPTORS ] = { 2 };
+	static size_t s_nEmergencyDescriptors = 1;
+	static Target *s_vEmergencyTargets[ LOGOG_EMERGENCY_MAX_TARGETS ];
+
+	static const char s_sEmergencyPrefix[] = "emergency: ";
+
+	void SetEmergencyDescriptors( const int *pDescriptors, size_t nCount )
+	{
+		if ( nCount > LOGOG_EMERGENCY_MAX_DESCRIPTORS )
+			nCount = LOGOG_EMERGENCY_MAX_DESCRIPTORS;
+
+		for ( size_t t = 0; t < nCount; t++ )
+			s_vEmergencyDescriptors[ t ] = pDescriptors[ t ];
+
+		s_nEmergencyDescriptors = nCount;
+	}
+
+	static void EmergencyWriteDescriptor( int nDescriptor, const char *pData, size_t nLength )
+	{
+		while ( nLength > 0 )
+		{
+#ifdef LOGOG_FLAVOR_WINDOWS
+			int nWritten = _write( nDescriptor, pData, (unsigned int)nLength );
+#else // LOGOG_FLAVOR_WINDOWS
+			ssize_t nWritten = write( nDescriptor, pData, nLength );
+#endif // LOGOG_FLAVOR_WINDOWS
+
+			if ( nWritten < 0 )
+			{
+				if ( errno == EINTR )
+					continue;
+				return;
+			}
+
+			if ( nWritten == 0 )
+				return;
+
+			pData += nWritten;
+			nLength -= (size_t)nWritten;
+		}
+	}
+
+	void EmergencyWrite( const void *pData, size_t nLength )
+	{
+		/* A signal handler must leave errno as it found it. */
+		int nSavedErrno = errno;
+
+		for ( size_t t = 0; t < s_nEmergencyDescriptors; t++ )
+			EmergencyWriteDescriptor( s_vEmergencyDescriptors[ t ], (const char *)pData, nLength );
+
+		errno = nSavedErrno;
+	}
+
+	bool AddEmergencyTarget( Target *pTarget )
+	{
+		for ( size_t t = 0; t < LOGOG_EMERGENCY_MAX_TARGETS; t++ )
+		{
+			if ( LOGOG_ATOMIC_CAS_POINTER( &s_vEmergencyTargets[ t ], (Target *)NULL, pTarget ))
+				return true;
+		}
+
+		return false;
+	}
+
+	void RemoveEmergencyTarget( Target *pTarget )
+	{
+		for ( size_t t = 0; t < LOGOG_EMERGENCY_MAX_TARGETS; t++ )
+		{
+			if ( LOGOG_ATOMIC_CAS_POINTER( &s_vEmergencyTargets[ t ], pTarget, (Target *)NULL ))
+				return;
+		}
+	}
+
+	void EmergencyFlush()
+	{
+		for ( size_t t = 0; t < LOGOG_EMERGENCY_MAX_TARGETS; t++ )
+		{
+			Target *pTarget = (Target *)LOGOG_ATOMIC_LOAD_POINTER( &s_vEmergencyTargets[ t ] );
+
+			if ( pTarget != NULL )
+				pTarget->EmergencyDump();
+		}
+	}
+
+	void EmergencyLog( const char *sMessage )
+	{
+		EmergencyMessage msg;
+
+		msg.Append( sMessage );
+		msg.Write();
+
+		EmergencyFlush();
+	}
+
+	EmergencyMessage::EmergencyMessage() :
+		m_nLength( 0 )
+	{
+		m_vBuffer[ 0 ] = '\0';
+		Append( s_sEmergencyPrefix );
+	}
+
+	EmergencyMessage &EmergencyMessage::Append( const char *sText )
+	{
+		if ( sText == NULL )
+			sText = "(null)";
+
+		/* Leave room for the new line added by Write(), and the terminating null. */
+		while (( *sText != '\0' ) && ( m_nLength < sizeof( m_vBuffer ) - 2 ))
+			m_vBuffer[ m_nLength++ ] = *sText++;
+
+		m_vBuffer[ m_nLength ] = '\0';
+
+		return *this;
+	}
+
+	EmergencyMessage &EmergencyMessage::AppendInteger( LOGOG_INT64 nValue )
+	{
+		char vDigits[ 24 ];
+		char *pDigit = vDigits + sizeof( vDigits );
+		/* Negate as unsigned, so that the most negative value doesn't overflow. */
+		LOGOG_UINT64 nMagnitude = ( nValue < 0 ) ? ( 0 - (LOGOG_UINT64)nValue ) : (LOGOG_UINT64)nValue;
+
+		*--pDigit = '\0';
+		do
+		{
+			*--pDigit = (char)( '0' + ( nMagnitude % 10 ));
+			nMagnitude /= 10;
+		} while ( nMagnitude != 0 );
+
+		if ( nValue < 0 )
+			*--pDigit = '-';
+
+		return Append( pDigit );
+	}
+
+	EmergencyMessage &EmergencyMessage::AppendHex( LOGOG_UINT64 nValue )
+	{
+		char vDigits[ 20 ];
+		char *pDigit = vDigits + sizeof( vDigits );
+
+		*--pDigit = '\0';
+		do
+		{
+			*--pDigit = "0123456789abcdef"[ nValue & 15 ];
+			nValue >>= 4;
+		} while ( nValue != 0 );
+
+		*--pDigit = 'x';
+		*--pDigit = '0';
+
+		return Append( pDigit );
+	}
+
+	const char *EmergencyMessage::c_str() const
+	{
+		return m_vBuffer;
+	}
+
+	size_t EmergencyMessage::size() const
+	{
+		return m_nLength;
+	}
+
+	void EmergencyMessage::Write() const
+	{
+		char vLine[ LOGOG_EMERGENCY_MESSAGE_SIZE ];
+
+		for ( size_t t = 0; t < m_nLength; t++ )
+			vLine[ t ] = m_vBuffer[ t ];
+		vLine[ m_nLength ] = '\n';
+
+		/* One write per descriptor, so that messages from several crashing threads don't interleave mid-line. */
+		EmergencyWrite( vLine, m_nLength + 1 );
+	}
+}
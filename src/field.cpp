@@ -0,0 +1,209 @@
+/*
+ * \file field.cpp
+ */
+
+#include "logog.hpp"
+
+namespace logog {
+
+	/* Compares a null-terminated string against nLength characters, which need not be null-terminated. */
+	static bool FieldCharsEqual( const LOGOG_CHAR *sString, const LOGOG_CHAR *pChars, size_t nLength )
+	{
+		for ( size_t t = 0; t < nLength; t++ )
+			if ( sString[ t ] != pChars[ t ] )
+				return false;
+
+		return ( sString[ nLength ] == (LOGOG_CHAR)NULL );
+	}
+
+	FieldSet::FieldSet() :
+		m_nCount( 0 )
+	{
+	}
+
+	size_t FieldSet::Count() const
+	{
+		return m_nCount;
+	}
+
+	const Field &FieldSet::Get( size_t nIndex ) const
+	{
+		return m_vFields[ nIndex ];
+	}
+
+	const Field *FieldSet::Find( const LOGOG_CHAR *sKey ) const
+	{
+		for ( size_t t = 0; t < m_nCount; t++ )
+			if ( FieldCharsEqual( sKey, m_vFields[ t ].m_sKey, String::Length( m_vFields[ t ].m_sKey )))
+				return &m_vFields[ t ];
+
+		return NULL;
+	}
+
+	Field *FieldSet::Next( const LOGOG_CHAR *sKey, FieldType type )
+	{
+		if (( m_nCount >= LOGOG_MAX_FIELDS ) || ( sKey == NULL ))
+			return NULL;
+
+		Field *pField = &m_vFields[ m_nCount++ ];
+		pField->m_sKey = sKey;
+		pField->m_Type = type;
+
+		return pField;
+	}
+
+	void FieldSet::AddValue( const LOGOG_CHAR *sKey, int nValue )
+	{
+		AddValue( sKey, (long long)nValue );
+	}
+
+	void FieldSet::AddValue( const LOGOG_CHAR *sKey, unsigned int nValue )
+	{
+		AddValue( sKey, (unsigned long long)nValue );
+	}
+
+	void FieldSet::AddValue( const LOGOG_CHAR *sKey, long nValue )
+	{
+		AddValue( sKey, (long long)nValue );
+	}
+
+	void FieldSet::AddValue( const LOGOG_CHAR *sKey, unsigned long nValue )
+	{
+		AddValue( sKey, (unsigned long long)nValue );
+	}
+
+	void FieldSet::AddValue( const LOGOG_CHAR *sKey, long long nValue )
+	{
+		Field *pField = Next( sKey, FIELD_INTEGER );
+
+		if ( pField != NULL )
+			pField->m_nInteger = (LOGOG_INT64)nValue;
+	}
+
+	void FieldSet::AddValue( const LOGOG_CHAR *sKey, unsigned long long nValue )
+	{
+		Field *pField = Next( sKey, FIELD_UNSIGNED );
+
+		if ( pField != NULL )
+			pField->m_nUnsigned = (LOGOG_UINT64)nValue;
+	}
+
+	void FieldSet::AddValue( const LOGOG_CHAR *sKey, double dValue )
+	{
+		Field *pField = Next( sKey, FIELD_FLOAT );
+
+		if ( pField != NULL )
+			pField->m_dFloat = dValue;
+	}
+
+	void FieldSet::AddValue( const LOGOG_CHAR *sKey, long double dValue )
+	{
+		AddValue( sKey, (double)dValue );
+	}
+
+	void FieldSet::AddValue( const LOGOG_CHAR *sKey, bool bValue )
+	{
+		Field *pField = Next( sKey, FIELD_BOOLEAN );
+
+		if ( pField != NULL )
+			pField->m_bBoolean = bValue;
+	}
+
+	void FieldSet::AddValue( const LOGOG_CHAR *sKey, const LOGOG_CHAR *sValue )
+	{
+		Field *pField = Next( sKey, FIELD_STRING );
+
+		if ( pField != NULL )
+		{
+			pField->m_String.m_pChars = sValue;
+			pField->m_String.m_nLength = ( sValue == NULL ) ? 0 : String::Length( sValue );
+		}
+	}
+
+	void FieldSet::AddValue( const LOGOG_CHAR *sKey, const LOGOG_STRING &sValue )
+	{
+		Field *pField = Next( sKey, FIELD_STRING );
+
+		if ( pField != NULL )
+		{
+			/* Strings assigned from constants count their trailing null in size(), so stop at the first null. */
+			const LOGOG_CHAR *pChars = sValue.c_str();
+			size_t nSize = ( pChars == NULL ) ? 0 : sValue.size();
+			size_t nLength = 0;
+
+			while (( nLength < nSize ) && ( pChars[ nLength ] != (LOGOG_CHAR)NULL ))
+				nLength++;
+
+			pField->m_String.m_pChars = pChars;
+			pField->m_String.m_nLength = nLength;
+		}
+	}
+
+	FieldFilter::FieldFilter( const LOGOG_CHAR *sKey ) :
+		m_Match( MATCH_ANY ),
+		m_nValue( 0 )
+	{
+		size_t nLength = String::Length( sKey );
+		m_sKey.reserve( nLength + 1 );
+		m_sKey.append( sKey, nLength );
+	}
+
+	void FieldFilter::MatchString( const LOGOG_CHAR *sValue )
+	{
+		size_t nLength = String::Length( sValue );
+		m_sValue.reserve( nLength + 1 );
+		m_sValue.append( sValue, nLength );
+		m_Match = MATCH_STRING;
+	}
+
+	void FieldFilter::MatchInteger( LOGOG_INT64 nValue )
+	{
+		m_nValue = nValue;
+		m_Match = MATCH_INTEGER;
+	}
+
+	void FieldFilter::MatchAny()
+	{
+		m_Match = MATCH_ANY;
+	}
+
+	bool FieldFilter::Matches( const Field &field ) const
+	{
+		switch ( m_Match )
+		{
+		case MATCH_ANY:
+			return true;
+
+		case MATCH_STRING:
+			return ( field.m_Type == FIELD_STRING ) &&
+				FieldCharsEqual( m_sValue.c_str(), field.m_String.m_pChars, field.m_String.m_nLength );
+
+		case MATCH_INTEGER:
+			if ( field.m_Type == FIELD_INTEGER )
+				return field.m_nInteger == m_nValue;
+			if ( field.m_Type == FIELD_UNSIGNED )
+				return ( m_nValue >= 0 ) && ( field.m_nUnsigned == (LOGOG_UINT64)m_nValue );
+			if ( field.m_Type == FIELD_BOOLEAN )
+				return ( field.m_bBoolean ? 1 : 0 ) == m_nValue;
+			return false;
+		}
+
+		return false;
+	}
+
+	/** The FieldFilter silently discards messages that don't carry a matching field. */
+	int FieldFilter::Receive( const Topic &node )
+	{
+		const FieldSet *pFields = node.Fields();
+
+		if ( pFields == NULL )
+			return 0;
+
+		const Field *pField = pFields->Find( m_sKey.c_str() );
+
+		if (( pField == NULL ) || !Matches( *pField ))
+			return 0;
+
+		return super::Receive( node );
+	}
+}
@@ -0,0 +1,376 @@
+/*
+ * \file flight.cpp
+ */
+
+#include "logog.hpp"
+
+#include <cstring>
+
+#ifndef LOGOG_FLAVOR_WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // LOGOG_FLAVOR_WINDOWS
+
+namespace logog {
+
+	/** The size of the header in front of each record in the ring. */
+	static const size_t FLIGHT_RECORD_HEADER_SIZE = 8;
+
+	static inline size_t AlignFlight( size_t n )
+	{
+		return ( n + 7 ) & ~(size_t)7;
+	}
+
+	FlightRecorder::FlightRecorder( const char *sFileName, size_t nSize ) :
+		m_pMapping( NULL ),
+		m_nMappingSize( 0 ),
+		m_pHeader( NULL ),
+		m_pRing( NULL ),
+		m_nRingSize( AlignFlight( nSize < 64 ? 64 : nSize )),
+		m_nCursor( 0 ),
+#ifdef LOGOG_FLAVOR_WINDOWS
+		m_hFile( INVALID_HANDLE_VALUE ),
+		m_hMapping( NULL )
+#else // LOGOG_FLAVOR_WINDOWS
+		m_nFile( -1 )
+#endif // LOGOG_FLAVOR_WINDOWS
+	{
+		m_bNullTerminatesStrings = false;
+		SetName( LOGOG_CONST_STRING( "flight" ));
+
+		Map( sFileName );
+	}
+
+	FlightRecorder::~FlightRecorder()
+	{
+		Unmap();
+	}
+
+	int FlightRecorder::Sync()
+	{
+		ScopedLock sl( m_MutexReceive );
+
+		if ( m_pMapping == NULL )
+			return 0;
+
+#ifdef LOGOG_FLAVOR_WINDOWS
+		return ( FlushViewOfFile( m_pMapping, m_nMappingSize ) && FlushFileBuffers( m_hFile )) ? 0 : -1;
+#else // LOGOG_FLAVOR_WINDOWS
+		return ( msync( m_pMapping, m_nMappingSize, MS_SYNC ) == 0 ) ? 0 : -1;
+#endif // LOGOG_FLAVOR_WINDOWS
+	}
+
+	bool FlightRecorder::IsOpen() const
+	{
+		return ( m_pRing != NULL );
+	}
+
+	bool FlightRecorder::Map( const char *sFileName )
+	{
+		m_nMappingSize = sizeof( FlightRecorderHeader ) + m_nRingSize;
+
+#ifdef LOGOG_FLAVOR_WINDOWS
+		m_hFile = CreateFileA( sFileName, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS,
+			FILE_ATTRIBUTE_NORMAL, NULL );
+		if ( m_hFile == INVALID_HANDLE_VALUE )
+			return false;
+
+		LARGE_INTEGER nFileSize;
+		nFileSize.QuadPart = (LONGLONG)m_nMappingSize;
+		if ( !SetFilePointerEx( m_hFile, nFileSize, NULL, FILE_BEGIN ) || !SetEndOfFile( m_hFile ))
+		{
+			Unmap();
+			return false;
+		}
+
+		m_hMapping = CreateFileMappingA( m_hFile, NULL, PAGE_READWRITE, 0, 0, NULL );
+		if ( m_hMapping == NULL )
+		{
+			Unmap();
+			return false;
+		}
+
+		m_pMapping = (unsigned char *)MapViewOfFile( m_hMapping, FILE_MAP_WRITE, 0, 0, m_nMappingSize );
+		if ( m_pMapping == NULL )
+		{
+			Unmap();
+			return false;
+		}
+#else // LOGOG_FLAVOR_WINDOWS
+		m_nFile = open( sFileName, O_RDWR | O_CREAT, 0644 );
+		if ( m_nFile < 0 )
+			return false;
+
+		struct stat st;
+		if (( fstat( m_nFile, &st ) != 0 ) ||
+			(( (size_t)st.st_size != m_nMappingSize ) && ( ftruncate( m_nFile, (off_t)m_nMappingSize ) != 0 )))
+		{
+			Unmap();
+			return false;
+		}
+
+#ifdef __linux__
+		/* Allocate the blocks now; writing to a hole in a mapped file raises SIGBUS if the disk is full. */
+		if ( posix_fallocate( m_nFile, 0, (off_t)m_nMappingSize ) != 0 )
+		{
+			Unmap();
+			return false;
+		}
+#endif // __linux__
+
+		void *pMapping = mmap( NULL, m_nMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_nFile, 0 );
+		if ( pMapping == MAP_FAILED )
+		{
+			Unmap();
+			return false;
+		}
+
+		m_pMapping = (unsigned char *)pMapping;
+#endif // LOGOG_FLAVOR_WINDOWS
+
+		m_pHeader = (FlightRecorderHeader *)m_pMapping;
+		m_pRing = m_pMapping + sizeof( FlightRecorderHeader );
+
+		if (( memcmp( m_pHeader->m_vMagic, LOGOG_FLIGHT_MAGIC, LOGOG_FLIGHT_MAGIC_LENGTH ) == 0 ) &&
+			( m_pHeader->m_nVersion == LOGOG_FLIGHT_VERSION ) &&
+			( m_pHeader->m_nHeaderSize == sizeof( FlightRecorderHeader )) &&
+			( m_pHeader->m_nRingSize == m_nRingSize ) &&
+			(( m_pHeader->m_nCursor & 7 ) == 0 ))
+		{
+			/* Carry on after the previous run, so that its last records survive until they are overwritten. */
+			m_nCursor = m_pHeader->m_nCursor;
+			return true;
+		}
+
+		/* Write the magic last, so that a header interrupted part way through is never mistaken for a valid one. */
+		memset( m_pHeader, 0, sizeof( FlightRecorderHeader ));
+		m_pHeader->m_nVersion = LOGOG_FLIGHT_VERSION;
+		m_pHeader->m_nHeaderSize = sizeof( FlightRecorderHeader );
+		m_pHeader->m_nRingSize = m_nRingSize;
+		memcpy( m_pHeader->m_vMagic, LOGOG_FLIGHT_MAGIC, LOGOG_FLIGHT_MAGIC_LENGTH );
+		m_nCursor = 0;
+
+		return true;
+	}
+
+	void FlightRecorder::Unmap()
+	{
+#ifdef LOGOG_FLAVOR_WINDOWS
+		if ( m_pMapping != NULL )
+			UnmapViewOfFile( m_pMapping );
+		if ( m_hMapping != NULL )
+			CloseHandle( m_hMapping );
+		if ( m_hFile != INVALID_HANDLE_VALUE )
+			CloseHandle( m_hFile );
+
+		m_hMapping = NULL;
+		m_hFile = INVALID_HANDLE_VALUE;
+#else // LOGOG_FLAVOR_WINDOWS
+		if ( m_pMapping != NULL )
+			munmap( m_pMapping, m_nMappingSize );
+		if ( m_nFile >= 0 )
+			close( m_nFile );
+
+		m_nFile = -1;
+#endif // LOGOG_FLAVOR_WINDOWS
+
+		m_pMapping = NULL;
+		m_pHeader = NULL;
+		m_pRing = NULL;
+	}
+
+	int FlightRecorder::Output( const LOGOG_STRING &data )
+	{
+		if ( m_pRing == NULL )
+			return -1;
+
+		size_t nLength = data.size() * sizeof( LOGOG_CHAR );
+		if ( nLength > m_nRingSize - FLIGHT_RECORD_HEADER_SIZE )
+			nLength = m_nRingSize - FLIGHT_RECORD_HEADER_SIZE;
+
+		/* The cursor is always a multiple of eight, and so is the ring, so a record header never wraps. */
+		size_t nOffset = (size_t)( m_nCursor % m_nRingSize );
+		unsigned int vRecordHeader[ 2 ];
+		vRecordHeader[ 0 ] = LOGOG_FLIGHT_RECORD_MARKER;
+		vRecordHeader[ 1 ] = (unsigned int)nLength;
+		memcpy( m_pRing + nOffset, vRecordHeader, FLIGHT_RECORD_HEADER_SIZE );
+
+		nOffset += FLIGHT_RECORD_HEADER_SIZE;
+		if ( nOffset == m_nRingSize )
+			nOffset = 0;
+
+		const unsigned char *pData = (const unsigned char *)data.c_str();
+		size_t nFirst = m_nRingSize - nOffset;
+
+		if ( nLength <= nFirst )
+		{
+			if ( nLength > 0 )
+				memcpy( m_pRing + nOffset, pData, nLength );
+		}
+		else
+		{
+			memcpy( m_pRing + nOffset, pData, nFirst );
+			memcpy( m_pRing, pData + nFirst, nLength - nFirst );
+		}
+
+		m_nCursor += FLIGHT_RECORD_HEADER_SIZE + AlignFlight( nLength );
+
+		/* Publish the record only once it is complete; a crash before this leaves the old cursor in place. */
+		LOGOG_ATOMIC_STORE_RELEASE( &m_pHeader->m_nCursor, m_nCursor );
+		LOGOG_ATOMIC_STORE( &m_pHeader->m_nRecords, m_pHeader->m_nRecords + 1 );
+
+		return 0;
+	}
+
+	FlightRecorderReader::FlightRecorderReader() :
+		m_nCursor( 0 ),
+		m_nPosition( 0 ),
+		m_nRecordsWritten( 0 )
+	{
+	}
+
+	void FlightRecorderReader::Close()
+	{
+		m_vRing.clear();
+		m_vRecord.clear();
+		m_nCursor = 0;
+		m_nPosition = 0;
+		m_nRecordsWritten = 0;
+	}
+
+	LOGOG_UINT64 FlightRecorderReader::GetRecordsWritten() const
+	{
+		return m_nRecordsWritten;
+	}
+
+	bool FlightRecorderReader::Open( const char *sFileName, bool bSearch )
+	{
+		Close();
+
+		FILE *fp;
+
+#ifdef LOGOG_FLAVOR_WINDOWS
+		if ( fopen_s( &fp, sFileName, "rb" ) != 0 )
+			fp = NULL;
+#else // LOGOG_FLAVOR_WINDOWS
+		fp = fopen( sFileName, "rb" );
+#endif // LOGOG_FLAVOR_WINDOWS
+
+		if ( fp == NULL )
+			return false;
+
+		/* Mappings start on page boundaries, and core dumps keep them there. */
+		const size_t nPageSize = 4096;
+		LOGOG_UINT64 nHeaderOffset = 0;
+		FlightRecorderHeader header;
+		bool bFound = false;
+
+		while ( !bFound )
+		{
+			if ( !SeekLogFile( fp, nHeaderOffset ) ||
+				( fread( &header, 1, sizeof( header ), fp ) != sizeof( header )))
+				break;
+
+			bFound = ( memcmp( header.m_vMagic, LOGOG_FLIGHT_MAGIC, LOGOG_FLIGHT_MAGIC_LENGTH ) == 0 ) &&
+				( header.m_nVersion == LOGOG_FLIGHT_VERSION ) &&
+				( header.m_nHeaderSize == sizeof( FlightRecorderHeader )) &&
+				( header.m_nRingSize >= 64 ) && ( header.m_nRingSize <= ( (LOGOG_UINT64)1 << 32 )) &&
+				(( header.m_nRingSize & 7 ) == 0 ) && (( header.m_nCursor & 7 ) == 0 );
+
+			if ( !bSearch )
+				break;
+
+			if ( !bFound )
+				nHeaderOffset += nPageSize;
+		}
+
+		if ( bFound )
+		{
+			m_vRing.resize( (size_t)header.m_nRingSize );
+			bFound = ( fread( &m_vRing[ 0 ], 1, m_vRing.size(), fp ) == m_vRing.size() );
+		}
+
+		fclose( fp );
+
+		if ( !bFound )
+		{
+			Close();
+			return false;
+		}
+
+		m_nCursor = header.m_nCursor;
+		m_nRecordsWritten = header.m_nRecords;
+		m_nPosition = FindOldestRecord();
+
+		return true;
+	}
+
+	void FlightRecorderReader::CopyFromRing( LOGOG_UINT64 nPosition, unsigned char *pOut, size_t nLength ) const
+	{
+		size_t nRingSize = m_vRing.size();
+		size_t nOffset = (size_t)( nPosition % nRingSize );
+		size_t nFirst = nRingSize - nOffset;
+
+		if ( nLength <= nFirst )
+			memcpy( pOut, &m_vRing[ nOffset ], nLength );
+		else
+		{
+			memcpy( pOut, &m_vRing[ nOffset ], nFirst );
+			memcpy( pOut + nFirst, &m_vRing[ 0 ], nLength - nFirst );
+		}
+	}
+
+	bool FlightRecorderReader::ReadRecordHeader( LOGOG_UINT64 nPosition, size_t &nLength ) const
+	{
+		unsigned int vRecordHeader[ 2 ];
+
+		CopyFromRing( nPosition, (unsigned char *)vRecordHeader, FLIGHT_RECORD_HEADER_SIZE );
+
+		if (( vRecordHeader[ 0 ] != LOGOG_FLIGHT_RECORD_MARKER ) ||
+			( vRecordHeader[ 1 ] > m_vRing.size() - FLIGHT_RECORD_HEADER_SIZE ))
+			return false;
+
+		nLength = vRecordHeader[ 1 ];
+		return true;
+	}
+
+	LOGOG_UINT64 FlightRecorderReader::FindOldestRecord() const
+	{
+		LOGOG_UINT64 nStart = ( m_nCursor > m_vRing.size() ) ? m_nCursor - m_vRing.size() : 0;
+
+		/* Until the ring has wrapped, the first record is at the start. */
+		if ( nStart == 0 )
+			return 0;
+
+		for ( LOGOG_UINT64 nCandidate = nStart; nCandidate < m_nCursor; nCandidate += FLIGHT_RECORD_HEADER_SIZE )
+		{
+			LOGOG_UINT64 nPosition = nCandidate;
+			size_t nLength;
+
+			while (( nPosition < m_nCursor ) && ReadRecordHeader( nPosition, nLength ))
+				nPosition += FLIGHT_RECORD_HEADER_SIZE + AlignFlight( nLength );
+
+			if ( nPosition == m_nCursor )
+				return nCandidate;
+		}
+
+		return m_nCursor;
+	}
+
+	bool FlightRecorderReader::Next( const unsigned char *&pData, size_t &nLength )
+	{
+		if (( m_nPosition >= m_nCursor ) || !ReadRecordHeader( m_nPosition, nLength ))
+			return false;
+
+		m_vRecord.resize( nLength + 1 );
+		CopyFromRing( m_nPosition + FLIGHT_RECORD_HEADER_SIZE, &m_vRecord[ 0 ], nLength );
+		m_vRecord[ nLength ] = 0;
+
+		m_nPosition += FLIGHT_RECORD_HEADER_SIZE + AlignFlight( nLength );
+		pData = &m_vRecord[ 0 ];
+
+		return true;
+	}
+}
@@ -0,0 +1,505 @@
+/*
+ * \file format.cpp
+ */
+
+#include "logog.hpp"
+
+#include <cstring>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define LOGOG_FORMAT_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined( LOGOG_FORMAT_SSE2 ) && defined( _MSC_VER )
+#include <intrin.h>
+#endif
+
+namespace logog {
+
+	FormatWriter::FormatWriter( LOGOG_STRING &s ) :
+		m_String( s )
+	{
+		/* If s still points at a constant string, this gives it a buffer of its own to write into. */
+		m_String.grow( m_String.capacity() );
+	}
+
+	void FormatWriter::Reserve( size_t nCount )
+	{
+		size_t nNeeded = m_String.size() + nCount + 1;
+		size_t nNewSize = 2 * m_String.capacity();
+
+		if ( nNewSize < LOGOG_FORMAT_INITIAL_LENGTH )
+			nNewSize = LOGOG_FORMAT_INITIAL_LENGTH;
+
+		if ( nNewSize < nNeeded )
+			nNewSize = nNeeded;
+
+		m_String.grow( nNewSize );
+	}
+
+	void FormatWriter::Put( const LOGOG_CHAR *sChars )
+	{
+		Put( sChars, String::Length( sChars ));
+	}
+
+	void FormatWriter::PutRepeated( LOGOG_CHAR c, size_t nCount )
+	{
+		const size_t CHUNK = 32;
+		LOGOG_CHAR vChunk[ CHUNK ];
+
+		for ( size_t t = 0; t < CHUNK && t < nCount; t++ )
+			vChunk[ t ] = c;
+
+		while ( nCount > 0 )
+		{
+			size_t nThis = ( nCount < CHUNK ) ? nCount : CHUNK;
+			Put( vChunk, nThis );
+			nCount -= nThis;
+		}
+	}
+
+	void FormatWriter::PutNarrow( const char *pChars, size_t nCount )
+	{
+#ifdef LOGOG_UNICODE
+		const size_t CHUNK = 64;
+		LOGOG_CHAR vChunk[ CHUNK ];
+
+		while ( nCount > 0 )
+		{
+			size_t nThis = ( nCount < CHUNK ) ? nCount : CHUNK;
+
+			for ( size_t t = 0; t < nThis; t++ )
+				vChunk[ t ] = (LOGOG_CHAR)(unsigned char)*pChars++;
+
+			Put( vChunk, nThis );
+			nCount -= nThis;
+		}
+#else // LOGOG_UNICODE
+		Put( pChars, nCount );
+#endif // LOGOG_UNICODE
+	}
+
+	void FormatWriter::PutWide( const wchar_t *pChars, size_t nCount )
+	{
+#ifdef LOGOG_UNICODE
+		Put( pChars, nCount );
+#else // LOGOG_UNICODE
+		const size_t CHUNK = 64;
+		LOGOG_CHAR vChunk[ CHUNK ];
+
+		while ( nCount > 0 )
+		{
+			size_t nThis = ( nCount < CHUNK ) ? nCount : CHUNK;
+
+			for ( size_t t = 0; t < nThis; t++ )
+			{
+				wchar_t c = *pChars++;
+				vChunk[ t ] = ( c >= 0 && c < 0x80 ) ? (LOGOG_CHAR)c : '?';
+			}
+
+			Put( vChunk, nThis );
+			nCount -= nThis;
+		}
+#endif // LOGOG_UNICODE
+	}
+
+	void FormatWriter::Pad( size_t nLength, const FormatSpec &spec, bool bBefore )
+	{
+		if (( spec.m_nWidth < 0 ) || ( nLength >= (size_t)spec.m_nWidth ))
+			return;
+
+		bool bLeft = ( spec.m_nFlags & FORMAT_FLAG_LEFT ) != 0;
+
+		if ( bBefore != bLeft )
+			PutRepeated( ' ', spec.m_nWidth - nLength );
+	}
+
+	void FormatWriter::PutInteger( LOGOG_UINT64 nMagnitude, bool bNegative, const FormatSpec &spec )
+	{
+		unsigned int nBase = 10;
+		const char *sDigits = "0123456789abcdef";
+
+		switch ( spec.m_cConversion )
+		{
+		case 'o':
+			nBase = 8;
+			break;
+		case 'x':
+			nBase = 16;
+			break;
+		case 'X':
+			nBase = 16;
+			sDigits = "0123456789ABCDEF";
+			break;
+		default:
+			break;
+		}
+
+		/* Digits are generated least significant first. */
+		char vDigits[ 64 ];
+		size_t nDigits = 0;
+
+		for ( LOGOG_UINT64 n = nMagnitude; n != 0; n /= nBase )
+			vDigits[ nDigits++ ] = sDigits[ n % nBase ];
+
+		size_t nMinimumDigits = ( spec.m_nPrecision >= 0 ) ? (size_t)spec.m_nPrecision : 1;
+		size_t nZeros = ( nDigits < nMinimumDigits ) ? nMinimumDigits - nDigits : 0;
+
+		if (( spec.m_nFlags & FORMAT_FLAG_ALTERNATE ) && ( nBase == 8 ) && ( nZeros == 0 ) &&
+			( nDigits == 0 || vDigits[ nDigits - 1 ] != '0' ))
+			nZeros = 1;
+
+		char vPrefix[ 2 ];
+		size_t nPrefix = 0;
+
+		if ( spec.m_cConversion == 'd' || spec.m_cConversion == 'i' )
+		{
+			if ( bNegative )
+				vPrefix[ nPrefix++ ] = '-';
+			else if ( spec.m_nFlags & FORMAT_FLAG_PLUS )
+				vPrefix[ nPrefix++ ] = '+';
+			else if ( spec.m_nFlags & FORMAT_FLAG_SPACE )
+				vPrefix[ nPrefix++ ] = ' ';
+		}
+		else if (( spec.m_nFlags & FORMAT_FLAG_ALTERNATE ) && ( nBase == 16 ) && ( nMagnitude != 0 ))
+		{
+			vPrefix[ nPrefix++ ] = '0';
+			vPrefix[ nPrefix++ ] = (char)spec.m_cConversion;
+		}
+
+		size_t nLength = nPrefix + nZeros + nDigits;
+
+		if (( spec.m_nFlags & FORMAT_FLAG_ZERO ) && !( spec.m_nFlags & FORMAT_FLAG_LEFT ) &&
+			( spec.m_nPrecision < 0 ) && ( spec.m_nWidth > 0 ) && ( nLength < (size_t)spec.m_nWidth ))
+		{
+			nZeros += spec.m_nWidth - nLength;
+			nLength = spec.m_nWidth;
+		}
+
+		Pad( nLength, spec, true );
+		PutNarrow( vPrefix, nPrefix );
+		PutRepeated( '0', nZeros );
+
+		char vOut[ 64 ];
+		for ( size_t t = 0; t < nDigits; t++ )
+			vOut[ t ] = vDigits[ nDigits - 1 - t ];
+		PutNarrow( vOut, nDigits );
+
+		Pad( nLength, spec, false );
+	}
+
+	void FormatWriter::PutDecimal( LOGOG_UINT64 nValue )
+	{
+		char vDigits[ 24 ];
+		char *pDigit = vDigits + sizeof( vDigits );
+
+		do
+		{
+			*--pDigit = (char)( '0' + nValue % 10 );
+			nValue /= 10;
+		}
+		while ( nValue != 0 );
+
+		PutNarrow( pDigit, vDigits + sizeof( vDigits ) - pDigit );
+	}
+
+	/* Writes a small non-negative integer in decimal, and returns a pointer past it. */
+	static char *AppendDecimal( char *pOut, int nValue )
+	{
+		char vDigits[ 16 ];
+		int nDigits = 0;
+
+		do
+		{
+			vDigits[ nDigits++ ] = (char)( '0' + nValue % 10 );
+			nValue /= 10;
+		}
+		while ( nValue != 0 && nDigits < 16 );
+
+		while ( nDigits > 0 )
+			*pOut++ = vDigits[ --nDigits ];
+
+		return pOut;
+	}
+
+	void FormatWriter::PutSnprintf( const FormatSpec &spec, const char *sModifier, char cConversion, ... )
+	{
+		char vFormat[ 48 ];
+		char *pFormat = vFormat;
+
+		*pFormat++ = '%';
+		if ( spec.m_nFlags & FORMAT_FLAG_LEFT )
+			*pFormat++ = '-';
+		if ( spec.m_nFlags & FORMAT_FLAG_PLUS )
+			*pFormat++ = '+';
+		if ( spec.m_nFlags & FORMAT_FLAG_SPACE )
+			*pFormat++ = ' ';
+		if ( spec.m_nFlags & FORMAT_FLAG_ALTERNATE )
+			*pFormat++ = '#';
+		if ( spec.m_nFlags & FORMAT_FLAG_ZERO )
+			*pFormat++ = '0';
+		if ( spec.m_nWidth >= 0 )
+			pFormat = AppendDecimal( pFormat, spec.m_nWidth );
+		if ( spec.m_nPrecision >= 0 )
+		{
+			*pFormat++ = '.';
+			pFormat = AppendDecimal( pFormat, spec.m_nPrecision );
+		}
+		while ( *sModifier )
+			*pFormat++ = *sModifier++;
+		*pFormat++ = cConversion;
+		*pFormat = '\0';
+
+		char vBuffer[ 128 ];
+		va_list args;
+
+		va_start( args, cConversion );
+		int nLength = vsnprintf( vBuffer, sizeof( vBuffer ), vFormat, args );
+		va_end( args );
+
+		if ( nLength < 0 )
+			return;
+
+		if ( (size_t)nLength < sizeof( vBuffer ))
+		{
+			PutNarrow( vBuffer, nLength );
+			return;
+		}
+
+		/* Rare: very wide fields, or huge values printed with %f. */
+		char *pBuffer = (char *)Object::Allocate( nLength + 1 );
+
+		va_start( args, cConversion );
+		vsnprintf( pBuffer, nLength + 1, vFormat, args );
+		va_end( args );
+
+		PutNarrow( pBuffer, nLength );
+		Object::Deallocate( pBuffer );
+	}
+
+	void FormatWriter::PutFloat( double dValue, const FormatSpec &spec )
+	{
+		PutSnprintf( spec, "", (char)spec.m_cConversion, dValue );
+	}
+
+	void FormatWriter::PutFloat( long double dValue, const FormatSpec &spec )
+	{
+		PutSnprintf( spec, "L", (char)spec.m_cConversion, dValue );
+	}
+
+	void FormatWriter::PutPointer( const void *pValue, const FormatSpec &spec )
+	{
+		PutSnprintf( spec, "", 'p', pValue );
+	}
+
+	void FormatWriter::PutCharacter( LOGOG_CHAR c, const FormatSpec &spec )
+	{
+		Pad( 1, spec, true );
+		Put( c );
+		Pad( 1, spec, false );
+	}
+
+	void FormatWriter::PutString( const char *pString, const FormatSpec &spec )
+	{
+		if ( pString == NULL )
+			pString = "(null)";
+
+		size_t nLength = 0;
+		while ( pString[ nLength ] != '\0' && ( spec.m_nPrecision < 0 || nLength < (size_t)spec.m_nPrecision ))
+			nLength++;
+
+		Pad( nLength, spec, true );
+		PutNarrow( pString, nLength );
+		Pad( nLength, spec, false );
+	}
+
+	void FormatWriter::PutString( const wchar_t *pString, const FormatSpec &spec )
+	{
+		if ( pString == NULL )
+			pString = L"(null)";
+
+		size_t nLength = 0;
+		while ( pString[ nLength ] != L'\0' && ( spec.m_nPrecision < 0 || nLength < (size_t)spec.m_nPrecision ))
+			nLength++;
+
+		Pad( nLength, spec, true );
+		PutWide( pString, nLength );
+		Pad( nLength, spec, false );
+	}
+
+	void FormatWriter::PutString( const LOGOG_STRING &s, const FormatSpec &spec )
+	{
+		const LOGOG_CHAR *pString = s.c_str();
+
+		if ( pString == NULL )
+		{
+			PutString( (const char *)NULL, spec );
+			return;
+		}
+
+		/* Strings assigned from constants count their trailing null in size(), so stop at the first null. */
+		size_t nSize = s.size();
+		size_t nLength = 0;
+		while ( nLength < nSize && pString[ nLength ] != (LOGOG_CHAR)'\0' &&
+			( spec.m_nPrecision < 0 || nLength < (size_t)spec.m_nPrecision ))
+			nLength++;
+
+		Pad( nLength, spec, true );
+		Put( pString, nLength );
+		Pad( nLength, spec, false );
+	}
+
+	/* Returns true if c must be escaped in a JSON string; with bLogfmt, also if c forces a logfmt value to be
+	 * quoted. */
+	static inline bool FormatIsSpecial( LOGOG_CHAR c, bool bLogfmt )
+	{
+#ifdef LOGOG_UNICODE
+		/* wchar_t is signed on some platforms. */
+		if ( (unsigned long)c < 0x20 )
+			return true;
+#else // LOGOG_UNICODE
+		if ( (unsigned char)c < 0x20 )
+			return true;
+#endif // LOGOG_UNICODE
+		return ( c == '"' || c == '\\' || ( bLogfmt && ( c == ' ' || c == '=' )));
+	}
+
+	/* Returns the offset of the first character in pChars that FormatIsSpecial() matches, or nCount if there
+	 * is none.  Narrow strings are scanned sixteen bytes at a time with SSE2, or eight at a time in a general
+	 * purpose register where SSE2 is not available. */
+	static size_t FormatFindSpecial( const LOGOG_CHAR *pChars, size_t nCount, bool bLogfmt )
+	{
+		size_t nOffset = 0;
+
+#ifndef LOGOG_UNICODE
+		/* For plain JSON, the extra characters repeat the quote and backslash, which costs nothing. */
+		const char cExtra1 = bLogfmt ? ' ' : '"';
+		const char cExtra2 = bLogfmt ? '=' : '\\';
+
+#ifdef LOGOG_FORMAT_SSE2
+		const __m128i vQuote = _mm_set1_epi8( '"' );
+		const __m128i vBackslash = _mm_set1_epi8( '\\' );
+		const __m128i vExtra1 = _mm_set1_epi8( cExtra1 );
+		const __m128i vExtra2 = _mm_set1_epi8( cExtra2 );
+		const __m128i vControl = _mm_set1_epi8( 0x1f );
+
+		while ( nOffset + 16 <= nCount )
+		{
+			__m128i vChars = _mm_loadu_si128( (const __m128i *)( pChars + nOffset ));
+			__m128i vMatch = _mm_or_si128(
+				_mm_or_si128( _mm_cmpeq_epi8( vChars, vQuote ), _mm_cmpeq_epi8( vChars, vBackslash )),
+				_mm_or_si128( _mm_cmpeq_epi8( vChars, vExtra1 ), _mm_cmpeq_epi8( vChars, vExtra2 )));
+			/* An unsigned byte is a control character if min( byte, 0x1f ) == byte. */
+			vMatch = _mm_or_si128( vMatch, _mm_cmpeq_epi8( _mm_min_epu8( vChars, vControl ), vChars ));
+
+			unsigned int nMask = (unsigned int)_mm_movemask_epi8( vMatch );
+			if ( nMask != 0 )
+			{
+#ifdef _MSC_VER
+				unsigned long nBit;
+				_BitScanForward( &nBit, nMask );
+				return nOffset + nBit;
+#else // _MSC_VER
+				return nOffset + __builtin_ctz( nMask );
+#endif // _MSC_VER
+			}
+
+			nOffset += 16;
+		}
+#else // LOGOG_FORMAT_SSE2
+		const LOGOG_UINT64 nOnes = 0x0101010101010101ULL;
+		const LOGOG_UINT64 nHighs = 0x8080808080808080ULL;
+
+		while ( nOffset + 8 <= nCount )
+		{
+			LOGOG_UINT64 nWord;
+			memcpy( &nWord, pChars + nOffset, sizeof( nWord ));
+
+			/* Each term is nonzero if some byte of the word is zero, that is, equal to the character XORed
+			 * away; the last is nonzero if some byte is below 0x20.  None of the terms reports a false match in
+			 * a word with no true one, so the scalar loop below finds the exact position. */
+			LOGOG_UINT64 nQuote = nWord ^ ( nOnes * '"' );
+			LOGOG_UINT64 nBackslash = nWord ^ ( nOnes * '\\' );
+			LOGOG_UINT64 nExtra1 = nWord ^ ( nOnes * (unsigned char)cExtra1 );
+			LOGOG_UINT64 nExtra2 = nWord ^ ( nOnes * (unsigned char)cExtra2 );
+			LOGOG_UINT64 nMatch =
+				(( nQuote - nOnes ) & ~nQuote ) |
+				(( nBackslash - nOnes ) & ~nBackslash ) |
+				(( nExtra1 - nOnes ) & ~nExtra1 ) |
+				(( nExtra2 - nOnes ) & ~nExtra2 ) |
+				(( nWord - nOnes * 0x20 ) & ~nWord );
+
+			if (( nMatch & nHighs ) != 0 )
+				break;
+
+			nOffset += 8;
+		}
+#endif // LOGOG_FORMAT_SSE2
+#endif // LOGOG_UNICODE
+
+		while ( nOffset < nCount && !FormatIsSpecial( pChars[ nOffset ], bLogfmt ))
+			nOffset++;
+
+		return nOffset;
+	}
+
+	void FormatWriter::PutEscaped( const LOGOG_CHAR *pChars, size_t nCount )
+	{
+		static const char *sHexDigits = "0123456789abcdef";
+
+		while ( nCount > 0 )
+		{
+			/* Copy the run of characters that need no escaping in one go. */
+			size_t nClean = FormatFindSpecial( pChars, nCount, false );
+			Put( pChars, nClean );
+			pChars += nClean;
+			nCount -= nClean;
+
+			if ( nCount == 0 )
+				break;
+
+			LOGOG_CHAR c = *pChars++;
+			nCount--;
+
+			char vEscape[ 6 ] = { '\\', 0, 0, 0, 0, 0 };
+			size_t nEscape = 2;
+
+			switch ( c )
+			{
+			case '"':	vEscape[ 1 ] = '"'; break;
+			case '\\':	vEscape[ 1 ] = '\\'; break;
+			case '\n':	vEscape[ 1 ] = 'n'; break;
+			case '\r':	vEscape[ 1 ] = 'r'; break;
+			case '\t':	vEscape[ 1 ] = 't'; break;
+			case '\b':	vEscape[ 1 ] = 'b'; break;
+			case '\f':	vEscape[ 1 ] = 'f'; break;
+			default:
+				vEscape[ 1 ] = 'u';
+				vEscape[ 2 ] = '0';
+				vEscape[ 3 ] = '0';
+				vEscape[ 4 ] = sHexDigits[ ( c >> 4 ) & 0xf ];
+				vEscape[ 5 ] = sHexDigits[ c & 0xf ];
+				nEscape = 6;
+				break;
+			}
+
+			PutNarrow( vEscape, nEscape );
+		}
+	}
+
+	void FormatWriter::PutJSONString( const LOGOG_CHAR *pChars, size_t nCount )
+	{
+		Put( (LOGOG_CHAR)'"' );
+		PutEscaped( pChars, nCount );
+		Put( (LOGOG_CHAR)'"' );
+	}
+
+	void FormatWriter::PutLogfmtValue( const LOGOG_CHAR *pChars, size_t nCount )
+	{
+		if (( nCount > 0 ) && ( FormatFindSpecial( pChars, nCount, true ) == nCount ))
+			Put( pChars, nCount );
+		else
+			PutJSONString( pChars, nCount );
+	}
+}
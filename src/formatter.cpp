@@ -5,8 +5,53 @@
 
 #include "logog.hpp"
 
+#ifdef LOGOG_FLAVOR_POSIX
+#include <cerrno>
+#include <unistd.h>
+#endif // LOGOG_FLAVOR_POSIX
+
 namespace logog {
 
+	/* Gets the characters of a topic field.  Fields assigned from constants count their trailing null in
+	 * size(), so this stops at the first null. */
+	static const LOGOG_CHAR *FieldChars( const LOGOG_STRING &s, size_t &nLength )
+	{
+		static const LOGOG_CHAR cEmpty = (LOGOG_CHAR)NULL;
+		const LOGOG_CHAR *pChars = s.c_str();
+
+		nLength = 0;
+
+		if ( pChars == NULL )
+			return &cEmpty;
+
+		size_t nSize = s.size();
+		while (( nLength < nSize ) && ( pChars[ nLength ] != (LOGOG_CHAR)NULL ))
+			nLength++;
+
+		return pChars;
+	}
+
+	/* Appends a line number, which might be negative. */
+	static void PutLineNumber( FormatWriter &writer, int nLineNumber )
+	{
+		if ( nLineNumber < 0 )
+		{
+			writer.Put( (LOGOG_CHAR)'-' );
+			writer.PutDecimal( (LOGOG_UINT64)0 - (LOGOG_UINT64)(LOGOG_INT64)nLineNumber );
+		}
+		else
+			writer.PutDecimal( (LOGOG_UINT64)nLineNumber );
+	}
+
+	/* Appends a topic field. */
+	static void PutField( FormatWriter &writer, const LOGOG_STRING &s )
+	{
+		size_t nLength;
+		const LOGOG_CHAR *pChars = FieldChars( s, nLength );
+
+		writer.Put( pChars, nLength );
+	}
+
 	Formatter::Formatter() :
 		m_bShowTimeOfDay( false )
 	{
@@ -39,6 +84,62 @@ namespace logog {
 		}
 	}
 
+	void Formatter::PutTimeOfDay( FormatWriter &writer, const LOGOG_STRING &sOutput )
+	{
+		if ( !m_bShowTimeOfDay )
+			return;
+
+		/* Format() already holds the lock on m_sMessageBuffer, and is rendering into it. */
+		if ( &sOutput == &m_sMessageBuffer )
+		{
+			RenderTimeOfDay();
+			return;
+		}
+
+		ScopedLock sl( m_MutexFormat );
+
+		m_sMessageBuffer.clear();
+		RenderTimeOfDay();
+		writer.Put( m_sMessageBuffer.c_str(), m_sMessageBuffer.size() );
+	}
+
+	void Formatter::FormatTo( LOGOG_STRING &sOutput, const Topic &topic, const Target &target )
+	{
+		sOutput.clear();
+
+		if ( IsReentrant() )
+		{
+			Render( sOutput, topic, target );
+			return;
+		}
+
+		ScopedLock sl( m_MutexFormat );
+
+		const LOGOG_STRING &sFormatted = Format( topic, target );
+
+		/* The output may hold nulls, such as a binary record's, so copy its length rather than up to a null. */
+		size_t nLength = sFormatted.size();
+		sOutput.grow( nLength + 1 );
+		sOutput.append( sFormatted.c_str(), nLength );
+	}
+
+	LOGOG_STRING &Formatter::Format( const Topic &topic, const Target &target )
+	{
+		m_sMessageBuffer.clear();
+		Render( m_sMessageBuffer, topic, target );
+
+		return m_sMessageBuffer;
+	}
+
+	bool Formatter::IsReentrant() const
+	{
+		return false;
+	}
+
+	void Formatter::Render( LOGOG_STRING &, const Topic &, const Target & )
+	{
+	}
+
 	const LOGOG_CHAR * Formatter::ErrorDescription( const LOGOG_LEVEL_TYPE level )
 	{
 		if ( level <= LOGOG_LEVEL_NONE )
@@ -102,126 +203,805 @@ namespace logog {
 	}
 #endif
 
+	void Formatter::PutFields( FormatWriter &writer, const Topic &topic, bool bJSON )
+	{
+		const FieldSet *pFields = topic.Fields();
+
+		if ( pFields == NULL )
+			return;
+
+		for ( size_t t = 0; t < pFields->Count(); t++ )
+		{
+			const Field &field = pFields->Get( t );
+
+			if ( bJSON )
+			{
+				writer.Put( (LOGOG_CHAR)',' );
+				writer.PutJSONString( field.m_sKey, String::Length( field.m_sKey ));
+				writer.Put( (LOGOG_CHAR)':' );
+			}
+			else
+			{
+				writer.Put( (LOGOG_CHAR)' ' );
+				writer.Put( field.m_sKey );
+				writer.Put( (LOGOG_CHAR)'=' );
+			}
+
+			switch ( field.m_Type )
+			{
+			case FIELD_INTEGER:
+				if ( field.m_nInteger < 0 )
+				{
+					writer.Put( (LOGOG_CHAR)'-' );
+					writer.PutDecimal( (LOGOG_UINT64)0 - (LOGOG_UINT64)field.m_nInteger );
+				}
+				else
+					writer.PutDecimal( (LOGOG_UINT64)field.m_nInteger );
+				break;
+
+			case FIELD_UNSIGNED:
+				writer.PutDecimal( field.m_nUnsigned );
+				break;
+
+			case FIELD_FLOAT:
+				/* JSON has no representation for infinities or NaNs.  x - x is 0 for every finite x. */
+				if ( bJSON && ( field.m_dFloat - field.m_dFloat != 0.0 ))
+					writer.Put( LOGOG_CONST_STRING("null") );
+				else
+				{
+					FormatSpec spec = { 0, 0, 0, 0, -1, 15, 'g' };
+					writer.PutFloat( field.m_dFloat, spec );
+				}
+				break;
+
+			case FIELD_BOOLEAN:
+				writer.Put( field.m_bBoolean ? LOGOG_CONST_STRING("true") : LOGOG_CONST_STRING("false") );
+				break;
+
+			case FIELD_STRING:
+				if ( bJSON )
+					writer.PutJSONString( field.m_String.m_pChars, field.m_String.m_nLength );
+				else
+					writer.PutLogfmtValue( field.m_String.m_pChars, field.m_String.m_nLength );
+				break;
+			}
+		}
+	}
+
 	TOPIC_FLAGS Formatter::GetTopicFlags( const Topic &topic )
 	{
 		return topic.GetTopicFlags();
 	}
 
-	LOGOG_STRING &FormatterGCC::Format( const Topic &topic, const Target &target )
+	FormattedMessage::FormattedMessage() :
+		m_pFormatter( NULL ),
+		m_bNullTerminated( false ),
+		m_nReferences( 1 )
+	{
+	}
+
+	FormattedMessage::~FormattedMessage()
+	{
+	}
+
+	void FormattedMessage::Format( Formatter &formatter, const Topic &topic, const Target &target )
+	{
+		m_pFormatter = &formatter;
+		m_bNullTerminated = target.GetNullTerminatesStrings();
+
+		formatter.FormatTo( m_sOutput, topic, target );
+	}
+
+	void FormattedMessage::AddReference()
+	{
+		LOGOG_ATOMIC_ADD( &m_nReferences, 1 );
+	}
+
+	void FormattedMessage::Release()
+	{
+		if ( LOGOG_ATOMIC_ADD_ACQ_REL( &m_nReferences, (LOGOG_UINT64)-1 ) == 1 )
+			delete this;
+	}
+
+	bool FormattedMessage::IsShared() const
+	{
+		return LOGOG_ATOMIC_LOAD_ACQUIRE( &m_nReferences ) > 1;
+	}
+
+	void FormatterGCC::Render( LOGOG_STRING &sOutput, const Topic &topic, const Target &target )
 	{
 		TOPIC_FLAGS flags;
 		flags = GetTopicFlags( topic );
 
-		m_sMessageBuffer.clear();
+		FormatWriter writer( sOutput );
 
 		if ( flags & TOPIC_FILE_NAME_FLAG )
 		{
-			m_sMessageBuffer.append( topic.FileName() );
-			m_sMessageBuffer.append( ':' );
+			PutField( writer, topic.FileName() );
+			writer.Put( (LOGOG_CHAR)':' );
 		}
 
 		if ( flags & TOPIC_LINE_NUMBER_FLAG )
 		{
-			m_sIntBuffer.assign( topic.LineNumber() );
-			m_sMessageBuffer.append( m_sIntBuffer );
-
-			m_sMessageBuffer.append( LOGOG_CONST_STRING(": "));
+			PutLineNumber( writer, topic.LineNumber() );
+			writer.Put( LOGOG_CONST_STRING(": "));
 		}
 
-		RenderTimeOfDay();
+		PutTimeOfDay( writer, sOutput );
 
 		if ( flags & TOPIC_LEVEL_FLAG )
 		{
-			m_sMessageBuffer.append( ErrorDescription( topic.Level()));
-			m_sMessageBuffer.append( LOGOG_CONST_STRING(": "));
+			writer.Put( ErrorDescription( topic.Level()));
+			writer.Put( LOGOG_CONST_STRING(": "));
 		}
 
 		if ( flags & TOPIC_GROUP_FLAG )
 		{
-			m_sMessageBuffer.append( LOGOG_CONST_STRING("{") );
-			m_sMessageBuffer.append( topic.Group() );
-			m_sMessageBuffer.append( LOGOG_CONST_STRING("} ") );
+			writer.Put( LOGOG_CONST_STRING("{") );
+			PutField( writer, topic.Group() );
+			writer.Put( LOGOG_CONST_STRING("} ") );
 		}
 
 		if ( flags & TOPIC_CATEGORY_FLAG )
 		{
-			m_sMessageBuffer.append( LOGOG_CONST_STRING("["));
-			m_sMessageBuffer.append( topic.Category() );
-			m_sMessageBuffer.append( LOGOG_CONST_STRING("] "));
+			writer.Put( LOGOG_CONST_STRING("["));
+			PutField( writer, topic.Category() );
+			writer.Put( LOGOG_CONST_STRING("] "));
 		}
 
 		if ( flags & TOPIC_MESSAGE_FLAG )
 		{
-			m_sMessageBuffer.append( topic.Message() );
-			m_sMessageBuffer.append( (LOGOG_CHAR)'\n' );
+			PutField( writer, topic.Message() );
+			PutFields( writer, topic, false );
+			writer.Put( (LOGOG_CHAR)'\n' );
 		}
 
 		if ( target.GetNullTerminatesStrings() )
-			m_sMessageBuffer.append( (LOGOG_CHAR)NULL );
-
-		return m_sMessageBuffer;
+			writer.Put( (LOGOG_CHAR)NULL );
 	}
 
-
-	LOGOG_STRING &FormatterMSVC::Format( const Topic &topic, const Target &target )
+	void FormatterMSVC::Render( LOGOG_STRING &sOutput, const Topic &topic, const Target &target )
     {
-        m_sMessageBuffer.clear();
-
         TOPIC_FLAGS flags;
         flags = GetTopicFlags( topic );
 
+        FormatWriter writer( sOutput );
+
         if ( flags & TOPIC_FILE_NAME_FLAG )
         {
-            m_sMessageBuffer.append( topic.FileName() );
-            m_sMessageBuffer.append( '(' );
+            PutField( writer, topic.FileName() );
+            writer.Put( (LOGOG_CHAR)'(' );
         }
 
         if ( flags & TOPIC_LINE_NUMBER_FLAG  )
         {
-            m_sIntBuffer.assign( topic.LineNumber() );
-            m_sMessageBuffer.append( m_sIntBuffer );
-
-            m_sMessageBuffer.append( LOGOG_CONST_STRING(") : ") );
+            PutLineNumber( writer, topic.LineNumber() );
+            writer.Put( LOGOG_CONST_STRING(") : ") );
         }
 
-		RenderTimeOfDay();
+		PutTimeOfDay( writer, sOutput );
 
         if ( flags & TOPIC_LEVEL_FLAG )
         {
-            m_sMessageBuffer.append( ErrorDescription( topic.Level() ) );
-            m_sMessageBuffer.append( LOGOG_CONST_STRING(": "));
+            writer.Put( ErrorDescription( topic.Level() ) );
+            writer.Put( LOGOG_CONST_STRING(": "));
         }
 
         if ( flags & TOPIC_GROUP_FLAG )
         {
-            m_sMessageBuffer.append( LOGOG_CONST_STRING("{"));
-            m_sMessageBuffer.append( topic.Group() );
-            m_sMessageBuffer.append( LOGOG_CONST_STRING("} "));
+            writer.Put( LOGOG_CONST_STRING("{"));
+            PutField( writer, topic.Group() );
+            writer.Put( LOGOG_CONST_STRING("} "));
         }
 
         if ( flags & TOPIC_CATEGORY_FLAG )
         {
-            m_sMessageBuffer.append( LOGOG_CONST_STRING("["));
-            m_sMessageBuffer.append( topic.Category() );
-            m_sMessageBuffer.append( LOGOG_CONST_STRING("] "));
+            writer.Put( LOGOG_CONST_STRING("["));
+            PutField( writer, topic.Category() );
+            writer.Put( LOGOG_CONST_STRING("] "));
         }
 
         if ( flags & TOPIC_MESSAGE_FLAG )
         {
-            m_sMessageBuffer.append( topic.Message() );
+            PutField( writer, topic.Message() );
+            PutFields( writer, topic, false );
+
 #ifdef LOGOG_FLAVOR_WINDOWS
-			m_sMessageBuffer.append( LOGOG_CONST_STRING("\r\n") );
+			writer.Put( LOGOG_CONST_STRING("\r\n") );
 #else // LOGOG_FLAVOR_WINDOWS
-            m_sMessageBuffer.append( LOGOG_CONST_STRING("\n") );
+            writer.Put( LOGOG_CONST_STRING("\n") );
 #endif // LOGOG_FLAVOR_WINDOWS
         }
 
 		if ( target.GetNullTerminatesStrings() )
-			m_sMessageBuffer.append( LOGOG_CHAR( NULL ) );
-
-        return m_sMessageBuffer;
+			writer.Put( LOGOG_CHAR( NULL ) );
     }
 
+	PatternFormatter::PatternFormatter( const LOGOG_CHAR *sPattern )
+	{
+		SetPattern( sPattern );
+	}
+
+	void PatternFormatter::AddOp( PatternOpType type, const LOGOG_CHAR *pLiteral, size_t nLength )
+	{
+		if ( type == PATTERN_LITERAL )
+		{
+			if ( m_sLiterals.size() + nLength >= m_sLiterals.capacity() )
+				m_sLiterals.grow( 2 * ( m_sLiterals.size() + nLength + 1 ));
+
+			size_t nOffset = m_sLiterals.size();
+			m_sLiterals.append( pLiteral, nLength );
+
+			if ( !m_vOps.empty() && m_vOps.back().m_Type == PATTERN_LITERAL )
+			{
+				m_vOps.back().m_nLength += nLength;
+				return;
+			}
+
+			PatternOp op = { PATTERN_LITERAL, nOffset, nLength };
+			m_vOps.push_back( op );
+			return;
+		}
+
+		PatternOp op = { type, 0, 0 };
+		m_vOps.push_back( op );
+	}
+
+	void PatternFormatter::SetPattern( const LOGOG_CHAR *sPattern )
+	{
+		m_vOps.clear();
+		m_sLiterals.clear();
+		m_sLiterals.grow( String::Length( sPattern ) + 1 );
+
+		const LOGOG_CHAR *pCurrent = sPattern;
+
+		while ( *pCurrent != (LOGOG_CHAR)NULL )
+		{
+			const LOGOG_CHAR *pLiteral = pCurrent;
+			while (( *pCurrent != (LOGOG_CHAR)NULL ) && ( *pCurrent != '%' ))
+				pCurrent++;
+
+			if ( pCurrent > pLiteral )
+				AddOp( PATTERN_LITERAL, pLiteral, pCurrent - pLiteral );
+
+			if ( *pCurrent == (LOGOG_CHAR)NULL )
+				break;
+
+			/* Skip the '%' and look at the field. */
+			switch ( *++pCurrent )
+			{
+			case 'f':
+				AddOp( PATTERN_FILE_NAME );
+				break;
+			case 'n':
+				AddOp( PATTERN_LINE_NUMBER );
+				break;
+			case 'L':
+				AddOp( PATTERN_LEVEL );
+				break;
+			case 'g':
+				AddOp( PATTERN_GROUP );
+				break;
+			case 'c':
+				AddOp( PATTERN_CATEGORY );
+				break;
+			case 'm':
+				AddOp( PATTERN_MESSAGE );
+				break;
+			case 'F':
+				AddOp( PATTERN_FIELDS );
+				break;
+			case 'T':
+				AddOp( PATTERN_TIME_OF_DAY );
+				break;
+			case '%':
+				AddOp( PATTERN_LITERAL, pCurrent, 1 );
+				break;
+			case (LOGOG_CHAR)NULL:
+				/* A trailing '%' is copied as is. */
+				AddOp( PATTERN_LITERAL, pCurrent - 1, 1 );
+				continue;
+			default:
+				AddOp( PATTERN_LITERAL, pCurrent - 1, 2 );
+				break;
+			}
+
+			pCurrent++;
+		}
+	}
+
+	/* The time of day that a thread last rendered for a PatternFormatter.  Plain old data, so that it can be kept
+	 * for each thread. */
+	struct TimeOfDayCache
+	{
+		const Formatter *m_pFormatter;
+		LOGOG_UINT64 m_nSecond;
+		size_t m_nLength;
+		LOGOG_CHAR m_vTimeOfDay[ LOGOG_TIME_STRING_MAX ];
+	};
+
+#ifdef LOGOG_THREAD_LOCAL
+	static LOGOG_THREAD_LOCAL TimeOfDayCache s_TimeOfDay;
+#endif // LOGOG_THREAD_LOCAL
+
+	void PatternFormatter::AppendTimeOfDay( FormatWriter &writer )
+	{
+		time_t tNow = time( NULL );
+
+#ifdef LOGOG_THREAD_LOCAL
+		TimeOfDayCache &cache = s_TimeOfDay;
+#else // LOGOG_THREAD_LOCAL
+		TimeOfDayCache cache = { NULL, 0, 0 };
+#endif // LOGOG_THREAD_LOCAL
+
+		if (( cache.m_pFormatter != this ) || ( (LOGOG_UINT64)tNow != cache.m_nSecond ))
+		{
+			TimeStamp stamp;
+#ifdef LOGOG_UNICODE
+			const char *pTime = stamp.Get();
+#else // LOGOG_UNICODE
+			const char *pTime = stamp.Get( m_TimeOfDayFormat );
+#endif // LOGOG_UNICODE
+
+			/* Time stamps are always ASCII, so this widens them if need be. */
+			cache.m_nLength = 0;
+			while (( pTime[ cache.m_nLength ] != '\0' ) && ( cache.m_nLength < LOGOG_TIME_STRING_MAX - 1 ))
+			{
+				cache.m_vTimeOfDay[ cache.m_nLength ] = (LOGOG_CHAR)(unsigned char)pTime[ cache.m_nLength ];
+				cache.m_nLength++;
+			}
+
+			cache.m_pFormatter = this;
+			cache.m_nSecond = (LOGOG_UINT64)tNow;
+		}
+
+		writer.Put( cache.m_vTimeOfDay, cache.m_nLength );
+	}
+
+	bool PatternFormatter::IsReentrant() const
+	{
+		return true;
+	}
+
+	void PatternFormatter::Render( LOGOG_STRING &sOutput, const Topic &topic, const Target &target )
+	{
+		const LOGOG_CHAR *pLiterals = m_sLiterals.c_str();
+		FormatWriter writer( sOutput );
+
+		for ( PatternOpsType::const_iterator it = m_vOps.begin(); it != m_vOps.end(); ++it )
+		{
+			switch ( it->m_Type )
+			{
+			case PATTERN_LITERAL:
+				writer.Put( pLiterals + it->m_nOffset, it->m_nLength );
+				break;
+			case PATTERN_FILE_NAME:
+				PutField( writer, topic.FileName() );
+				break;
+			case PATTERN_LINE_NUMBER:
+				PutLineNumber( writer, topic.LineNumber() );
+				break;
+			case PATTERN_LEVEL:
+				writer.Put( ErrorDescription( topic.Level() ));
+				break;
+			case PATTERN_GROUP:
+				PutField( writer, topic.Group() );
+				break;
+			case PATTERN_CATEGORY:
+				PutField( writer, topic.Category() );
+				break;
+			case PATTERN_MESSAGE:
+				PutField( writer, topic.Message() );
+				break;
+			case PATTERN_FIELDS:
+				PutFields( writer, topic, false );
+				break;
+			case PATTERN_TIME_OF_DAY:
+				AppendTimeOfDay( writer );
+				break;
+			}
+		}
+
+#ifdef LOGOG_FLAVOR_WINDOWS
+		writer.Put( LOGOG_CONST_STRING("\r\n") );
+#else // LOGOG_FLAVOR_WINDOWS
+		writer.Put( (LOGOG_CHAR)'\n' );
+#endif // LOGOG_FLAVOR_WINDOWS
+
+		if ( target.GetNullTerminatesStrings() )
+			writer.Put( (LOGOG_CHAR)NULL );
+	}
+
+	/* Writes nValue as nDigits decimal digits, with leading zeros. */
+	static LOGOG_CHAR *PutZeroPadded( LOGOG_CHAR *pOut, unsigned int nValue, int nDigits )
+	{
+		for ( int t = nDigits - 1; t >= 0; t-- )
+		{
+			pOut[ t ] = (LOGOG_CHAR)( '0' + nValue % 10 );
+			nValue /= 10;
+		}
+
+		return pOut + nDigits;
+	}
+
+	/* The date and time of day that a thread last rendered for a StructuredFormatter, without the fraction of a
+	 * second: YYYY-MM-DDTHH:MM:SS */
+	struct DateTimeCache
+	{
+		LOGOG_UINT64 m_nSecond;
+		LOGOG_CHAR m_vDateTime[ 20 ];
+	};
+
+#ifdef LOGOG_THREAD_LOCAL
+	static LOGOG_THREAD_LOCAL DateTimeCache s_DateTime;
+#endif // LOGOG_THREAD_LOCAL
+
+	bool StructuredFormatter::IsReentrant() const
+	{
+		return true;
+	}
+
+	void StructuredFormatter::PutTimestamp( FormatWriter &writer )
+	{
+		LOGOG_UINT64 nNow = GetRealtimeNanoseconds();
+		LOGOG_UINT64 nSecond = nNow / 1000000000ULL;
+
+#ifdef LOGOG_THREAD_LOCAL
+		DateTimeCache &cache = s_DateTime;
+#else // LOGOG_THREAD_LOCAL
+		DateTimeCache cache;
+		cache.m_vDateTime[ 0 ] = (LOGOG_CHAR)NULL;
+#endif // LOGOG_THREAD_LOCAL
+
+		if (( cache.m_vDateTime[ 0 ] == (LOGOG_CHAR)NULL ) || ( nSecond != cache.m_nSecond ))
+		{
+			time_t tNow = (time_t)nSecond;
+			struct tm tmNow;
+
+#ifdef LOGOG_FLAVOR_WINDOWS
+			gmtime_s( &tmNow, &tNow );
+#else // LOGOG_FLAVOR_WINDOWS
+			gmtime_r( &tNow, &tmNow );
+#endif // LOGOG_FLAVOR_WINDOWS
+
+			LOGOG_CHAR *pOut = cache.m_vDateTime;
+			pOut = PutZeroPadded( pOut, tmNow.tm_year + 1900, 4 );
+			*pOut++ = '-';
+			pOut = PutZeroPadded( pOut, tmNow.tm_mon + 1, 2 );
+			*pOut++ = '-';
+			pOut = PutZeroPadded( pOut, tmNow.tm_mday, 2 );
+			*pOut++ = 'T';
+			pOut = PutZeroPadded( pOut, tmNow.tm_hour, 2 );
+			*pOut++ = ':';
+			pOut = PutZeroPadded( pOut, tmNow.tm_min, 2 );
+			*pOut++ = ':';
+			pOut = PutZeroPadded( pOut, tmNow.tm_sec, 2 );
+			*pOut = (LOGOG_CHAR)NULL;
+
+			cache.m_nSecond = nSecond;
+		}
+
+		LOGOG_CHAR vFraction[ 8 ];
+		vFraction[ 0 ] = '.';
+		PutZeroPadded( vFraction + 1, (unsigned int)(( nNow % 1000000000ULL ) / 1000 ), 6 );
+		vFraction[ 7 ] = 'Z';
+
+		writer.Put( cache.m_vDateTime, 19 );
+		writer.Put( vFraction, 8 );
+	}
+
+	void StructuredFormatter::PutEnd( FormatWriter &writer, const Target &target )
+	{
+		writer.Put( (LOGOG_CHAR)'\n' );
+
+		if ( target.GetNullTerminatesStrings() )
+			writer.Put( (LOGOG_CHAR)NULL );
+	}
+
+	void FormatterJSON::Render( LOGOG_STRING &sOutput, const Topic &topic, const Target &target )
+	{
+		TOPIC_FLAGS flags = GetTopicFlags( topic );
+		const LOGOG_CHAR *pField;
+		size_t nField;
+
+		FormatWriter writer( sOutput );
+
+		writer.Put( LOGOG_CONST_STRING("{\"timestamp\":\"") );
+		PutTimestamp( writer );
+		writer.Put( (LOGOG_CHAR)'"' );
+
+		if ( flags & TOPIC_LEVEL_FLAG )
+		{
+			writer.Put( LOGOG_CONST_STRING(",\"level\":\"") );
+			writer.Put( ErrorDescription( topic.Level() ));
+			writer.Put( (LOGOG_CHAR)'"' );
+		}
+
+		if ( flags & TOPIC_FILE_NAME_FLAG )
+		{
+			writer.Put( LOGOG_CONST_STRING(",\"file\":") );
+			pField = FieldChars( topic.FileName(), nField );
+			writer.PutJSONString( pField, nField );
+		}
+
+		if ( flags & TOPIC_LINE_NUMBER_FLAG )
+		{
+			writer.Put( LOGOG_CONST_STRING(",\"line\":") );
+			PutLineNumber( writer, topic.LineNumber() );
+		}
+
+		if ( flags & TOPIC_GROUP_FLAG )
+		{
+			writer.Put( LOGOG_CONST_STRING(",\"group\":") );
+			pField = FieldChars( topic.Group(), nField );
+			writer.PutJSONString( pField, nField );
+		}
+
+		if ( flags & TOPIC_CATEGORY_FLAG )
+		{
+			writer.Put( LOGOG_CONST_STRING(",\"category\":") );
+			pField = FieldChars( topic.Category(), nField );
+			writer.PutJSONString( pField, nField );
+		}
+
+		writer.Put( LOGOG_CONST_STRING(",\"thread\":") );
+		writer.PutDecimal( GetCurrentThreadIdentifier() );
+
+		if ( flags & TOPIC_MESSAGE_FLAG )
+		{
+			writer.Put( LOGOG_CONST_STRING(",\"message\":") );
+			pField = FieldChars( topic.Message(), nField );
+			writer.PutJSONString( pField, nField );
+		}
+
+		PutFields( writer, topic, true );
+
+		writer.Put( (LOGOG_CHAR)'}' );
+		PutEnd( writer, target );
+	}
+
+	void FormatterLogfmt::Render( LOGOG_STRING &sOutput, const Topic &topic, const Target &target )
+	{
+		TOPIC_FLAGS flags = GetTopicFlags( topic );
+		const LOGOG_CHAR *pField;
+		size_t nField;
+
+		FormatWriter writer( sOutput );
+
+		writer.Put( LOGOG_CONST_STRING("timestamp=") );
+		PutTimestamp( writer );
+
+		if ( flags & TOPIC_LEVEL_FLAG )
+		{
+			writer.Put( LOGOG_CONST_STRING(" level=") );
+			writer.Put( ErrorDescription( topic.Level() ));
+		}
+
+		if ( flags & TOPIC_FILE_NAME_FLAG )
+		{
+			writer.Put( LOGOG_CONST_STRING(" file=") );
+			pField = FieldChars( topic.FileName(), nField );
+			writer.PutLogfmtValue( pField, nField );
+		}
+
+		if ( flags & TOPIC_LINE_NUMBER_FLAG )
+		{
+			writer.Put( LOGOG_CONST_STRING(" line=") );
+			PutLineNumber( writer, topic.LineNumber() );
+		}
+
+		if ( flags & TOPIC_GROUP_FLAG )
+		{
+			writer.Put( LOGOG_CONST_STRING(" group=") );
+			pField = FieldChars( topic.Group(), nField );
+			writer.PutLogfmtValue( pField, nField );
+		}
+
+		if ( flags & TOPIC_CATEGORY_FLAG )
+		{
+			writer.Put( LOGOG_CONST_STRING(" category=") );
+			pField = FieldChars( topic.Category(), nField );
+			writer.PutLogfmtValue( pField, nField );
+		}
+
+		writer.Put( LOGOG_CONST_STRING(" thread=") );
+		writer.PutDecimal( GetCurrentThreadIdentifier() );
+
+		if ( flags & TOPIC_MESSAGE_FLAG )
+		{
+			writer.Put( LOGOG_CONST_STRING(" message=") );
+			pField = FieldChars( topic.Message(), nField );
+			writer.PutLogfmtValue( pField, nField );
+		}
+
+		PutFields( writer, topic, false );
+
+		PutEnd( writer, target );
+	}
+
+	FormatterSyslog::FormatterSyslog( int nFacility, const char *sAppName ) :
+		m_nFacility( nFacility )
+	{
+		if (( m_nFacility < 0 ) || ( m_nFacility > 23 ))
+			m_nFacility = LOGOG_SYSLOG_FACILITY;
+
+		char vHostName[ 256 ];
+		vHostName[ 0 ] = '\0';
+
+#ifdef LOGOG_FLAVOR_WINDOWS
+		DWORD nHostName = (DWORD)sizeof( vHostName );
+		if ( GetComputerNameA( vHostName, &nHostName ) == 0 )
+			vHostName[ 0 ] = '\0';
+		m_nProcessId = (LOGOG_UINT64)GetCurrentProcessId();
+#else // LOGOG_FLAVOR_WINDOWS
+		if ( gethostname( vHostName, sizeof( vHostName ) ) != 0 )
+			vHostName[ 0 ] = '\0';
+		vHostName[ sizeof( vHostName ) - 1 ] = '\0';
+		m_nProcessId = (LOGOG_UINT64)getpid();
+#endif // LOGOG_FLAVOR_WINDOWS
+
+#if defined( __GLIBC__ ) && defined( _GNU_SOURCE )
+		if ( sAppName == NULL )
+			sAppName = program_invocation_short_name;
+#endif
+
+		/* RFC 5424 limits the host name to 255 characters and the application name to 48. */
+		m_nHostName = CopyHeaderField( m_vHostName, 255, vHostName );
+		m_nAppName = CopyHeaderField( m_vAppName, 48, sAppName );
+	}
+
+	size_t FormatterSyslog::CopyHeaderField( char *pOut, size_t nMax, const char *sField )
+	{
+		size_t nLength = 0;
+
+		if ( sField != NULL )
+		{
+			while (( nLength < nMax ) && ( sField[ nLength ] != '\0' ))
+			{
+				char c = sField[ nLength ];
+				pOut[ nLength++ ] = (( c > ' ' ) && ( c < 127 )) ? c : '_';
+			}
+		}
+
+		if ( nLength == 0 )
+			pOut[ nLength++ ] = '-';
+
+		pOut[ nLength ] = '\0';
+		return nLength;
+	}
+
+	int FormatterSyslog::GetSeverity( LOGOG_LEVEL_TYPE level )
+	{
+		if ( level <= LOGOG_LEVEL_EMERGENCY )
+			return 0;
+		if ( level <= LOGOG_LEVEL_ALERT )
+			return 1;
+		if ( level <= LOGOG_LEVEL_CRITICAL )
+			return 2;
+		if ( level <= LOGOG_LEVEL_ERROR )
+			return 3;
+		if ( level <= LOGOG_LEVEL_WARN )
+			return 4;
+		if ( level < LOGOG_LEVEL_INFO )
+			return 5;
+		if ( level <= LOGOG_LEVEL_INFO )
+			return 6;
+		return 7;
+	}
+
+	void FormatterSyslog::PutParameterName( FormatWriter &writer, bool &bOpen, const LOGOG_CHAR *sName )
+	{
+		if ( !bOpen )
+		{
+			writer.Put( (LOGOG_CHAR)'[' );
+			writer.PutNarrow( LOGOG_SYSLOG_SD_ID, sizeof( LOGOG_SYSLOG_SD_ID ) - 1 );
+			bOpen = true;
+		}
+
+		writer.Put( (LOGOG_CHAR)' ' );
+		writer.Put( sName );
+		writer.Put( LOGOG_CONST_STRING("=\"") );
+	}
+
+	void FormatterSyslog::PutParameterValue( FormatWriter &writer, const LOGOG_CHAR *pValue, size_t nValue )
+	{
+		size_t nRun = 0;
+
+		for ( size_t t = 0; t < nValue; t++ )
+		{
+			LOGOG_CHAR c = pValue[ t ];
+
+			if (( c == '"' ) || ( c == '\\' ) || ( c == ']' ))
+			{
+				writer.Put( pValue + nRun, t - nRun );
+				writer.Put( (LOGOG_CHAR)'\\' );
+				nRun = t;
+			}
+		}
+
+		writer.Put( pValue + nRun, nValue - nRun );
+		writer.Put( (LOGOG_CHAR)'"' );
+	}
+
+	void FormatterSyslog::Render( LOGOG_STRING &sOutput, const Topic &topic, const Target &target )
+	{
+		TOPIC_FLAGS flags = GetTopicFlags( topic );
+		const LOGOG_CHAR *pField;
+		size_t nField;
+
+		FormatWriter writer( sOutput );
+
+		writer.Put( (LOGOG_CHAR)'<' );
+		writer.PutDecimal( (LOGOG_UINT64)( m_nFacility * 8 + GetSeverity( topic.Level() )));
+		writer.Put( LOGOG_CONST_STRING(">1 ") );
+		PutTimestamp( writer );
+		writer.Put( (LOGOG_CHAR)' ' );
+		writer.PutNarrow( m_vHostName, m_nHostName );
+		writer.Put( (LOGOG_CHAR)' ' );
+		writer.PutNarrow( m_vAppName, m_nAppName );
+		writer.Put( (LOGOG_CHAR)' ' );
+		writer.PutDecimal( m_nProcessId );
+		writer.Put( LOGOG_CONST_STRING(" - ") );
+
+		bool bOpen = false;
+
+		if ( flags & TOPIC_GROUP_FLAG )
+		{
+			PutParameterName( writer, bOpen, LOGOG_CONST_STRING("group") );
+			pField = FieldChars( topic.Group(), nField );
+			PutParameterValue( writer, pField, nField );
+		}
+
+		if ( flags & TOPIC_CATEGORY_FLAG )
+		{
+			PutParameterName( writer, bOpen, LOGOG_CONST_STRING("category") );
+			pField = FieldChars( topic.Category(), nField );
+			PutParameterValue( writer, pField, nField );
+		}
+
+		if ( flags & TOPIC_FILE_NAME_FLAG )
+		{
+			PutParameterName( writer, bOpen, LOGOG_CONST_STRING("file") );
+			pField = FieldChars( topic.FileName(), nField );
+			PutParameterValue( writer, pField, nField );
+		}
+
+		if ( flags & TOPIC_LINE_NUMBER_FLAG )
+		{
+			PutParameterName( writer, bOpen, LOGOG_CONST_STRING("line") );
+			PutLineNumber( writer, topic.LineNumber() );
+			writer.Put( (LOGOG_CHAR)'"' );
+		}
+
+		if ( bOpen )
+			writer.Put( (LOGOG_CHAR)']' );
+		else
+			writer.Put( (LOGOG_CHAR)'-' );
+
+		if ( flags & TOPIC_MESSAGE_FLAG )
+		{
+			pField = FieldChars( topic.Message(), nField );
+			if ( nField > 0 )
+			{
+				writer.Put( (LOGOG_CHAR)' ' );
+				writer.Put( pField, nField );
+			}
+		}
+
+		if ( target.GetNullTerminatesStrings() )
+			writer.Put( (LOGOG_CHAR)NULL );
+	}
+
+	bool ReentrantFormatterGCC::IsReentrant() const
+	{
+		return true;
+	}
+
+	bool ReentrantFormatterMSVC::IsReentrant() const
+	{
+		return true;
+	}
+
 	Formatter &GetDefaultFormatter()
 	{
 		Statics *pStatic = &Static();
@@ -229,9 +1009,9 @@ namespace logog {
 		if ( pStatic->s_pDefaultFormatter == NULL )
 		{
 #ifdef LOGOG_FLAVOR_WINDOWS
-			pStatic->s_pDefaultFormatter = new FormatterMSVC();
+			pStatic->s_pDefaultFormatter = new ReentrantFormatterMSVC();
 #else
-			pStatic->s_pDefaultFormatter = new FormatterGCC();
+			pStatic->s_pDefaultFormatter = new ReentrantFormatterGCC();
 #endif
 		}
 
@@ -252,18 +1032,17 @@ namespace logog {
 const char * TimeStamp::Get(const char* fmt)
 {
 	time_t tRawTime;
-	struct tm * tmInfo;
+	struct tm tmLocal;
+	struct tm * tmInfo = &tmLocal;
 
 	time ( &tRawTime );
 
+	/* Formatters may run on several threads at once, so use the reentrant versions of localtime(). */
 #ifdef LOGOG_FLAVOR_WINDOWS
-#pragma warning( push )
-#pragma warning( disable : 4996 )
-#endif // LOGOG_FLAVOR_WINDOWS
-	/* Microsoft is afraid of this function; I'm not sure this warning is sensible */
-	tmInfo = localtime ( &tRawTime );
-#ifdef LOGOG_FLAVOR_WINDOWS
-#pragma warning( pop )
+	if ( localtime_s( &tmLocal, &tRawTime ) != 0 )
+		tmInfo = NULL;
+#else // LOGOG_FLAVOR_WINDOWS
+	tmInfo = localtime_r( &tRawTime, &tmLocal );
 #endif // LOGOG_FLAVOR_WINDOWS
 
 	cTimeString[ 0 ] = '\0';
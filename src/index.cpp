@@ -0,0 +1,184 @@
+/*
+ * \file index.cpp
+ */
+
+#include "logog.hpp"
+
+#include <cstring>
+
+namespace logog {
+
+	static void PutLittleEndian( unsigned char *p, LOGOG_UINT64 n, int nBytes )
+	{
+		for ( int t = 0; t < nBytes; t++ )
+		{
+			p[ t ] = (unsigned char)n;
+			n >>= 8;
+		}
+	}
+
+	static LOGOG_UINT64 GetLittleEndian( const unsigned char *p, int nBytes )
+	{
+		LOGOG_UINT64 n = 0;
+
+		for ( int t = nBytes - 1; t >= 0; t-- )
+			n = ( n << 8 ) | p[ t ];
+
+		return n;
+	}
+
+	bool WriteLogIndexEntry( FILE *fp, const LogIndexEntry &entry )
+	{
+		unsigned char vEntry[ LOGOG_INDEX_ENTRY_LENGTH ];
+
+		PutLittleEndian( vEntry, entry.m_nFirstTime, 8 );
+		PutLittleEndian( vEntry + 8, entry.m_nLastTime, 8 );
+		PutLittleEndian( vEntry + 16, entry.m_nOffset, 8 );
+		PutLittleEndian( vEntry + 24, entry.m_nLength, 8 );
+		PutLittleEndian( vEntry + 32, entry.m_nRecords, 4 );
+		PutLittleEndian( vEntry + 36, entry.m_nLevel, 4 );
+
+		return ( fwrite( vEntry, 1, sizeof( vEntry ), fp ) == sizeof( vEntry ));
+	}
+
+	bool SeekLogFile( FILE *fp, LOGOG_UINT64 nOffset )
+	{
+#ifdef LOGOG_FLAVOR_WINDOWS
+		return ( _fseeki64( fp, (__int64)nOffset, SEEK_SET ) == 0 );
+#else // LOGOG_FLAVOR_WINDOWS
+		return ( fseeko( fp, (off_t)nOffset, SEEK_SET ) == 0 );
+#endif // LOGOG_FLAVOR_WINDOWS
+	}
+
+	LOGOG_UINT64 SeekLogFileEnd( FILE *fp )
+	{
+#ifdef LOGOG_FLAVOR_WINDOWS
+		if ( _fseeki64( fp, 0, SEEK_END ) != 0 )
+			return 0;
+		__int64 nEnd = _ftelli64( fp );
+#else // LOGOG_FLAVOR_WINDOWS
+		if ( fseeko( fp, 0, SEEK_END ) != 0 )
+			return 0;
+		off_t nEnd = ftello( fp );
+#endif // LOGOG_FLAVOR_WINDOWS
+
+		return ( nEnd < 0 ) ? 0 : (LOGOG_UINT64)nEnd;
+	}
+
+	LogIndex::LogIndex() :
+		m_nLogSize( 0 )
+	{
+	}
+
+	bool LogIndex::Open( const char *sLogFileName )
+	{
+		m_vEntries.clear();
+		m_nLogSize = 0;
+
+		size_t nNameLength = strlen( sLogFileName );
+		LOGOG_VECTOR< char, Allocator< char > > vIndexName( sLogFileName, sLogFileName + nNameLength );
+		vIndexName.insert( vIndexName.end(), LOGOG_INDEX_SUFFIX, LOGOG_INDEX_SUFFIX + sizeof( LOGOG_INDEX_SUFFIX ));
+
+		FILE *fp;
+
+#ifdef LOGOG_FLAVOR_WINDOWS
+		if ( fopen_s( &fp, &vIndexName[ 0 ], "rb" ) != 0 )
+			fp = NULL;
+#else // LOGOG_FLAVOR_WINDOWS
+		fp = fopen( &vIndexName[ 0 ], "rb" );
+#endif // LOGOG_FLAVOR_WINDOWS
+
+		if ( fp == NULL )
+			return false;
+
+		char vMagic[ LOGOG_INDEX_MAGIC_LENGTH ];
+
+		if (( fread( vMagic, 1, sizeof( vMagic ), fp ) != sizeof( vMagic )) ||
+			( memcmp( vMagic, LOGOG_INDEX_MAGIC, sizeof( vMagic )) != 0 ))
+		{
+			fclose( fp );
+			return false;
+		}
+
+		unsigned char vEntry[ LOGOG_INDEX_ENTRY_LENGTH ];
+
+		while ( fread( vEntry, 1, sizeof( vEntry ), fp ) == sizeof( vEntry ))
+		{
+			LogIndexEntry entry;
+
+			entry.m_nFirstTime = GetLittleEndian( vEntry, 8 );
+			entry.m_nLastTime = GetLittleEndian( vEntry + 8, 8 );
+			entry.m_nOffset = GetLittleEndian( vEntry + 16, 8 );
+			entry.m_nLength = GetLittleEndian( vEntry + 24, 8 );
+			entry.m_nRecords = (unsigned int)GetLittleEndian( vEntry + 32, 4 );
+			entry.m_nLevel = (unsigned int)GetLittleEndian( vEntry + 36, 4 );
+
+			m_vEntries.push_back( entry );
+		}
+
+		fclose( fp );
+
+#ifdef LOGOG_FLAVOR_WINDOWS
+		if ( fopen_s( &fp, sLogFileName, "rb" ) != 0 )
+			fp = NULL;
+#else // LOGOG_FLAVOR_WINDOWS
+		fp = fopen( sLogFileName, "rb" );
+#endif // LOGOG_FLAVOR_WINDOWS
+
+		if ( fp != NULL )
+		{
+			m_nLogSize = SeekLogFileEnd( fp );
+			fclose( fp );
+		}
+
+		return true;
+	}
+
+	const LogIndex::EntriesType &LogIndex::GetEntries() const
+	{
+		return m_vEntries;
+	}
+
+	size_t LogIndex::Find( LOGOG_UINT64 nFrom, LOGOG_UINT64 nTo, LOGOG_LEVEL_TYPE level, RangesType &vRanges ) const
+	{
+		LOGOG_UINT64 nIndexedEnd = 0;
+
+		vRanges.clear();
+
+		/* Entries are scanned in full rather than searched, because the wall clock can step backwards. */
+		for ( EntriesType::const_iterator it = m_vEntries.begin(); it != m_vEntries.end(); ++it )
+		{
+			if ( it->m_nOffset + it->m_nLength > nIndexedEnd )
+				nIndexedEnd = it->m_nOffset + it->m_nLength;
+
+			if (( it->m_nLastTime < nFrom ) || ( it->m_nFirstTime > nTo ) || ( (LOGOG_LEVEL_TYPE)it->m_nLevel > level ))
+				continue;
+
+			if ( !vRanges.empty() && ( vRanges.back().m_nOffset + vRanges.back().m_nLength == it->m_nOffset ))
+			{
+				vRanges.back().m_nLength += it->m_nLength;
+				continue;
+			}
+
+			LogIndexRange range;
+			range.m_nOffset = it->m_nOffset;
+			range.m_nLength = it->m_nLength;
+			vRanges.push_back( range );
+		}
+
+		if ( m_nLogSize > nIndexedEnd )
+		{
+			if ( !vRanges.empty() && ( vRanges.back().m_nOffset + vRanges.back().m_nLength == nIndexedEnd ))
+				vRanges.back().m_nLength += m_nLogSize - nIndexedEnd;
+			else
+			{
+				LogIndexRange range;
+				range.m_nOffset = nIndexedEnd;
+				range.m_nLength = m_nLogSize - nIndexedEnd;
+				vRanges.push_back( range );
+			}
+		}
+
+		return vRanges.size();
+	}
+}
@@ -83,6 +83,10 @@ AllocationsType s_Allocations;
 	void *Object::Allocate( size_t nSize )
     {
         void *ptr = Static().s_pfMalloc( nSize );
+#ifdef LOGOG_STATISTICS
+        LOGOG_ATOMIC_ADD( &s_nStatisticsAllocations, 1 );
+        LOGOG_ATOMIC_ADD( &s_nStatisticsBytesAllocated, nSize );
+#endif // LOGOG_STATISTICS
 #ifdef LOGOG_REPORT_ALLOCATIONS
         LOGOG_COUT << _LG("Allocated ") << nSize << _LG(" bytes of memory at ") << ptr << endl;
 #endif // LOGOG_REPORT_ALLOCATIONS
@@ -128,6 +132,9 @@ AllocationsType s_Allocations;
         s_Allocations.erase( ptr );
         UnlockAllocationsMutex();
 #endif // LOGOG_LEAK_DETECTION
+#ifdef LOGOG_STATISTICS
+        LOGOG_ATOMIC_ADD( &s_nStatisticsDeallocations, 1 );
+#endif // LOGOG_STATISTICS
         Static().s_pfFree( ptr );
     }
 
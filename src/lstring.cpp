@@ -41,6 +41,92 @@ namespace logog {
 		return len;
 	}
 
+#ifdef LOGOG_UNICODE
+	/* Decodes the code point that starts at pChars[ t ], and moves t past it. */
+	static unsigned long NextCodePoint( const LOGOG_CHAR *pChars, size_t nCount, size_t &t )
+	{
+		unsigned long nCode = (unsigned long)pChars[ t++ ];
+
+		if ( sizeof( LOGOG_CHAR ) == 2 )
+		{
+			nCode &= 0xffff;
+
+			if (( nCode >= 0xd800 ) && ( nCode < 0xdc00 ) && ( t < nCount ))
+			{
+				unsigned long nLow = (unsigned long)pChars[ t ] & 0xffff;
+
+				if (( nLow >= 0xdc00 ) && ( nLow < 0xe000 ))
+				{
+					t++;
+					return 0x10000 + (( nCode - 0xd800 ) << 10 ) + ( nLow - 0xdc00 );
+				}
+			}
+		}
+
+		/* What is left of the surrogates is unpaired. */
+		if ((( nCode >= 0xd800 ) && ( nCode < 0xe000 )) || ( nCode > 0x10ffff ))
+			nCode = 0xfffd;
+
+		return nCode;
+	}
+#endif // LOGOG_UNICODE
+
+	size_t String::UTF8Length( const LOGOG_CHAR *pChars, size_t nCount )
+	{
+#ifdef LOGOG_UNICODE
+		size_t nBytes = 0;
+
+		for ( size_t t = 0; t < nCount; )
+		{
+			unsigned long nCode = NextCodePoint( pChars, nCount, t );
+			nBytes += ( nCode < 0x80 ) ? 1 : ( nCode < 0x800 ) ? 2 : ( nCode < 0x10000 ) ? 3 : 4;
+		}
+
+		return nBytes;
+#else // LOGOG_UNICODE
+		(void)pChars;
+		return nCount;
+#endif // LOGOG_UNICODE
+	}
+
+	unsigned char *String::EncodeUTF8( const LOGOG_CHAR *pChars, size_t nCount, unsigned char *pOut )
+	{
+#ifdef LOGOG_UNICODE
+		for ( size_t t = 0; t < nCount; )
+		{
+			unsigned long nCode = NextCodePoint( pChars, nCount, t );
+
+			if ( nCode < 0x80 )
+				*pOut++ = (unsigned char)nCode;
+			else if ( nCode < 0x800 )
+			{
+				*pOut++ = (unsigned char)( 0xc0 | ( nCode >> 6 ));
+				*pOut++ = (unsigned char)( 0x80 | ( nCode & 0x3f ));
+			}
+			else if ( nCode < 0x10000 )
+			{
+				*pOut++ = (unsigned char)( 0xe0 | ( nCode >> 12 ));
+				*pOut++ = (unsigned char)( 0x80 | (( nCode >> 6 ) & 0x3f ));
+				*pOut++ = (unsigned char)( 0x80 | ( nCode & 0x3f ));
+			}
+			else
+			{
+				*pOut++ = (unsigned char)( 0xf0 | ( nCode >> 18 ));
+				*pOut++ = (unsigned char)( 0x80 | (( nCode >> 12 ) & 0x3f ));
+				*pOut++ = (unsigned char)( 0x80 | (( nCode >> 6 ) & 0x3f ));
+				*pOut++ = (unsigned char)( 0x80 | ( nCode & 0x3f ));
+			}
+		}
+
+		return pOut;
+#else // LOGOG_UNICODE
+		if ( nCount > 0 )
+			memcpy( pOut, pChars, nCount );
+
+		return pOut + nCount;
+#endif // LOGOG_UNICODE
+	}
+
 	String & String::operator=( const String & other )
 	{
 		Free();
@@ -122,6 +208,38 @@ namespace logog {
 		return MAXIMUM_INT_SIZE;
 	}
 
+	size_t String::grow( size_t nSize )
+	{
+		size_t nCapacity = capacity();
+
+		if (( nSize <= nCapacity ) && ( m_bIsConst == false ))
+			return nCapacity;
+
+		if ( nSize < nCapacity )
+			nSize = nCapacity;
+
+		size_t nUsed = size();
+		LOGOG_CHAR *pNewBuffer = (LOGOG_CHAR *)Allocate( sizeof( LOGOG_CHAR ) * nSize );
+
+		for ( size_t t = 0; t < nUsed; t++ )
+			pNewBuffer[ t ] = m_pBuffer[ t ];
+
+		if (( m_pBuffer != NULL ) && ( m_bIsConst == false ))
+			Deallocate( m_pBuffer );
+
+		m_pBuffer = pNewBuffer;
+		m_pOffset = pNewBuffer + nUsed;
+		m_pEndOfBuffer = pNewBuffer + nSize;
+		m_bIsConst = false;
+
+		return nSize;
+	}
+
+	size_t String::capacity() const
+	{
+		return ( m_pEndOfBuffer - m_pBuffer );
+	}
+
 	String::operator const LOGOG_CHAR *() const
 	{
 		return m_pBuffer;
@@ -242,6 +360,20 @@ namespace logog {
 		return ( m_pOffset - m_pBuffer );
 	}
 
+	size_t String::append( const LOGOG_CHAR *other, size_t nCount )
+	{
+		if ( other == NULL )
+			return ( m_pOffset - m_pBuffer );
+
+		while (( m_pOffset < m_pEndOfBuffer ) && ( nCount-- > 0 ))
+			*m_pOffset++ = *other++;
+
+		if ( m_pOffset < m_pEndOfBuffer )
+			*m_pOffset = (LOGOG_CHAR)NULL;
+
+		return ( m_pOffset - m_pBuffer );
+	}
+
 	size_t String::append( const LOGOG_CHAR c )
 	{
 		if ( m_pOffset < m_pEndOfBuffer )
@@ -392,11 +524,11 @@ namespace logog {
 			 ** does not include a null.  We need to verify that the nAttemptedSize can hold all
 			 ** of nActualSize PLUS the size of one null on this platform.  A LOGOG_CHAR could
 			 ** be 1, 2, or 4 bytes long.  So nAttemptedSize must be greater or equal to nActualSize
-			 ** less the size of one (null) LOGOG_CHAR in bytes.  Also, the last
+			 ** plus the size of one (null) LOGOG_CHAR in bytes.  Also, the last
 			 ** allocation may have failed altogether.  Verify that all these conditions
 			 ** are clean before accepting the output and jumping out of this loop.
 			 **/
-			if (( nAttemptedSize >= (nActualSize - (ptrdiff_t) sizeof(LOGOG_CHAR))) && 
+			if (( nAttemptedSize >= (nActualSize + (ptrdiff_t) sizeof(LOGOG_CHAR))) && 
 				( nActualSize > 0 ) )
 				break;
 
@@ -21,6 +21,16 @@ namespace logog
 		if ( pbIsCreated != NULL )
 			*pbIsCreated = true;
 
+#ifdef LOGOG_STATISTICS
+		m_nHits = 0;
+
+		LockableNodesType *pAllMessages = &AllMessages();
+		{
+			ScopedLock sl( *pAllMessages );
+			pAllMessages->insert( this );
+		}
+#endif // LOGOG_STATISTICS
+
         /* Messages are always sources, so there's no need to call Initialize() here */
         // Initialize();
 
@@ -35,6 +45,55 @@ namespace logog
 	{
 		if ( m_pbIsCreated != NULL )
 			*m_pbIsCreated = false;
+
+#ifdef LOGOG_STATISTICS
+		/* At shutdown the message list is destroyed before the messages are, so don't recreate it here. */
+		LockableNodesType *pAllMessages = ( LockableNodesType * )Static().s_pAllMessages;
+		if ( pAllMessages != NULL )
+		{
+			ScopedLock sl( *pAllMessages );
+			pAllMessages->erase( this );
+		}
+#endif // LOGOG_STATISTICS
+	}
+
+	int Message::Transmit()
+	{
+		Statics *pStatic = &Static();
+
+		/* Once Shutdown() has begun draining the targets, nothing new may reach them; and it waits for the
+		 * transmissions it has counted, so that no target is destroyed while one is using it. */
+		if ( LOGOG_ATOMIC_ADD_ACQ_REL( &pStatic->s_nTransmitting, 1 ) >= LOGOG_TRANSMIT_CLOSED )
+		{
+			LOGOG_ATOMIC_ADD_ACQ_REL( &pStatic->s_nTransmitting, (LOGOG_UINT64)-1 );
+			return 0;
+		}
+
+#ifdef LOGOG_STATISTICS
+		LOGOG_ATOMIC_ADD( &m_nHits, 1 );
+#endif // LOGOG_STATISTICS
+		int nResult = Checkpoint::Transmit();
+
+		LOGOG_ATOMIC_ADD_ACQ_REL( &pStatic->s_nTransmitting, (LOGOG_UINT64)-1 );
+		return nResult;
+	}
+
+	void Message::GetStatistics( Statistics::MessageEntry &entry ) const
+	{
+		entry.m_sFileName = FileName().c_str();
+		entry.m_nLineNumber = LineNumber();
+		entry.m_nLevel = Level();
+#ifdef LOGOG_STATISTICS
+		entry.m_nHits = LOGOG_ATOMIC_LOAD( &m_nHits );
+#else // LOGOG_STATISTICS
+		entry.m_nHits = 0;
+#endif // LOGOG_STATISTICS
+		m_Transmitting.GetStatistics( entry.m_TransmitLock );
+	}
+
+	LockableNodesType &AllMessages()
+	{
+		return GetStaticNodes( &(Static().s_pAllMessages ) );
 	}
 
 
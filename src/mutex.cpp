@@ -5,21 +5,117 @@
 
 #include "logog.hpp"
 
+#ifdef LOGOG_FUTEX_MUTEX
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined( __i386__ ) || defined( __x86_64__ )
+#define LOGOG_CPU_RELAX() __builtin_ia32_pause()
+#elif defined( __aarch64__ ) || defined( __arm__ )
+#define LOGOG_CPU_RELAX() __asm__ __volatile__( "yield" ::: "memory" )
+#else
+#define LOGOG_CPU_RELAX()
+#endif
+#endif // __linux__
+#endif // LOGOG_FUTEX_MUTEX
+
 namespace logog {
 
+#ifdef LOGOG_FUTEX_MUTEX
+#ifdef __linux__
+	/* The lock protocol is the three-state mutex described in Ulrich Drepper's "Futexes Are Tricky".
+	 * A state of 2 tells the unlocking thread that it must wake up a sleeper.
+	 */
+	static void FutexWait( int *pState, int nExpected )
+	{
+		syscall( SYS_futex, pState, FUTEX_WAIT_PRIVATE, nExpected, NULL, NULL, 0 );
+	}
+
+	static void FutexWake( int *pState )
+	{
+		syscall( SYS_futex, pState, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0 );
+	}
+
+	void FutexMutexInit( FutexMutex *pMutex )
+	{
+		pMutex->m_nState = 0;
+		pMutex->m_nSpinEstimate = 0;
+	}
+
+	int FutexMutexTryLock( FutexMutex *pMutex )
+	{
+		int nExpected = 0;
+
+		if ( __atomic_compare_exchange_n( &pMutex->m_nState, &nExpected, 1, false,
+			__ATOMIC_ACQUIRE, __ATOMIC_RELAXED ))
+			return 0;
+
+		return 1;
+	}
+
+	void FutexMutexLock( FutexMutex *pMutex )
+	{
+		if ( FutexMutexTryLock( pMutex ) == 0 )
+			return;
+
+		/* Spin for a while, on the theory that the holder will be done soon.  The spin limit tracks twice the
+		 * recent average, so a mutex that is usually released quickly spins, and one that is held for a long
+		 * time goes to sleep almost immediately.
+		 */
+		int nEstimate = __atomic_load_n( &pMutex->m_nSpinEstimate, __ATOMIC_RELAXED );
+		int nMaxSpin = nEstimate * 2 + 10;
+		if ( nMaxSpin > LOGOG_FUTEX_MAX_SPIN )
+			nMaxSpin = LOGOG_FUTEX_MAX_SPIN;
+
+		int nSpin;
+		for ( nSpin = 0; nSpin < nMaxSpin; nSpin++ )
+		{
+			LOGOG_CPU_RELAX();
+
+			if (( __atomic_load_n( &pMutex->m_nState, __ATOMIC_RELAXED ) == 0 ) &&
+				( FutexMutexTryLock( pMutex ) == 0 ))
+			{
+				__atomic_store_n( &pMutex->m_nSpinEstimate, nEstimate + ( nSpin - nEstimate ) / 8, __ATOMIC_RELAXED );
+				return;
+			}
+		}
+
+		__atomic_store_n( &pMutex->m_nSpinEstimate, nEstimate + ( nSpin - nEstimate ) / 8, __ATOMIC_RELAXED );
+
+		/* Mark the lock as contended and sleep until we're the ones who changed it from unlocked. */
+		while ( __atomic_exchange_n( &pMutex->m_nState, 2, __ATOMIC_ACQUIRE ) != 0 )
+			FutexWait( &pMutex->m_nState, 2 );
+	}
+
+	void FutexMutexUnlock( FutexMutex *pMutex )
+	{
+		if ( __atomic_fetch_sub( &pMutex->m_nState, 1, __ATOMIC_RELEASE ) != 1 )
+		{
+			__atomic_store_n( &pMutex->m_nState, 0, __ATOMIC_RELEASE );
+			FutexWake( &pMutex->m_nState );
+		}
+	}
+#endif // __linux__
+#endif // LOGOG_FUTEX_MUTEX
+
 	Mutex::Mutex() LOGOG_MUTEX_CTOR( m_Mutex )
 	{
 		LOGOG_MUTEX_INIT(&m_Mutex);
+		ResetStatistics();
 	}
 
 	Mutex::Mutex( const Mutex & )
 	{
 		LOGOG_MUTEX_INIT(&m_Mutex);
+		ResetStatistics();
 	}
 
 	Mutex & Mutex::operator = (const Mutex &)
 	{
 		LOGOG_MUTEX_INIT(&m_Mutex);
+		ResetStatistics();
 		return *this;
 	}
 
@@ -30,7 +126,23 @@ namespace logog {
 
 	void Mutex::MutexLock()
 	{
+#ifdef LOGOG_MUTEX_STATISTICS
+		/* Only a lock that has to wait pays for reading the clock. */
+		if ( LOGOG_MUTEX_TRYLOCK(&m_Mutex) != 0 )
+		{
+			LOGOG_UINT64 nStart = GetMonotonicNanoseconds();
+			LOGOG_MUTEX_LOCK(&m_Mutex);
+			LOGOG_ATOMIC_STORE( &m_Statistics.m_nContendedAcquisitions,
+								LOGOG_ATOMIC_LOAD( &m_Statistics.m_nContendedAcquisitions ) + 1 );
+			LOGOG_ATOMIC_STORE( &m_Statistics.m_nWaitNanoseconds,
+								LOGOG_ATOMIC_LOAD( &m_Statistics.m_nWaitNanoseconds ) + GetMonotonicNanoseconds() - nStart );
+		}
+
+		/* Only the holder writes the counters, so they need no read-modify-write of their own. */
+		LOGOG_ATOMIC_STORE( &m_Statistics.m_nAcquisitions, LOGOG_ATOMIC_LOAD( &m_Statistics.m_nAcquisitions ) + 1 );
+#else // LOGOG_MUTEX_STATISTICS
 		LOGOG_MUTEX_LOCK(&m_Mutex);
+#endif // LOGOG_MUTEX_STATISTICS
 	}
 
 	void Mutex::MutexUnlock()
@@ -38,6 +150,32 @@ namespace logog {
 		LOGOG_MUTEX_UNLOCK(&m_Mutex);
 	}
 
+	bool Mutex::GetStatistics( MutexStatistics &stats ) const
+	{
+#ifdef LOGOG_MUTEX_STATISTICS
+		/* Read without locking, so that asking for statistics neither changes them nor waits on a thread that holds
+		 * the mutex for a long time, such as a target's delivery thread stuck in Output(). */
+		stats.m_nAcquisitions = LOGOG_ATOMIC_LOAD( &m_Statistics.m_nAcquisitions );
+		stats.m_nContendedAcquisitions = LOGOG_ATOMIC_LOAD( &m_Statistics.m_nContendedAcquisitions );
+		stats.m_nWaitNanoseconds = LOGOG_ATOMIC_LOAD( &m_Statistics.m_nWaitNanoseconds );
+		return true;
+#else // LOGOG_MUTEX_STATISTICS
+		stats.m_nAcquisitions = 0;
+		stats.m_nContendedAcquisitions = 0;
+		stats.m_nWaitNanoseconds = 0;
+		return false;
+#endif // LOGOG_MUTEX_STATISTICS
+	}
+
+	void Mutex::ResetStatistics()
+	{
+#ifdef LOGOG_MUTEX_STATISTICS
+		LOGOG_ATOMIC_STORE( &m_Statistics.m_nAcquisitions, 0 );
+		LOGOG_ATOMIC_STORE( &m_Statistics.m_nContendedAcquisitions, 0 );
+		LOGOG_ATOMIC_STORE( &m_Statistics.m_nWaitNanoseconds, 0 );
+#endif // LOGOG_MUTEX_STATISTICS
+	}
+
 	ScopedLock::ScopedLock( Mutex &mutex )
 	{
 		m_pMutex = &mutex;
@@ -49,6 +187,60 @@ namespace logog {
 		m_pMutex->MutexUnlock();
 	}
 
+	Condition::Condition()
+	{
+		LOGOG_CONDITION_INIT( m_Condition );
+	}
+
+	Condition::~Condition()
+	{
+		LOGOG_CONDITION_DELETE( m_Condition );
+	}
+
+	void Condition::Lock()
+	{
+		LOGOG_CONDITION_LOCK( m_Condition );
+	}
+
+	void Condition::Unlock()
+	{
+		LOGOG_CONDITION_UNLOCK( m_Condition );
+	}
+
+	void Condition::Wait()
+	{
+		LOGOG_CONDITION_WAIT( m_Condition );
+	}
+
+	void Condition::Wait( unsigned int nMilliseconds )
+	{
+		LOGOG_CONDITION_WAIT_FOR( m_Condition, nMilliseconds );
+	}
+
+#ifdef LOGOG_FLAVOR_POSIX
+	void PosixConditionWaitFor( pthread_cond_t *pCondition, pthread_mutex_t *pMutex, unsigned int nMilliseconds )
+	{
+		/* Condition variables time out against the wall clock unless told otherwise. */
+		LOGOG_UINT64 nDeadline = GetRealtimeNanoseconds() + (LOGOG_UINT64)nMilliseconds * 1000000;
+		struct timespec deadline;
+
+		deadline.tv_sec = (time_t)( nDeadline / 1000000000 );
+		deadline.tv_nsec = (long)( nDeadline % 1000000000 );
+
+		pthread_cond_timedwait( pCondition, pMutex, &deadline );
+	}
+#endif // LOGOG_FLAVOR_POSIX
+
+	void Condition::Signal()
+	{
+		LOGOG_CONDITION_SIGNAL( m_Condition );
+	}
+
+	void Condition::Broadcast()
+	{
+		LOGOG_CONDITION_BROADCAST( m_Condition );
+	}
+
 #ifdef LOGOG_LEAK_DETECTION
 	Mutex s_AllocationsMutex;
 	void LockAllocationsMutex()
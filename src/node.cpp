@@ -319,6 +319,7 @@ namespace logog {
 		DestroyNodesList( &(pStatics->s_pAllSubscriberNodes ));
 		DestroyNodesList( &(pStatics->s_pAllFilterNodes ));
 		DestroyNodesList( &(pStatics->s_pAllTargets ));
+		DestroyNodesList( &(pStatics->s_pAllMessages ));
 
 		/* We have to copy the AllNodes because destroying each node will remove it from AllNodes.  Fortunately
 		 * this only happens at shutdown, so we don't have to worry about efficiency.
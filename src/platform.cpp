@@ -4,8 +4,38 @@
 
 #include "logog.hpp"
 
+#if defined( LOGOG_FLAVOR_POSIX ) && defined( __linux__ )
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
 namespace logog {
 
 	bool sb_AvoidLinkError4221_platform_cpp = false;
-}
 
+	static LOGOG_UINT64 ReadCurrentThreadIdentifier()
+	{
+#if defined( LOGOG_FLAVOR_WINDOWS )
+		return (LOGOG_UINT64)GetCurrentThreadId();
+#elif defined( LOGOG_FLAVOR_POSIX ) && defined( __linux__ ) && defined( SYS_gettid )
+		return (LOGOG_UINT64)syscall( SYS_gettid );
+#else
+		return (LOGOG_UINT64)(size_t)LOGOG_THREAD_SELF;
+#endif
+	}
+
+	LOGOG_UINT64 GetCurrentThreadIdentifier()
+	{
+#ifdef LOGOG_THREAD_LOCAL
+		/* Thread ids are never zero, so zero means the id hasn't been read on this thread yet. */
+		static LOGOG_THREAD_LOCAL LOGOG_UINT64 s_nThreadIdentifier = 0;
+
+		if ( s_nThreadIdentifier == 0 )
+			s_nThreadIdentifier = ReadCurrentThreadIdentifier();
+
+		return s_nThreadIdentifier;
+#else // LOGOG_THREAD_LOCAL
+		return ReadCurrentThreadIdentifier();
+#endif // LOGOG_THREAD_LOCAL
+	}
+}
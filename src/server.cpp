@@ -0,0 +1,864 @@
+/*
+ * \file server.cpp
+ */
+
+#include "logog.hpp"
+
+#ifdef LOGOG_FLAVOR_POSIX
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <stddef.h>
+
+#ifdef __linux__
+#define LOGOG_SERVER_EPOLL
+#include <sys/epoll.h>
+#endif // __linux__
+#endif // LOGOG_FLAVOR_POSIX
+
+namespace logog {
+
+	BinarySocket::BinarySocket( const char *sAddress, int port ) :
+		Socket( sAddress, SOCK_STREAM, port ),
+		m_nStreamStart( 0 )
+	{
+		SetFormatter( m_BinaryFormatter );
+		SetName( LOGOG_CONST_STRING( "binarysocket" ));
+	}
+
+	void BinarySocket::Connected()
+	{
+		/* Until some of the stream has been sent, the queue still starts with its header, and can go as it is. */
+		if ( m_nStreamSent == m_nStreamStart )
+			return;
+
+		/* The rest of the stream refers to call sites that were described to a server that is gone. */
+		DropQueue();
+		m_BinaryFormatter.Reset();
+		m_nStreamStart = m_nStreamSent;
+	}
+
+#ifdef LOGOG_FLAVOR_POSIX
+
+	typedef LOGOG_VECTOR< LOGOG_CHAR, Allocator< LOGOG_CHAR > > ServerTextType;
+
+	struct ServerSite : public Object
+	{
+		/** A hash of m_vKey, to make the search quick. */
+		LOGOG_UINT64 m_nHash;
+		/** The level, line number, file name, group, category and format string, as read. */
+		LOGOG_VECTOR< char, Allocator< char > > m_vKey;
+		/** The file name, group, category and format string, each null-terminated.  The message refers to
+		 ** them rather than copying them.
+		 **/
+		ServerTextType m_vText;
+		size_t m_vOffsets[ 4 ];
+		Message *m_pMessage;
+	};
+
+	/** A message read from a connection, waiting for its turn to be transmitted. */
+	struct ServerRecord
+	{
+		/** When the producer logged it, in nanoseconds since 1970. */
+		LOGOG_UINT64 m_nTime;
+		/** When it was read, from GetMonotonicNanoseconds(). */
+		LOGOG_UINT64 m_nArrival;
+		ServerSite *m_pSite;
+		/** Where the message is in ServerConnection::m_vText. */
+		size_t m_nText;
+		size_t m_nTextLength;
+		/** Where its fields are in ServerConnection::m_vFields. */
+		size_t m_nFirstField;
+		size_t m_nFieldCount;
+	};
+
+	/** A field of a waiting message.  The key and any string value are offsets into ServerConnection::m_vText. */
+	struct ServerField
+	{
+		size_t m_nKey;
+		FieldType m_Type;
+		LOGOG_INT64 m_nInteger;
+		LOGOG_UINT64 m_nUnsigned;
+		double m_dFloat;
+		bool m_bBoolean;
+		size_t m_nString;
+	};
+
+	struct ServerConnection : public Object
+	{
+		int m_nSocket;
+		bool m_bListener;
+		/** The path of a listening Unix domain socket, to remove when it closes, or empty. */
+		LOGOG_VECTOR< char, Allocator< char > > m_vPath;
+
+		/** Bytes received but not yet read as whole records. */
+		LOGOG_VECTOR< unsigned char, Allocator< unsigned char > > m_vInput;
+		BinaryLogReader m_Reader;
+		/** The reader's header count when m_vSites was last cleared. */
+		LOGOG_UINT64 m_nHeaders;
+		/** The shared site for each site id in the current stream, or NULL if it hasn't been looked up yet. */
+		LOGOG_VECTOR< ServerSite *, Allocator< ServerSite * > > m_vSites;
+
+		/** The waiting messages.  Those before m_nRecordHead have been transmitted. */
+		LOGOG_VECTOR< ServerRecord, Allocator< ServerRecord > > m_vRecords;
+		size_t m_nRecordHead;
+		LOGOG_VECTOR< ServerField, Allocator< ServerField > > m_vFields;
+		ServerTextType m_vText;
+
+		bool HasRecords() const
+		{
+			return ( m_nRecordHead < m_vRecords.size() );
+		}
+	};
+
+	/* Appends nLength bytes of UTF-8 to text as LOGOG_CHARs, stopping at a null, then appends a null.  Bytes that
+	 * aren't valid UTF-8 become U+FFFD. */
+	static void AppendUTF8( ServerTextType &text, const char *pChars, size_t nLength )
+	{
+		const unsigned char *pIn = (const unsigned char *)pChars;
+		const unsigned char *pEnd = pIn + nLength;
+
+#ifdef LOGOG_UNICODE
+		while (( pIn < pEnd ) && ( *pIn != 0 ))
+		{
+			unsigned long nCode = *pIn++;
+			int nFollowing = 0;
+
+			if ( nCode >= 0xf0 && nCode < 0xf8 )
+			{
+				nCode &= 0x07;
+				nFollowing = 3;
+			}
+			else if ( nCode >= 0xe0 && nCode < 0xf0 )
+			{
+				nCode &= 0x0f;
+				nFollowing = 2;
+			}
+			else if ( nCode >= 0xc0 && nCode < 0xe0 )
+			{
+				nCode &= 0x1f;
+				nFollowing = 1;
+			}
+			else if ( nCode >= 0x80 )
+			{
+				nCode = 0xfffd;
+			}
+
+			for ( ; nFollowing > 0; nFollowing-- )
+			{
+				if (( pIn == pEnd ) || (( *pIn & 0xc0 ) != 0x80 ))
+				{
+					nCode = 0xfffd;
+					break;
+				}
+
+				nCode = ( nCode << 6 ) | ( *pIn++ & 0x3f );
+			}
+
+			text.push_back( (LOGOG_CHAR)nCode );
+		}
+#else // LOGOG_UNICODE
+		const unsigned char *pStart = pIn;
+
+		while (( pIn < pEnd ) && ( *pIn != 0 ))
+			pIn++;
+
+		text.insert( text.end(), (const char *)pStart, (const char *)pIn );
+#endif // LOGOG_UNICODE
+
+		text.push_back( (LOGOG_CHAR)NULL );
+	}
+
+	/* Makes a descriptor non-blocking, and closes it on exec. */
+	static int SetNonBlocking( int nDescriptor )
+	{
+		fcntl( nDescriptor, F_SETFD, FD_CLOEXEC );
+		return ( fcntl( nDescriptor, F_SETFL, fcntl( nDescriptor, F_GETFL, 0 ) | O_NONBLOCK ) == -1 ) ? -1 : 0;
+	}
+
+	SocketServer::SocketServer() :
+		m_nPoller( -1 ),
+		m_nMergeWindow( (LOGOG_UINT64)LOGOG_DEFAULT_SERVER_MERGE_WINDOW * 1000000ULL ),
+		m_nMessages( 0 ),
+		m_nSkipped( 0 ),
+		m_ServeThread( ServeThread, this ),
+		m_bStarted( false ),
+		m_bStop( false )
+	{
+		m_vWake[ 0 ] = -1;
+		m_vWake[ 1 ] = -1;
+	}
+
+	SocketServer::~SocketServer()
+	{
+		Stop();
+
+		ScopedLock sl( m_Mutex );
+
+		TransmitDue( true );
+
+		for ( size_t t = 0; t < m_vConnections.size(); t++ )
+		{
+			CloseConnection( m_vConnections[ t ] );
+			delete m_vConnections[ t ];
+		}
+
+		m_vConnections.clear();
+
+		for ( size_t t = 0; t < m_vSites.size(); t++ )
+		{
+			/* A message stays published to the filters until it is destroyed, unlike other nodes. */
+			m_vSites[ t ]->m_pMessage->UnpublishToMultiple( AllFilters() );
+			delete m_vSites[ t ]->m_pMessage;
+			delete m_vSites[ t ];
+		}
+
+		m_vSites.clear();
+
+		if ( m_nPoller != -1 )
+			close( m_nPoller );
+
+		for ( int t = 0; t < 2; t++ )
+			if ( m_vWake[ t ] != -1 )
+				close( m_vWake[ t ] );
+	}
+
+	int SocketServer::Open()
+	{
+		if ( m_vWake[ 0 ] != -1 )
+			return 0;
+
+		if ( pipe( m_vWake ) != 0 )
+		{
+			m_vWake[ 0 ] = -1;
+			m_vWake[ 1 ] = -1;
+			return -1;
+		}
+
+		SetNonBlocking( m_vWake[ 0 ] );
+		SetNonBlocking( m_vWake[ 1 ] );
+
+#ifdef LOGOG_SERVER_EPOLL
+		m_nPoller = epoll_create1( EPOLL_CLOEXEC );
+
+		if ( m_nPoller != -1 )
+		{
+			/* The wake pipe is the only descriptor whose event carries no connection. */
+			struct epoll_event event;
+			memset( &event, 0, sizeof( event ));
+			event.events = EPOLLIN;
+			event.data.ptr = NULL;
+			epoll_ctl( m_nPoller, EPOLL_CTL_ADD, m_vWake[ 0 ], &event );
+		}
+#endif // LOGOG_SERVER_EPOLL
+
+		return 0;
+	}
+
+	int SocketServer::Listen( const char *sAddress, int port )
+	{
+		ScopedLock sl( m_Mutex );
+
+		if ( Open() != 0 )
+			return -1;
+
+		ServerConnection *pListener = new ServerConnection();
+		pListener->m_bListener = true;
+		pListener->m_nHeaders = 0;
+		pListener->m_nRecordHead = 0;
+		pListener->m_nSocket = -1;
+
+		if ( strchr( sAddress, '/' ) != NULL )
+		{
+			struct sockaddr_un address;
+			size_t nPathLength = strlen( sAddress );
+
+			if ( nPathLength >= sizeof( address.sun_path ))
+			{
+				delete pListener;
+				return -1;
+			}
+
+			memset( &address, 0, sizeof( address ));
+			address.sun_family = AF_UNIX;
+			memcpy( address.sun_path, sAddress, nPathLength + 1 );
+
+			/* Replace the socket of a server that didn't clean up after itself, but never any other file. */
+			struct stat status;
+			if (( lstat( sAddress, &status ) == 0 ) && S_ISSOCK( status.st_mode ))
+				unlink( sAddress );
+
+			pListener->m_nSocket = socket( AF_UNIX, SOCK_STREAM, 0 );
+
+			if (( pListener->m_nSocket != -1 ) &&
+				( bind( pListener->m_nSocket, (struct sockaddr *)&address,
+					(socklen_t)( offsetof( struct sockaddr_un, sun_path ) + nPathLength + 1 )) == 0 ))
+				pListener->m_vPath.assign( sAddress, sAddress + nPathLength + 1 );
+			else if ( pListener->m_nSocket != -1 )
+			{
+				close( pListener->m_nSocket );
+				pListener->m_nSocket = -1;
+			}
+		}
+		else
+		{
+			struct addrinfo hints;
+			struct addrinfo *pInfo;
+			char sPort[ 16 ];
+
+			memset( &hints, 0, sizeof( hints ));
+			hints.ai_family = AF_UNSPEC;
+			hints.ai_socktype = SOCK_STREAM;
+			hints.ai_flags = AI_PASSIVE;
+			snprintf( sPort, sizeof( sPort ), "%d", port );
+
+			if (( getaddrinfo( sAddress, sPort, &hints, &pInfo ) == 0 ) && ( pInfo != NULL ))
+			{
+				pListener->m_nSocket = socket( pInfo->ai_family, SOCK_STREAM, 0 );
+
+				int nOn = 1;
+				if ( pListener->m_nSocket != -1 )
+					setsockopt( pListener->m_nSocket, SOL_SOCKET, SO_REUSEADDR, &nOn, sizeof( nOn ));
+
+				if (( pListener->m_nSocket != -1 ) &&
+					( bind( pListener->m_nSocket, pInfo->ai_addr, pInfo->ai_addrlen ) != 0 ))
+				{
+					close( pListener->m_nSocket );
+					pListener->m_nSocket = -1;
+				}
+
+				freeaddrinfo( pInfo );
+			}
+		}
+
+		if (( pListener->m_nSocket == -1 ) || ( SetNonBlocking( pListener->m_nSocket ) != 0 ) ||
+			( listen( pListener->m_nSocket, SOMAXCONN ) != 0 ))
+		{
+			CloseConnection( pListener );
+			delete pListener;
+			return -1;
+		}
+
+		AddConnection( pListener );
+		return 0;
+	}
+
+	void SocketServer::AddConnection( ServerConnection *pConnection )
+	{
+		m_vConnections.push_back( pConnection );
+
+#ifdef LOGOG_SERVER_EPOLL
+		if ( m_nPoller != -1 )
+		{
+			struct epoll_event event;
+			memset( &event, 0, sizeof( event ));
+			event.events = EPOLLIN;
+			event.data.ptr = pConnection;
+			epoll_ctl( m_nPoller, EPOLL_CTL_ADD, pConnection->m_nSocket, &event );
+		}
+#endif // LOGOG_SERVER_EPOLL
+	}
+
+	void SocketServer::CloseConnection( ServerConnection *pConnection )
+	{
+		if ( pConnection->m_nSocket == -1 )
+			return;
+
+		/* Closing the descriptor removes it from the epoll instance too. */
+		close( pConnection->m_nSocket );
+		pConnection->m_nSocket = -1;
+
+		if ( !pConnection->m_vPath.empty() )
+		{
+			unlink( &pConnection->m_vPath[ 0 ] );
+			pConnection->m_vPath.clear();
+		}
+	}
+
+	void SocketServer::Accept( ServerConnection *pListener )
+	{
+		for ( ;; )
+		{
+			int nSocket = accept( pListener->m_nSocket, NULL, NULL );
+
+			if ( nSocket == -1 )
+			{
+				if ( errno == EINTR )
+					continue;
+				return;
+			}
+
+			if ( SetNonBlocking( nSocket ) != 0 )
+			{
+				close( nSocket );
+				continue;
+			}
+
+			ServerConnection *pConnection = new ServerConnection();
+			pConnection->m_nSocket = nSocket;
+			pConnection->m_bListener = false;
+			pConnection->m_nHeaders = 0;
+			pConnection->m_nRecordHead = 0;
+
+			AddConnection( pConnection );
+		}
+	}
+
+	void SocketServer::Read( ServerConnection *pConnection )
+	{
+		/* One read per wakeup, so that a busy producer can't starve the others; epoll reports it again. */
+		size_t nOld = pConnection->m_vInput.size();
+		pConnection->m_vInput.resize( nOld + LOGOG_SERVER_READ_SIZE );
+
+		ssize_t nRead;
+		do
+		{
+			nRead = recv( pConnection->m_nSocket, &pConnection->m_vInput[ nOld ], LOGOG_SERVER_READ_SIZE, 0 );
+		}
+		while (( nRead < 0 ) && ( errno == EINTR ));
+
+		pConnection->m_vInput.resize( nOld + (( nRead > 0 ) ? (size_t)nRead : 0 ));
+
+		if (( nRead < 0 ) && (( errno == EAGAIN ) || ( errno == EWOULDBLOCK )))
+			return;
+
+		if ( !pConnection->m_vInput.empty() )
+		{
+			BinaryLogReader &reader = pConnection->m_Reader;
+			BinaryLogRecord record;
+			LOGOG_UINT64 nSkipped = reader.GetSkippedCount();
+			LOGOG_UINT64 nNow = GetMonotonicNanoseconds();
+
+			reader.SetBuffer( &pConnection->m_vInput[ 0 ], pConnection->m_vInput.size() );
+
+			while ( reader.Next( record ))
+			{
+				if ( reader.GetHeaderCount() != pConnection->m_nHeaders )
+				{
+					pConnection->m_vSites.clear();
+					pConnection->m_nHeaders = reader.GetHeaderCount();
+				}
+
+				size_t nSite = (size_t)record.m_Site.m_nId;
+
+				if ( nSite >= pConnection->m_vSites.size() )
+					pConnection->m_vSites.resize( nSite + 1, NULL );
+
+				if ( pConnection->m_vSites[ nSite ] == NULL )
+					pConnection->m_vSites[ nSite ] = FindSite( record.m_Site );
+
+				ServerRecord waiting;
+				waiting.m_nTime = record.m_nTime;
+				waiting.m_nArrival = nNow;
+				waiting.m_pSite = pConnection->m_vSites[ nSite ];
+				waiting.m_nText = pConnection->m_vText.size();
+				AppendUTF8( pConnection->m_vText, record.m_sMessage, record.m_nMessageLength );
+				waiting.m_nTextLength = pConnection->m_vText.size() - waiting.m_nText - 1;
+				waiting.m_nFirstField = pConnection->m_vFields.size();
+				waiting.m_nFieldCount = record.m_nFieldCount;
+
+				for ( size_t t = 0; t < record.m_nFieldCount; t++ )
+				{
+					const BinaryLogField &in = record.m_vFields[ t ];
+					ServerField field;
+
+					field.m_Type = in.m_Type;
+					field.m_nInteger = in.m_nInteger;
+					field.m_nUnsigned = in.m_nUnsigned;
+					field.m_dFloat = in.m_dFloat;
+					field.m_bBoolean = in.m_bBoolean;
+					field.m_nKey = pConnection->m_vText.size();
+					AppendUTF8( pConnection->m_vText, in.m_sKey, strlen( in.m_sKey ));
+					field.m_nString = pConnection->m_vText.size();
+					if ( in.m_Type == FIELD_STRING )
+						AppendUTF8( pConnection->m_vText, in.m_sString, in.m_nStringLength );
+
+					pConnection->m_vFields.push_back( field );
+				}
+
+				pConnection->m_vRecords.push_back( waiting );
+			}
+
+			m_nSkipped += reader.GetSkippedCount() - nSkipped;
+
+			pConnection->m_vInput.erase( pConnection->m_vInput.begin(),
+				pConnection->m_vInput.begin() + (ptrdiff_t)reader.GetBufferPosition() );
+
+			if ( reader.IsCorrupt() )
+				nRead = -1;
+		}
+
+		/* The producer has gone, or sent something that isn't a binary log. */
+		if ( nRead <= 0 )
+			CloseConnection( pConnection );
+	}
+
+	ServerSite *SocketServer::FindSite( const BinaryLogSite &site )
+	{
+		LOGOG_VECTOR< char, Allocator< char > > vKey;
+		char vNumbers[ 32 ];
+		const char *vStrings[ 4 ] = { site.m_sFileName, site.m_sGroup, site.m_sCategory, site.m_sFormat };
+
+		int nNumbers = snprintf( vNumbers, sizeof( vNumbers ), "%d:%d", site.m_nLevel, site.m_nLineNumber );
+		vKey.insert( vKey.end(), vNumbers, vNumbers + nNumbers + 1 );
+
+		for ( int t = 0; t < 4; t++ )
+			vKey.insert( vKey.end(), vStrings[ t ], vStrings[ t ] + strlen( vStrings[ t ] ) + 1 );
+
+		/* FNV-1a */
+		LOGOG_UINT64 nHash = 14695981039346656037ULL;
+		for ( size_t t = 0; t < vKey.size(); t++ )
+			nHash = ( nHash ^ (unsigned char)vKey[ t ] ) * 1099511628211ULL;
+
+		for ( size_t t = 0; t < m_vSites.size(); t++ )
+			if (( m_vSites[ t ]->m_nHash == nHash ) && ( m_vSites[ t ]->m_vKey == vKey ))
+				return m_vSites[ t ];
+
+		ServerSite *pSite = new ServerSite();
+		pSite->m_nHash = nHash;
+		pSite->m_vKey = vKey;
+
+		for ( int t = 0; t < 4; t++ )
+		{
+			pSite->m_vOffsets[ t ] = pSite->m_vText.size();
+			AppendUTF8( pSite->m_vText, vStrings[ t ], strlen( vStrings[ t ] ));
+		}
+
+		/* Empty groups and categories were never set, and must not be set here either, or filters would
+		 * match them differently. */
+		const LOGOG_CHAR *pText = &pSite->m_vText[ 0 ];
+		const LOGOG_CHAR *sFileName = pText + pSite->m_vOffsets[ 0 ];
+		const LOGOG_CHAR *sGroup = ( *site.m_sGroup != '\0' ) ? pText + pSite->m_vOffsets[ 1 ] : NULL;
+		const LOGOG_CHAR *sCategory = ( *site.m_sCategory != '\0' ) ? pText + pSite->m_vOffsets[ 2 ] : NULL;
+
+		Mutex *pMessageCreation = &GetMessageCreationMutex();
+		pMessageCreation->MutexLock();
+		pSite->m_pMessage = new Message( (LOGOG_LEVEL_TYPE)site.m_nLevel, sFileName, site.m_nLineNumber,
+			sGroup, sCategory, LOGOG_CONST_STRING( "" ));
+		pMessageCreation->MutexUnlock();
+
+		m_vSites.push_back( pSite );
+		return pSite;
+	}
+
+	int SocketServer::TransmitDue( bool bAll )
+	{
+		int nTransmitted = 0;
+		LOGOG_UINT64 nNow = GetMonotonicNanoseconds();
+
+		for ( ;; )
+		{
+			ServerConnection *pOldest = NULL;
+			bool bWaiting = false;
+
+			for ( size_t t = 0; t < m_vConnections.size(); t++ )
+			{
+				ServerConnection *pConnection = m_vConnections[ t ];
+
+				if ( pConnection->m_bListener )
+					continue;
+
+				if ( !pConnection->HasRecords() )
+				{
+					/* A stream with nothing queued might yet send something older. */
+					if ( pConnection->m_nSocket != -1 )
+						bWaiting = true;
+				}
+				else if (( pOldest == NULL ) || ( pConnection->m_vRecords[ pConnection->m_nRecordHead ].m_nTime <
+					pOldest->m_vRecords[ pOldest->m_nRecordHead ].m_nTime ))
+					pOldest = pConnection;
+			}
+
+			if ( pOldest == NULL )
+				break;
+
+			const ServerRecord &record = pOldest->m_vRecords[ pOldest->m_nRecordHead ];
+
+			if ( bWaiting && !bAll && ( record.m_nArrival + m_nMergeWindow > nNow ))
+				break;
+
+			FieldSet fields;
+			const LOGOG_CHAR *pText = &pOldest->m_vText[ 0 ];
+
+			for ( size_t t = 0; t < record.m_nFieldCount; t++ )
+			{
+				const ServerField &field = pOldest->m_vFields[ record.m_nFirstField + t ];
+				const LOGOG_CHAR *sKey = pText + field.m_nKey;
+
+				switch ( field.m_Type )
+				{
+				case FIELD_INTEGER:
+					fields.AddValue( sKey, (long long)field.m_nInteger );
+					break;
+				case FIELD_UNSIGNED:
+					fields.AddValue( sKey, (unsigned long long)field.m_nUnsigned );
+					break;
+				case FIELD_FLOAT:
+					fields.AddValue( sKey, field.m_dFloat );
+					break;
+				case FIELD_BOOLEAN:
+					fields.AddValue( sKey, field.m_bBoolean );
+					break;
+				case FIELD_STRING:
+					fields.AddValue( sKey, pText + field.m_nString );
+					break;
+				}
+			}
+
+			Message *pMessage = record.m_pSite->m_pMessage;
+
+			pMessage->m_Transmitting.MutexLock();
+			pMessage->BeginFormat().append( pText + record.m_nText, record.m_nTextLength );
+			pMessage->FormatString( &record.m_pSite->m_vText[ record.m_pSite->m_vOffsets[ 3 ] ] );
+			pMessage->Fields(( record.m_nFieldCount > 0 ) ? &fields : NULL );
+			pMessage->Transmit();
+			pMessage->Fields( NULL );
+			pMessage->m_Transmitting.MutexUnlock();
+
+			m_nMessages++;
+			nTransmitted++;
+
+			if ( ++pOldest->m_nRecordHead == pOldest->m_vRecords.size() )
+			{
+				pOldest->m_vRecords.clear();
+				pOldest->m_vFields.clear();
+				pOldest->m_vText.clear();
+				pOldest->m_nRecordHead = 0;
+			}
+		}
+
+		/* Forget producers that have gone, once their last messages are out. */
+		for ( size_t t = 0; t < m_vConnections.size(); )
+		{
+			ServerConnection *pConnection = m_vConnections[ t ];
+
+			if (( pConnection->m_nSocket == -1 ) && !pConnection->HasRecords() )
+			{
+				delete pConnection;
+				m_vConnections.erase( m_vConnections.begin() + (ptrdiff_t)t );
+			}
+			else
+				t++;
+		}
+
+		return nTransmitted;
+	}
+
+	unsigned int SocketServer::GetWaitTime( unsigned int nMilliseconds )
+	{
+		LOGOG_UINT64 nNow = GetMonotonicNanoseconds();
+
+		for ( size_t t = 0; t < m_vConnections.size(); t++ )
+		{
+			const ServerConnection *pConnection = m_vConnections[ t ];
+
+			if ( !pConnection->HasRecords() )
+				continue;
+
+			/* Each stream's records arrive in order, so its first is the first due. */
+			LOGOG_UINT64 nDue = pConnection->m_vRecords[ pConnection->m_nRecordHead ].m_nArrival + m_nMergeWindow;
+			LOGOG_UINT64 nWait = ( nDue > nNow ) ? ( nDue - nNow + 999999ULL ) / 1000000ULL : 0;
+
+			if ( nWait < nMilliseconds )
+				nMilliseconds = (unsigned int)nWait;
+		}
+
+		return nMilliseconds;
+	}
+
+	int SocketServer::Poll( unsigned int nMilliseconds )
+	{
+		int nReady;
+		ConnectionsType vPolled;
+
+#ifdef LOGOG_SERVER_EPOLL
+		struct epoll_event vEvents[ LOGOG_SERVER_MAX_EVENTS ];
+#endif // LOGOG_SERVER_EPOLL
+		LOGOG_VECTOR< struct pollfd, Allocator< struct pollfd > > vPollers;
+
+		{
+			ScopedLock sl( m_Mutex );
+
+			if ( Open() != 0 )
+				return 0;
+
+			nMilliseconds = GetWaitTime( nMilliseconds );
+
+			if ( m_nPoller == -1 )
+			{
+				/* Without epoll, poll every open socket, with the wake pipe first. */
+				struct pollfd poller;
+				poller.fd = m_vWake[ 0 ];
+				poller.events = POLLIN;
+				poller.revents = 0;
+				vPollers.push_back( poller );
+				vPolled.push_back( NULL );
+
+				for ( size_t t = 0; t < m_vConnections.size(); t++ )
+				{
+					if ( m_vConnections[ t ]->m_nSocket == -1 )
+						continue;
+
+					poller.fd = m_vConnections[ t ]->m_nSocket;
+					vPollers.push_back( poller );
+					vPolled.push_back( m_vConnections[ t ] );
+				}
+			}
+		}
+
+		/* Only this thread removes connections, so those polled stay valid while the lock is released. */
+#ifdef LOGOG_SERVER_EPOLL
+		if ( m_nPoller != -1 )
+		{
+			nReady = epoll_wait( m_nPoller, vEvents, LOGOG_SERVER_MAX_EVENTS, (int)nMilliseconds );
+
+			for ( int t = 0; t < nReady; t++ )
+			{
+				if (( vEvents[ t ].events & ( EPOLLIN | EPOLLHUP | EPOLLERR )) != 0 )
+					vPolled.push_back( (ServerConnection *)vEvents[ t ].data.ptr );
+			}
+		}
+		else
+#endif // LOGOG_SERVER_EPOLL
+		{
+			nReady = poll( &vPollers[ 0 ], (nfds_t)vPollers.size(), (int)nMilliseconds );
+
+			size_t nReadyCount = 0;
+			for ( size_t t = 0; t < vPollers.size(); t++ )
+			{
+				if ( nReady > 0 && ( vPollers[ t ].revents & ( POLLIN | POLLHUP | POLLERR )) != 0 )
+					vPolled[ nReadyCount++ ] = vPolled[ t ];
+			}
+			vPolled.resize( nReadyCount );
+		}
+
+		ScopedLock sl( m_Mutex );
+
+		for ( size_t t = 0; t < vPolled.size(); t++ )
+		{
+			ServerConnection *pConnection = vPolled[ t ];
+
+			if ( pConnection == NULL )
+			{
+				char vDrain[ 64 ];
+				while ( read( m_vWake[ 0 ], vDrain, sizeof( vDrain )) > 0 )
+					;
+			}
+			else if ( pConnection->m_nSocket == -1 )
+				continue;
+			else if ( pConnection->m_bListener )
+				Accept( pConnection );
+			else
+				Read( pConnection );
+		}
+
+		return TransmitDue( false );
+	}
+
+	int SocketServer::Flush()
+	{
+		ScopedLock sl( m_Mutex );
+
+		return TransmitDue( true );
+	}
+
+	void *SocketServer::ServeThread( void *pvServer )
+	{
+		SocketServer *pServer = (SocketServer *)pvServer;
+
+		for ( ;; )
+		{
+			{
+				ScopedLock sl( pServer->m_Mutex );
+
+				if ( pServer->m_bStop )
+					break;
+			}
+
+			pServer->Poll( 1000 );
+		}
+
+		return NULL;
+	}
+
+	int SocketServer::Start()
+	{
+		ScopedLock sl( m_Mutex );
+
+		if ( m_bStarted )
+			return 0;
+
+		if ( Open() != 0 )
+			return -1;
+
+		m_bStop = false;
+		m_bStarted = ( m_ServeThread.Start() == 0 );
+
+		return m_bStarted ? 0 : -1;
+	}
+
+	void SocketServer::Stop()
+	{
+		{
+			ScopedLock sl( m_Mutex );
+
+			if ( !m_bStarted )
+				return;
+
+			m_bStop = true;
+
+			char cWake = 0;
+			if ( write( m_vWake[ 1 ], &cWake, 1 ) < 0 )
+			{
+				/* The pipe is full, so the thread will wake anyway. */
+			}
+		}
+
+		Thread::WaitFor( m_ServeThread );
+
+		ScopedLock sl( m_Mutex );
+		m_bStarted = false;
+	}
+
+	void SocketServer::SetMergeWindow( unsigned int nMilliseconds )
+	{
+		ScopedLock sl( m_Mutex );
+
+		m_nMergeWindow = (LOGOG_UINT64)nMilliseconds * 1000000ULL;
+	}
+
+	size_t SocketServer::GetConnectionCount()
+	{
+		ScopedLock sl( m_Mutex );
+
+		size_t nConnections = 0;
+
+		for ( size_t t = 0; t < m_vConnections.size(); t++ )
+			if ( !m_vConnections[ t ]->m_bListener && ( m_vConnections[ t ]->m_nSocket != -1 ))
+				nConnections++;
+
+		return nConnections;
+	}
+
+	LOGOG_UINT64 SocketServer::GetMessageCount()
+	{
+		ScopedLock sl( m_Mutex );
+
+		return m_nMessages;
+	}
+
+	LOGOG_UINT64 SocketServer::GetSkippedCount()
+	{
+		ScopedLock sl( m_Mutex );
+
+		return m_nSkipped;
+	}
+
+#endif // LOGOG_FLAVOR_POSIX
+}
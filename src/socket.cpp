@@ -1,10 +1,699 @@
-/* 
+/*
  * \file socket.cpp
  */
 
 #include "logog.hpp"
 
+#include <cerrno>
+#include <cstring>
+
+#ifdef LOGOG_FLAVOR_POSIX
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <stddef.h>
+#endif // LOGOG_FLAVOR_POSIX
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
 namespace logog {
-	bool sb_AvoidLinkError4221_socket_cpp = false;
-}
 
+	/** Returns the error from the last failed socket call. */
+	static int GetSocketError()
+	{
+#ifdef LOGOG_FLAVOR_WINDOWS
+		return WSAGetLastError();
+#else // LOGOG_FLAVOR_WINDOWS
+		return errno;
+#endif // LOGOG_FLAVOR_WINDOWS
+	}
+
+	/** Does the error mean that the socket can't take any more just now? */
+	static bool IsWouldBlock( int nError )
+	{
+#ifdef LOGOG_FLAVOR_WINDOWS
+		return ( nError == WSAEWOULDBLOCK ) || ( nError == WSAENOBUFS );
+#else // LOGOG_FLAVOR_WINDOWS
+		return ( nError == EAGAIN ) || ( nError == EWOULDBLOCK ) || ( nError == ENOBUFS );
+#endif // LOGOG_FLAVOR_WINDOWS
+	}
+
+	/** Does the error mean that the call was interrupted, and should be repeated? */
+	static bool IsInterrupted( int nError )
+	{
+#ifdef LOGOG_FLAVOR_WINDOWS
+		return ( nError == WSAEINTR );
+#else // LOGOG_FLAVOR_WINDOWS
+		return ( nError == EINTR );
+#endif // LOGOG_FLAVOR_WINDOWS
+	}
+
+	/** Does the error mean that the message was too big to send as a datagram? */
+	static bool IsTooBig( int nError )
+	{
+#ifdef LOGOG_FLAVOR_WINDOWS
+		return ( nError == WSAEMSGSIZE );
+#else // LOGOG_FLAVOR_WINDOWS
+		return ( nError == EMSGSIZE );
+#endif // LOGOG_FLAVOR_WINDOWS
+	}
+
+	int Socket::InitializeSockets()
+	{
+		if ( Static().s_nSockets++ == 0 )
+		{
+#ifdef LOGOG_FLAVOR_WINDOWS
+			WORD wVersionRequested;
+			WSADATA wsaData;
+			int err;
+			wVersionRequested = MAKEWORD( 2, 2 );
+
+			err = WSAStartup( wVersionRequested, &wsaData );
+
+			if ( err != 0 )
+			{
+#ifdef LOGOG_INTERNAL_DEBUGGING
+				LOGOG_COUT << _LG("WSAStartup failed with error: ") <<  err << endl;
+#endif
+				Static().s_nSockets--;
+				return 1;
+			}
+#endif // LOGOG_FLAVOR_WINDOWS
+		}
+
+		return 0;
+	}
+
+	void Socket::ShutdownSockets()
+	{
+		if (( Static().s_nSockets > 0 ) && ( --Static().s_nSockets == 0 ))
+		{
+#ifdef LOGOG_FLAVOR_WINDOWS
+			WSACleanup();
+#endif // LOGOG_FLAVOR_WINDOWS
+		}
+	}
+
+	Socket::Socket( int type, int port )
+	{
+		Construct( "127.0.0.1", type, port );
+	}
+
+	Socket::Socket( const char *sAddress, int type, int port )
+	{
+		Construct( sAddress, type, port );
+	}
+
+	void Socket::Construct( const char *sAddress, int type, int port )
+	{
+		InitializeSockets();
+
+		m_Socket = -1;
+		m_nType = type;
+		m_nPort = port;
+		m_nState = STATE_CLOSED;
+		m_nQueueHead = 0;
+		m_nQueueSent = 0;
+		m_nQueuedBytes = 0;
+		m_nQueueLimit = LOGOG_DEFAULT_SOCKET_QUEUE_SIZE;
+		m_nDropped = 0;
+		m_nStreamSent = 0;
+		m_nRetryTime = 0;
+		m_nRetryDelay = LOGOG_SOCKET_RETRY_MIN;
+
+		size_t nAddressLength = strlen( sAddress ) + 1;
+		m_pAddress = (char *)Object::Allocate( nAddressLength );
+		memcpy( m_pAddress, sAddress, nAddressLength );
+
+		m_bNullTerminatesStrings = false;
+		SetName( LOGOG_CONST_STRING( "socket" ));
+	}
+
+	Socket::~Socket()
+	{
+		Flush();
+		Close();
+
+		Object::Deallocate( m_pAddress );
+
+		ShutdownSockets();
+	}
+
+	void Socket::Close()
+	{
+		if ( m_Socket != -1 )
+		{
+#ifdef LOGOG_FLAVOR_WINDOWS
+			closesocket( m_Socket );
+#endif
+#ifdef LOGOG_FLAVOR_POSIX
+			close( m_Socket );
+#endif
+		}
+
+		m_Socket = -1;
+		m_nState = STATE_CLOSED;
+	}
+
+	int Socket::Create()
+	{
+		Close();
+
+		/* Big enough, and aligned enough, for any address. */
+		union
+		{
+			struct sockaddr generic;
+#ifdef LOGOG_FLAVOR_POSIX
+			struct sockaddr_storage storage;
+			struct sockaddr_un local;
+#else // LOGOG_FLAVOR_POSIX
+			struct sockaddr_in internet;
+#endif // LOGOG_FLAVOR_POSIX
+		} address;
+		int nFamily;
+		int nAddressLength;
+
+		memset( &address, 0, sizeof( address ));
+
+#ifdef LOGOG_FLAVOR_POSIX
+		if ( strchr( m_pAddress, '/' ) != NULL )
+		{
+			size_t nPathLength = strlen( m_pAddress );
+
+			if ( nPathLength >= sizeof( address.local.sun_path ))
+				return -1;
+
+			nFamily = AF_UNIX;
+			address.local.sun_family = AF_UNIX;
+			memcpy( address.local.sun_path, m_pAddress, nPathLength + 1 );
+			nAddressLength = (int)( offsetof( struct sockaddr_un, sun_path ) + nPathLength + 1 );
+		}
+		else
+		{
+			struct addrinfo hints;
+			struct addrinfo *pInfo;
+			char sPort[ 16 ];
+
+			memset( &hints, 0, sizeof( hints ));
+			hints.ai_family = AF_UNSPEC;
+			hints.ai_socktype = m_nType;
+			snprintf( sPort, sizeof( sPort ), "%d", m_nPort );
+
+			if (( getaddrinfo( m_pAddress, sPort, &hints, &pInfo ) != 0 ) || ( pInfo == NULL ))
+				return -1;
+
+			nFamily = pInfo->ai_family;
+			nAddressLength = (int)pInfo->ai_addrlen;
+			memcpy( &address, pInfo->ai_addr, pInfo->ai_addrlen );
+			freeaddrinfo( pInfo );
+		}
+#else // LOGOG_FLAVOR_POSIX
+		nFamily = AF_INET;
+		nAddressLength = sizeof( address.internet );
+		address.internet.sin_family = AF_INET;
+		address.internet.sin_port = htons( (u_short)m_nPort );
+		address.internet.sin_addr.s_addr = inet_addr( m_pAddress );
+
+		if ( address.internet.sin_addr.s_addr == INADDR_NONE )
+		{
+			struct hostent *hp = gethostbyname( m_pAddress );
+
+			if ( hp == NULL || hp->h_addrtype != AF_INET )
+				return -1;
+
+			memcpy( &address.internet.sin_addr, hp->h_addr, sizeof( address.internet.sin_addr ));
+		}
+#endif // LOGOG_FLAVOR_POSIX
+
+		m_Socket = (int)socket( nFamily, m_nType, 0 );
+
+		if ( m_Socket == -1 )
+			return -1;
+
+#ifdef LOGOG_FLAVOR_POSIX
+		fcntl( m_Socket, F_SETFD, FD_CLOEXEC );
+#ifdef SO_NOSIGPIPE
+		/* Where there is no MSG_NOSIGNAL, a collector that goes away must not kill the process instead. */
+		int nOn = 1;
+		setsockopt( m_Socket, SOL_SOCKET, SO_NOSIGPIPE, &nOn, sizeof( nOn ));
+#endif // SO_NOSIGPIPE
+#endif // LOGOG_FLAVOR_POSIX
+
+		if ( SetNonBlocking() != 0 )
+		{
+			Close();
+			return -1;
+		}
+
+		if ( connect( m_Socket, &address.generic, nAddressLength ) == 0 )
+		{
+			m_nState = STATE_CONNECTED;
+			Connected();
+			return 0;
+		}
+
+		int nError = GetSocketError();
+
+#ifdef LOGOG_FLAVOR_WINDOWS
+		if ( nError == WSAEWOULDBLOCK )
+#else // LOGOG_FLAVOR_WINDOWS
+		if (( nError == EINPROGRESS ) || ( nError == EINTR ))
+#endif // LOGOG_FLAVOR_WINDOWS
+		{
+			m_nState = STATE_CONNECTING;
+			return 0;
+		}
+
+		Close();
+		return -1;
+	}
+
+	int Socket::SetNonBlocking()
+	{
+		int err;
+
+#ifdef LOGOG_FLAVOR_POSIX
+		int flags;
+		flags = fcntl( m_Socket, F_GETFL, 0 );
+		flags |= O_NONBLOCK;
+		err = ( fcntl( m_Socket, F_SETFL, flags ) == -1 ) ? -1 : 0;
+#endif
+
+#ifdef LOGOG_FLAVOR_WINDOWS
+		unsigned long parg;
+		parg = 1;
+		err = ioctlsocket( m_Socket, FIONBIO, &parg );
+#endif
+		return err;
+	}
+
+	int Socket::Output( const LOGOG_STRING &output )
+	{
+		return Enqueue( (const unsigned char *)output.c_str(), output.size() * sizeof( LOGOG_CHAR ));
+	}
+
+	int Socket::Enqueue( const unsigned char *pData, size_t nLength )
+	{
+		/* Make room first, if the collector has caught up. */
+		if ( m_nQueuedBytes + nLength > m_nQueueLimit )
+			SendQueue();
+
+		if ( m_nQueuedBytes + nLength > m_nQueueLimit )
+		{
+			m_nDropped++;
+			return -1;
+		}
+
+		unsigned int nMessageLength = (unsigned int)nLength;
+		const unsigned char *pLength = (const unsigned char *)&nMessageLength;
+
+		m_vQueue.insert( m_vQueue.end(), pLength, pLength + sizeof( nMessageLength ));
+		m_vQueue.insert( m_vQueue.end(), pData, pData + nLength );
+		m_nQueuedBytes += nLength;
+
+		SendQueue();
+
+		return 0;
+	}
+
+	int Socket::Flush()
+	{
+		ScopedLock sl( m_MutexReceive );
+
+		LOGOG_UINT64 nDeadline = GetMonotonicNanoseconds() +
+			(LOGOG_UINT64)LOGOG_DEFAULT_SOCKET_FLUSH_TIMEOUT * 1000000ULL;
+
+		for ( ;; )
+		{
+			SendQueue();
+
+			if ( m_nQueueHead == m_vQueue.size() )
+				return 0;
+
+			/* Closed, and waiting to try again later. */
+			if ( m_nState == STATE_CLOSED )
+				return -1;
+
+			LOGOG_UINT64 nNow = GetMonotonicNanoseconds();
+
+			if ( nNow >= nDeadline )
+				return -1;
+
+			WaitForWritable( (unsigned int)(( nDeadline - nNow ) / 1000000ULL ) + 1 );
+		}
+	}
+
+	void Socket::SetQueueLimit( size_t nBytes )
+	{
+		ScopedLock sl( m_MutexReceive );
+
+		m_nQueueLimit = nBytes;
+	}
+
+	LOGOG_UINT64 Socket::GetDroppedCount()
+	{
+		ScopedLock sl( m_MutexReceive );
+
+		return m_nDropped;
+	}
+
+	size_t Socket::GetQueuedBytes()
+	{
+		ScopedLock sl( m_MutexReceive );
+
+		return m_nQueuedBytes;
+	}
+
+	bool Socket::IsConnected()
+	{
+		ScopedLock sl( m_MutexReceive );
+
+		return ( m_nState == STATE_CONNECTED );
+	}
+
+	void Socket::SendQueue()
+	{
+		if ( m_nQueueHead == m_vQueue.size() )
+			return;
+
+		if ( m_nState == STATE_CLOSED )
+		{
+			if ( GetMonotonicNanoseconds() < m_nRetryTime )
+				return;
+
+			if ( Create() != 0 )
+			{
+				Disconnect();
+				return;
+			}
+		}
+
+		if (( m_nState == STATE_CONNECTING ) && !FinishConnecting() )
+			return;
+
+		if ( m_nState != STATE_CONNECTED )
+			return;
+
+		if ( m_nType == SOCK_DGRAM )
+			SendDatagrams();
+		else
+			SendStream();
+
+		/* Reclaim the space of sent messages once it is worth the copy. */
+		if ( m_nQueueHead == m_vQueue.size() )
+		{
+			m_vQueue.clear();
+			m_nQueueHead = 0;
+		}
+		else if (( m_nQueueHead >= 64 * 1024 ) && ( m_nQueueHead * 2 >= m_vQueue.size() ))
+		{
+			m_vQueue.erase( m_vQueue.begin(), m_vQueue.begin() + (ptrdiff_t)m_nQueueHead );
+			m_nQueueHead = 0;
+		}
+	}
+
+	bool Socket::SendDatagrams()
+	{
+		while ( m_nQueueHead < m_vQueue.size() )
+		{
+			int nSent;
+
+#ifdef __linux__
+			struct mmsghdr vMessages[ LOGOG_SOCKET_BATCH ];
+			struct iovec vVectors[ LOGOG_SOCKET_BATCH ];
+			unsigned int nCount = 0;
+			size_t nPosition = m_nQueueHead;
+
+			while (( nCount < LOGOG_SOCKET_BATCH ) && ( nPosition < m_vQueue.size() ))
+			{
+				size_t nLength;
+				const unsigned char *pMessage = PeekMessage( nPosition, nLength );
+
+				vVectors[ nCount ].iov_base = (void *)pMessage;
+				vVectors[ nCount ].iov_len = nLength;
+				memset( &vMessages[ nCount ], 0, sizeof( vMessages[ nCount ] ));
+				vMessages[ nCount ].msg_hdr.msg_iov = &vVectors[ nCount ];
+				vMessages[ nCount ].msg_hdr.msg_iovlen = 1;
+
+				nPosition += sizeof( unsigned int ) + nLength;
+				nCount++;
+			}
+
+			nSent = sendmmsg( m_Socket, vMessages, nCount, MSG_NOSIGNAL );
+#else // __linux__
+			size_t nLength;
+			const unsigned char *pMessage = PeekMessage( m_nQueueHead, nLength );
+
+			nSent = ( send( m_Socket, (const char *)pMessage, (int)nLength, MSG_NOSIGNAL ) < 0 ) ? -1 : 1;
+#endif // __linux__
+
+			if ( nSent < 0 )
+			{
+				int nError = GetSocketError();
+
+				if ( IsInterrupted( nError ))
+					continue;
+
+				if ( IsWouldBlock( nError ))
+					return true;
+
+				if ( IsTooBig( nError ))
+				{
+					PopMessage();
+					m_nDropped++;
+					continue;
+				}
+
+				Disconnect();
+				return false;
+			}
+
+			for ( int t = 0; t < nSent; t++ )
+				PopMessage();
+
+			m_nRetryDelay = LOGOG_SOCKET_RETRY_MIN;
+		}
+
+		return true;
+	}
+
+	bool Socket::SendStream()
+	{
+		while ( m_nQueueHead < m_vQueue.size() )
+		{
+			long nSent;
+
+#ifdef LOGOG_FLAVOR_POSIX
+			struct iovec vVectors[ LOGOG_SOCKET_BATCH ];
+			int nCount = 0;
+			size_t nPosition = m_nQueueHead;
+
+			while (( nCount < LOGOG_SOCKET_BATCH ) && ( nPosition < m_vQueue.size() ))
+			{
+				size_t nLength;
+				const unsigned char *pMessage = PeekMessage( nPosition, nLength );
+				size_t nSkip = ( nCount == 0 ) ? m_nQueueSent : 0;
+
+				vVectors[ nCount ].iov_base = (void *)( pMessage + nSkip );
+				vVectors[ nCount ].iov_len = nLength - nSkip;
+
+				nPosition += sizeof( unsigned int ) + nLength;
+				nCount++;
+			}
+
+			struct msghdr message;
+			memset( &message, 0, sizeof( message ));
+			message.msg_iov = vVectors;
+			message.msg_iovlen = nCount;
+
+			nSent = (long)sendmsg( m_Socket, &message, MSG_NOSIGNAL );
+#else // LOGOG_FLAVOR_POSIX
+			size_t nLength;
+			const unsigned char *pMessage = PeekMessage( m_nQueueHead, nLength );
+
+			nSent = send( m_Socket, (const char *)( pMessage + m_nQueueSent ), (int)( nLength - m_nQueueSent ), 0 );
+#endif // LOGOG_FLAVOR_POSIX
+
+			if ( nSent < 0 )
+			{
+				int nError = GetSocketError();
+
+				if ( IsInterrupted( nError ))
+					continue;
+
+				if ( IsWouldBlock( nError ))
+					return true;
+
+				Disconnect();
+				return false;
+			}
+
+			/* Retire every message sent in full, and remember how much of the next one went. */
+			size_t nRemaining = (size_t)nSent;
+			m_nStreamSent += (LOGOG_UINT64)nSent;
+
+			while ( nRemaining > 0 )
+			{
+				size_t nLength;
+				PeekMessage( m_nQueueHead, nLength );
+
+				if ( nRemaining < nLength - m_nQueueSent )
+				{
+					m_nQueueSent += nRemaining;
+					break;
+				}
+
+				nRemaining -= nLength - m_nQueueSent;
+				PopMessage();
+			}
+
+			/* Messages of no bytes at all are sent as soon as they are reached. */
+			while ( m_nQueueHead < m_vQueue.size() )
+			{
+				size_t nLength;
+				PeekMessage( m_nQueueHead, nLength );
+
+				if ( nLength != 0 )
+					break;
+
+				PopMessage();
+			}
+
+			m_nRetryDelay = LOGOG_SOCKET_RETRY_MIN;
+		}
+
+		return true;
+	}
+
+	bool Socket::FinishConnecting()
+	{
+		bool bReady;
+		int nError = 0;
+
+#ifdef LOGOG_FLAVOR_POSIX
+		struct pollfd poller;
+		poller.fd = m_Socket;
+		poller.events = POLLOUT;
+		poller.revents = 0;
+
+		bReady = ( poll( &poller, 1, 0 ) > 0 );
+
+		if ( bReady )
+		{
+			socklen_t nErrorLength = sizeof( nError );
+
+			if ( getsockopt( m_Socket, SOL_SOCKET, SO_ERROR, &nError, &nErrorLength ) != 0 )
+				nError = -1;
+		}
+#else // LOGOG_FLAVOR_POSIX
+		fd_set writable, failed;
+		struct timeval tv = { 0, 0 };
+
+		FD_ZERO( &writable );
+		FD_ZERO( &failed );
+		FD_SET( (SOCKET)m_Socket, &writable );
+		FD_SET( (SOCKET)m_Socket, &failed );
+
+		bReady = ( select( 0, NULL, &writable, &failed, &tv ) > 0 );
+
+		if ( bReady && FD_ISSET( (SOCKET)m_Socket, &failed ))
+			nError = -1;
+#endif // LOGOG_FLAVOR_POSIX
+
+		if ( !bReady )
+			return true;
+
+		if ( nError != 0 )
+		{
+			Disconnect();
+			return false;
+		}
+
+		m_nState = STATE_CONNECTED;
+		Connected();
+		return true;
+	}
+
+	void Socket::Connected()
+	{
+	}
+
+	void Socket::WaitForWritable( unsigned int nMilliseconds )
+	{
+		if ( m_Socket == -1 )
+			return;
+
+#ifdef LOGOG_FLAVOR_POSIX
+		struct pollfd poller;
+		poller.fd = m_Socket;
+		poller.events = POLLOUT;
+		poller.revents = 0;
+
+		poll( &poller, 1, (int)nMilliseconds );
+#else // LOGOG_FLAVOR_POSIX
+		fd_set writable;
+		struct timeval tv;
+
+		tv.tv_sec = (long)( nMilliseconds / 1000 );
+		tv.tv_usec = (long)(( nMilliseconds % 1000 ) * 1000 );
+
+		FD_ZERO( &writable );
+		FD_SET( (SOCKET)m_Socket, &writable );
+
+		select( 0, NULL, &writable, NULL, &tv );
+#endif // LOGOG_FLAVOR_POSIX
+	}
+
+	void Socket::Disconnect()
+	{
+		Close();
+
+		/* A stream starts again with a whole message, rather than with the rest of one the collector never saw. */
+		m_nQueueSent = 0;
+
+		m_nRetryTime = GetMonotonicNanoseconds() + (LOGOG_UINT64)m_nRetryDelay * 1000000ULL;
+
+		m_nRetryDelay *= 2;
+		if ( m_nRetryDelay > LOGOG_SOCKET_RETRY_MAX )
+			m_nRetryDelay = LOGOG_SOCKET_RETRY_MAX;
+	}
+
+	void Socket::PopMessage()
+	{
+		size_t nLength;
+		PeekMessage( m_nQueueHead, nLength );
+
+		m_nQueueHead += sizeof( unsigned int ) + nLength;
+		m_nQueuedBytes -= nLength;
+		m_nQueueSent = 0;
+	}
+
+	void Socket::DropQueue()
+	{
+		while ( m_nQueueHead < m_vQueue.size() )
+		{
+			PopMessage();
+			m_nDropped++;
+		}
+
+		m_vQueue.clear();
+		m_nQueueHead = 0;
+	}
+
+	const unsigned char *Socket::PeekMessage( size_t nPosition, size_t &nLength ) const
+	{
+		unsigned int nMessageLength;
+		const unsigned char *pLength = &m_vQueue[ 0 ] + nPosition;
+
+		memcpy( &nMessageLength, pLength, sizeof( nMessageLength ));
+		nLength = nMessageLength;
+
+		return pLength + sizeof( nMessageLength );
+	}
+}
@@ -12,6 +12,7 @@ namespace logog {
 		s_pAllSubscriberNodes = NULL;
 		s_pAllFilterNodes = NULL;
 		s_pAllTargets = NULL;
+		s_pAllMessages = NULL;
 		s_pTimer = NULL;
 		s_pDefaultFormatter = NULL;
 		s_pDefaultFilter = NULL;
@@ -21,10 +22,13 @@ namespace logog {
 		s_pfFree = NULL;
 		s_pSelf = this;
 		s_nSockets = 0;
+		s_nTransmitting = 0;
 	}
 
 	void Statics::Reset()
 	{
+		/* Delivery threads call their targets, so they must stop before anything is destroyed. */
+		StopDeliveryQueues( false );
 		DestroyGlobalTimer();
 		DestroyDefaultFormatter();
 		s_pDefaultFilter = NULL; // This will be destroyed on the next step
@@ -34,6 +38,7 @@ namespace logog {
 		s_pfMalloc = NULL;
 		s_pfFree = NULL;
 		s_nSockets = 0;
+		s_nTransmitting = 0;
 	}
 
 	Statics::~Statics()
@@ -0,0 +1,416 @@
+/*
+ * \file stats.cpp
+ */
+
+#include "logog.hpp"
+
+namespace logog {
+
+#ifdef LOGOG_STATISTICS
+	LOGOG_UINT64 s_nStatisticsAllocations = 0;
+	LOGOG_UINT64 s_nStatisticsDeallocations = 0;
+	LOGOG_UINT64 s_nStatisticsBytesAllocated = 0;
+#endif // LOGOG_STATISTICS
+
+	void ResetTargetStatistics( TargetStatistics &stats )
+	{
+		stats.m_nMessages = 0;
+		stats.m_nBytes = 0;
+		stats.m_nErrors = 0;
+
+		for ( int i = 0; i < LOGOG_STATISTICS_LATENCY_BUCKETS; i++ )
+			stats.m_vOutputLatency[ i ] = 0;
+
+		stats.m_nQueued = 0;
+		stats.m_nDropped = 0;
+		stats.m_nLagNanoseconds = 0;
+		stats.m_nMaxLagNanoseconds = 0;
+	}
+
+	void RecordTargetOutput( TargetStatistics &stats, size_t nBytes, LOGOG_UINT64 nNanoseconds, int nError )
+	{
+		/* The bucket is the position of the highest set bit, i.e. floor( log2( nNanoseconds )). */
+		int nBucket = 0;
+#ifdef __GNUC__
+		if ( nNanoseconds > 1 )
+			nBucket = 63 - __builtin_clzll( nNanoseconds );
+#else // __GNUC__
+		while (( nNanoseconds >>= 1 ) != 0 )
+			nBucket++;
+#endif // __GNUC__
+		if ( nBucket >= LOGOG_STATISTICS_LATENCY_BUCKETS )
+			nBucket = LOGOG_STATISTICS_LATENCY_BUCKETS - 1;
+
+		LOGOG_ATOMIC_ADD( &stats.m_nMessages, 1 );
+		LOGOG_ATOMIC_ADD( &stats.m_nBytes, nBytes );
+		LOGOG_ATOMIC_ADD( &stats.m_vOutputLatency[ nBucket ], 1 );
+
+		if ( nError != 0 )
+			LOGOG_ATOMIC_ADD( &stats.m_nErrors, 1 );
+	}
+
+	LOGOG_UINT64 Statistics::TargetEntry::OutputLatencyPercentile( double dPercentile ) const
+	{
+		LOGOG_UINT64 nTotal = 0;
+
+		for ( int i = 0; i < LOGOG_STATISTICS_LATENCY_BUCKETS; i++ )
+			nTotal += m_Counters.m_vOutputLatency[ i ];
+
+		if ( nTotal == 0 )
+			return 0;
+
+		LOGOG_UINT64 nRank = (LOGOG_UINT64)( dPercentile * (double)nTotal );
+		if ( nRank >= nTotal )
+			nRank = nTotal - 1;
+
+		LOGOG_UINT64 nSeen = 0;
+		for ( int i = 0; i < LOGOG_STATISTICS_LATENCY_BUCKETS; i++ )
+		{
+			nSeen += m_Counters.m_vOutputLatency[ i ];
+			if ( nSeen > nRank )
+				return ((LOGOG_UINT64)1) << ( i + 1 );
+		}
+
+		return ((LOGOG_UINT64)1) << LOGOG_STATISTICS_LATENCY_BUCKETS;
+	}
+
+	Statistics::Statistics()
+	{
+		Clear();
+	}
+
+	void Statistics::Clear()
+	{
+		m_bEnabled = false;
+		m_nAllocations = 0;
+		m_nDeallocations = 0;
+		m_nBytesAllocated = 0;
+		m_MessageCreationLock.m_nAcquisitions = 0;
+		m_MessageCreationLock.m_nContendedAcquisitions = 0;
+		m_MessageCreationLock.m_nWaitNanoseconds = 0;
+		m_vTargets.clear();
+		m_vMessages.clear();
+	}
+
+	const Statistics::TargetEntry *Statistics::GetSlowestTarget() const
+	{
+		const TargetEntry *pSlowest = NULL;
+
+		for ( TargetEntriesType::const_iterator it = m_vTargets.begin(); it != m_vTargets.end(); ++it )
+		{
+			if (( it->m_nLag == 0 ) && ( it->m_Counters.m_nMaxLagNanoseconds == 0 ))
+				continue;
+
+			if (( pSlowest == NULL ) ||
+				( it->m_nLag > pSlowest->m_nLag ) ||
+				(( it->m_nLag == pSlowest->m_nLag ) &&
+				( it->m_Counters.m_nMaxLagNanoseconds > pSlowest->m_Counters.m_nMaxLagNanoseconds )))
+				pSlowest = &*it;
+		}
+
+		return pSlowest;
+	}
+
+	/* Appends a string to out, enlarging out as needed. */
+	static void AppendGrowing( LOGOG_STRING &out, const LOGOG_CHAR *pChars )
+	{
+		size_t nLength = String::Length( pChars );
+
+		if ( out.size() + nLength + 1 > out.capacity() )
+			out.grow( 2 * ( out.size() + nLength + 1 ) + 256 );
+
+		out.append( pChars );
+	}
+
+	static void AppendGrowing( LOGOG_STRING &out, LOGOG_UINT64 nValue )
+	{
+		LOGOG_CHAR vDigits[ 24 ];
+		LOGOG_CHAR *pDigit = vDigits + 23;
+
+		*pDigit = (LOGOG_CHAR)'\0';
+		do
+		{
+			*--pDigit = (LOGOG_CHAR)( '0' + ( nValue % 10 ));
+			nValue /= 10;
+		}
+		while ( nValue != 0 );
+
+		AppendGrowing( out, pDigit );
+	}
+
+	/* Appends a quoted JSON string, escaping quotes, backslashes and control characters. */
+	static void AppendJSONString( LOGOG_STRING &out, const LOGOG_CHAR *pChars )
+	{
+		AppendGrowing( out, LOGOG_CONST_STRING( "\"" ));
+
+		if ( pChars != NULL )
+		{
+			LOGOG_CHAR vEscape[ 8 ];
+
+			for ( ; *pChars != (LOGOG_CHAR)'\0'; pChars++ )
+			{
+				LOGOG_CHAR c = *pChars;
+
+				if (( c == (LOGOG_CHAR)'"' ) || ( c == (LOGOG_CHAR)'\\' ))
+				{
+					vEscape[ 0 ] = (LOGOG_CHAR)'\\';
+					vEscape[ 1 ] = c;
+					vEscape[ 2 ] = (LOGOG_CHAR)'\0';
+				}
+				else if (( c >= 0 ) && ( c < 0x20 ))
+				{
+					vEscape[ 0 ] = (LOGOG_CHAR)'\\';
+					vEscape[ 1 ] = (LOGOG_CHAR)'u';
+					vEscape[ 2 ] = (LOGOG_CHAR)'0';
+					vEscape[ 3 ] = (LOGOG_CHAR)'0';
+					vEscape[ 4 ] = _LG("0123456789abcdef")[ ( c >> 4 ) & 0xf ];
+					vEscape[ 5 ] = _LG("0123456789abcdef")[ c & 0xf ];
+					vEscape[ 6 ] = (LOGOG_CHAR)'\0';
+				}
+				else
+				{
+					vEscape[ 0 ] = c;
+					vEscape[ 1 ] = (LOGOG_CHAR)'\0';
+				}
+
+				AppendGrowing( out, vEscape );
+			}
+		}
+
+		AppendGrowing( out, LOGOG_CONST_STRING( "\"" ));
+	}
+
+	static void AppendLockText( LOGOG_STRING &out, const MutexStatistics &lock )
+	{
+		AppendGrowing( out, lock.m_nAcquisitions );
+		AppendGrowing( out, LOGOG_CONST_STRING( " acquisitions, " ));
+		AppendGrowing( out, lock.m_nContendedAcquisitions );
+		AppendGrowing( out, LOGOG_CONST_STRING( " contended, " ));
+		AppendGrowing( out, lock.m_nWaitNanoseconds );
+		AppendGrowing( out, LOGOG_CONST_STRING( " ns waiting" ));
+	}
+
+	static void AppendLockJSON( LOGOG_STRING &out, const MutexStatistics &lock )
+	{
+		AppendGrowing( out, LOGOG_CONST_STRING( "{\"acquisitions\":" ));
+		AppendGrowing( out, lock.m_nAcquisitions );
+		AppendGrowing( out, LOGOG_CONST_STRING( ",\"contended\":" ));
+		AppendGrowing( out, lock.m_nContendedAcquisitions );
+		AppendGrowing( out, LOGOG_CONST_STRING( ",\"wait_ns\":" ));
+		AppendGrowing( out, lock.m_nWaitNanoseconds );
+		AppendGrowing( out, LOGOG_CONST_STRING( "}" ));
+	}
+
+	void Statistics::RenderText( LOGOG_STRING &out ) const
+	{
+		out.clear();
+
+		if ( !m_bEnabled )
+		{
+			AppendGrowing( out, LOGOG_CONST_STRING( "statistics: disabled; compile with LOGOG_STATISTICS\n" ));
+			out.append( (LOGOG_CHAR)'\0' );
+			return;
+		}
+
+		AppendGrowing( out, LOGOG_CONST_STRING( "allocator: " ));
+		AppendGrowing( out, m_nAllocations );
+		AppendGrowing( out, LOGOG_CONST_STRING( " allocations, " ));
+		AppendGrowing( out, m_nDeallocations );
+		AppendGrowing( out, LOGOG_CONST_STRING( " deallocations, " ));
+		AppendGrowing( out, m_nBytesAllocated );
+		AppendGrowing( out, LOGOG_CONST_STRING( " bytes\nmessage creation lock: " ));
+		AppendLockText( out, m_MessageCreationLock );
+		AppendGrowing( out, LOGOG_CONST_STRING( "\n" ));
+
+		for ( TargetEntriesType::const_iterator it = m_vTargets.begin(); it != m_vTargets.end(); ++it )
+		{
+			AppendGrowing( out, LOGOG_CONST_STRING( "target " ));
+			AppendGrowing( out, it->m_sName );
+			AppendGrowing( out, LOGOG_CONST_STRING( ": " ));
+			AppendGrowing( out, it->m_Counters.m_nMessages );
+			AppendGrowing( out, LOGOG_CONST_STRING( " messages, " ));
+			AppendGrowing( out, it->m_Counters.m_nBytes );
+			AppendGrowing( out, LOGOG_CONST_STRING( " bytes, " ));
+			AppendGrowing( out, it->m_Counters.m_nErrors );
+			AppendGrowing( out, LOGOG_CONST_STRING( " errors; output p50 " ));
+			AppendGrowing( out, it->OutputLatencyPercentile( 0.5 ));
+			AppendGrowing( out, LOGOG_CONST_STRING( " ns, p99 " ));
+			AppendGrowing( out, it->OutputLatencyPercentile( 0.99 ));
+			AppendGrowing( out, LOGOG_CONST_STRING( " ns, p999 " ));
+			AppendGrowing( out, it->OutputLatencyPercentile( 0.999 ));
+			AppendGrowing( out, LOGOG_CONST_STRING( " ns; receive lock: " ));
+			AppendLockText( out, it->m_ReceiveLock );
+
+			if ( it->m_Counters.m_nQueued != 0 )
+			{
+				AppendGrowing( out, LOGOG_CONST_STRING( "; queue: " ));
+				AppendGrowing( out, (LOGOG_UINT64)it->m_nWaiting );
+				AppendGrowing( out, LOGOG_CONST_STRING( " waiting, lag " ));
+				AppendGrowing( out, it->m_nLag );
+				AppendGrowing( out, LOGOG_CONST_STRING( " ns, max lag " ));
+				AppendGrowing( out, it->m_Counters.m_nMaxLagNanoseconds );
+				AppendGrowing( out, LOGOG_CONST_STRING( " ns, " ));
+				AppendGrowing( out, it->m_Counters.m_nDropped );
+				AppendGrowing( out, LOGOG_CONST_STRING( " dropped" ));
+			}
+
+			AppendGrowing( out, LOGOG_CONST_STRING( "\n" ));
+		}
+
+		const TargetEntry *pSlowest = GetSlowestTarget();
+
+		if ( pSlowest != NULL )
+		{
+			AppendGrowing( out, LOGOG_CONST_STRING( "slowest target: " ));
+			AppendGrowing( out, pSlowest->m_sName );
+			AppendGrowing( out, LOGOG_CONST_STRING( ", lag " ));
+			AppendGrowing( out, pSlowest->m_nLag );
+			AppendGrowing( out, LOGOG_CONST_STRING( " ns\n" ));
+		}
+
+		for ( MessageEntriesType::const_iterator it = m_vMessages.begin(); it != m_vMessages.end(); ++it )
+		{
+			AppendGrowing( out, LOGOG_CONST_STRING( "message " ));
+			AppendGrowing( out, it->m_sFileName ? it->m_sFileName : LOGOG_CONST_STRING( "?" ));
+			AppendGrowing( out, LOGOG_CONST_STRING( ":" ));
+			AppendGrowing( out, (LOGOG_UINT64)it->m_nLineNumber );
+			AppendGrowing( out, LOGOG_CONST_STRING( ": " ));
+			AppendGrowing( out, it->m_nHits );
+			AppendGrowing( out, LOGOG_CONST_STRING( " hits; transmit lock: " ));
+			AppendLockText( out, it->m_TransmitLock );
+			AppendGrowing( out, LOGOG_CONST_STRING( "\n" ));
+		}
+
+		out.append( (LOGOG_CHAR)'\0' );
+	}
+
+	void Statistics::RenderJSON( LOGOG_STRING &out ) const
+	{
+		out.clear();
+
+		AppendGrowing( out, LOGOG_CONST_STRING( "{\"enabled\":" ));
+		AppendGrowing( out, m_bEnabled ? LOGOG_CONST_STRING( "true" ) : LOGOG_CONST_STRING( "false" ));
+		AppendGrowing( out, LOGOG_CONST_STRING( ",\"allocator\":{\"allocations\":" ));
+		AppendGrowing( out, m_nAllocations );
+		AppendGrowing( out, LOGOG_CONST_STRING( ",\"deallocations\":" ));
+		AppendGrowing( out, m_nDeallocations );
+		AppendGrowing( out, LOGOG_CONST_STRING( ",\"bytes\":" ));
+		AppendGrowing( out, m_nBytesAllocated );
+		AppendGrowing( out, LOGOG_CONST_STRING( "},\"message_creation_lock\":" ));
+		AppendLockJSON( out, m_MessageCreationLock );
+		AppendGrowing( out, LOGOG_CONST_STRING( ",\"targets\":[" ));
+
+		for ( TargetEntriesType::const_iterator it = m_vTargets.begin(); it != m_vTargets.end(); ++it )
+		{
+			if ( it != m_vTargets.begin() )
+				AppendGrowing( out, LOGOG_CONST_STRING( "," ));
+
+			AppendGrowing( out, LOGOG_CONST_STRING( "{\"name\":" ));
+			AppendJSONString( out, it->m_sName );
+			AppendGrowing( out, LOGOG_CONST_STRING( ",\"messages\":" ));
+			AppendGrowing( out, it->m_Counters.m_nMessages );
+			AppendGrowing( out, LOGOG_CONST_STRING( ",\"bytes\":" ));
+			AppendGrowing( out, it->m_Counters.m_nBytes );
+			AppendGrowing( out, LOGOG_CONST_STRING( ",\"errors\":" ));
+			AppendGrowing( out, it->m_Counters.m_nErrors );
+			AppendGrowing( out, LOGOG_CONST_STRING( ",\"output_ns\":{\"p50\":" ));
+			AppendGrowing( out, it->OutputLatencyPercentile( 0.5 ));
+			AppendGrowing( out, LOGOG_CONST_STRING( ",\"p99\":" ));
+			AppendGrowing( out, it->OutputLatencyPercentile( 0.99 ));
+			AppendGrowing( out, LOGOG_CONST_STRING( ",\"p999\":" ));
+			AppendGrowing( out, it->OutputLatencyPercentile( 0.999 ));
+			AppendGrowing( out, LOGOG_CONST_STRING( ",\"log2_histogram\":[" ));
+			for ( int i = 0; i < LOGOG_STATISTICS_LATENCY_BUCKETS; i++ )
+			{
+				if ( i != 0 )
+					AppendGrowing( out, LOGOG_CONST_STRING( "," ));
+				AppendGrowing( out, it->m_Counters.m_vOutputLatency[ i ] );
+			}
+			AppendGrowing( out, LOGOG_CONST_STRING( "]},\"receive_lock\":" ));
+			AppendLockJSON( out, it->m_ReceiveLock );
+			AppendGrowing( out, LOGOG_CONST_STRING( ",\"queue\":{\"queued\":" ));
+			AppendGrowing( out, it->m_Counters.m_nQueued );
+			AppendGrowing( out, LOGOG_CONST_STRING( ",\"waiting\":" ));
+			AppendGrowing( out, (LOGOG_UINT64)it->m_nWaiting );
+			AppendGrowing( out, LOGOG_CONST_STRING( ",\"lag_ns\":" ));
+			AppendGrowing( out, it->m_nLag );
+			AppendGrowing( out, LOGOG_CONST_STRING( ",\"total_lag_ns\":" ));
+			AppendGrowing( out, it->m_Counters.m_nLagNanoseconds );
+			AppendGrowing( out, LOGOG_CONST_STRING( ",\"max_lag_ns\":" ));
+			AppendGrowing( out, it->m_Counters.m_nMaxLagNanoseconds );
+			AppendGrowing( out, LOGOG_CONST_STRING( ",\"dropped\":" ));
+			AppendGrowing( out, it->m_Counters.m_nDropped );
+			AppendGrowing( out, LOGOG_CONST_STRING( "}}" ));
+		}
+
+		AppendGrowing( out, LOGOG_CONST_STRING( "],\"slowest_target\":" ));
+
+		const TargetEntry *pSlowest = GetSlowestTarget();
+
+		if ( pSlowest != NULL )
+			AppendJSONString( out, pSlowest->m_sName );
+		else
+			AppendGrowing( out, LOGOG_CONST_STRING( "null" ));
+
+		AppendGrowing( out, LOGOG_CONST_STRING( ",\"messages\":[" ));
+
+		for ( MessageEntriesType::const_iterator it = m_vMessages.begin(); it != m_vMessages.end(); ++it )
+		{
+			if ( it != m_vMessages.begin() )
+				AppendGrowing( out, LOGOG_CONST_STRING( "," ));
+
+			AppendGrowing( out, LOGOG_CONST_STRING( "{\"file\":" ));
+			AppendJSONString( out, it->m_sFileName );
+			AppendGrowing( out, LOGOG_CONST_STRING( ",\"line\":" ));
+			AppendGrowing( out, (LOGOG_UINT64)it->m_nLineNumber );
+			AppendGrowing( out, LOGOG_CONST_STRING( ",\"level\":" ));
+			AppendGrowing( out, (LOGOG_UINT64)it->m_nLevel );
+			AppendGrowing( out, LOGOG_CONST_STRING( ",\"hits\":" ));
+			AppendGrowing( out, it->m_nHits );
+			AppendGrowing( out, LOGOG_CONST_STRING( ",\"transmit_lock\":" ));
+			AppendLockJSON( out, it->m_TransmitLock );
+			AppendGrowing( out, LOGOG_CONST_STRING( "}" ));
+		}
+
+		AppendGrowing( out, LOGOG_CONST_STRING( "]}\n" ));
+		out.append( (LOGOG_CHAR)'\0' );
+	}
+
+	void GetStats( Statistics &stats )
+	{
+		stats.Clear();
+
+#ifdef LOGOG_STATISTICS
+		stats.m_bEnabled = true;
+		stats.m_nAllocations = LOGOG_ATOMIC_LOAD( &s_nStatisticsAllocations );
+		stats.m_nDeallocations = LOGOG_ATOMIC_LOAD( &s_nStatisticsDeallocations );
+		stats.m_nBytesAllocated = LOGOG_ATOMIC_LOAD( &s_nStatisticsBytesAllocated );
+
+		GetMessageCreationMutex().GetStatistics( stats.m_MessageCreationLock );
+
+		{
+			LockableNodesType *pAllTargets = &AllTargets();
+			ScopedLock sl( *pAllTargets );
+
+			for ( LockableNodesType::iterator it = pAllTargets->begin(); it != pAllTargets->end(); ++it )
+			{
+				Statistics::TargetEntry entry;
+				(( Target * )*it )->GetStatistics( entry );
+				stats.m_vTargets.push_back( entry );
+			}
+		}
+
+		{
+			LockableNodesType *pAllMessages = &AllMessages();
+			ScopedLock sl( *pAllMessages );
+
+			for ( LockableNodesType::iterator it = pAllMessages->begin(); it != pAllMessages->end(); ++it )
+			{
+				Statistics::MessageEntry entry;
+				(( Message * )*it )->GetStatistics( entry );
+				stats.m_vMessages.push_back( entry );
+			}
+		}
+#endif // LOGOG_STATISTICS
+	}
+}
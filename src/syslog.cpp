@@ -0,0 +1,35 @@
+/*
+ * \file syslog.cpp
+ */
+
+#include "logog.hpp"
+
+namespace logog {
+
+	Syslog::Syslog( const char *sAddress, int nFacility, const char *sAppName, int port ) :
+		Socket( sAddress, SOCK_DGRAM, port ),
+		m_Formatter( nFacility, sAppName )
+	{
+		SetFormatter( m_Formatter );
+		SetName( LOGOG_CONST_STRING( "syslog" ));
+	}
+
+	int Syslog::Output( const LOGOG_STRING &output )
+	{
+#ifdef LOGOG_UNICODE
+		const LOGOG_CHAR *pChars = output.c_str();
+		size_t nCount = output.size();
+
+		m_vUTF8.resize( String::UTF8Length( pChars, nCount ));
+
+		if ( m_vUTF8.empty() )
+			return 0;
+
+		String::EncodeUTF8( pChars, nCount, &m_vUTF8[ 0 ] );
+
+		return Enqueue( &m_vUTF8[ 0 ], m_vUTF8.size() );
+#else // LOGOG_UNICODE
+		return Socket::Output( output );
+#endif // LOGOG_UNICODE
+	}
+}
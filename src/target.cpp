@@ -5,12 +5,190 @@
 #include "logog.hpp"
 
 #include <iostream>
+#include <cstring>
+#include <cwchar>
+
+#ifdef LOGOG_FLAVOR_WINDOWS
+#include <io.h>
+#else // LOGOG_FLAVOR_WINDOWS
+#include <unistd.h>
+#endif // LOGOG_FLAVOR_WINDOWS
 
 namespace logog {
 
+	/* A message in a delivery queue: its output, and the properties of its topic.  The topic's strings are copied
+	 * end to end into one allocation, so that the entry stays cheap to move about in the queue. */
+	struct DeliveryEntry
+	{
+		/* Copies the properties of the topic, but not its output. */
+		void Assign( const Topic &topic )
+		{
+			size_t nTotal = 0;
+
+			m_pFormatted = NULL;
+			m_nLevel = topic.Level();
+			m_nLineNumber = topic.LineNumber();
+			m_tTime = topic.Timestamp();
+			m_TopicFlags = topic.GetTopicFlags();
+
+			const LOGOG_STRING *vStrings[ TOPIC_STRING_COUNT ] =
+				{ &topic.FileName(), &topic.Group(), &topic.Category(), &topic.Message() };
+
+			for ( size_t t = 0; t < TOPIC_STRING_COUNT; t++ )
+			{
+				m_vLengths[ t ] = vStrings[ t ]->size();
+				nTotal += m_vLengths[ t ];
+			}
+
+			m_pStrings = NULL;
+			if ( nTotal == 0 )
+				return;
+
+			m_pStrings = (LOGOG_CHAR *)Object::Allocate( sizeof( LOGOG_CHAR ) * nTotal );
+
+			LOGOG_CHAR *pTo = m_pStrings;
+			for ( size_t t = 0; t < TOPIC_STRING_COUNT; t++ )
+			{
+				const LOGOG_CHAR *pFrom = vStrings[ t ]->c_str();
+
+				for ( size_t c = 0; c < m_vLengths[ t ]; c++ )
+					*pTo++ = pFrom[ c ];
+			}
+		}
+
+		void Release()
+		{
+			if ( m_pFormatted != NULL )
+				m_pFormatted->Release();
+			m_pFormatted = NULL;
+
+			if ( m_pStrings != NULL )
+				Object::Deallocate( m_pStrings );
+			m_pStrings = NULL;
+		}
+
+		FormattedMessage *m_pFormatted;
+		LOGOG_LEVEL_TYPE m_nLevel;
+		int m_nLineNumber;
+		LOGOG_TIME m_tTime;
+		TOPIC_FLAGS m_TopicFlags;
+		/* The file name, group, category and message, in that order, and their lengths. */
+		LOGOG_CHAR *m_pStrings;
+		size_t m_vLengths[ TOPIC_STRING_COUNT ];
+		/* When the message was queued, from GetMonotonicNanoseconds(). */
+		LOGOG_UINT64 m_nQueued;
+	};
+
+	/* The topic that a delivery thread passes to Receive(), standing for one queued message at a time.  It offers
+	 * the queued output to GetFormatted() as though it were being transmitted, so that Receive() outputs it
+	 * without formatting anything.  It isn't one of AllNodes(), since it belongs to its target, which destroys it. */
+	class DeliveryTopic : public Topic
+	{
+	public:
+		DeliveryTopic()
+		{
+			LockableNodesType *pAllNodes = &AllNodes();
+			ScopedLock sl( *pAllNodes );
+			pAllNodes->erase( this );
+		}
+
+		/* Takes over the entry's reference to its output; the entry keeps its strings. */
+		void Begin( const DeliveryEntry &entry )
+		{
+			Level( entry.m_nLevel );
+			LineNumber( entry.m_nLineNumber );
+			Timestamp( entry.m_tTime );
+
+			/* The buffers are kept from one message to the next, so they only grow now and then. */
+			const LOGOG_CHAR *pFrom = entry.m_pStrings;
+			for ( size_t t = 0; t < TOPIC_STRING_COUNT; t++ )
+			{
+				m_vStringProps[ t ].clear();
+				m_vStringProps[ t ].grow( entry.m_vLengths[ t ] + 1 );
+				m_vStringProps[ t ].append( pFrom, entry.m_vLengths[ t ] );
+				pFrom += entry.m_vLengths[ t ];
+			}
+			m_TopicFlags = entry.m_TopicFlags;
+
+			m_vFormatted[ 0 ] = entry.m_pFormatted;
+			m_nFormatted = 1;
+			m_bTransmitting = true;
+		}
+
+		void End()
+		{
+			m_bTransmitting = false;
+			m_nFormatted = 0;
+			m_vFormatted[ 0 ]->Release();
+			m_vFormatted[ 0 ] = NULL;
+		}
+	};
+
+	struct DeliveryQueue : public Object
+	{
+		DeliveryQueue( Thread::ThreadStartLocationType fnThread, Target *pTarget ) :
+			m_nHead( 0 ),
+			m_nLimit( 0 ),
+			m_bDropWhenFull( false ),
+			m_bRunning( false ),
+			m_bStop( false ),
+			m_bDiscard( false ),
+			m_bIdle( false ),
+			m_nWaiters( 0 ),
+			m_Thread( fnThread, pTarget )
+		{
+		}
+
+		size_t Count() const
+		{
+			return m_vEntries.size() - m_nHead;
+		}
+
+		void Pop()
+		{
+			m_nHead++;
+
+			/* Drop the delivered entries from the front now and then, rather than moving the rest each time. */
+			if ( m_nHead == m_vEntries.size() )
+			{
+				m_vEntries.clear();
+				m_nHead = 0;
+			}
+			else if ( m_nHead >= m_nLimit )
+			{
+				m_vEntries.erase( m_vEntries.begin(), m_vEntries.begin() + m_nHead );
+				m_nHead = 0;
+			}
+		}
+
+		/** Guards everything below, and wakes the delivery thread and the threads waiting on it. */
+		Condition m_Condition;
+		/** The queue.  The entries before m_nHead have been delivered; the one at m_nHead is being delivered. */
+		LOGOG_VECTOR< DeliveryEntry, Allocator< DeliveryEntry > > m_vEntries;
+		size_t m_nHead;
+		size_t m_nLimit;
+		bool m_bDropWhenFull;
+		/** Is the delivery thread running?  Messages are delivered synchronously when it isn't. */
+		bool m_bRunning;
+		/** Has the delivery thread been asked to stop, and should it drop what is waiting when it does? */
+		bool m_bStop;
+		bool m_bDiscard;
+		/** Is the delivery thread waiting for a message? */
+		bool m_bIdle;
+		/** The number of threads waiting for room in the queue, or for it to empty. */
+		int m_nWaiters;
+		Thread m_Thread;
+		DeliveryTopic m_Topic;
+	};
+
 	Target::Target() :
-		m_bNullTerminatesStrings( true )
+		m_bNullTerminatesStrings( true ),
+		m_sName( LOGOG_CONST_STRING( "target" )),
+		m_pDelivery( NULL )
 	{
+#ifdef LOGOG_STATISTICS
+		ResetTargetStatistics( m_Statistics );
+#endif // LOGOG_STATISTICS
 		SetFormatter( GetDefaultFormatter() );
 		LockableNodesType *pAllTargets = &AllTargets();
 
@@ -25,11 +203,22 @@ namespace logog {
 
 	Target::~Target()
 	{
-		LockableNodesType *pAllTargets = &AllTargets();
+		if ( m_pDelivery != NULL )
+		{
+			StopDelivery( true );
+			delete m_pDelivery;
+		}
 
-		UnsubscribeToMultiple( AllFilters() );
+		/* Shutdown destroys the lists of filters and targets before the targets themselves; don't create them
+		 * again. */
+		Statics *pStatics = &Static();
 
+		if ( pStatics->s_pAllFilterNodes != NULL )
+			UnsubscribeToMultiple( AllFilters() );
+
+		if ( pStatics->s_pAllTargets != NULL )
 		{
+			LockableNodesType *pAllTargets = &AllTargets();
 			ScopedLock sl( *pAllTargets );
 			pAllTargets->erase( this );
 		}
@@ -37,6 +226,9 @@ namespace logog {
 
 	void Target::SetFormatter( Formatter &formatter )
 	{
+		if ( m_pDelivery != NULL )
+			WaitForDelivery( ~(LOGOG_UINT64)0 );
+
 		m_pFormatter = &formatter;
 	}
 
@@ -47,8 +239,366 @@ namespace logog {
 
 	int Target::Receive( const Topic &topic )
 	{
+		FormattedMessage *pFormatted = PrepareOutput( topic );
+
 		ScopedLock sl( m_MutexReceive );
-		return Output( m_pFormatter->Format( topic, *this ) );
+		return FormatAndOutput( topic, pFormatted );
+	}
+
+	FormattedMessage *Target::PrepareOutput( const Topic &topic )
+	{
+		if ( !m_pFormatter->IsReentrant() )
+			return NULL;
+
+		return topic.GetFormatted( *m_pFormatter, *this );
+	}
+
+	int Target::FormatAndOutput( const Topic &topic, FormattedMessage *pFormatted )
+	{
+		if ( pFormatted == NULL )
+			pFormatted = topic.GetFormatted( *m_pFormatter, *this );
+
+		if ( pFormatted == NULL )
+		{
+			m_pFormatter->FormatTo( m_sOutputBuffer, topic, *this );
+			return TimedOutput( m_sOutputBuffer );
+		}
+
+		int nError = TimedOutput( pFormatted->Get() );
+		pFormatted->Release();
+
+		return nError;
+	}
+
+	int Target::Deliver( const Topic &topic )
+	{
+		if ( m_pDelivery == NULL )
+			return Receive( topic );
+
+		return Enqueue( topic );
+	}
+
+	FormattedMessage *Target::FormatForQueue( const Topic &topic )
+	{
+		FormattedMessage *pFormatted = topic.GetFormatted( *m_pFormatter, *this );
+
+		if ( pFormatted == NULL )
+		{
+			pFormatted = new FormattedMessage();
+			pFormatted->Format( *m_pFormatter, topic, *this );
+		}
+
+		return pFormatted;
+	}
+
+	int Target::Enqueue( const Topic &topic )
+	{
+		DeliveryQueue *pQueue = m_pDelivery;
+		DeliveryEntry entry;
+
+		entry.Assign( topic );
+
+		/* A formatter that isn't reentrant may keep state from one message to the next, such as the call sites a
+		 * binary log has described, so it must format the messages in the order they are queued. */
+		if ( m_pFormatter->IsReentrant() )
+			entry.m_pFormatted = FormatForQueue( topic );
+
+		pQueue->m_Condition.Lock();
+
+		for ( ;; )
+		{
+			/* While the thread is stopping, wait for it to deliver what it has, so that nothing overtakes it. */
+			if ( pQueue->m_bRunning && pQueue->m_bStop )
+			{
+				pQueue->m_nWaiters++;
+				pQueue->m_Condition.Wait();
+				pQueue->m_nWaiters--;
+				continue;
+			}
+
+			if ( !pQueue->m_bRunning )
+			{
+				pQueue->m_Condition.Unlock();
+				entry.Release();
+
+				return Receive( topic );
+			}
+
+			if ( pQueue->Count() < pQueue->m_nLimit )
+				break;
+
+			if ( pQueue->m_bDropWhenFull )
+			{
+				pQueue->m_Condition.Unlock();
+				entry.Release();
+#ifdef LOGOG_STATISTICS
+				LOGOG_ATOMIC_ADD( &m_Statistics.m_nDropped, 1 );
+#endif // LOGOG_STATISTICS
+				return -1;
+			}
+
+			pQueue->m_nWaiters++;
+			pQueue->m_Condition.Wait();
+			pQueue->m_nWaiters--;
+		}
+
+		if ( entry.m_pFormatted == NULL )
+			entry.m_pFormatted = FormatForQueue( topic );
+
+		entry.m_nQueued = GetMonotonicNanoseconds();
+
+		pQueue->m_vEntries.push_back( entry );
+
+		if ( pQueue->m_bIdle )
+			pQueue->m_Condition.Signal();
+
+		pQueue->m_Condition.Unlock();
+
+#ifdef LOGOG_STATISTICS
+		LOGOG_ATOMIC_ADD( &m_Statistics.m_nQueued, 1 );
+#endif // LOGOG_STATISTICS
+		return 0;
+	}
+
+	void *Target::DeliveryThread( void *pvTarget )
+	{
+		Target *pThis = ( Target * )pvTarget;
+		DeliveryQueue *pQueue = pThis->m_pDelivery;
+
+		pQueue->m_Condition.Lock();
+
+		while ( !pQueue->m_bStop || (( pQueue->Count() != 0 ) && !pQueue->m_bDiscard ))
+		{
+			if ( pQueue->Count() == 0 )
+			{
+				pQueue->m_bIdle = true;
+				pQueue->m_Condition.Wait();
+				pQueue->m_bIdle = false;
+				continue;
+			}
+
+			/* The entry stays at the head of the queue while it is delivered, so that the lag counts it. */
+			DeliveryEntry entry = pQueue->m_vEntries[ pQueue->m_nHead ];
+			pQueue->m_Condition.Unlock();
+
+#ifdef LOGOG_STATISTICS
+			LOGOG_UINT64 nLag = GetMonotonicNanoseconds() - entry.m_nQueued;
+
+			LOGOG_ATOMIC_ADD( &pThis->m_Statistics.m_nLagNanoseconds, nLag );
+			if ( nLag > LOGOG_ATOMIC_LOAD( &pThis->m_Statistics.m_nMaxLagNanoseconds ))
+				LOGOG_ATOMIC_STORE( &pThis->m_Statistics.m_nMaxLagNanoseconds, nLag );
+#endif // LOGOG_STATISTICS
+
+			pQueue->m_Topic.Begin( entry );
+			pThis->Receive( pQueue->m_Topic );
+			pQueue->m_Topic.End();
+			entry.m_pFormatted = NULL;
+			entry.Release();
+
+			pQueue->m_Condition.Lock();
+			pQueue->Pop();
+
+			if ( pQueue->m_nWaiters != 0 )
+				pQueue->m_Condition.Broadcast();
+		}
+
+		/* Stopped at a deadline: drop whatever is left. */
+		while ( pQueue->Count() != 0 )
+		{
+			pQueue->m_vEntries[ pQueue->m_nHead ].Release();
+			pQueue->Pop();
+#ifdef LOGOG_STATISTICS
+			LOGOG_ATOMIC_ADD( &pThis->m_Statistics.m_nDropped, 1 );
+#endif // LOGOG_STATISTICS
+		}
+
+		pQueue->m_bRunning = false;
+		pQueue->m_Condition.Broadcast();
+		pQueue->m_Condition.Unlock();
+
+		return NULL;
+	}
+
+	void Target::SetDeliveryQueue( size_t nMessages, bool bDropWhenFull )
+	{
+		if ( nMessages == 0 )
+		{
+			StopDelivery( false );
+			return;
+		}
+
+		if ( m_pDelivery == NULL )
+			m_pDelivery = new DeliveryQueue( DeliveryThread, this );
+
+		DeliveryQueue *pQueue = m_pDelivery;
+		bool bStart;
+
+		pQueue->m_Condition.Lock();
+		pQueue->m_nLimit = nMessages;
+		pQueue->m_bDropWhenFull = bDropWhenFull;
+		bStart = !pQueue->m_bRunning;
+
+		if ( bStart )
+		{
+			pQueue->m_bRunning = true;
+			pQueue->m_bStop = false;
+			pQueue->m_bDiscard = false;
+		}
+
+		/* Threads waiting for room may have some now. */
+		if ( pQueue->m_nWaiters != 0 )
+			pQueue->m_Condition.Broadcast();
+
+		pQueue->m_Condition.Unlock();
+
+		if ( bStart && ( pQueue->m_Thread.Start() != 0 ))
+		{
+			pQueue->m_Condition.Lock();
+			pQueue->m_bRunning = false;
+			pQueue->m_Condition.Unlock();
+		}
+	}
+
+	void Target::StopDelivery( bool bDiscard )
+	{
+		DeliveryQueue *pQueue = m_pDelivery;
+
+		if ( pQueue == NULL )
+			return;
+
+		pQueue->m_Condition.Lock();
+
+		if ( !pQueue->m_bRunning || pQueue->m_bStop )
+		{
+			pQueue->m_Condition.Unlock();
+			return;
+		}
+
+		pQueue->m_bStop = true;
+		pQueue->m_bDiscard = bDiscard;
+		pQueue->m_Condition.Broadcast();
+		pQueue->m_Condition.Unlock();
+
+		Thread::WaitFor( pQueue->m_Thread );
+	}
+
+	bool Target::WaitForDelivery( LOGOG_UINT64 nDeadline )
+	{
+		DeliveryQueue *pQueue = m_pDelivery;
+
+		if ( pQueue == NULL )
+			return true;
+
+		pQueue->m_Condition.Lock();
+
+		while ( pQueue->Count() != 0 )
+		{
+			LOGOG_UINT64 nNow = GetMonotonicNanoseconds();
+
+			if ( nNow >= nDeadline )
+				break;
+
+			/* Wake now and then regardless, so that a distant deadline can't overflow the wait. */
+			LOGOG_UINT64 nWait = ( nDeadline - nNow ) / 1000000 + 1;
+
+			pQueue->m_nWaiters++;
+			pQueue->m_Condition.Wait( nWait < 1000 ? (unsigned int)nWait : 1000 );
+			pQueue->m_nWaiters--;
+		}
+
+		bool bEmpty = ( pQueue->Count() == 0 );
+		pQueue->m_Condition.Unlock();
+
+		return bEmpty;
+	}
+
+	size_t Target::GetQueuedMessages() const
+	{
+		DeliveryQueue *pQueue = m_pDelivery;
+
+		if ( pQueue == NULL )
+			return 0;
+
+		pQueue->m_Condition.Lock();
+		size_t nCount = pQueue->Count();
+		pQueue->m_Condition.Unlock();
+
+		return nCount;
+	}
+
+	LOGOG_UINT64 Target::GetDeliveryLag() const
+	{
+		DeliveryQueue *pQueue = m_pDelivery;
+
+		if ( pQueue == NULL )
+			return 0;
+
+		LOGOG_UINT64 nLag = 0;
+
+		pQueue->m_Condition.Lock();
+		if ( pQueue->Count() != 0 )
+			nLag = GetMonotonicNanoseconds() - pQueue->m_vEntries[ pQueue->m_nHead ].m_nQueued;
+		pQueue->m_Condition.Unlock();
+
+		return nLag;
+	}
+
+	void StopDeliveryQueues( bool bDiscard )
+	{
+		if ( Static().s_pAllTargets == NULL )
+			return;
+
+		LOGOG_VECTOR< Target *, Allocator< Target * > > vTargets;
+
+		{
+			LockableNodesType *pAllTargets = &AllTargets();
+			ScopedLock sl( *pAllTargets );
+
+			for ( LockableNodesType::iterator it = pAllTargets->begin(); it != pAllTargets->end(); ++it )
+				vTargets.push_back( ( Target * )*it );
+		}
+
+		for ( size_t t = 0; t < vTargets.size(); t++ )
+			vTargets[ t ]->StopDelivery( bDiscard );
+	}
+
+	int Target::TimedOutput( const LOGOG_STRING &data )
+	{
+#ifdef LOGOG_STATISTICS
+		LOGOG_UINT64 nStart = GetMonotonicNanoseconds();
+		int nError = Output( data );
+		RecordTargetOutput( m_Statistics, data.size() * sizeof( LOGOG_CHAR ), GetMonotonicNanoseconds() - nStart, nError );
+		return nError;
+#else // LOGOG_STATISTICS
+		return Output( data );
+#endif // LOGOG_STATISTICS
+	}
+
+	void Target::GetStatistics( Statistics::TargetEntry &entry ) const
+	{
+		entry.m_sName = m_sName;
+		entry.m_pTarget = this;
+#ifdef LOGOG_STATISTICS
+		entry.m_Counters.m_nMessages = LOGOG_ATOMIC_LOAD( &m_Statistics.m_nMessages );
+		entry.m_Counters.m_nBytes = LOGOG_ATOMIC_LOAD( &m_Statistics.m_nBytes );
+		entry.m_Counters.m_nErrors = LOGOG_ATOMIC_LOAD( &m_Statistics.m_nErrors );
+		for ( int i = 0; i < LOGOG_STATISTICS_LATENCY_BUCKETS; i++ )
+			entry.m_Counters.m_vOutputLatency[ i ] = LOGOG_ATOMIC_LOAD( &m_Statistics.m_vOutputLatency[ i ] );
+		entry.m_Counters.m_nQueued = LOGOG_ATOMIC_LOAD( &m_Statistics.m_nQueued );
+		entry.m_Counters.m_nDropped = LOGOG_ATOMIC_LOAD( &m_Statistics.m_nDropped );
+		entry.m_Counters.m_nLagNanoseconds = LOGOG_ATOMIC_LOAD( &m_Statistics.m_nLagNanoseconds );
+		entry.m_Counters.m_nMaxLagNanoseconds = LOGOG_ATOMIC_LOAD( &m_Statistics.m_nMaxLagNanoseconds );
+#else // LOGOG_STATISTICS
+		ResetTargetStatistics( entry.m_Counters );
+#endif // LOGOG_STATISTICS
+		m_MutexReceive.GetStatistics( entry.m_ReceiveLock );
+		entry.m_nWaiting = GetQueuedMessages();
+		entry.m_nLag = GetDeliveryLag();
+	}
+
+	Cerr::Cerr()
+	{
+		SetName( LOGOG_CONST_STRING( "cerr" ));
 	}
 
 	int Cerr::Output( const LOGOG_STRING &data )
@@ -57,6 +607,11 @@ namespace logog {
 
 		return 0;
 	}
+	Cout::Cout()
+	{
+		SetName( LOGOG_CONST_STRING( "cout" ));
+	}
+
 //! [Cout]
 	int Cout::Output( const LOGOG_STRING &data )
 	{
@@ -66,6 +621,11 @@ namespace logog {
 	}
 //! [Cout]
 
+	OutputDebug::OutputDebug()
+	{
+		SetName( LOGOG_CONST_STRING( "debug" ));
+	}
+
 	int OutputDebug::Output( const LOGOG_STRING &data )
 	{
 #ifdef LOGOG_FLAVOR_WINDOWS
@@ -78,13 +638,175 @@ namespace logog {
 		return 0;
 	}
 
+	NullTarget::NullTarget( bool bSkipFormatting ) :
+		m_bSkipFormatting( bSkipFormatting )
+	{
+		SetName( LOGOG_CONST_STRING( "null" ));
+	}
+
+	int NullTarget::Receive( const Topic &topic )
+	{
+		if ( !m_bSkipFormatting )
+			return Target::Receive( topic );
+
+		ScopedLock sl( m_MutexReceive );
+		return TimedOutput( m_sEmpty );
+	}
+
+	int NullTarget::Output( const LOGOG_STRING & )
+	{
+		return 0;
+	}
+
+	MemoryTarget::MemoryTarget( size_t nSize ) :
+		m_pArena( NULL ),
+		m_nSize( 0 ),
+		m_nUsed( 0 )
+	{
+		m_bNullTerminatesStrings = false;
+		SetName( LOGOG_CONST_STRING( "memory" ));
+
+		if ( nSize > 0 )
+		{
+			m_pArena = (LOGOG_CHAR *)Object::Allocate( nSize * sizeof( LOGOG_CHAR ));
+			if ( m_pArena != NULL )
+				m_nSize = nSize;
+		}
+	}
+
+	MemoryTarget::~MemoryTarget()
+	{
+		if ( m_pArena )
+			Object::Deallocate( m_pArena );
+	}
+
+	bool MemoryTarget::Reserve( size_t nSize )
+	{
+		if ( m_nUsed + nSize <= m_nSize )
+			return true;
+
+		size_t nNewSize = ( m_nSize > 0 ) ? m_nSize : 256;
+		while ( nNewSize < m_nUsed + nSize )
+			nNewSize *= 2;
+
+		LOGOG_CHAR *pNewArena = (LOGOG_CHAR *)Object::Allocate( nNewSize * sizeof( LOGOG_CHAR ));
+		if ( pNewArena == NULL )
+			return false;
+
+		if ( m_pArena )
+		{
+			memcpy( pNewArena, m_pArena, m_nUsed * sizeof( LOGOG_CHAR ));
+			Object::Deallocate( m_pArena );
+		}
+
+		m_pArena = pNewArena;
+		m_nSize = nNewSize;
+
+		return true;
+	}
+
+	int MemoryTarget::Output( const LOGOG_STRING &data )
+	{
+		size_t nLength = data.size();
+
+		// add one for trailing null
+		if ( !Reserve( nLength + 1 ))
+			return -1;
+
+		m_vOffsets.push_back( m_nUsed );
+
+		if ( nLength > 0 )
+			memcpy( m_pArena + m_nUsed, data.c_str(), nLength * sizeof( LOGOG_CHAR ));
+
+		m_nUsed += nLength;
+		m_pArena[ m_nUsed++ ] = (LOGOG_CHAR)'\0';
+
+		return 0;
+	}
+
+	size_t MemoryTarget::GetRecordCount() const
+	{
+		ScopedLock sl( const_cast< Mutex & >( m_MutexReceive ));
+		return m_vOffsets.size();
+	}
+
+	const LOGOG_CHAR *MemoryTarget::GetRecord( size_t nRecord ) const
+	{
+		ScopedLock sl( const_cast< Mutex & >( m_MutexReceive ));
+
+		if ( nRecord >= m_vOffsets.size() )
+			return NULL;
+
+		return m_pArena + m_vOffsets[ nRecord ];
+	}
+
+	size_t MemoryTarget::GetRecordLength( size_t nRecord ) const
+	{
+		ScopedLock sl( const_cast< Mutex & >( m_MutexReceive ));
+
+		if ( nRecord >= m_vOffsets.size() )
+			return 0;
+
+		size_t nEnd = ( nRecord + 1 < m_vOffsets.size() ) ? m_vOffsets[ nRecord + 1 ] : m_nUsed;
+
+		// subtract one for trailing null
+		return nEnd - m_vOffsets[ nRecord ] - 1;
+	}
+
+	size_t MemoryTarget::CountRecordsContaining( const LOGOG_CHAR *sText ) const
+	{
+		ScopedLock sl( const_cast< Mutex & >( m_MutexReceive ));
+
+		size_t nCount = 0;
+
+		for ( OffsetsType::const_iterator it = m_vOffsets.begin(); it != m_vOffsets.end(); ++it )
+		{
+#ifdef LOGOG_UNICODE
+			if ( wcsstr( m_pArena + *it, sText ) != NULL )
+#else // LOGOG_UNICODE
+			if ( strstr( m_pArena + *it, sText ) != NULL )
+#endif // LOGOG_UNICODE
+				nCount++;
+		}
+
+		return nCount;
+	}
+
+	size_t MemoryTarget::GetUsed() const
+	{
+		ScopedLock sl( const_cast< Mutex & >( m_MutexReceive ));
+		return m_nUsed;
+	}
+
+	void MemoryTarget::Clear()
+	{
+		ScopedLock sl( m_MutexReceive );
+		m_vOffsets.clear();
+		m_nUsed = 0;
+	}
+
 	LogFile::LogFile(const char *sFileName, bool bEnableOutputBuffering) :
 		m_bFirstTime( true ),
 		m_bOpenFailed( false ),
 		m_pFile( NULL ),
-        m_bEnableOutputBuffering( bEnableOutputBuffering )
+        m_bEnableOutputBuffering( bEnableOutputBuffering ),
+		m_nIndexIntervalBytes( 0 ),
+		m_nIndexIntervalRecords( 0 ),
+		m_bIndexEnabled( false ),
+		m_pIndexFile( NULL ),
+		m_nIndexOffset( 0 ),
+		m_nOutputLevel( LOGOG_LEVEL_ALL ),
+		m_nDurableLevel( LOGOG_LEVEL_NONE ),
+		m_nCommitQueued( 0 ),
+		m_nCommitDone( 0 ),
+		m_nCommits( 0 ),
+		m_bCommitting( false ),
+		m_bCommitFailed( false )
 	{
+		memset( &m_IndexBucket, 0, sizeof( m_IndexBucket ));
+
 		m_bNullTerminatesStrings = false;
+		SetName( LOGOG_CONST_STRING( "file" ));
 
 #ifdef LOGOG_UNICODE
 		m_bWriteUnicodeBOM = true;
@@ -110,6 +832,12 @@ namespace logog {
 
 	LogFile::~LogFile()
 	{
+		if ( m_pIndexFile )
+		{
+			WriteIndexBucket();
+			fclose( m_pIndexFile );
+		}
+
 		if ( m_pFile )
 			fclose( m_pFile );
 
@@ -196,9 +924,240 @@ namespace logog {
 				return result;
 
 			m_bFirstTime = false;
+
+			if ( m_bIndexEnabled )
+				OpenIndex();
+		}
+
+		result = InternalOutput( data.size(), data.c_str());
+
+		if (( m_pIndexFile != NULL ) && ( result == 0 ))
+			IndexRecord( data.size() * sizeof( LOGOG_CHAR ));
+
+		return result;
+	}
+
+	int LogFile::Receive( const Topic &topic )
+	{
+		LOGOG_UINT64 nCommit = 0;
+		int nError;
+		FormattedMessage *pFormatted = PrepareOutput( topic );
+
+		{
+			ScopedLock sl( m_MutexReceive );
+
+			m_nOutputLevel = topic.Level();
+			nError = FormatAndOutput( topic, pFormatted );
+			m_nOutputLevel = LOGOG_LEVEL_ALL;
+
+			if (( nError == 0 ) && ( topic.Level() <= m_nDurableLevel ))
+			{
+				/* The message must reach the kernel before it is counted, so that whichever thread runs the next
+				 * fdatasync() covers it. */
+				if ( FlushOutput() != 0 )
+					nError = -1;
+				else
+				{
+					m_CommitCondition.Lock();
+					nCommit = ++m_nCommitQueued;
+					m_CommitCondition.Unlock();
+				}
+			}
+		}
+
+		/* Wait for the disk without holding m_MutexReceive, so that other threads can queue their messages for
+		 * the same commit meanwhile. */
+		if ( nCommit != 0 )
+			nError = WaitForCommit( nCommit );
+
+		return nError;
+	}
+
+	void LogFile::SetDurableLevel( LOGOG_LEVEL_TYPE level )
+	{
+		ScopedLock sl( m_MutexReceive );
+
+		m_nDurableLevel = level;
+	}
+
+	LOGOG_UINT64 LogFile::GetCommitCount()
+	{
+		m_CommitCondition.Lock();
+		LOGOG_UINT64 nCommits = m_nCommits;
+		m_CommitCondition.Unlock();
+
+		return nCommits;
+	}
+
+	bool LogFile::EnableIndex( size_t nIntervalBytes, size_t nIntervalRecords )
+	{
+		ScopedLock sl( m_MutexReceive );
+
+		m_bIndexEnabled = true;
+		m_nIndexIntervalBytes = nIntervalBytes;
+		m_nIndexIntervalRecords = nIntervalRecords;
+
+		return true;
+	}
+
+	void LogFile::OpenIndex()
+	{
+		size_t nNameLength = strlen( m_pFileName );
+		char *pIndexName = (char *)Object::Allocate( nNameLength + sizeof( LOGOG_INDEX_SUFFIX ));
+
+		memcpy( pIndexName, m_pFileName, nNameLength );
+		memcpy( pIndexName + nNameLength, LOGOG_INDEX_SUFFIX, sizeof( LOGOG_INDEX_SUFFIX ));
+
+#ifdef LOGOG_FLAVOR_WINDOWS
+		m_pIndexFile = _fsopen( pIndexName, "ab", _SH_DENYWR );
+#else // LOGOG_FLAVOR_WINDOWS
+		m_pIndexFile = fopen( pIndexName, "ab" );
+#endif // LOGOG_FLAVOR_WINDOWS
+
+		Object::Deallocate( pIndexName );
+
+		/* Without an index the log itself carries on as usual. */
+		if ( m_pIndexFile == NULL )
+			return;
+
+		if ( SeekLogFileEnd( m_pIndexFile ) == 0 )
+			fwrite( LOGOG_INDEX_MAGIC, 1, LOGOG_INDEX_MAGIC_LENGTH, m_pIndexFile );
+
+		/* Earlier runs may have appended to the log, and Open() may have written a byte order mark. */
+		m_nIndexOffset = GetOutputSize();
+	}
+
+	void LogFile::IndexRecord( size_t nBytes )
+	{
+		LOGOG_UINT64 nNow = GetRealtimeNanoseconds();
+
+		if ( m_IndexBucket.m_nRecords == 0 )
+		{
+			m_IndexBucket.m_nFirstTime = nNow;
+			m_IndexBucket.m_nOffset = m_nIndexOffset;
+			m_IndexBucket.m_nLength = 0;
+			m_IndexBucket.m_nLevel = LOGOG_LEVEL_ALL;
+		}
+
+		m_IndexBucket.m_nLastTime = nNow;
+		m_IndexBucket.m_nLength += nBytes;
+		m_IndexBucket.m_nRecords++;
+
+		if ( (unsigned int)m_nOutputLevel < m_IndexBucket.m_nLevel )
+			m_IndexBucket.m_nLevel = (unsigned int)m_nOutputLevel;
+
+		m_nIndexOffset += nBytes;
+
+		if ((( m_nIndexIntervalBytes != 0 ) && ( m_IndexBucket.m_nLength >= m_nIndexIntervalBytes )) ||
+			(( m_nIndexIntervalRecords != 0 ) && ( m_IndexBucket.m_nRecords >= m_nIndexIntervalRecords )))
+			WriteIndexBucket();
+	}
+
+	void LogFile::WriteIndexBucket()
+	{
+		if ( m_IndexBucket.m_nRecords == 0 )
+			return;
+
+		/* Write the log first, so that the index never describes bytes that aren't in the log yet. */
+		FlushOutput();
+		WriteLogIndexEntry( m_pIndexFile, m_IndexBucket );
+		fflush( m_pIndexFile );
+
+		m_IndexBucket.m_nRecords = 0;
+	}
+
+	int LogFile::FlushOutput()
+	{
+		return ( m_pFile && fflush( m_pFile ) != 0 ) ? -1 : 0;
+	}
+
+	int LogFile::Flush()
+	{
+		ScopedLock sl( m_MutexReceive );
+		int nError = FlushOutput();
+
+		if ( m_pIndexFile && fflush( m_pIndexFile ) != 0 )
+			nError = -1;
+
+		return nError;
+	}
+
+	/** Waits for everything written to a stdio file to reach the disk.  The file must already be flushed.
+	 ** \param bDataOnly If true, metadata such as the modification time need not be written, unless it is needed to
+	 ** read the data back, as with fdatasync().
+	 **/
+	static int SyncFile( FILE *fp, bool bDataOnly = false )
+	{
+#if defined( LOGOG_FLAVOR_WINDOWS )
+		(void)bDataOnly;
+		return ( _commit( _fileno( fp )) == 0 ) ? 0 : -1;
+#elif defined( __linux__ )
+		return ((( bDataOnly ) ? fdatasync( fileno( fp )) : fsync( fileno( fp ))) == 0 ) ? 0 : -1;
+#else
+		/* Not every POSIX system has fdatasync(). */
+		(void)bDataOnly;
+		return ( fsync( fileno( fp )) == 0 ) ? 0 : -1;
+#endif
+	}
+
+	int LogFile::SyncOutput( bool bDataOnly )
+	{
+		return ( m_pFile && SyncFile( m_pFile, bDataOnly ) != 0 ) ? -1 : 0;
+	}
+
+	LOGOG_UINT64 LogFile::GetOutputSize()
+	{
+		return SeekLogFileEnd( m_pFile );
+	}
+
+	int LogFile::WaitForCommit( LOGOG_UINT64 nCommit )
+	{
+		m_CommitCondition.Lock();
+
+		while ( m_nCommitDone < nCommit )
+		{
+			if ( m_bCommitting )
+			{
+				m_CommitCondition.Wait();
+				continue;
+			}
+
+			/* Lead a commit covering everything queued so far, including messages from other threads. */
+			m_bCommitting = true;
+			LOGOG_UINT64 nBatch = m_nCommitQueued;
+			m_CommitCondition.Unlock();
+
+			bool bFailed = ( SyncOutput( true ) != 0 );
+
+			m_CommitCondition.Lock();
+			m_bCommitting = false;
+			m_nCommitDone = nBatch;
+			m_nCommits++;
+			if ( bFailed )
+				m_bCommitFailed = true;
+			m_CommitCondition.Broadcast();
 		}
 
-		return InternalOutput( data.size(), data.c_str());
+		bool bFailed = m_bCommitFailed;
+		m_CommitCondition.Unlock();
+
+		return bFailed ? -1 : 0;
+	}
+
+	int LogFile::Sync()
+	{
+		int nError = Flush();
+
+		ScopedLock sl( m_MutexReceive );
+
+		/* The log before its index, as when writing them. */
+		if ( SyncOutput( false ) != 0 )
+			nError = -1;
+
+		if ( m_pIndexFile && SyncFile( m_pIndexFile ) != 0 )
+			nError = -1;
+
+		return nError;
 	}
 
 	int LogFile::InternalOutput( size_t nSize, const LOGOG_CHAR *pData )
@@ -255,14 +1214,26 @@ namespace logog {
 	LogBuffer::LogBuffer( Target *pTarget ,
 		size_t s  ) :
 	m_pStart( NULL ),
-		m_nSize( 0 )
+		m_nSize( 0 ),
+		m_nRecords( 0 ),
+		m_nFlushBytes( 0 ),
+		m_nFlushRecords( 0 ),
+		m_nFlushLevel( LOGOG_LEVEL_NONE ),
+		m_nFlushInterval( 0 ),
+		m_bFlushStop( false ),
+		m_FlushThread( FlushThread, this ),
+		m_bFlushThreadStarted( false )
 	{
+		SetName( LOGOG_CONST_STRING( "buffer" ));
 		m_pOutputTarget = pTarget;
 		Allocate( s );
+		AddEmergencyTarget( this );
 	}
 
 	LogBuffer::~LogBuffer()
 	{
+		StopFlushThread();
+		RemoveEmergencyTarget( this );
 		Dump();
 		Deallocate();
 	}
@@ -294,6 +1265,8 @@ namespace logog {
 		while ( size-- )
 			*m_pCurrent++ = *pChars++;
 
+		m_nRecords++;
+
 		return 0;
 	}
 
@@ -306,6 +1279,10 @@ namespace logog {
 		if ( m_pOutputTarget == NULL )
 			return -1;
 
+		/* An empty buffer leaves the output target alone, since at shutdown it may already be destroyed. */
+		if ( m_pCurrent == m_pStart )
+			return 0;
+
 		// We have to lock the output target here, as we do an end run around its Receive() function */
 		ScopedLock sl( m_pOutputTarget->m_MutexReceive );
 
@@ -321,7 +1298,7 @@ namespace logog {
 
 			if ( m_pOutputTarget )
 			{
-				nError = m_pOutputTarget->Output( sOut );
+				nError = m_pOutputTarget->TimedOutput( sOut );
 				if ( nError != 0 )
 					return nError;
 			}
@@ -331,6 +1308,7 @@ namespace logog {
 
 		// reset buffer
 		m_pCurrent = m_pStart;
+		m_nRecords = 0;
 
 		return 0;
 	}
@@ -340,6 +1318,171 @@ namespace logog {
 		return Insert( &(*data), data.size() );
 	}
 
+	int LogBuffer::Flush()
+	{
+		/* With nowhere to write to, the messages stay in the buffer. */
+		if ( m_pOutputTarget == NULL )
+			return 0;
+
+		int nError;
+
+		{
+			ScopedLock sl( m_MutexReceive );
+			nError = Dump();
+		}
+
+		int nFlushError = m_pOutputTarget->Flush();
+		return ( nError != 0 ) ? nError : nFlushError;
+	}
+
+	int LogBuffer::Sync()
+	{
+		if ( m_pOutputTarget == NULL )
+			return 0;
+
+		int nError;
+
+		{
+			ScopedLock sl( m_MutexReceive );
+			nError = Dump();
+		}
+
+		int nSyncError = m_pOutputTarget->Sync();
+		return ( nError != 0 ) ? nError : nSyncError;
+	}
+
+	int LogBuffer::DumpAndFlush()
+	{
+		if ( m_pOutputTarget == NULL )
+			return 0;
+
+		int nError = Dump();
+		int nFlushError = m_pOutputTarget->Flush();
+
+		return ( nError != 0 ) ? nError : nFlushError;
+	}
+
+	int LogBuffer::Receive( const Topic &topic )
+	{
+		FormattedMessage *pFormatted = PrepareOutput( topic );
+		ScopedLock sl( m_MutexReceive );
+
+		int nError = FormatAndOutput( topic, pFormatted );
+
+		if (( topic.Level() <= m_nFlushLevel ) ||
+			(( m_nFlushRecords != 0 ) && ( m_nRecords >= m_nFlushRecords )) ||
+			(( m_nFlushBytes != 0 ) && ( (size_t)( m_pCurrent - m_pStart ) * sizeof( LOGOG_CHAR ) >= m_nFlushBytes )))
+		{
+			int nFlushError = DumpAndFlush();
+			if ( nError == 0 )
+				nError = nFlushError;
+		}
+
+		return nError;
+	}
+
+	void LogBuffer::SetFlushThreshold( size_t nBytes, size_t nRecords )
+	{
+		ScopedLock sl( m_MutexReceive );
+
+		m_nFlushBytes = nBytes;
+		m_nFlushRecords = nRecords;
+	}
+
+	void LogBuffer::SetFlushLevel( LOGOG_LEVEL_TYPE level )
+	{
+		ScopedLock sl( m_MutexReceive );
+
+		m_nFlushLevel = level;
+	}
+
+	void LogBuffer::SetFlushInterval( unsigned int nMilliseconds )
+	{
+		if ( nMilliseconds == 0 )
+		{
+			StopFlushThread();
+			return;
+		}
+
+		m_FlushCondition.Lock();
+		m_nFlushInterval = nMilliseconds;
+		m_FlushCondition.Signal();
+		m_FlushCondition.Unlock();
+
+		if ( !m_bFlushThreadStarted )
+		{
+			m_bFlushStop = false;
+			m_bFlushThreadStarted = ( m_FlushThread.Start() == 0 );
+		}
+	}
+
+	void LogBuffer::StopFlushThread()
+	{
+		if ( !m_bFlushThreadStarted )
+			return;
+
+		m_FlushCondition.Lock();
+		m_bFlushStop = true;
+		m_FlushCondition.Signal();
+		m_FlushCondition.Unlock();
+
+		Thread::WaitFor( m_FlushThread );
+		m_bFlushThreadStarted = false;
+	}
+
+	void *LogBuffer::FlushThread( void *pvParams )
+	{
+		LogBuffer *pThis = ( LogBuffer * )pvParams;
+
+		pThis->m_FlushCondition.Lock();
+
+		while ( !pThis->m_bFlushStop )
+		{
+			pThis->m_FlushCondition.Wait( pThis->m_nFlushInterval );
+
+			if ( pThis->m_bFlushStop )
+				break;
+
+			/* Never hold the condition's lock while waiting for m_MutexReceive, or StopFlushThread() could wait
+			 * on a thread that waits on a logging thread. */
+			pThis->m_FlushCondition.Unlock();
+			{
+				ScopedLock sl( pThis->m_MutexReceive );
+
+				if ( pThis->m_pCurrent != pThis->m_pStart )
+					pThis->DumpAndFlush();
+			}
+			pThis->m_FlushCondition.Lock();
+		}
+
+		pThis->m_FlushCondition.Unlock();
+
+		return NULL;
+	}
+
+	void LogBuffer::EmergencyDump()
+	{
+		/* Another thread may be inserting, so read the end once and never follow a size past it. */
+		LOGOG_CHAR *pEnd = m_pCurrent;
+		LOGOG_CHAR *pCurrent = m_pStart;
+
+		while ( pCurrent + sizeof( size_t ) / sizeof( LOGOG_CHAR ) <= pEnd )
+		{
+			size_t nSize = *( size_t * )pCurrent;
+			pCurrent = ( LOGOG_CHAR * )(( size_t * )pCurrent + 1 );
+
+			if ( nSize > (size_t)( pEnd - pCurrent ))
+				break;
+
+			size_t nLength = nSize;
+			if ( nLength > 0 && pCurrent[ nLength - 1 ] == (LOGOG_CHAR)'\0' )
+				nLength--;
+
+			EmergencyWrite( pCurrent, nLength * sizeof( LOGOG_CHAR ));
+			pCurrent += nSize;
+		}
+	}
+
 	void LogBuffer::Allocate( size_t size )
 	{
 		m_nSize = size;
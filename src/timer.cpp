@@ -76,5 +76,44 @@ namespace logog {
 		pStatic->s_pTimer = NULL;
 	}
 
+	LOGOG_UINT64 GetMonotonicNanoseconds()
+	{
+#ifdef LOGOG_FLAVOR_WINDOWS
+		static LARGE_INTEGER liFrequency;
+		LARGE_INTEGER liTime;
+
+		if ( liFrequency.QuadPart == 0 )
+			QueryPerformanceFrequency( &liFrequency );
+
+		QueryPerformanceCounter( &liTime );
+
+		return (LOGOG_UINT64)(( (double)liTime.QuadPart * 1000000000.0 ) / (double)liFrequency.QuadPart );
+#endif
+
+#ifdef LOGOG_FLAVOR_POSIX
+		timespec ts;
+		clock_gettime( CLOCK_MONOTONIC, &ts );
+		return (LOGOG_UINT64)ts.tv_sec * 1000000000ULL + (LOGOG_UINT64)ts.tv_nsec;
+#endif
+	}
+
+	LOGOG_UINT64 GetRealtimeNanoseconds()
+	{
+#ifdef LOGOG_FLAVOR_WINDOWS
+		FILETIME ft;
+		GetSystemTimeAsFileTime( &ft );
+
+		/* FILETIME counts 100 nanosecond intervals since 1601. */
+		LOGOG_UINT64 nTicks = ( (LOGOG_UINT64)ft.dwHighDateTime << 32 ) | ft.dwLowDateTime;
+		return ( nTicks - 116444736000000000ULL ) * 100;
+#endif
+
+#ifdef LOGOG_FLAVOR_POSIX
+		timespec ts;
+		clock_gettime( CLOCK_REALTIME, &ts );
+		return (LOGOG_UINT64)ts.tv_sec * 1000000000ULL + (LOGOG_UINT64)ts.tv_nsec;
+#endif
+	}
+
 }
 
@@ -23,6 +23,13 @@ namespace logog {
 		const double dTimestamp )
 	{
 		m_TopicFlags = 0;
+		m_pFields = NULL;
+		m_sFormat = NULL;
+		m_nFormatted = 0;
+		m_bTransmitting = false;
+
+		for ( size_t t = 0; t < LOGOG_FORMAT_MEMO_SIZE; t++ )
+			m_vFormatted[ t ] = NULL;
 
 		if ( sFileName != NULL )
 		{
@@ -68,6 +75,15 @@ namespace logog {
 			m_TopicFlags |= TOPIC_TIMESTAMP_FLAG;
 	}
 
+	Topic::~Topic()
+	{
+		for ( size_t t = 0; t < LOGOG_FORMAT_MEMO_SIZE; t++ )
+		{
+			if ( m_vFormatted[ t ] != NULL )
+				m_vFormatted[ t ]->Release();
+		}
+	}
+
 	bool Topic::IsTopic() const
 	{
 		return true;
@@ -98,7 +114,7 @@ namespace logog {
 			pCurrentTopic = ( Topic * )pCurrentNode;
 
 			if ( pCurrentTopic )
-				nError += pCurrentTopic->Receive( node );
+				nError += pCurrentTopic->Deliver( node );
 
 			++it;
 		}
@@ -110,7 +126,53 @@ namespace logog {
 
 	int Topic::Transmit()
 	{
-		return Send( *this );
+		/* The outputs of the last transmission are out of date. */
+		m_nFormatted = 0;
+		m_bTransmitting = true;
+
+		int nError = Send( *this );
+
+		m_bTransmitting = false;
+
+		return nError;
+	}
+
+	FormattedMessage *Topic::GetFormatted( Formatter &formatter, const Target &target ) const
+	{
+		if ( !m_bTransmitting )
+			return NULL;
+
+		bool bNullTerminated = target.GetNullTerminatesStrings();
+
+		for ( size_t t = 0; t < m_nFormatted; t++ )
+		{
+			if ( m_vFormatted[ t ]->Matches( formatter, bNullTerminated ))
+			{
+				m_vFormatted[ t ]->AddReference();
+				return m_vFormatted[ t ];
+			}
+		}
+
+		if ( m_nFormatted == LOGOG_FORMAT_MEMO_SIZE )
+			return NULL;
+
+		FormattedMessage *&pFormatted = m_vFormatted[ m_nFormatted ];
+
+		/* Reuse the output left from an earlier transmission, unless some target still holds it. */
+		if (( pFormatted != NULL ) && pFormatted->IsShared() )
+		{
+			pFormatted->Release();
+			pFormatted = NULL;
+		}
+
+		if ( pFormatted == NULL )
+			pFormatted = new FormattedMessage();
+
+		pFormatted->Format( formatter, *this, target );
+		m_nFormatted++;
+
+		pFormatted->AddReference();
+		return pFormatted;
 	}
 
 	int Topic::Receive( const Topic &node )
@@ -119,6 +181,11 @@ namespace logog {
 		return Send( node );
 	}
 
+	int Topic::Deliver( const Topic &node )
+	{
+		return Receive( node );
+	}
+
 	bool Topic::CanSubscribeTo( const Node &otherNode )
 	{
 		if ( CanSubscribe() == false )
@@ -225,6 +292,8 @@ namespace logog {
 	{
 		va_list args;
 
+		m_sFormat = cFormatMessage;
+
 		va_start( args, cFormatMessage );
 		m_vStringProps[ TOPIC_MESSAGE ].format_va( cFormatMessage, args );
 		va_end( args );
@@ -232,6 +301,19 @@ namespace logog {
 		m_TopicFlags |= TOPIC_MESSAGE_FLAG;
 	}
 
+	LOGOG_STRING &Topic::BeginFormat()
+	{
+		LOGOG_STRING &sMessage = m_vStringProps[ TOPIC_MESSAGE ];
+
+		sMessage.clear();
+		/* If the message still points at a constant string, this replaces it with a buffer of our own. */
+		sMessage.grow( LOGOG_FORMAT_INITIAL_LENGTH );
+
+		m_TopicFlags |= TOPIC_MESSAGE_FLAG;
+
+		return sMessage;
+	}
+
 	const LOGOG_STRING & Topic::FileName() const
 	{
 		return m_vStringProps[ TOPIC_FILE_NAME ];
@@ -314,6 +396,26 @@ namespace logog {
 		return m_TopicFlags;
 	}
 
+	const FieldSet *Topic::Fields() const
+	{
+		return m_pFields;
+	}
+
+	void Topic::Fields( const FieldSet *pFields )
+	{
+		m_pFields = pFields;
+	}
+
+	const LOGOG_CHAR *Topic::FormatString() const
+	{
+		return m_sFormat;
+	}
+
+	void Topic::FormatString( const LOGOG_CHAR *sFormat )
+	{
+		m_sFormat = sFormat;
+	}
+
 
 /********************************************************/
 
@@ -341,6 +443,53 @@ namespace logog {
 		}
 	}
 
+	Filter::~Filter()
+	{
+		/* At shutdown the node lists are destroyed first, and every node is then deleted in no particular order,
+		 * so there is nothing to detach from. */
+		LockableNodesType *pFilterNodes = ( LockableNodesType * )Static().s_pAllFilterNodes;
+
+		if ( pFilterNodes == NULL )
+			return;
+
+		{
+			ScopedLock sl( *pFilterNodes );
+			pFilterNodes->erase( this );
+		}
+
+		/* Otherwise, a filter that goes out of scope must not leave dangling pointers in the messages that
+		 * publish to it or in the targets it publishes to. */
+		for ( ;; )
+		{
+			Node *pSubscriber = NULL;
+			{
+				ScopedLock sl( m_Subscribers );
+				if ( !m_Subscribers.empty() )
+					pSubscriber = *m_Subscribers.begin();
+			}
+
+			if ( pSubscriber == NULL )
+				break;
+
+			UnpublishTo( *pSubscriber );
+		}
+
+		for ( ;; )
+		{
+			Node *pPublisher = NULL;
+			{
+				ScopedLock sl( m_Publishers );
+				if ( !m_Publishers.empty() )
+					pPublisher = *m_Publishers.begin();
+			}
+
+			if ( pPublisher == NULL )
+				break;
+
+			UnsubscribeTo( *pPublisher );
+		}
+	}
+
 	/** A FilterDefault represents a singleton filter whose level may be changed dynamically 
 	  * at run time.  We only determine message routing once, when a message is invoked the
 	  * first time.  So therefore a FilterDefault subscribes to all normal messages but
@@ -0,0 +1,434 @@
+/*
+ * \file bench.cpp Throughput and latency benchmarks for logog.
+ *
+ * Each benchmark initializes logog, creates one target, sends a fixed number of messages through the normal
+ * logging macros, and shuts logog down again.  Results are written one JSON object per line, so that runs from
+ * different releases can be compared mechanically.  A summary is also written to stderr.
+ *
+ * Usage: bench-logog [--iterations N] [--threads N] [--output FILE] [--target NAME] [--pattern PATTERN]
+ *                    [--formatter json|logfmt]
+ *
+ * The targets are: unformatted (a NullTarget that skips formatting, measuring routing alone), null (a NullTarget,
+ * measuring routing and formatting), memory (a MemoryTarget), buffer (a LogBuffer draining into a NullTarget),
+ * file (a LogFile), descriptor (a DescriptorLogFile) and direct (a DirectLogFile), both on POSIX systems only,
+ * binary (a BinaryLogFile), compressed (a CompressedLogFile) and cout.  If a pattern is given,
+ * every target formats with a PatternFormatter using it; if a formatter is given, every target formats with a
+ * FormatterJSON or a FormatterLogfmt.
+ *
+ * The cout benchmarks write their messages to standard output; redirect it if you don't want to see them.
+ */
+
+#include "logog.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+using namespace logog;
+
+/* Every allocation logog makes goes through these, so that we can report allocations per message
+ * regardless of whether the library was compiled with LOGOG_STATISTICS.
+ */
+static LOGOG_UINT64 s_nBenchAllocations = 0;
+
+static void *CountingMalloc( size_t nSize )
+{
+	LOGOG_ATOMIC_ADD( &s_nBenchAllocations, 1 );
+	return malloc( nSize );
+}
+
+static void CountingFree( void *p )
+{
+	free( p );
+}
+
+static const char *BENCH_LOG_FILE = "bench-logog.log";
+
+/* If set, the pattern given to a PatternFormatter used by every benchmarked target. */
+static const char *s_sPattern = NULL;
+
+/* If set, the name of the structured formatter used by every benchmarked target. */
+static const char *s_sFormatter = NULL;
+
+enum MessageKind
+{
+	MESSAGE_CONSTANT,
+	MESSAGE_FORMATTED,
+	MESSAGE_DISABLED
+};
+
+static const char *MessageKindName( MessageKind kind )
+{
+	switch ( kind )
+	{
+	case MESSAGE_CONSTANT:
+		return "constant";
+	case MESSAGE_FORMATTED:
+		return "formatted";
+	default:
+		return "disabled";
+	}
+}
+
+/* Each kind of message has exactly one call site, so every iteration reuses the same static Message. */
+static void LogOnce( MessageKind kind, int i )
+{
+	switch ( kind )
+	{
+	case MESSAGE_CONSTANT:
+		INFO( _LG( "A constant benchmark message of typical length for an application log" ));
+		break;
+	case MESSAGE_FORMATTED:
+#ifdef LOGOG_UNICODE
+		INFO( _LG( "Formatted: id=%d name=%ls ratio=%f mask=%x total=%ld" ), i, L"benchmark", i * 0.5, i, (long)i * 3 );
+#else // LOGOG_UNICODE
+		INFO( _LG( "Formatted: id=%d name=%s ratio=%f mask=%x total=%ld" ), i, "benchmark", i * 0.5, i, (long)i * 3 );
+#endif // LOGOG_UNICODE
+		break;
+	default:
+		/* The default level is set to LOGOG_LEVEL_ERROR for this kind, so this is filtered at run time. */
+		DBUG( _LG( "A debug message that the default filter discards: %d" ), i );
+		break;
+	}
+}
+
+struct BenchThreadParams
+{
+	MessageKind m_Kind;
+	int m_nIterations;
+	/** Per-call latencies in nanoseconds; only filled in if non-NULL. */
+	LOGOG_UINT64 *m_pLatencies;
+};
+
+static void *BenchThread( void *pvParams )
+{
+	BenchThreadParams *pParams = (BenchThreadParams *)pvParams;
+
+	if ( pParams->m_pLatencies != NULL )
+	{
+		for ( int i = 0; i < pParams->m_nIterations; i++ )
+		{
+			LOGOG_UINT64 nStart = GetMonotonicNanoseconds();
+			LogOnce( pParams->m_Kind, i );
+			pParams->m_pLatencies[ i ] = GetMonotonicNanoseconds() - nStart;
+		}
+	}
+	else
+	{
+		for ( int i = 0; i < pParams->m_nIterations; i++ )
+			LogOnce( pParams->m_Kind, i );
+	}
+
+	return NULL;
+}
+
+struct BenchResult
+{
+	const char *m_sTargetName;
+	MessageKind m_Kind;
+	int m_nThreads;
+	LOGOG_UINT64 m_nMessages;
+	LOGOG_UINT64 m_nNanoseconds;
+	LOGOG_UINT64 m_nAllocations;
+	/** Latency percentiles; only meaningful if m_bHasLatencies is true. */
+	bool m_bHasLatencies;
+	LOGOG_UINT64 m_nP50;
+	LOGOG_UINT64 m_nP99;
+	LOGOG_UINT64 m_nP999;
+};
+
+/* Creates the named target, plus any target it needs to drain into.  Returns NULL for an unknown name. */
+static Target *CreateBenchTarget( const char *sName, Target **ppDownstream )
+{
+	*ppDownstream = NULL;
+
+	if ( strcmp( sName, "null" ) == 0 )
+		return new NullTarget();
+
+	if ( strcmp( sName, "unformatted" ) == 0 )
+		return new NullTarget( true );
+
+	if ( strcmp( sName, "memory" ) == 0 )
+		return new MemoryTarget();
+
+	if ( strcmp( sName, "cout" ) == 0 )
+		return new Cout();
+
+	if ( strcmp( sName, "file" ) == 0 )
+		return new LogFile( BENCH_LOG_FILE );
+
+#ifdef LOGOG_FLAVOR_POSIX
+	if ( strcmp( sName, "descriptor" ) == 0 )
+		return new DescriptorLogFile( BENCH_LOG_FILE );
+
+	if ( strcmp( sName, "direct" ) == 0 )
+		return new DirectLogFile( BENCH_LOG_FILE );
+#endif // LOGOG_FLAVOR_POSIX
+
+	if ( strcmp( sName, "binary" ) == 0 )
+		return new BinaryLogFile( BENCH_LOG_FILE );
+
+	if ( strcmp( sName, "compressed" ) == 0 )
+		return new CompressedLogFile( BENCH_LOG_FILE );
+
+	if ( strcmp( sName, "buffer" ) == 0 )
+	{
+		/* The buffer drains into a discarding target, so that we measure the buffer and not the I/O. */
+		*ppDownstream = new NullTarget();
+		( *ppDownstream )->UnsubscribeToMultiple( AllFilters() );
+		LogBuffer *pBuffer = new LogBuffer( *ppDownstream );
+		pBuffer->SetNullTerminatesStrings( false );
+		return pBuffer;
+	}
+
+	return NULL;
+}
+
+static LOGOG_UINT64 Percentile( LOGOG_VECTOR< LOGOG_UINT64 > &vSorted, double dPercentile )
+{
+	if ( vSorted.empty() )
+		return 0;
+
+	size_t nIndex = (size_t)( dPercentile * (double)vSorted.size() );
+	if ( nIndex >= vSorted.size() )
+		nIndex = vSorted.size() - 1;
+
+	return vSorted[ nIndex ];
+}
+
+static bool RunBenchmark( const char *sTargetName, MessageKind kind, int nThreads, int nIterations,
+						 BenchResult &result )
+{
+	INIT_PARAMS params;
+	params.m_pfMalloc = CountingMalloc;
+	params.m_pfFree = CountingFree;
+
+	remove( BENCH_LOG_FILE );
+
+	LOGOG_INITIALIZE( &params );
+
+	Target *pDownstream;
+	Target *pTarget = CreateBenchTarget( sTargetName, &pDownstream );
+
+	if ( pTarget == NULL )
+	{
+		LOGOG_SHUTDOWN();
+		return false;
+	}
+
+	if ( kind == MESSAGE_DISABLED )
+		SetDefaultLevel( LOGOG_LEVEL_ERROR );
+
+	Formatter *pFormatter = NULL;
+	if ( s_sPattern != NULL )
+	{
+		LOGOG_VECTOR< LOGOG_CHAR > vPattern( s_sPattern, s_sPattern + strlen( s_sPattern ) + 1 );
+		pFormatter = new PatternFormatter( &vPattern[ 0 ] );
+	}
+	else if ( s_sFormatter != NULL )
+	{
+		if ( strcmp( s_sFormatter, "json" ) == 0 )
+			pFormatter = new FormatterJSON();
+		else
+			pFormatter = new FormatterLogfmt();
+	}
+
+	if ( pFormatter != NULL )
+		pTarget->SetFormatter( *pFormatter );
+
+	/* Latencies are only collected single threaded, where they aren't distorted by time slicing. */
+	LOGOG_VECTOR< LOGOG_UINT64 > vLatencies;
+	if ( nThreads == 1 )
+		vLatencies.resize( nIterations );
+
+	LOGOG_VECTOR< BenchThreadParams > vParams( nThreads );
+	for ( int t = 0; t < nThreads; t++ )
+	{
+		vParams[ t ].m_Kind = kind;
+		vParams[ t ].m_nIterations = nIterations;
+		vParams[ t ].m_pLatencies = ( nThreads == 1 ) ? &vLatencies[ 0 ] : NULL;
+	}
+
+	/* Warm up: create the call site's static Message and settle the allocator before we start counting. */
+	LogOnce( kind, 0 );
+
+	LOGOG_UINT64 nAllocationsBefore = LOGOG_ATOMIC_LOAD( &s_nBenchAllocations );
+	LOGOG_UINT64 nStart = GetMonotonicNanoseconds();
+
+	if ( nThreads == 1 )
+	{
+		BenchThread( &vParams[ 0 ] );
+	}
+	else
+	{
+		LOGOG_VECTOR< Thread * > vpThreads;
+
+		for ( int t = 0; t < nThreads; t++ )
+			vpThreads.push_back( new Thread( BenchThread, &vParams[ t ] ));
+
+		for ( int t = 0; t < nThreads; t++ )
+			vpThreads[ t ]->Start();
+
+		for ( int t = 0; t < nThreads; t++ )
+		{
+			Thread::WaitFor( *vpThreads[ t ] );
+			delete vpThreads[ t ];
+		}
+	}
+
+	result.m_nNanoseconds = GetMonotonicNanoseconds() - nStart;
+	result.m_nAllocations = LOGOG_ATOMIC_LOAD( &s_nBenchAllocations ) - nAllocationsBefore;
+	result.m_sTargetName = sTargetName;
+	result.m_Kind = kind;
+	result.m_nThreads = nThreads;
+	result.m_nMessages = (LOGOG_UINT64)nThreads * (LOGOG_UINT64)nIterations;
+
+	result.m_bHasLatencies = !vLatencies.empty();
+	std::sort( vLatencies.begin(), vLatencies.end() );
+	result.m_nP50 = Percentile( vLatencies, 0.5 );
+	result.m_nP99 = Percentile( vLatencies, 0.99 );
+	result.m_nP999 = Percentile( vLatencies, 0.999 );
+
+	delete pTarget;
+	if ( pDownstream != NULL )
+		delete pDownstream;
+	if ( pFormatter != NULL )
+		delete pFormatter;
+
+	LOGOG_SHUTDOWN();
+
+	remove( BENCH_LOG_FILE );
+
+	return true;
+}
+
+static void WriteResult( FILE *fp, const BenchResult &result )
+{
+	double dSeconds = (double)result.m_nNanoseconds / 1000000000.0;
+	double dNsPerMessage = (double)result.m_nNanoseconds / (double)result.m_nMessages;
+	double dMessagesPerSecond = dSeconds > 0.0 ? (double)result.m_nMessages / dSeconds : 0.0;
+	double dAllocationsPerMessage = (double)result.m_nAllocations / (double)result.m_nMessages;
+
+	fprintf( fp, "{\"benchmark\":\"%s/%s/%d\",\"target\":\"%s\",\"message\":\"%s\",\"threads\":%d,"
+		"\"messages\":%llu,\"ns_total\":%llu,\"ns_per_message\":%.1f,\"messages_per_second\":%.0f,"
+		"\"allocations_per_message\":%.3f,\"latency_ns\":",
+		result.m_sTargetName, MessageKindName( result.m_Kind ), result.m_nThreads,
+		result.m_sTargetName, MessageKindName( result.m_Kind ), result.m_nThreads,
+		(unsigned long long)result.m_nMessages, (unsigned long long)result.m_nNanoseconds,
+		dNsPerMessage, dMessagesPerSecond, dAllocationsPerMessage );
+
+	if ( result.m_bHasLatencies )
+		fprintf( fp, "{\"p50\":%llu,\"p99\":%llu,\"p999\":%llu}}\n", (unsigned long long)result.m_nP50,
+			(unsigned long long)result.m_nP99, (unsigned long long)result.m_nP999 );
+	else
+		fprintf( fp, "null}\n" );
+
+	fflush( fp );
+
+	fprintf( stderr, "%-11s %-10s %2d thread(s): %10.1f ns/msg %12.0f msg/s %7.3f allocs/msg",
+		result.m_sTargetName, MessageKindName( result.m_Kind ), result.m_nThreads,
+		dNsPerMessage, dMessagesPerSecond, dAllocationsPerMessage );
+
+	if ( result.m_bHasLatencies )
+		fprintf( stderr, "  p50 %llu p99 %llu p999 %llu ns", (unsigned long long)result.m_nP50,
+			(unsigned long long)result.m_nP99, (unsigned long long)result.m_nP999 );
+
+	fprintf( stderr, "\n" );
+}
+
+static void WriteConfiguration( FILE *fp, int nIterations, int nThreads )
+{
+	fprintf( fp, "{\"configuration\":{\"iterations\":%d,\"threads\":%d,\"char_size\":%d,"
+		"\"statistics\":%s,\"futex_mutex\":%s,\"leak_detection\":%s}}\n",
+		nIterations, nThreads, (int)sizeof( LOGOG_CHAR ),
+#ifdef LOGOG_STATISTICS
+		"true",
+#else
+		"false",
+#endif
+#ifdef LOGOG_FUTEX_MUTEX
+		"true",
+#else
+		"false",
+#endif
+#ifdef LOGOG_LEAK_DETECTION
+		"true"
+#else
+		"false"
+#endif
+		);
+}
+
+int main( int argc, char *argv[] )
+{
+	int nIterations = 100000;
+	int nThreads = 4;
+	const char *sOutput = "bench-logog.jsonl";
+	const char *sOnlyTarget = NULL;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		if (( strcmp( argv[ i ], "--iterations" ) == 0 ) && ( i + 1 < argc ))
+			nIterations = atoi( argv[ ++i ] );
+		else if (( strcmp( argv[ i ], "--threads" ) == 0 ) && ( i + 1 < argc ))
+			nThreads = atoi( argv[ ++i ] );
+		else if (( strcmp( argv[ i ], "--output" ) == 0 ) && ( i + 1 < argc ))
+			sOutput = argv[ ++i ];
+		else if (( strcmp( argv[ i ], "--target" ) == 0 ) && ( i + 1 < argc ))
+			sOnlyTarget = argv[ ++i ];
+		else if (( strcmp( argv[ i ], "--pattern" ) == 0 ) && ( i + 1 < argc ))
+			s_sPattern = argv[ ++i ];
+		else if (( strcmp( argv[ i ], "--formatter" ) == 0 ) && ( i + 1 < argc ) &&
+			(( strcmp( argv[ i + 1 ], "json" ) == 0 ) || ( strcmp( argv[ i + 1 ], "logfmt" ) == 0 )))
+			s_sFormatter = argv[ ++i ];
+		else
+		{
+			fprintf( stderr, "Usage: %s [--iterations N] [--threads N] [--output FILE] [--target NAME] [--pattern PATTERN] "
+				"[--formatter json|logfmt]\n", argv[ 0 ] );
+			return 1;
+		}
+	}
+
+	if ( nIterations < 1 || nThreads < 1 )
+	{
+		fprintf( stderr, "Iterations and threads must be positive\n" );
+		return 1;
+	}
+
+	FILE *fp = fopen( sOutput, "w" );
+	if ( fp == NULL )
+	{
+		fprintf( stderr, "Cannot open %s for writing\n", sOutput );
+		return 1;
+	}
+
+	WriteConfiguration( fp, nIterations, nThreads );
+
+	static const char *vTargets[] = { "unformatted", "null", "memory", "buffer", "file",
+#ifdef LOGOG_FLAVOR_POSIX
+		"descriptor", "direct",
+#endif // LOGOG_FLAVOR_POSIX
+		"binary", "compressed", "cout" };
+	static const MessageKind vKinds[] = { MESSAGE_CONSTANT, MESSAGE_FORMATTED, MESSAGE_DISABLED };
+
+	for ( size_t t = 0; t < sizeof( vTargets ) / sizeof( vTargets[ 0 ] ); t++ )
+	{
+		if (( sOnlyTarget != NULL ) && ( strcmp( sOnlyTarget, vTargets[ t ] ) != 0 ))
+			continue;
+
+		for ( size_t k = 0; k < sizeof( vKinds ) / sizeof( vKinds[ 0 ] ); k++ )
+		{
+			BenchResult result;
+
+			if ( RunBenchmark( vTargets[ t ], vKinds[ k ], 1, nIterations, result ))
+				WriteResult( fp, result );
+
+			if (( nThreads > 1 ) && RunBenchmark( vTargets[ t ], vKinds[ k ], nThreads, nIterations, result ))
+				WriteResult( fp, result );
+		}
+	}
+
+	fclose( fp );
+
+	return 0;
+}
@@ -8,6 +8,7 @@ const int TEST_STRESS_LEVEL = 1;
 #include "logog.hpp"
 
 #include <cstdio>
+#include <csignal>
 
 #include <fcntl.h>
 
@@ -15,6 +16,12 @@ const int TEST_STRESS_LEVEL = 1;
 #include <io.h>
 #endif
 
+#ifdef LOGOG_FLAVOR_POSIX
+#include <netinet/in.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
 using namespace logog;
 using namespace std;
 
@@ -96,262 +103,2932 @@ UNITTEST( Subscription )
         if ( n2.PublishTo( n1 ) != false )
             nResult++;
 
-        n2.Transmit();
+        n2.Transmit();
+
+        if ( n2.UnpublishTo( n1 ) != true )
+            nResult++;
+
+        if ( n1.UnsubscribeTo( n2 ) != false )
+            nResult++;
+    }
+
+    LOGOG_SHUTDOWN();
+
+//! [Subscription]
+
+    return nResult;
+}
+
+UNITTEST( GlobalNodelist )
+{
+    LOGOG_INITIALIZE();
+
+    const int MAX_NODES = 10 * TEST_STRESS_LEVEL;
+
+    LOGOG_VECTOR< Topic *> vTopics;
+
+    for (int t = 0; t < MAX_NODES; t++ )
+        vTopics.push_back( new Topic );
+
+    for ( int i = 0; i < MAX_NODES; i++ )
+        for ( int j = i + 1; j < MAX_NODES; j++ )
+            vTopics.at( i )->SubscribeTo( *vTopics.at( j ) );
+
+    LockableNodesType *pNodes = ( LockableNodesType * )Static().s_pAllNodes;
+
+    // For this test we assume that the default Filter has always been created.
+    if ( pNodes->size() != ( MAX_NODES + 1))
+    {
+        LOGOG_COUT << _LG("Incorrect number of nodes!") << endl;
+        return 1;
+    }
+
+    // Try having that master node send a message to all other nodes!
+    vTopics.at( MAX_NODES - 1)->Transmit();
+
+    // Let's try leaving all the nodes allocated and let logog clean them all up.
+    LOGOG_SHUTDOWN();
+
+    if ( Static().s_pAllNodes != NULL )
+    {
+        LOGOG_COUT << _LG("Could not delete all nodes!") << endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+
+UNITTEST( TimerTest )
+{
+    const int NUM_TRIALS = 10 * TEST_STRESS_LEVEL;
+    const int WAIT_TIME = 1000000 * TEST_STRESS_LEVEL;
+
+    Timer time;
+    LOGOG_TIME fCurrent = time.Get();
+
+    for ( int t = 0; t < NUM_TRIALS; t++  )
+    {
+        /* do busy work */
+        int k = 0;
+        for ( int i = 0; i < WAIT_TIME; i++ )
+            k = k + 1;  // fixes a lint warning
+
+        if ( time.Get() < fCurrent )
+        {
+            LOGOG_COUT << _LG("Timer error!  Non monotonic timer behavior") << endl;
+            return 1;
+        }
+        fCurrent = time.Get();
+        LOGOG_COUT << _LG("Current reported time: ") << fCurrent << endl;
+    }
+
+    return 0;
+}
+
+UNITTEST( TopicTest1 )
+{
+    LOGOG_INITIALIZE();
+
+    {
+        Topic t1( LOGOG_LEVEL_WARN,
+                  _LG( "file1.cpp" ), 50 );
+        Topic t2( LOGOG_LEVEL_WARN );
+        Topic t3( LOGOG_LEVEL_ERROR,
+                  _LG( "file2.cpp" ), 100 );
+        Topic t4( LOGOG_LEVEL_WARN, NULL, 0,
+                  _LG( "Group" ),
+                  _LG( "Category" ),
+                  _LG( "Message" ),
+                  30.0f);
+        Topic t5( LOGOG_LEVEL_CRITICAL, NULL, 0,
+                  _LG( "GroupGROUP" ),
+                  _LG( "Important Category" ),
+                  _LG( "Your Message Here"),
+                  150.0f);
+
+        if (t1.CanSubscribeTo( t2 ) == true)
+        {
+            LOGOG_COUT << _LG("Subscription test failed; t1 can subscribe to t2") << endl;
+            return 1;
+        }
+
+        if (t2.CanSubscribeTo( t1 ) == false )
+        {
+            LOGOG_COUT << _LG("Subscription test failed; t2 can't subscribe to t1") << endl;
+            return 1;
+        }
+
+        if ( t1.CanSubscribeTo( t3 ) == true )
+        {
+            LOGOG_COUT << _LG("Subscription test failed; t1 can subscribe to t3") << endl;
+            return 1;
+        }
+
+        if (t2.CanSubscribeTo( t3 ) == false )
+        {
+            LOGOG_COUT << _LG("Subscription test failed; t2 can't subscribe to t3") << endl;
+            return 1;
+        }
+
+        if (t4.CanSubscribeTo( t5 ) == false )
+        {
+            LOGOG_COUT << _LG("Subscription test failed; t4 can't subscribe to t5") << endl;
+            return 1;
+        }
+
+        if ( t5.CanSubscribeTo( t4 ) == true )
+        {
+            LOGOG_COUT << _LG("Subscription test failed; t5 can subscribe to t4") << endl;
+            return 1;
+        }
+    }
+
+    LOGOG_SHUTDOWN();
+
+    return 0;
+}
+
+UNITTEST( Checkpoint1 )
+{
+    LOGOG_INITIALIZE();
+
+    {
+        Checkpoint check( LOGOG_LEVEL_ALL, _LG( __FILE__ ), __LINE__,
+                          _LG("Group"), _LG("Category"), _LG("Message"), 1.0f );
+
+        Topic t;
+
+        Cerr cerrobj;
+        Cerr cerrgnu;
+        OutputDebug outdebug;
+
+        FormatterGCC f;
+        cerrgnu.SetFormatter( f );
+
+        check.PublishTo( t );
+        t.PublishToMultiple( AllTargets() );
+
+        LOGOG_COUT << _LG("Setup complete; ready to transmit ") << endl;
+        check.Transmit();
+    }
+
+    LOGOG_SHUTDOWN();
+
+    return 0;
+}
+
+UNITTEST( FormatString1 )
+{
+    LOGOG_INITIALIZE();
+    {
+        String s;
+
+        s.format( _LG("This is a test message.\n"));
+        LOGOG_COUT << s.c_str();
+
+        s.format( _LG("This is a test message: %d %x %f\n"), 1234, 0xf00d, 1.234f );
+        LOGOG_COUT << s.c_str();
+
+        const LOGOG_CHAR *p = _LG("Here is a string");
+
+#ifdef LOGOG_UNICODE
+        s.format( _LG("Here are six strings: %ls %ls %ls %ls %ls %ls \n"), p,p,p,p,p,p );
+#else // LOGOG_UNICODE
+        s.format( _LG("Here are six strings: %s %s %s %s %s %s \n"), p,p,p,p,p,p );
+#endif
+
+        LOGOG_COUT << s.c_str();
+    }
+
+    LOGOG_SHUTDOWN();
+
+    return 0;
+}
+
+UNITTEST( FormatTopic1 )
+{
+    LOGOG_INITIALIZE();
+    {
+        Cout out;
+        LogFile f( "log.txt");
+        Message m;
+
+        m.PublishToMultiple( AllTargets() );
+
+        m.Format( _LG("This is a test message: %d %x %f"), 1234, 0xf00d, 1.234f );
+        m.Transmit();
+
+        const char *p = "Here is a string";
+
+        m.Format( _LG("Here are six strings: %s %s %s %s %s %s"), p,p,p,p,p,p );
+        m.Transmit();
+    }
+
+    LOGOG_SHUTDOWN();
+
+    return 0;
+}
+
+UNITTEST( ThreadLocking )
+{
+    LOGOG_INITIALIZE();
+    {
+        Cout out; // only one of these please
+
+        const int NUM_THREADS = 10 * TEST_STRESS_LEVEL;
+
+        LOGOG_VECTOR< Thread *> vpThreads;
+        Mutex mSharedMutex;
+
+        for ( int t = 0; t < NUM_THREADS; t++ )
+            vpThreads.push_back( new Thread( (Thread::ThreadStartLocationType) LockingThread,&mSharedMutex ));
+
+        for ( int t = 0; t < NUM_THREADS; t++ )
+            vpThreads[ t ]->Start();
+
+        for ( int t = 0; t < NUM_THREADS; t++ )
+            Thread::WaitFor( *vpThreads[ t ]);
+
+		for ( int t = 0; t < NUM_THREADS; t++ )
+			delete vpThreads[t];
+
+    }
+
+    LOGOG_SHUTDOWN();
+
+    return _s_ThreadLockingTest;
+}
+
+struct ContendedCounter
+{
+    Mutex m_Mutex;
+    int m_nCount;
+};
+
+void ContendingThread( void *pvCounter )
+{
+    const int NUM_TRIALS = 10000 * TEST_STRESS_LEVEL;
+    ContendedCounter *pCounter = (ContendedCounter *)pvCounter;
+
+    for ( int t = 0; t < NUM_TRIALS; t++ )
+    {
+        ScopedLock sl( pCounter->m_Mutex );
+        pCounter->m_nCount++;
+    }
+}
+
+UNITTEST( MutexContention )
+{
+    const int NUM_THREADS = 4;
+    const int NUM_TRIALS = 10000 * TEST_STRESS_LEVEL;
+    int nResult = 0;
+
+    LOGOG_INITIALIZE();
+    {
+        ContendedCounter counter;
+        counter.m_nCount = 0;
+
+        LOGOG_VECTOR< Thread *> vpThreads;
+
+        for ( int t = 0; t < NUM_THREADS; t++ )
+            vpThreads.push_back( new Thread( (Thread::ThreadStartLocationType) ContendingThread, &counter ));
+
+        for ( int t = 0; t < NUM_THREADS; t++ )
+            vpThreads[ t ]->Start();
+
+        for ( int t = 0; t < NUM_THREADS; t++ )
+            Thread::WaitFor( *vpThreads[ t ]);
+
+        for ( int t = 0; t < NUM_THREADS; t++ )
+            delete vpThreads[t];
+
+        if ( counter.m_nCount != NUM_THREADS * NUM_TRIALS )
+        {
+            LOGOG_COUT << _LG("Mutex failed to serialize increments; count is ") << counter.m_nCount << endl;
+            nResult++;
+        }
+
+        MutexStatistics stats;
+        if ( counter.m_Mutex.GetStatistics( stats ) )
+        {
+            LOGOG_COUT << _LG("Acquisitions: ") << stats.m_nAcquisitions
+                       << _LG(", contended: ") << stats.m_nContendedAcquisitions
+                       << _LG(", wait ns: ") << stats.m_nWaitNanoseconds << endl;
+
+            if ( stats.m_nAcquisitions != (LOGOG_UINT64)( NUM_THREADS * NUM_TRIALS ))
+            {
+                LOGOG_COUT << _LG("Mutex statistics miscounted acquisitions") << endl;
+                nResult++;
+            }
+        }
+    }
+    LOGOG_SHUTDOWN();
+
+    return nResult;
+}
+
+UNITTEST( StatisticsSnapshot )
+{
+    int nResult = 0;
+
+//! [StatisticsSnapshot]
+    LOGOG_INITIALIZE();
+    {
+        LogFile logFile( "log.txt" );
+
+        for ( int i = 0; i < 10; i++ )
+            WARN( _LG("Counting warning %d"), i );
+
+        Statistics stats;
+        GetStats( stats );
+
+        LOGOG_STRING sReport;
+        stats.RenderText( sReport );
+        LOGOG_COUT << sReport.c_str();
+        stats.RenderJSON( sReport );
+        LOGOG_COUT << sReport.c_str();
+//! [StatisticsSnapshot]
+
+        if ( stats.m_bEnabled )
+        {
+            if ( stats.m_vTargets.size() != 1 || stats.m_vTargets[ 0 ].m_Counters.m_nMessages != 10 )
+            {
+                LOGOG_COUT << _LG("Target statistics did not count ten messages") << endl;
+                nResult++;
+            }
+
+            if ( stats.m_vMessages.size() != 1 || stats.m_vMessages[ 0 ].m_nHits != 10 )
+            {
+                LOGOG_COUT << _LG("Call site statistics did not count ten hits") << endl;
+                nResult++;
+            }
+
+            if ( stats.m_nAllocations == 0 )
+            {
+                LOGOG_COUT << _LG("Allocator statistics did not count any allocations") << endl;
+                nResult++;
+            }
+        }
+    }
+    LOGOG_SHUTDOWN();
+
+    return nResult;
+}
+
+/* A NullTarget that counts what it is given to output before discarding it. */
+class WatchedNullTarget : public NullTarget
+{
+public:
+    WatchedNullTarget( bool bSkipFormatting = false ) :
+        NullTarget( bSkipFormatting ), m_nOutputs( 0 ), m_nBytes( 0 ), m_nResult( 0 ) {}
+
+    virtual int Output( const LOGOG_STRING &data )
+    {
+        m_nOutputs++;
+        m_nBytes += data.size();
+        m_nResult |= NullTarget::Output( data );
+        return 0;
+    }
+
+    size_t m_nOutputs;
+    size_t m_nBytes;
+    int m_nResult;
+};
+
+UNITTEST( MemoryAndNullTargets )
+{
+    int nResult = 0;
+
+    LOGOG_INITIALIZE();
+    {
+        /* A deliberately tiny arena, so that it has to grow several times. */
+        MemoryTarget memory( 16 );
+        WatchedNullTarget nullFormatted;
+        WatchedNullTarget nullUnformatted( true );
+
+        for ( int i = 0; i < 100; i++ )
+            WARN( _LG("Captured warning %d"), i );
+
+        ERR( _LG("Captured error") );
+
+        if ( memory.GetRecordCount() != 101 )
+        {
+            LOGOG_COUT << _LG("MemoryTarget captured ") << memory.GetRecordCount() << _LG(" records instead of 101") << endl;
+            nResult++;
+        }
+
+        if ( memory.CountRecordsContaining( _LG("Captured warning") ) != 100 ||
+            memory.CountRecordsContaining( _LG("Captured warning 42\n") ) != 1 ||
+            memory.CountRecordsContaining( _LG("Captured error") ) != 1 )
+        {
+            LOGOG_COUT << _LG("MemoryTarget records do not contain the expected messages") << endl;
+            nResult++;
+        }
+
+        const LOGOG_CHAR *pLast = memory.GetRecord( 100 );
+        if ( pLast == NULL || String::Length( pLast ) != memory.GetRecordLength( 100 ) ||
+            memory.GetRecord( 101 ) != NULL )
+        {
+            LOGOG_COUT << _LG("MemoryTarget record lookup is inconsistent") << endl;
+            nResult++;
+        }
+
+        /* Both null targets receive every message and write nothing; only the one that formats has any output to
+         * discard. */
+        if ( nullFormatted.m_nOutputs != 101 || nullFormatted.m_nBytes == 0 || nullFormatted.m_nResult != 0 )
+        {
+            LOGOG_COUT << _LG("A formatting NullTarget was given ") << nullFormatted.m_nOutputs
+                       << _LG(" of 101 messages") << endl;
+            nResult++;
+        }
+
+        if ( nullUnformatted.m_nOutputs != 101 || nullUnformatted.m_nBytes != 0 || nullUnformatted.m_nResult != 0 )
+        {
+            LOGOG_COUT << _LG("A NullTarget that skips formatting was given ") << nullUnformatted.m_nOutputs
+                       << _LG(" messages and ") << nullUnformatted.m_nBytes << _LG(" characters") << endl;
+            nResult++;
+        }
+
+        memory.Clear();
+        INFO( _LG("After clearing") );
+
+        if ( memory.GetRecordCount() != 1 || memory.CountRecordsContaining( _LG("After clearing") ) != 1 )
+        {
+            LOGOG_COUT << _LG("MemoryTarget did not clear correctly") << endl;
+            nResult++;
+        }
+    }
+    LOGOG_SHUTDOWN();
+
+    return nResult;
+}
+
+/* Counts the messages it formats. */
+class FormatterCounting : public FormatterGCC
+{
+public:
+    FormatterCounting() : m_nFormatted( 0 ) {}
+
+    LOGOG_UINT64 m_nFormatted;
+
+protected:
+    virtual void Render( LOGOG_STRING &sOutput, const Topic &topic, const Target &target )
+    {
+        LOGOG_ATOMIC_ADD( &m_nFormatted, 1 );
+        FormatterGCC::Render( sOutput, topic, target );
+    }
+};
+
+/* Holds on to the output of the last message it received. */
+class HoldingTarget : public Target
+{
+public:
+    HoldingTarget() : m_pHeld( NULL ) {}
+    virtual ~HoldingTarget() { if ( m_pHeld != NULL ) m_pHeld->Release(); }
+
+    virtual int Receive( const Topic &topic )
+    {
+        ScopedLock sl( m_MutexReceive );
+        if ( m_pHeld != NULL )
+            m_pHeld->Release();
+        m_pHeld = topic.GetFormatted( *m_pFormatter, *this );
+        return 0;
+    }
+
+    virtual int Output( const LOGOG_STRING & ) { return 0; }
+
+    FormattedMessage *m_pHeld;
+};
+
+UNITTEST( SharedFormatting )
+{
+    int nResult = 0;
+
+    LOGOG_INITIALIZE();
+    {
+        FormatterCounting counting;
+        MemoryTarget first, second, terminated;
+        HoldingTarget holding;
+
+        first.SetFormatter( counting );
+        second.SetFormatter( counting );
+        terminated.SetFormatter( counting );
+        terminated.SetNullTerminatesStrings( true );
+        holding.SetFormatter( counting );
+
+        /* One rendering for the three targets that don't want a null, and one for the target that does. */
+        WARN( _LG("Shared output %d"), 1 );
+
+        if ( counting.m_nFormatted != 2 )
+        {
+            LOGOG_COUT << _LG("Four targets formatted a message ") << counting.m_nFormatted << _LG(" times instead of 2") << endl;
+            nResult++;
+        }
+
+        size_t nLength = first.GetRecordLength( 0 );
+        bool bSame = ( first.GetRecordCount() == 1 ) && ( second.GetRecordCount() == 1 ) &&
+            ( second.GetRecordLength( 0 ) == nLength ) && ( terminated.GetRecordCount() == 1 ) &&
+            ( first.CountRecordsContaining( _LG("Shared output 1\n") ) == 1 ) &&
+            ( terminated.CountRecordsContaining( _LG("Shared output 1\n") ) == 1 );
+
+        for ( size_t t = 0; bSame && t < nLength; t++ )
+            bSame = ( first.GetRecord( 0 )[ t ] == second.GetRecord( 0 )[ t ] );
+
+        if ( !bSame )
+        {
+            LOGOG_COUT << _LG("Targets sharing a formatter did not receive the same output") << endl;
+            nResult++;
+        }
+
+        /* A target may keep an output after the transmission; the next message must not overwrite it. */
+        FormattedMessage *pHeld = holding.m_pHeld;
+        if ( pHeld != NULL )
+            pHeld->AddReference();
+
+        WARN( _LG("Shared output %d"), 2 );
+
+        if ( pHeld == NULL || holding.m_pHeld == pHeld ||
+            String::Length( pHeld->Get().c_str() ) != nLength ||
+            first.CountRecordsContaining( _LG("Shared output 2\n") ) != 1 || counting.m_nFormatted != 4 )
+        {
+            LOGOG_COUT << _LG("An output held by a target was not kept") << endl;
+            nResult++;
+        }
+        else
+        {
+            for ( size_t t = 0; t < nLength; t++ )
+            {
+                if ( pHeld->Get().c_str()[ t ] != first.GetRecord( 0 )[ t ] )
+                {
+                    LOGOG_COUT << _LG("An output held by a target was overwritten") << endl;
+                    nResult++;
+                    break;
+                }
+            }
+        }
+
+        if ( pHeld != NULL )
+            pHeld->Release();
+
+        /* Outside a transmission, each target formats for itself. */
+        Topic topic( LOGOG_LEVEL_WARN, NULL, 0, NULL, NULL, _LG("Received directly") );
+        first.Receive( topic );
+        second.Receive( topic );
+
+        if ( counting.m_nFormatted != 6 || second.CountRecordsContaining( _LG("Received directly") ) != 1 )
+        {
+            LOGOG_COUT << _LG("Topics received outside a transmission were not formatted for each target") << endl;
+            nResult++;
+        }
+    }
+    LOGOG_SHUTDOWN();
+
+    return nResult;
+}
+
+struct FormattingThreadData
+{
+    Formatter *m_pFormatter;
+    const Topic *m_pTopic;
+    const Target *m_pTarget;
+    const LOGOG_STRING *m_pExpected;
+    int m_nErrors;
+};
+
+void FormattingThread( void *pvData )
+{
+    const int NUM_TRIALS = 2000 * TEST_STRESS_LEVEL;
+    FormattingThreadData *pData = (FormattingThreadData *)pvData;
+    LOGOG_STRING sOutput;
+
+    for ( int t = 0; t < NUM_TRIALS; t++ )
+    {
+        pData->m_pFormatter->FormatTo( sOutput, *pData->m_pTopic, *pData->m_pTarget );
+
+        bool bSame = ( sOutput.size() == pData->m_pExpected->size() );
+        for ( size_t n = 0; bSame && n < sOutput.size(); n++ )
+            bSame = ( sOutput.c_str()[ n ] == pData->m_pExpected->c_str()[ n ] );
+
+        if ( !bSame )
+            pData->m_nErrors++;
+    }
+}
+
+/* Appends to the output of its parent, and so must be called under its lock. */
+class FormatterAppending : public FormatterGCC
+{
+public:
+    virtual LOGOG_STRING &Format( const Topic &topic, const Target &target )
+    {
+        LOGOG_STRING &sOutput = FormatterGCC::Format( topic, target );
+        sOutput.append( _LG("(appended)") );
+        return sOutput;
+    }
+};
+
+/* Replaces the output of its parent for warnings only, so that the first message it formats comes back unchanged. */
+class FormatterBang : public FormatterGCC
+{
+public:
+    virtual LOGOG_STRING &Format( const Topic &topic, const Target &target )
+    {
+        if ( topic.Level() > LOGOG_LEVEL_WARN )
+            return FormatterGCC::Format( topic, target );
+
+        m_sMessageBuffer.clear();
+        m_sMessageBuffer.append( _LG("BANG\n") );
+        return m_sMessageBuffer;
+    }
+};
+
+/* Renders its own time of day, while its parent stays reentrant. */
+class FormatterClock : public ReentrantFormatterGCC
+{
+public:
+    virtual void RenderTimeOfDay()
+    {
+        m_sMessageBuffer.append( _LG("[clock] ") );
+    }
+};
+
+UNITTEST( ReentrantFormatters )
+{
+    const int NUM_THREADS = 4;
+    int nResult = 0;
+
+    LOGOG_INITIALIZE();
+    {
+        MemoryTarget target;
+        Topic topic( LOGOG_LEVEL_WARN, _LG("reentrant.cpp"), 42, _LG("group"), _LG("category"),
+            _LG("Formatted on many threads") );
+
+        ReentrantFormatterGCC gcc;
+        PatternFormatter pattern( _LG("%L [%g/%c] %f:%n %m") );
+        FormatterLogfmt logfmt;
+        Formatter *vFormatters[] = { &gcc, &pattern };
+
+        for ( size_t f = 0; f < sizeof( vFormatters ) / sizeof( vFormatters[ 0 ] ); f++ )
+        {
+            LOGOG_STRING sExpected;
+            vFormatters[ f ]->FormatTo( sExpected, topic, target );
+
+            if ( !vFormatters[ f ]->IsReentrant() )
+            {
+                LOGOG_COUT << _LG("Formatter ") << f << _LG(" is not reentrant") << endl;
+                nResult++;
+            }
+
+            FormattingThreadData vData[ NUM_THREADS ];
+            LOGOG_VECTOR< Thread * > vpThreads;
+
+            for ( int t = 0; t < NUM_THREADS; t++ )
+            {
+                FormattingThreadData data = { vFormatters[ f ], &topic, &target, &sExpected, 0 };
+                vData[ t ] = data;
+                vpThreads.push_back( new Thread( (Thread::ThreadStartLocationType)FormattingThread, &vData[ t ] ));
+            }
+
+            for ( int t = 0; t < NUM_THREADS; t++ )
+                vpThreads[ t ]->Start();
+
+            for ( int t = 0; t < NUM_THREADS; t++ )
+            {
+                Thread::WaitFor( *vpThreads[ t ] );
+                nResult += vData[ t ].m_nErrors;
+                delete vpThreads[ t ];
+            }
+        }
+
+        /* The time stamp changes, so just check that logfmt output can be rendered into separate buffers. */
+        LOGOG_STRING sFirst, sSecond;
+        logfmt.FormatTo( sFirst, topic, target );
+        logfmt.FormatTo( sSecond, topic, target );
+
+        if ( !logfmt.IsReentrant() || sFirst.size() == 0 || sSecond.size() == 0 ||
+            sFirst.c_str() == sSecond.c_str() )
+        {
+            LOGOG_COUT << _LG("FormatterLogfmt did not render into the buffers it was given") << endl;
+            nResult++;
+        }
+
+        /* FormatterGCC and FormatterMSVC are not reentrant, so that their subclasses may override Format(). */
+        FormatterGCC plainGCC;
+        FormatterMSVC plainMSVC;
+
+        if ( plainGCC.IsReentrant() || plainMSVC.IsReentrant() || !GetDefaultFormatter().IsReentrant() )
+        {
+            LOGOG_COUT << _LG("FormatterGCC or FormatterMSVC claims to be reentrant, or the default formatter doesn't")
+                       << endl;
+            nResult++;
+        }
+
+        /* A formatter that changes its parent's output in Format() keeps being called through Format(). */
+        FormatterAppending appending;
+        MemoryTarget appended;
+        appended.SetFormatter( appending );
+
+        WARN( _LG("Appended to %d"), 1 );
+        WARN( _LG("Appended to %d"), 2 );
+
+        if ( appending.IsReentrant() || appended.GetRecordCount() != 2 ||
+            appended.CountRecordsContaining( _LG("Appended to 2\n(appended)") ) != 1 )
+        {
+            LOGOG_COUT << _LG("A formatter overriding Format() was not called through it") << endl;
+            nResult++;
+        }
+
+        /* Reentrancy is declared, not guessed from the first message, which here comes back unchanged. */
+        FormatterBang bang;
+        MemoryTarget banged;
+        banged.SetFormatter( bang );
+
+        INFO( _LG("Not replaced") );
+        WARN( _LG("Replaced") );
+
+        if ( banged.GetRecordCount() != 2 || banged.CountRecordsContaining( _LG("Not replaced") ) != 1 ||
+            banged.CountRecordsContaining( _LG("BANG") ) != 1 )
+        {
+            LOGOG_COUT << _LG("A formatter replacing some messages in Format() was not always called through it")
+                       << endl;
+            nResult++;
+        }
+
+        /* An overridden RenderTimeOfDay() is used even when rendering into the caller's buffer. */
+        FormatterClock clock;
+        MemoryTarget clocked;
+        clock.SetShowTimeOfDay( true );
+        clocked.SetFormatter( clock );
+
+        WARN( _LG("Clocked") );
+
+        if ( !clock.IsReentrant() || clocked.CountRecordsContaining( _LG(": [clock] warning: Clocked") ) != 1 )
+        {
+            LOGOG_COUT << _LG("An overridden RenderTimeOfDay() was not called") << endl;
+            nResult++;
+        }
+    }
+    LOGOG_SHUTDOWN();
+
+    return nResult;
+}
+
+/* A target that can't output until it is opened, like a console that nobody is reading. */
+class GatedTarget : public MemoryTarget
+{
+public:
+    GatedTarget() : m_bOpen( false )
+    {
+        SetName( _LG("gated") );
+    }
+
+    void Open( bool bOpen )
+    {
+        m_Gate.Lock();
+        m_bOpen = bOpen;
+        m_Gate.Broadcast();
+        m_Gate.Unlock();
+    }
+
+    virtual int Output( const LOGOG_STRING &data )
+    {
+        m_Gate.Lock();
+        while ( !m_bOpen )
+            m_Gate.Wait();
+        m_Gate.Unlock();
+
+        return MemoryTarget::Output( data );
+    }
+
+protected:
+    Condition m_Gate;
+    bool m_bOpen;
+};
+
+/* A target that overrides Receive() and outputs the topic's strings instead of its formatted output. */
+class PropertiesTarget : public MemoryTarget
+{
+public:
+    virtual int Receive( const Topic &topic )
+    {
+        ScopedLock sl( m_MutexReceive );
+
+        LOGOG_STRING sLine;
+        sLine.grow( 256 );
+        sLine.append( topic.FileName().c_str() );
+        sLine.append( _LG('|') );
+        sLine.append( topic.Group().c_str() );
+        sLine.append( _LG('|') );
+        sLine.append( topic.Category().c_str() );
+        sLine.append( _LG('|') );
+        sLine.append( topic.Message().c_str() );
+
+        return Output( sLine );
+    }
+};
+
+UNITTEST( ParallelDelivery )
+{
+    int nResult = 0;
+
+    LOGOG_INITIALIZE();
+    {
+        GatedTarget slow;
+        MemoryTarget fast;
+
+//! [ParallelDelivery]
+        /* The slow target gets a queue and a thread of its own, so it holds up nobody else. */
+        slow.SetDeliveryQueue( 64 );
+//! [ParallelDelivery]
+
+        for ( int t = 0; t < 10; t++ )
+            INFO( _LG("delivered %d"), t );
+
+        if ( fast.GetRecordCount() != 10 )
+        {
+            LOGOG_COUT << _LG("A stuck target held up another; it received ") << fast.GetRecordCount()
+                       << _LG(" of 10 messages") << endl;
+            nResult++;
+        }
+
+        if (( slow.GetQueuedMessages() != 10 ) || ( slow.GetDeliveryLag() == 0 ))
+        {
+            LOGOG_COUT << _LG("The stuck target's queue holds ") << slow.GetQueuedMessages() << _LG(" messages, lagging ")
+                       << slow.GetDeliveryLag() << _LG(" ns") << endl;
+            nResult++;
+        }
+
+        Statistics stats;
+        GetStats( stats );
+
+        if ( stats.m_bEnabled && (( stats.GetSlowestTarget() == NULL ) || ( stats.GetSlowestTarget()->m_pTarget != &slow )))
+        {
+            LOGOG_COUT << _LG("The statistics did not name the stuck target as the slowest") << endl;
+            nResult++;
+        }
+
+        slow.Open( true );
+
+        if ( !slow.WaitForDelivery( GetMonotonicNanoseconds() + 10000000000ULL ))
+        {
+            LOGOG_COUT << _LG("The queue did not empty once its target could output") << endl;
+            nResult++;
+        }
+
+        LOGOG_STRING sExpected;
+
+        if ( slow.GetRecordCount() != 10 )
+        {
+            LOGOG_COUT << _LG("The queue delivered ") << slow.GetRecordCount() << _LG(" of 10 messages") << endl;
+            nResult++;
+        }
+
+        for ( size_t t = 0; t < slow.GetRecordCount(); t++ )
+        {
+            sExpected.format( _LG("delivered %d\n"), (int)t );
+
+            size_t nRecord = slow.GetRecordLength( t );
+            size_t nExpected = String::Length( sExpected.c_str() );
+
+            if (( nRecord < nExpected ) ||
+                ( memcmp( slow.GetRecord( t ) + nRecord - nExpected, sExpected.c_str(), nExpected * sizeof( LOGOG_CHAR )) != 0 ))
+            {
+                LOGOG_COUT << _LG("Queued messages arrived out of order: ") << slow.GetRecord( t ) << endl;
+                nResult++;
+                break;
+            }
+        }
+
+        /* A full queue that drops keeps what it has and counts the rest. */
+        slow.Open( false );
+        slow.SetDeliveryQueue( 2, true );
+
+        for ( int t = 0; t < 10; t++ )
+            INFO( _LG("overflowing %d"), t );
+
+        if ( slow.GetQueuedMessages() != 2 )
+        {
+            LOGOG_COUT << _LG("A full queue holds ") << slow.GetQueuedMessages() << _LG(" messages instead of 2") << endl;
+            nResult++;
+        }
+
+        GetStats( stats );
+
+        for ( size_t t = 0; stats.m_bEnabled && t < stats.m_vTargets.size(); t++ )
+        {
+            if (( stats.m_vTargets[ t ].m_pTarget == &slow ) && ( stats.m_vTargets[ t ].m_Counters.m_nDropped != 8 ))
+            {
+                LOGOG_COUT << _LG("A full queue dropped ") << stats.m_vTargets[ t ].m_Counters.m_nDropped
+                           << _LG(" messages instead of 8") << endl;
+                nResult++;
+            }
+        }
+
+        /* Stopping the queue delivers what is left, and delivery is synchronous again afterwards. */
+        slow.Open( true );
+        slow.SetDeliveryQueue( 0 );
+
+        INFO( _LG("synchronous") );
+
+        if ( slow.GetRecordCount() != 13 || slow.CountRecordsContaining( _LG("synchronous") ) != 1 )
+        {
+            LOGOG_COUT << _LG("The target has ") << slow.GetRecordCount() << _LG(" records instead of 13") << endl;
+            nResult++;
+        }
+
+        /* A target that reads the topic's strings in Receive() gets them from the queue too. */
+        PropertiesTarget properties;
+        properties.SetDeliveryQueue();
+
+        LOGOG_LEVEL_GROUP_CATEGORY_MESSAGE( LOGOG_LEVEL_WARN, "net", "io", _LG("queued %d"), 5 );
+        properties.SetDeliveryQueue( 0 );
+
+        if ( properties.CountRecordsContaining( _LG("|net|io|queued 5") ) != 1 ||
+             properties.CountRecordsContaining( _LG("test.cpp|") ) != 1 )
+        {
+            LOGOG_COUT << _LG("A queued topic lost its strings: ") << ( properties.GetRecordCount() ? properties.GetRecord( 0 ) : _LG("") ) << endl;
+            nResult++;
+        }
+
+        /* Shutdown delivers the queues of the targets it destroys. */
+        MemoryTarget *pLeft = new MemoryTarget();
+        pLeft->SetDeliveryQueue();
+
+        for ( int t = 0; t < 10; t++ )
+            INFO( _LG("left %d"), t );
+    }
+    LOGOG_SHUTDOWN();
+
+    return nResult;
+}
+
+UNITTEST( PatternFormatterLayout )
+{
+    int nResult = 0;
+
+    LOGOG_INITIALIZE();
+    {
+//! [PatternFormatter]
+        PatternFormatter pattern( _LG("%L [%g/%c] %f:%n %m (100%%) %q") );
+        MemoryTarget memory;
+        memory.SetFormatter( pattern );
+
+        LOGOG_LEVEL_GROUP_CATEGORY_MESSAGE( LOGOG_LEVEL_WARN, "net", "io", _LG("Pattern message %d"), 7 );
+//! [PatternFormatter]
+        int nLine = __LINE__ - 2;
+
+        LOGOG_STRING sExpected;
+        sExpected.format( _LG("warning [net/io] %s:%d Pattern message 7 (100%%) %%q\n"), __FILE__, nLine );
+
+        if ( memory.GetRecordCount() != 1 || memory.CountRecordsContaining( sExpected.c_str() ) != 1 )
+        {
+            LOGOG_COUT << _LG("PatternFormatter rendered \"") << ( memory.GetRecordCount() ? memory.GetRecord( 0 ) : _LG("") )
+                << _LG("\" instead of \"") << sExpected.c_str() << _LG("\"") << endl;
+            nResult++;
+        }
+
+        /* The time of day is rendered once and then reused within the same second. */
+        pattern.SetPattern( _LG("%T|%T|%m") );
+        memory.Clear();
+        INFO( _LG("Timed") );
+
+        const LOGOG_CHAR *pRecord = memory.GetRecord( 0 );
+        size_t nFirst = 0;
+        while ( pRecord != NULL && pRecord[ nFirst ] != '|' && pRecord[ nFirst ] != '\0' )
+            nFirst++;
+
+        if ( pRecord == NULL || nFirst == 0 || memory.CountRecordsContaining( _LG("|Timed\n") ) != 1 )
+        {
+            LOGOG_COUT << _LG("PatternFormatter did not render the time of day") << endl;
+            nResult++;
+        }
+    }
+    LOGOG_SHUTDOWN();
+
+    return nResult;
+}
+
+/* Escapes one character the way a JSON string needs it, for comparison with FormatWriter::PutJSONString(). */
+static void AppendEscapedReference( LOGOG_STRING &s, LOGOG_CHAR c )
+{
+    switch ( c )
+    {
+    case '"':   s.append( _LG("\\\"") ); break;
+    case '\\':  s.append( _LG("\\\\") ); break;
+    case '\n':  s.append( _LG("\\n") ); break;
+    case '\t':  s.append( _LG("\\t") ); break;
+    case '\x01': s.append( _LG("\\u0001") ); break;
+    default:    s.append( c ); break;
+    }
+}
+
+UNITTEST( StructuredFormatters )
+{
+    int nResult = 0;
+
+    LOGOG_INITIALIZE();
+    {
+        /* Put each special character at every position of strings long enough to take the vectorized path. */
+        const LOGOG_CHAR vSpecials[] = { '"', '\\', '\n', '\t', '\x01' };
+
+        for ( size_t nSpecial = 0; nSpecial < sizeof( vSpecials ) / sizeof( vSpecials[ 0 ] ); nSpecial++ )
+        {
+            for ( size_t nLength = 1; nLength <= 40; nLength++ )
+            {
+                for ( size_t nPosition = 0; nPosition < nLength; nPosition++ )
+                {
+                    LOGOG_CHAR vInput[ 40 ];
+                    LOGOG_STRING sExpected, sEscaped;
+
+                    sExpected.grow( 512 );
+                    sExpected.append( (LOGOG_CHAR)'"' );
+                    for ( size_t t = 0; t < nLength; t++ )
+                    {
+                        vInput[ t ] = ( t == nPosition ) ? vSpecials[ nSpecial ] : (LOGOG_CHAR)( 'a' + t % 26 );
+                        AppendEscapedReference( sExpected, vInput[ t ] );
+                    }
+                    sExpected.append( (LOGOG_CHAR)'"' );
+                    sExpected.append( (LOGOG_CHAR)NULL );
+                    sEscaped.grow( 512 );
+
+                    FormatWriter writer( sEscaped );
+                    writer.PutJSONString( vInput, nLength );
+                    writer.Put( (LOGOG_CHAR)NULL );
+
+                    size_t nEscaped = sEscaped.size();
+                    if ( nEscaped != sExpected.size() ||
+                        memcmp( sEscaped.c_str(), sExpected.c_str(), nEscaped * sizeof( LOGOG_CHAR )) != 0 )
+                    {
+                        LOGOG_COUT << _LG("PutJSONString rendered ") << sEscaped.c_str() << _LG(" instead of ")
+                            << sExpected.c_str() << endl;
+                        nResult++;
+                    }
+                }
+            }
+        }
+
+//! [FormatterJSON]
+        FormatterJSON json;
+        MemoryTarget memory;
+        memory.SetFormatter( json );
+
+        LOGOG_LEVEL_GROUP_CATEGORY_MESSAGE( LOGOG_LEVEL_WARN, "net", "io", _LG("say \"hi\"\\path\n\tnext\x01 %d"), 1 );
+//! [FormatterJSON]
+        int nLine = __LINE__ - 2;
+
+        LOGOG_STRING sExpected;
+        sExpected.format( _LG(",\"level\":\"warning\",\"file\":\"%s\",\"line\":%d,\"group\":\"net\",\"category\":\"io\",\"thread\":"),
+            __FILE__, nLine );
+
+        const LOGOG_CHAR *pRecord = memory.GetRecord( 0 );
+        if ( memory.GetRecordCount() != 1 ||
+            memory.CountRecordsContaining( _LG("{\"timestamp\":\"") ) != 1 ||
+            memory.CountRecordsContaining( sExpected.c_str() ) != 1 ||
+            memory.CountRecordsContaining( _LG(",\"message\":\"say \\\"hi\\\"\\\\path\\n\\tnext\\u0001 1\"}\n") ) != 1 ||
+            pRecord[ 33 ] != '.' || pRecord[ 40 ] != 'Z' || pRecord[ 42 ] != ',' )
+        {
+            LOGOG_COUT << _LG("FormatterJSON rendered ") << ( pRecord ? pRecord : _LG("nothing") ) << endl;
+            nResult++;
+        }
+
+//! [FormatterLogfmt]
+        FormatterLogfmt logfmt;
+        memory.SetFormatter( logfmt );
+        memory.Clear();
+
+        LOGOG_LEVEL_GROUP_CATEGORY_MESSAGE( LOGOG_LEVEL_INFO, "net", "a=b", _LG("hello world") );
+        INFO( _LG("plain") );
+//! [FormatterLogfmt]
+
+        if ( memory.GetRecordCount() != 2 ||
+            memory.CountRecordsContaining( _LG(" level=info file=") ) != 2 ||
+            memory.CountRecordsContaining( _LG(" group=net category=\"a=b\" thread=") ) != 1 ||
+            memory.CountRecordsContaining( _LG(" message=\"hello world\"\n") ) != 1 ||
+            memory.CountRecordsContaining( _LG(" message=plain\n") ) != 1 )
+        {
+            for ( size_t t = 0; t < memory.GetRecordCount(); t++ )
+                LOGOG_COUT << _LG("FormatterLogfmt rendered ") << memory.GetRecord( t ) << endl;
+            nResult++;
+        }
+
+        /* A negative line number is rendered with its sign, as the text formatters render it. */
+        Topic negative( LOGOG_LEVEL_WARN, _LG("negative.cpp"), -3 );
+        negative.PublishTo( memory );
+        negative.BeginFormat().append( _LG("before the start") );
+
+        memory.Clear();
+        negative.Transmit();
+        memory.SetFormatter( json );
+        negative.Transmit();
+
+        if ( memory.CountRecordsContaining( _LG(" line=-3 ") ) != 1 ||
+            memory.CountRecordsContaining( _LG(",\"line\":-3,") ) != 1 )
+        {
+            for ( size_t t = 0; t < memory.GetRecordCount(); t++ )
+                LOGOG_COUT << _LG("A negative line number was rendered as ") << memory.GetRecord( t ) << endl;
+            nResult++;
+        }
+    }
+    LOGOG_SHUTDOWN();
+
+    return nResult;
+}
+
+UNITTEST( KeyValueFields )
+{
+    int nResult = 0;
+
+    LOGOG_INITIALIZE();
+    {
+        FormatterJSON json;
+        MemoryTarget memory;
+        memory.SetFormatter( json );
+
+        const LOGOG_CHAR *sPath = _LG("/index \"main\"");
+        LOGOG_STRING sMethod( _LG("GET") );
+
+//! [KeyValueFields]
+        INFO_KV( _LG("request done"), _LG("latency_us"), 1250, _LG("status"), -3, _LG("bytes"), (size_t)4096,
+            _LG("ratio"), 0.25, _LG("cached"), true, _LG("path"), sPath, _LG("method"), sMethod );
+//! [KeyValueFields]
+
+        if ( memory.CountRecordsContaining( _LG("\"message\":\"request done\",\"latency_us\":1250,\"status\":-3,"
+                "\"bytes\":4096,\"ratio\":0.25,\"cached\":true,\"path\":\"/index \\\"main\\\"\",\"method\":\"GET\"}\n") ) != 1 )
+        {
+            LOGOG_COUT << _LG("FormatterJSON rendered fields as ") << memory.GetRecord( 0 ) << endl;
+            nResult++;
+        }
+
+        /* Human-readable formatters append the fields logfmt style; messages without fields are unchanged. */
+        FormatterGCC gcc;
+        memory.SetFormatter( gcc );
+        memory.Clear();
+
+        WARN_KV( _LG("slow"), _LG("latency_us"), 90000u, _LG("path"), sPath );
+        WARN( _LG("plain") );
+
+        if ( memory.CountRecordsContaining( _LG("slow latency_us=90000 path=\"/index \\\"main\\\"\"\n") ) != 1 ||
+            memory.CountRecordsContaining( _LG("plain\n") ) != 1 )
+        {
+            LOGOG_COUT << _LG("FormatterGCC rendered fields as ") << memory.GetRecord( 0 ) << endl;
+            nResult++;
+        }
+
+        /* A FieldFilter forwards only the messages whose fields match. */
+        FormatterLogfmt logfmt;
+        MemoryTarget routed;
+        routed.SetFormatter( logfmt );
+        routed.UnsubscribeToMultiple( AllFilters() );
+
+        FieldFilter filter( _LG("status") );
+        filter.MatchInteger( 500 );
+        filter.PublishTo( routed );
+
+        for ( int nStatus = 200; nStatus <= 500; nStatus += 100 )
+            INFO_KV( _LG("response"), _LG("status"), nStatus );
+        INFO( _LG("no fields") );
+
+        if ( routed.GetRecordCount() != 1 || routed.CountRecordsContaining( _LG(" message=response status=500\n") ) != 1 )
+        {
+            LOGOG_COUT << _LG("FieldFilter routed ") << routed.GetRecordCount() << _LG(" records") << endl;
+            nResult++;
+        }
+
+        filter.MatchString( _LG("error") );
+        routed.Clear();
+        INFO_KV( _LG("response"), _LG("status"), _LG("error") );
+        INFO_KV( _LG("response"), _LG("status"), _LG("ok") );
+
+        if ( routed.GetRecordCount() != 1 || routed.CountRecordsContaining( _LG(" status=error\n") ) != 1 )
+        {
+            LOGOG_COUT << _LG("FieldFilter matched strings in ") << routed.GetRecordCount() << _LG(" records") << endl;
+            nResult++;
+        }
+    }
+    LOGOG_SHUTDOWN();
+
+    return nResult;
+}
+
+UNITTEST( BinaryLogRoundTrip )
+{
+    int nResult = 0;
+    const char *sFileName = "binary.lgb";
+    const char *sTruncatedName = "binary-truncated.lgb";
+
+    remove( sFileName );
+    remove( sTruncatedName );
+
+    /* Two runs append to the same file; each starts its stream with a header and describes its call sites again. */
+    for ( int nRun = 0; nRun < 2; nRun++ )
+    {
+        LOGOG_INITIALIZE();
+        {
+            BinaryLogFile binary( sFileName );
+
+            for ( int t = 0; t < 2; t++ )
+                INFO( _LG("count %d"), t + nRun * 2 );
+
+            ERR_KV( _LG("failed"), _LG("code"), -42, _LG("path"), _LG("/tmp/x y"), _LG("ratio"), 0.5 );
+        }
+        LOGOG_SHUTDOWN();
+    }
+
+    LOGOG_INITIALIZE();
+    {
+        BinaryLogReader reader;
+        BinaryLogRecord record;
+        int nRecords = 0;
+        int nCounts = 0;
+        LOGOG_UINT64 nCountSite = 0;
+        LOGOG_UINT64 nPreviousTime = 0;
+
+        if ( !reader.Open( sFileName ))
+        {
+            LOGOG_COUT << _LG("BinaryLogReader could not open the binary log") << endl;
+            nResult++;
+        }
+
+        while ( reader.Next( record ))
+        {
+            nRecords++;
+
+            if ( record.m_nTime < nPreviousTime || strstr( record.m_Site.m_sFileName, "test.cpp" ) == NULL ||
+                record.m_Site.m_nLineNumber <= 0 )
+            {
+                LOGOG_COUT << _LG("Binary record ") << nRecords << _LG(" has a bad time or call site") << endl;
+                nResult++;
+            }
+            nPreviousTime = record.m_nTime;
+
+            if ( record.m_Site.m_nLevel == LOGOG_LEVEL_INFO )
+            {
+                char vExpected[ 16 ];
+                sprintf( vExpected, "count %d", nCounts );
+
+                /* Both messages from the loop share a call site. */
+                if ( nCounts % 2 == 0 )
+                    nCountSite = record.m_Site.m_nId;
+
+                if ( strcmp( record.m_sMessage, vExpected ) != 0 || strcmp( record.m_Site.m_sFormat, "count %d" ) != 0 ||
+                    record.m_Site.m_nId != nCountSite || record.m_nFieldCount != 0 )
+                {
+                    LOGOG_COUT << _LG("Binary record ") << nRecords << _LG(" does not match count ") << nCounts << endl;
+                    nResult++;
+                }
+
+                nCounts++;
+            }
+            else if ( record.m_Site.m_nLevel != LOGOG_LEVEL_ERROR || strcmp( record.m_sMessage, "failed" ) != 0 ||
+                record.m_nFieldCount != 3 ||
+                strcmp( record.m_vFields[ 0 ].m_sKey, "code" ) != 0 || record.m_vFields[ 0 ].m_Type != FIELD_INTEGER ||
+                record.m_vFields[ 0 ].m_nInteger != -42 ||
+                strcmp( record.m_vFields[ 1 ].m_sKey, "path" ) != 0 || record.m_vFields[ 1 ].m_Type != FIELD_STRING ||
+                strcmp( record.m_vFields[ 1 ].m_sString, "/tmp/x y" ) != 0 ||
+                record.m_vFields[ 2 ].m_Type != FIELD_FLOAT || record.m_vFields[ 2 ].m_dFloat != 0.5 )
+            {
+                LOGOG_COUT << _LG("Binary record ") << nRecords << _LG(" has the wrong message or fields") << endl;
+                nResult++;
+            }
+        }
+
+        if ( nRecords != 6 || nCounts != 4 || reader.IsCorrupt() )
+        {
+            LOGOG_COUT << _LG("BinaryLogReader read ") << nRecords << _LG(" records") << endl;
+            nResult++;
+        }
+
+        reader.Close();
+
+        /* A file that ends part way through a record reads up to the last complete record and reports corruption. */
+        FILE *fpIn = fopen( sFileName, "rb" );
+        FILE *fpOut = fopen( sTruncatedName, "wb" );
+        LOGOG_VECTOR< char > vBytes;
+        int nChar;
+
+        while (( nChar = getc( fpIn )) != EOF )
+            vBytes.push_back( (char)nChar );
+
+        /* Cut into the last field's value, past any padding. */
+        fwrite( &vBytes[ 0 ], 1, vBytes.size() - 12, fpOut );
+        fclose( fpIn );
+        fclose( fpOut );
+
+        nRecords = 0;
+        if ( reader.Open( sTruncatedName ))
+            while ( reader.Next( record ))
+                nRecords++;
+
+        if ( nRecords != 5 || !reader.IsCorrupt() )
+        {
+            LOGOG_COUT << _LG("BinaryLogReader read ") << nRecords << _LG(" records from a truncated log") << endl;
+            nResult++;
+        }
+
+        /* A topic whose level changes is described again, under a new site id. */
+        BinaryFormatter formatter;
+        MemoryTarget memory;
+        Topic topic( LOGOG_LEVEL_WARN, _LG("site.cpp"), 7, _LG("group") );
+        LOGOG_VECTOR< char > vStream;
+
+        for ( int t = 0; t < 2; t++ )
+        {
+            topic.BeginFormat().append( _LG("changing level") );
+
+            const LOGOG_STRING &sRecord = formatter.Format( topic, memory );
+            const char *pRecord = (const char *)sRecord.c_str();
+            vStream.insert( vStream.end(), pRecord, pRecord + sRecord.size() * sizeof( LOGOG_CHAR ));
+
+            topic.Level( LOGOG_LEVEL_ERROR );
+        }
+
+        /* Then site 0 is redefined by a record that is cut off in its file name. */
+        size_t nComplete = vStream.size();
+        const unsigned char vPartialSite[] = { BINARY_RECORD_SITE, 0, LOGOG_LEVEL_WARN, 7, 20, 'c', 'u', 't' };
+        vStream.insert( vStream.end(), vPartialSite, vPartialSite + sizeof( vPartialSite ));
+
+        BinaryLogReader splitReader;
+        BinaryLogRecord vRecords[ 2 ];
+
+        splitReader.SetBuffer( &vStream[ 0 ], vStream.size() );
+
+        if ( !splitReader.Next( vRecords[ 0 ] ) || !splitReader.Next( vRecords[ 1 ] ) ||
+            vRecords[ 0 ].m_Site.m_nLevel != LOGOG_LEVEL_WARN || vRecords[ 1 ].m_Site.m_nLevel != LOGOG_LEVEL_ERROR ||
+            vRecords[ 0 ].m_Site.m_nId == vRecords[ 1 ].m_Site.m_nId )
+        {
+            LOGOG_COUT << _LG("A topic whose level changed was not described again") << endl;
+            nResult++;
+        }
+
+        if ( splitReader.Next( record ) || splitReader.IsCorrupt() || splitReader.GetBufferPosition() != nComplete )
+        {
+            LOGOG_COUT << _LG("A cut off site record was not left to be read again") << endl;
+            nResult++;
+        }
+
+        /* A message for site 0 still finds its first definition, not the strings that never arrived. */
+        const unsigned char vMessage[] = { BINARY_RECORD_MESSAGE, 0, 0, 0, 1, 'm', 0 };
+        splitReader.SetBuffer( vMessage, sizeof( vMessage ));
+
+        if ( !splitReader.Next( record ) || strcmp( record.m_Site.m_sFileName, "site.cpp" ) != 0 ||
+            strcmp( record.m_sMessage, "m" ) != 0 )
+        {
+            LOGOG_COUT << _LG("A cut off site record changed the site it redefined") << endl;
+            nResult++;
+        }
+    }
+    LOGOG_SHUTDOWN();
+
+    return nResult;
+}
+
+UNITTEST( CompressedLogRoundTrip )
+{
+    int nResult = 0;
+
+    /* The codec must round trip empty, short, incompressible and highly repetitive blocks. */
+    LOGOG_VECTOR< unsigned char > vInput, vCompressed, vOutput;
+    unsigned int nSeed = 12345;
+
+    for ( size_t nSize = 0; nSize < 70000; nSize = nSize * 3 + 1 )
+    {
+        for ( int nKind = 0; nKind < 3; nKind++ )
+        {
+            vInput.resize( nSize );
+            for ( size_t t = 0; t < nSize; t++ )
+            {
+                nSeed = nSeed * 1103515245 + 12345;
+                vInput[ t ] = (unsigned char)(( nKind == 0 ) ? ( nSeed >> 16 ) : ( nKind == 1 ) ? 'x' : "abcab"[ ( t / 7 ) % 5 ] );
+            }
+
+            vCompressed.resize( CompressBoundLZ4( nSize ) + 1 );
+            vOutput.resize( nSize + 1 );
+
+            size_t nCompressed = CompressBlockLZ4( nSize ? &vInput[ 0 ] : NULL, nSize, &vCompressed[ 0 ] );
+
+            if ( nCompressed > CompressBoundLZ4( nSize ) ||
+                !DecompressBlockLZ4( &vCompressed[ 0 ], nCompressed, &vOutput[ 0 ], nSize ) ||
+                ( nSize > 0 && memcmp( &vInput[ 0 ], &vOutput[ 0 ], nSize ) != 0 ))
+            {
+                LOGOG_COUT << _LG("LZ4 round trip failed for ") << nSize << _LG(" bytes of kind ") << nKind << endl;
+                nResult++;
+            }
+        }
+    }
+
+    static const CompressionCodec vCodecs[] = { COMPRESSION_LZ4, COMPRESSION_ZLIB };
+
+    for ( size_t nCodec = 0; nCodec < sizeof( vCodecs ) / sizeof( vCodecs[ 0 ] ); nCodec++ )
+    {
+        const char *sFileName = "compressed.lgz";
+        LOGOG_VECTOR< unsigned char > vExpected;
+
+        remove( sFileName );
+
+        LOGOG_INITIALIZE();
+        {
+            MemoryTarget memory;
+            CompressedLogFile compressed( sFileName, vCodecs[ nCodec ], 4096 );
+
+            /* An index would hold offsets into the uncompressed output, so a compressed log refuses one. */
+            remove( "compressed.lgz" LOGOG_INDEX_SUFFIX );
+
+            if ( compressed.EnableIndex() )
+            {
+                LOGOG_COUT << _LG("CompressedLogFile accepted an index") << endl;
+                nResult++;
+            }
+
+            for ( int t = 0; t < 2000; t++ )
+                INFO( _LG("request %d served in %d ms"), t, t % 17 );
+
+            compressed.Flush();
+
+            for ( size_t t = 0; t < memory.GetRecordCount(); t++ )
+            {
+                const unsigned char *pRecord = (const unsigned char *)memory.GetRecord( t );
+                vExpected.insert( vExpected.end(), pRecord, pRecord + memory.GetRecordLength( t ) * sizeof( LOGOG_CHAR ));
+            }
+        }
+        LOGOG_SHUTDOWN();
+
+        LOGOG_INITIALIZE();
+        {
+            CompressedLogReader reader;
+            LOGOG_VECTOR< unsigned char > vRead( vExpected.size() + 1 );
+            size_t nRead = 0;
+
+            if ( reader.Open( sFileName ))
+                nRead = reader.Read( &vRead[ 0 ], vRead.size() );
+
+            FILE *fp = fopen( sFileName, "rb" );
+            fseek( fp, 0, SEEK_END );
+            size_t nFileSize = (size_t)ftell( fp );
+            fclose( fp );
+
+            if ( nRead != vExpected.size() || memcmp( &vRead[ 0 ], &vExpected[ 0 ], nRead ) != 0 || reader.IsCorrupt() )
+            {
+                LOGOG_COUT << _LG("CompressedLogReader read ") << nRead << _LG(" of ") << vExpected.size() << _LG(" bytes") << endl;
+                nResult++;
+            }
+
+            FILE *fpIndex = fopen( "compressed.lgz" LOGOG_INDEX_SUFFIX, "rb" );
+
+            if ( fpIndex != NULL )
+            {
+                LOGOG_COUT << _LG("CompressedLogFile wrote an index") << endl;
+                fclose( fpIndex );
+                nResult++;
+            }
+
+            if ( nFileSize * 4 > vExpected.size() )
+            {
+                LOGOG_COUT << _LG("CompressedLogFile only compressed ") << vExpected.size() << _LG(" bytes to ") << nFileSize << endl;
+                nResult++;
+            }
+
+            /* A file cut short reads back a prefix, up to the last whole block. */
+            const char *sTruncatedName = "compressed-truncated.lgz";
+            LOGOG_VECTOR< char > vBytes( nFileSize );
+
+            fp = fopen( sFileName, "rb" );
+            fread( &vBytes[ 0 ], 1, nFileSize, fp );
+            fclose( fp );
+
+            fp = fopen( sTruncatedName, "wb" );
+            fwrite( &vBytes[ 0 ], 1, nFileSize - 5, fp );
+            fclose( fp );
+
+            nRead = 0;
+            if ( reader.Open( sTruncatedName ))
+                nRead = reader.Read( &vRead[ 0 ], vRead.size() );
+
+            if ( nRead == 0 || nRead >= vExpected.size() || memcmp( &vRead[ 0 ], &vExpected[ 0 ], nRead ) != 0 ||
+                !reader.IsCorrupt() )
+            {
+                LOGOG_COUT << _LG("CompressedLogReader read ") << nRead << _LG(" bytes from a truncated file") << endl;
+                nResult++;
+            }
+        }
+        LOGOG_SHUTDOWN();
+    }
+
+    return nResult;
+}
+
+UNITTEST( LogFileIndex )
+{
+    int nResult = 0;
+    const char *sFileName = "indexed.log";
+    const char *sIndexName = "indexed.log" LOGOG_INDEX_SUFFIX;
+
+    remove( sFileName );
+    remove( sIndexName );
+
+    /* Two runs of 50 records each, in buckets of ten; the 25th record of each run is an error. */
+    for ( int nRun = 0; nRun < 2; nRun++ )
+    {
+        LOGOG_INITIALIZE();
+        {
+            LogFile file( sFileName );
+            file.EnableIndex( 0, 10 );
+
+            for ( int t = 0; t < 50; t++ )
+            {
+                if ( t == 24 )
+                    ERR( _LG("boom") );
+                else
+                    INFO( _LG("record %d"), t );
+            }
+        }
+        LOGOG_SHUTDOWN();
+    }
+
+    LOGOG_INITIALIZE();
+    {
+        LogIndex index;
+        LogIndex::RangesType vRanges;
+
+        if ( !index.Open( sFileName ) || index.GetEntries().size() != 10 )
+        {
+            LOGOG_COUT << _LG("LogIndex read ") << index.GetEntries().size() << _LG(" entries") << endl;
+            nResult++;
+        }
+
+        const LogIndex::EntriesType &vEntries = index.GetEntries();
+        FILE *fp = fopen( sFileName, "rb" );
+        LOGOG_UINT64 nLogSize = SeekLogFileEnd( fp );
+        fclose( fp );
+
+        /* The buckets tile the log, apart from any byte order mark at the start. */
+        for ( size_t t = 1; t < vEntries.size(); t++ )
+        {
+            if ( vEntries[ t ].m_nOffset != vEntries[ t - 1 ].m_nOffset + vEntries[ t - 1 ].m_nLength ||
+                vEntries[ t ].m_nRecords != 10 || vEntries[ t ].m_nFirstTime < vEntries[ t - 1 ].m_nLastTime )
+            {
+                LOGOG_COUT << _LG("Index entry ") << t << _LG(" does not follow the one before it") << endl;
+                nResult++;
+            }
+        }
+
+        if ( vEntries.empty() || vEntries.back().m_nOffset + vEntries.back().m_nLength != nLogSize )
+        {
+            LOGOG_COUT << _LG("The index does not cover the log") << endl;
+            nResult++;
+        }
+
+        /* Only the third bucket of each run holds an error. */
+        if ( vEntries.size() == 10 &&
+            ( index.Find( 0, (LOGOG_UINT64)-1, LOGOG_LEVEL_ERROR, vRanges ) != 2 ||
+            vRanges[ 0 ].m_nOffset != vEntries[ 2 ].m_nOffset || vRanges[ 0 ].m_nLength != vEntries[ 2 ].m_nLength ||
+            vRanges[ 1 ].m_nOffset != vEntries[ 7 ].m_nOffset || vEntries[ 2 ].m_nLevel != LOGOG_LEVEL_ERROR ))
+        {
+            LOGOG_COUT << _LG("LogIndex found ") << vRanges.size() << _LG(" ranges holding errors") << endl;
+            nResult++;
+        }
+
+        /* The first run's buckets are merged into one range. */
+        if ( vEntries.size() == 10 &&
+            ( index.Find( vEntries[ 0 ].m_nFirstTime, vEntries[ 4 ].m_nLastTime, LOGOG_LEVEL_ALL, vRanges ) < 1 ||
+            vRanges[ 0 ].m_nOffset != vEntries[ 0 ].m_nOffset ||
+            vRanges[ 0 ].m_nLength < vEntries[ 4 ].m_nOffset + vEntries[ 4 ].m_nLength - vEntries[ 0 ].m_nOffset ||
+            index.Find( vEntries[ 9 ].m_nLastTime + 1, (LOGOG_UINT64)-1, LOGOG_LEVEL_ALL, vRanges ) != 0 ))
+        {
+            LOGOG_COUT << _LG("LogIndex found the wrong ranges for a time period") << endl;
+            nResult++;
+        }
+
+        /* Anything written after the last bucket is always included. */
+        fp = fopen( sFileName, "ab" );
+        fwrite( "unindexed", 1, 9, fp );
+        fclose( fp );
+
+        if ( !index.Open( sFileName ) ||
+            index.Find( vEntries.empty() ? 0 : vEntries.back().m_nLastTime + 1, (LOGOG_UINT64)-1, LOGOG_LEVEL_ALL, vRanges ) != 1 ||
+            vRanges[ 0 ].m_nOffset != nLogSize || vRanges[ 0 ].m_nLength != 9 )
+        {
+            LOGOG_COUT << _LG("LogIndex did not include the unindexed end of the log") << endl;
+            nResult++;
+        }
+    }
+    LOGOG_SHUTDOWN();
+
+    return nResult;
+}
+
+/* Reads every record in a flight recorder, and checks that they run "record N" consecutively up to nLast.
+ * Returns the number of records read, or -1 if they don't. */
+static int ReadFlightRecords( FlightRecorderReader &reader, int nLast )
+{
+    const unsigned char *pData;
+    size_t nLength;
+    int nRecords = 0;
+    int nFirst = -1;
+    LOGOG_STRING sExpected;
+
+    while ( reader.Next( pData, nLength ))
+    {
+        if ( nFirst < 0 )
+        {
+            /* The oldest record may be any of them. */
+            for ( nFirst = 0; nFirst <= nLast; nFirst++ )
+            {
+                sExpected.format( _LG("record %d\n"), nFirst );
+                if ( nLength == String::Length( sExpected.c_str() ) * sizeof( LOGOG_CHAR ) && memcmp( pData, sExpected.c_str(), nLength ) == 0 )
+                    break;
+            }
+        }
+
+        sExpected.format( _LG("record %d\n"), nFirst + nRecords );
+        if ( nLength != String::Length( sExpected.c_str() ) * sizeof( LOGOG_CHAR ) || memcmp( pData, sExpected.c_str(), nLength ) != 0 )
+            return -1;
+
+        nRecords++;
+    }
+
+    return ( nFirst + nRecords - 1 == nLast ) ? nRecords : -1;
+}
+
+UNITTEST( FlightRecorderRing )
+{
+    int nResult = 0;
+    const char *sFileName = "flight.rec";
+    const char *sCoreName = "flight.core";
+
+    remove( sFileName );
+    remove( sCoreName );
+
+    LOGOG_INITIALIZE();
+    {
+        PatternFormatter pattern( _LG("%m") );
+        FlightRecorderReader reader;
+        int nRecords;
+
+        /* Many more records than fit in a 4K ring. */
+        {
+            FlightRecorder flight( sFileName, 4096 );
+            flight.SetFormatter( pattern );
+
+            for ( int t = 0; t < 500; t++ )
+                INFO( _LG("record %d"), t );
+        }
+
+        if ( !reader.Open( sFileName ) || ( nRecords = ReadFlightRecords( reader, 499 )) < 50 ||
+            reader.GetRecordsWritten() != 500 )
+        {
+            LOGOG_COUT << _LG("FlightRecorder did not keep the newest records in order") << endl;
+            nResult++;
+        }
+
+        /* A recorder of the same size carries on where the last one stopped. */
+        {
+            FlightRecorder flight( sFileName, 4096 );
+            flight.SetFormatter( pattern );
+
+            for ( int t = 500; t < 510; t++ )
+                INFO( _LG("record %d"), t );
+        }
+
+        if ( !reader.Open( sFileName ) || ReadFlightRecords( reader, 509 ) < 50 || reader.GetRecordsWritten() != 510 )
+        {
+            LOGOG_COUT << _LG("FlightRecorder did not continue an existing ring") << endl;
+            nResult++;
+        }
+
+        /* Bury the recorder two pages into a larger file, as in a core dump. */
+        FILE *fpIn = fopen( sFileName, "rb" );
+        FILE *fpOut = fopen( sCoreName, "wb" );
+        char vBuffer[ 4096 ];
+        size_t nRead;
+
+        memset( vBuffer, 'x', sizeof( vBuffer ));
+        fwrite( vBuffer, 1, sizeof( vBuffer ), fpOut );
+        fwrite( vBuffer, 1, sizeof( vBuffer ), fpOut );
+        while (( nRead = fread( vBuffer, 1, sizeof( vBuffer ), fpIn )) > 0 )
+            fwrite( vBuffer, 1, nRead, fpOut );
+        fclose( fpIn );
+        fclose( fpOut );
+
+        if ( reader.Open( sCoreName ) || !reader.Open( sCoreName, true ) || ReadFlightRecords( reader, 509 ) < 50 )
+        {
+            LOGOG_COUT << _LG("FlightRecorderReader did not find a recorder inside a larger file") << endl;
+            nResult++;
+        }
+
+        reader.Close();
+    }
+    LOGOG_SHUTDOWN();
+
+    remove( sFileName );
+    remove( sCoreName );
+
+    return nResult;
+}
+
+static void EmergencySignalHandler( int nSignal )
+{
+    EmergencyMessage msg;
+    msg.Append( "signal " ).AppendInteger( nSignal ).Append( " value " ).AppendInteger( (LOGOG_INT64)-1234567 * 1000000 )
+        .Append( " address " ).AppendHex( 0xdeadbeefU );
+    msg.Write();
+
+    EmergencyFlush();
+}
+
+/* Does the block of memory contain the bytes of sText? */
+static bool ContainsBytes( const LOGOG_VECTOR< char > &vData, const void *pText, size_t nLength )
+{
+    for ( size_t t = 0; t + nLength <= vData.size(); t++ )
+    {
+        if ( memcmp( &vData[ t ], pText, nLength ) == 0 )
+            return true;
+    }
+
+    return false;
+}
+
+UNITTEST( EmergencyLogFromSignal )
+{
+    int nResult = 0;
+    FILE *fp = tmpfile();
+    int nDescriptor = fileno( fp );
+    int nStandardError = 2;
+
+    LOGOG_INITIALIZE();
+    {
+        PatternFormatter pattern( _LG("%m") );
+        LogBuffer buffer;
+        buffer.SetFormatter( pattern );
+
+        INFO( _LG("buffered %d"), 7 );
+
+        SetEmergencyDescriptors( &nDescriptor, 1 );
+        signal( SIGTERM, EmergencySignalHandler );
+        raise( SIGTERM );
+        signal( SIGTERM, SIG_DFL );
+        SetEmergencyDescriptors( &nStandardError, 1 );
+    }
+    LOGOG_SHUTDOWN();
+
+    LOGOG_VECTOR< char > vData;
+    char vChunk[ 256 ];
+    size_t nRead;
+
+    rewind( fp );
+    while (( nRead = fread( vChunk, 1, sizeof( vChunk ), fp )) > 0 )
+        vData.insert( vData.end(), vChunk, vChunk + nRead );
+    fclose( fp );
+
+    char sExpected[ 80 ];
+    sprintf( sExpected, "emergency: signal %d value -1234567000000 address 0xdeadbeef\n", (int)SIGTERM );
+
+    if ( !ContainsBytes( vData, sExpected, strlen( sExpected )))
+    {
+        LOGOG_COUT << _LG("The signal handler's emergency message was not written") << endl;
+        nResult++;
+    }
+
+    const LOGOG_CHAR *sBuffered = _LG("buffered 7\n");
+    if ( !ContainsBytes( vData, sBuffered, String::Length( sBuffered ) * sizeof( LOGOG_CHAR )))
+    {
+        LOGOG_COUT << _LG("EmergencyFlush did not write out the LogBuffer") << endl;
+        nResult++;
+    }
+
+    return nResult;
+}
+
+/* The number of SlowTarget outputs under way, and whether a SlowTarget was flushed or destroyed during one. */
+static LOGOG_UINT64 s_nSlowOutputs = 0;
+static LOGOG_UINT64 s_nFinishedInOutput = 0;
+
+/* A target that takes a while to output, and notes whether it is flushed or destroyed while it is outputting. */
+class SlowTarget : public MemoryTarget
+{
+public:
+    virtual ~SlowTarget()
+    {
+        if ( LOGOG_ATOMIC_LOAD( &s_nSlowOutputs ) != 0 )
+            LOGOG_ATOMIC_STORE( &s_nFinishedInOutput, 1 );
+    }
+
+    virtual int Flush()
+    {
+        if ( LOGOG_ATOMIC_LOAD( &s_nSlowOutputs ) != 0 )
+            LOGOG_ATOMIC_STORE( &s_nFinishedInOutput, 1 );
+        return 0;
+    }
+
+    virtual int Output( const LOGOG_STRING &data )
+    {
+        LOGOG_ATOMIC_ADD( &s_nSlowOutputs, 1 );
+
+        Condition pause;
+        pause.Lock();
+        pause.Wait( 100 );
+        pause.Unlock();
+
+        int nResult = MemoryTarget::Output( data );
+        LOGOG_ATOMIC_ADD( &s_nSlowOutputs, (LOGOG_UINT64)-1 );
+        return nResult;
+    }
+};
+
+static void *LogSlowly( void * )
+{
+    INFO( _LG("slowly") );
+    return NULL;
+}
+
+UNITTEST( ShutdownWithDeadline )
+{
+    int nResult = 0;
+    const char *sFileName = "drain.log";
+
+    remove( sFileName );
+
+    /* Messages waiting in a LogBuffer reach the file it feeds, whichever is destroyed first. */
+    LOGOG_INITIALIZE();
+    {
+        LogFile *pFile = new LogFile( sFileName );
+        new LogBuffer( pFile );
+
+        /* The file receives messages only through the buffer. */
+        pFile->UnsubscribeToMultiple( AllFilters() );
+
+        for ( int t = 0; t < 100; t++ )
+            INFO( _LG("drained %d"), t );
+
+        if ( !Shutdown( 10.0 ))
+        {
+            LOGOG_COUT << _LG("Shutdown did not drain its targets before the deadline") << endl;
+            nResult++;
+        }
+    }
+
+    LOGOG_VECTOR< char > vData;
+    char vChunk[ 256 ];
+    size_t nRead;
+    FILE *fp = fopen( sFileName, "rb" );
+
+    while ( fp != NULL && ( nRead = fread( vChunk, 1, sizeof( vChunk ), fp )) > 0 )
+        vData.insert( vData.end(), vChunk, vChunk + nRead );
+    if ( fp != NULL )
+        fclose( fp );
+
+    const LOGOG_CHAR *sDrained = _LG("drained ");
+    size_t nLength = String::Length( sDrained ) * sizeof( LOGOG_CHAR );
+    int nFound = 0;
+
+    for ( size_t t = 0; t + nLength <= vData.size(); t++ )
+    {
+        if ( memcmp( &vData[ t ], sDrained, nLength ) == 0 )
+            nFound++;
+    }
+
+    if ( nFound != 100 )
+    {
+        LOGOG_COUT << _LG("Shutdown left ") << nFound << _LG(" of 100 messages in the log") << endl;
+        nResult++;
+    }
+
+    /* A deadline that has already passed drains nothing, and says so. */
+    LOGOG_INITIALIZE();
+    {
+        new MemoryTarget();
+
+        if ( Shutdown( 0.0 ))
+        {
+            LOGOG_COUT << _LG("Shutdown claimed to drain its targets with no time to do so") << endl;
+            nResult++;
+        }
+    }
+
+    /* A message that another thread is already transmitting reaches its target before the target is flushed. */
+    Thread logger( (Thread::ThreadStartLocationType)LogSlowly, NULL );
+
+    LOGOG_INITIALIZE();
+    {
+        new SlowTarget();
+        logger.Start();
+
+        Condition sleeper;
+        sleeper.Lock();
+        while ( LOGOG_ATOMIC_LOAD( &s_nSlowOutputs ) == 0 )
+            sleeper.Wait( 1 );
+        sleeper.Unlock();
+
+        if ( !Shutdown( 10.0 ))
+        {
+            LOGOG_COUT << _LG("Shutdown did not wait for a message in flight before the deadline") << endl;
+            nResult++;
+        }
+    }
+    Thread::WaitFor( logger );
+
+    if ( LOGOG_ATOMIC_LOAD( &s_nFinishedInOutput ) != 0 )
+    {
+        LOGOG_COUT << _LG("Shutdown flushed a target while a message was being transmitted to it") << endl;
+        nResult++;
+    }
+
+    remove( sFileName );
+
+    return nResult;
+}
+
+UNITTEST( LogBufferFlushPolicy )
+{
+    int nResult = 0;
+
+    LOGOG_INITIALIZE();
+    {
+        MemoryTarget memory;
+        LogBuffer buffer( &memory );
+        memory.UnsubscribeToMultiple( AllFilters() );
+
+        /* Errors push everything before them out at once. */
+        buffer.SetFlushLevel( LOGOG_LEVEL_ERROR );
+
+        INFO( _LG("held 1") );
+        WARN( _LG("held 2") );
+
+        if ( memory.GetRecordCount() != 0 )
+        {
+            LOGOG_COUT << _LG("LogBuffer dumped before its flush policy called for it") << endl;
+            nResult++;
+        }
+
+        ERR( _LG("flushed by level") );
+
+        if ( memory.GetRecordCount() != 3 )
+        {
+            LOGOG_COUT << _LG("LogBuffer did not dump on an error") << endl;
+            nResult++;
+        }
+
+        /* Every fourth message. */
+        buffer.SetFlushThreshold( 0, 4 );
+
+        for ( int t = 0; t < 9; t++ )
+            INFO( _LG("counted %d"), t );
+
+        if ( memory.GetRecordCount() != 11 )
+        {
+            LOGOG_COUT << _LG("LogBuffer held ") << 12 - memory.GetRecordCount() << _LG(" messages; expected 1") << endl;
+            nResult++;
+        }
+
+        /* The last message goes out on the timer. */
+        buffer.SetFlushInterval( 10 );
+
+        Condition sleeper;
+        sleeper.Lock();
+        for ( int t = 0; t < 500 && memory.GetRecordCount() != 12; t++ )
+            sleeper.Wait( 10 );
+        sleeper.Unlock();
+
+        if ( memory.GetRecordCount() != 12 )
+        {
+            LOGOG_COUT << _LG("LogBuffer did not dump on its timer") << endl;
+            nResult++;
+        }
+
+        buffer.SetFlushInterval( 0 );
+    }
+    LOGOG_SHUTDOWN();
+
+    return nResult;
+}
+
+void DurableLoggingThread( void * )
+{
+    for ( int t = 0; t < 25; t++ )
+    {
+        ERR( _LG("durable %d"), t );
+        INFO( _LG("buffered %d"), t );
+    }
+}
+
+UNITTEST( LogFileGroupCommit )
+{
+    int nResult = 0;
+    const char *sFileName = "durable.log";
+    const int NUM_THREADS = 4;
+
+    remove( sFileName );
+
+    LOGOG_INITIALIZE();
+    {
+        LogFile file( sFileName );
+        file.SetDurableLevel( LOGOG_LEVEL_ERROR );
+
+        /* A durable message is on disk, and so visible to another reader, by the time ERR returns. */
+        INFO( _LG("before") );
+        ERR( _LG("committed") );
+
+        FILE *fp = fopen( sFileName, "rb" );
+        LOGOG_UINT64 nSize = ( fp != NULL ) ? SeekLogFileEnd( fp ) : 0;
+        if ( fp != NULL )
+            fclose( fp );
+
+        if ( nSize == 0 || file.GetCommitCount() != 1 )
+        {
+            LOGOG_COUT << _LG("A durable message was not committed before it was acknowledged") << endl;
+            nResult++;
+        }
+
+        LOGOG_VECTOR< Thread *> vpThreads;
+
+        for ( int t = 0; t < NUM_THREADS; t++ )
+            vpThreads.push_back( new Thread( (Thread::ThreadStartLocationType) DurableLoggingThread, NULL ));
+
+        for ( int t = 0; t < NUM_THREADS; t++ )
+            vpThreads[ t ]->Start();
+
+        for ( int t = 0; t < NUM_THREADS; t++ )
+            Thread::WaitFor( *vpThreads[ t ]);
+
+        for ( int t = 0; t < NUM_THREADS; t++ )
+            delete vpThreads[t];
+
+        /* At most one commit per durable message, and fewer if any were grouped. */
+        LOGOG_UINT64 nCommits = file.GetCommitCount();
+        if ( nCommits < 2 || nCommits > 1 + NUM_THREADS * 25 )
+        {
+            LOGOG_COUT << _LG("LogFile made ") << (unsigned long)nCommits << _LG(" commits for ")
+                << 1 + NUM_THREADS * 25 << _LG(" durable messages") << endl;
+            nResult++;
+        }
+    }
+    LOGOG_SHUTDOWN();
+
+    remove( sFileName );
+
+    return nResult;
+}
+
+#ifdef LOGOG_FLAVOR_POSIX
+/* Reads a whole file into memory. */
+static bool ReadWholeFile( const char *sFileName, LOGOG_VECTOR< char > &vData )
+{
+    FILE *fp = fopen( sFileName, "rb" );
+    char vChunk[ 4096 ];
+    size_t nRead;
+
+    vData.clear();
+
+    if ( fp == NULL )
+        return false;
+
+    while (( nRead = fread( vChunk, 1, sizeof( vChunk ), fp )) > 0 )
+        vData.insert( vData.end(), vChunk, vChunk + nRead );
+
+    fclose( fp );
+    return true;
+}
+
+UNITTEST( DescriptorLogFileMatchesLogFile )
+{
+    int nResult = 0;
+    const char *sStdioName = "stdio.log";
+    const char *sDescriptorName = "descriptor.log";
+
+    remove( sStdioName );
+    remove( sDescriptorName );
+    remove( "descriptor.log" LOGOG_INDEX_SUFFIX );
+
+    LOGOG_INITIALIZE();
+    {
+        PatternFormatter pattern( _LG("%L %m") );
+        LogFile stdioFile( sStdioName );
+        /* A small buffer, so that it fills often, and some messages are too big for it. */
+        DescriptorLogFile descriptorFile( sDescriptorName, true, 256, true );
+
+        stdioFile.SetFormatter( pattern );
+        descriptorFile.SetFormatter( pattern );
+        descriptorFile.EnableIndex( 1024 );
+        descriptorFile.SetDurableLevel( LOGOG_LEVEL_ERROR );
+
+        LOGOG_STRING sLong;
+        for ( int t = 0; t < 100; t++ )
+            sLong.append( _LG("0123456789") );
+
+        for ( int t = 0; t < 500; t++ )
+        {
+            if ( t % 100 == 50 )
+                ERR( _LG("long message %d %s"), t, sLong.c_str() );
+            else
+                INFO( _LG("message %d"), t );
+        }
+
+        if ( descriptorFile.GetCommitCount() != 5 )
+        {
+            LOGOG_COUT << _LG("DescriptorLogFile made ") << (unsigned long)descriptorFile.GetCommitCount()
+                << _LG(" commits for 5 durable messages") << endl;
+            nResult++;
+        }
+    }
+    LOGOG_SHUTDOWN();
+
+    LOGOG_VECTOR< char > vStdio, vDescriptor;
+
+    if ( !ReadWholeFile( sStdioName, vStdio ) || !ReadWholeFile( sDescriptorName, vDescriptor ) ||
+        vStdio.empty() || vStdio != vDescriptor )
+    {
+        LOGOG_COUT << _LG("DescriptorLogFile wrote ") << vDescriptor.size() << _LG(" bytes; LogFile wrote ")
+            << vStdio.size() << endl;
+        nResult++;
+    }
+
+    LOGOG_INITIALIZE();
+    {
+        LogIndex index;
+
+        if ( !index.Open( sDescriptorName ) || index.GetEntries().empty() ||
+            index.GetEntries().back().m_nOffset + index.GetEntries().back().m_nLength != vDescriptor.size() )
+        {
+            LOGOG_COUT << _LG("The index of a DescriptorLogFile does not cover the log") << endl;
+            nResult++;
+        }
+    }
+    LOGOG_SHUTDOWN();
+
+    remove( sStdioName );
+    remove( sDescriptorName );
+    remove( "descriptor.log" LOGOG_INDEX_SUFFIX );
+
+    return nResult;
+}
+
+UNITTEST( DirectLogFileMatchesLogFile )
+{
+    int nResult = 0;
+    const char *sStdioName = "stdio.log";
+    const char *sDirectName = "direct.log";
+    LOGOG_VECTOR< char > vStdio, vDirect;
+
+    /* Both files start with a partial block, which the DirectLogFile must read back and carry on from. */
+    const char *vNames[] = { sStdioName, sDirectName };
+    for ( int t = 0; t < 2; t++ )
+    {
+        FILE *fp = fopen( vNames[ t ], "wb" );
+        fputs( "written by an earlier run\n", fp );
+        fclose( fp );
+    }
+
+    /* The first run uses the writing thread; the second appends with io_uring, where it is available. */
+    for ( int nRun = 0; nRun < 2; nRun++ )
+    {
+        LOGOG_INITIALIZE();
+        {
+            PatternFormatter pattern( _LG("%L %m") );
+            LogFile stdioFile( sStdioName );
+            /* Two buffers of a single block each, so that one is nearly always being written. */
+            DirectLogFile directFile( sDirectName, 1, 2, nRun == 1 );
+            LogBuffer buffer( &directFile );
+
+            directFile.UnsubscribeToMultiple( AllFilters() );
+            stdioFile.SetFormatter( pattern );
+            buffer.SetFormatter( pattern );
+            buffer.SetNullTerminatesStrings( false );
+            buffer.SetFlushThreshold( 0, 37 );
+
+            for ( int t = 0; t < 1000; t++ )
+                INFO( _LG("message %d of %d, %s"), t, 1000,
+                    ( t % 7 == 0 ) ? _LG("with a longer tail to vary the length") : _LG("short") );
+
+            /* Every automatic dump of the LogBuffer flushed the DirectLogFile, padding and truncating its last block;
+             * the file must never be left padded. */
+            buffer.Flush();
+            stdioFile.Flush();
+
+            if ( !ReadWholeFile( sStdioName, vStdio ) || !ReadWholeFile( sDirectName, vDirect ) || vStdio != vDirect )
+            {
+                LOGOG_COUT << _LG("After a flush, DirectLogFile has ") << vDirect.size() << _LG(" bytes; LogFile has ")
+                    << vStdio.size() << endl;
+                nResult++;
+            }
+
+            for ( int t = 0; t < 100; t++ )
+                WARN( _LG("after the flush %d"), t );
+        }
+        LOGOG_SHUTDOWN();
+
+        if ( !ReadWholeFile( sStdioName, vStdio ) || !ReadWholeFile( sDirectName, vDirect ) || vStdio != vDirect )
+        {
+            LOGOG_COUT << _LG("DirectLogFile wrote ") << vDirect.size() << _LG(" bytes; LogFile wrote ")
+                << vStdio.size() << _LG(" in run ") << nRun << endl;
+            nResult++;
+        }
+    }
+
+    remove( sStdioName );
+    remove( sDirectName );
+
+    return nResult;
+}
+
+/* Appends a narrow string to vBytes as the bytes of the same string of LOGOG_CHARs. */
+static void AppendAsLogogChars( LOGOG_VECTOR< char > &vBytes, const char *s )
+{
+    for ( ; *s != '\0'; s++ )
+    {
+        LOGOG_CHAR c = (LOGOG_CHAR)*s;
+        vBytes.insert( vBytes.end(), (const char *)&c, (const char *)&c + sizeof( c ));
+    }
+}
+
+/* Binds a socket of the given type to a local path, or, if sPath is NULL, to a UDP port on the loopback address,
+ * whose number is returned in nPort. */
+static int BindCollector( const char *sPath, int nType, int &nPort )
+{
+    int nSocket;
+
+    if ( sPath != NULL )
+    {
+        struct sockaddr_un address;
+        memset( &address, 0, sizeof( address ));
+        address.sun_family = AF_UNIX;
+        strcpy( address.sun_path, sPath );
+        unlink( sPath );
+
+        nSocket = socket( AF_UNIX, nType, 0 );
+        if ( bind( nSocket, (struct sockaddr *)&address, sizeof( address )) != 0 )
+            return -1;
+    }
+    else
+    {
+        struct sockaddr_in address;
+        socklen_t nLength = sizeof( address );
+        memset( &address, 0, sizeof( address ));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+
+        nSocket = socket( AF_INET, nType, 0 );
+        if ( bind( nSocket, (struct sockaddr *)&address, sizeof( address )) != 0 ||
+            getsockname( nSocket, (struct sockaddr *)&address, &nLength ) != 0 )
+            return -1;
+        nPort = ntohs( address.sin_port );
+    }
+
+    /* Never hang the tests on a collector that gets nothing. */
+    struct timeval tv = { 5, 0 };
+    setsockopt( nSocket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof( tv ));
+
+    if ( nType == SOCK_STREAM )
+        listen( nSocket, 1 );
+
+    return nSocket;
+}
+
+/* A collector that reads datagrams, and keeps them one after another, until it has SocketCollector::m_nExpected. */
+struct SocketCollector
+{
+    int m_nSocket;
+    int m_nExpected;
+    int m_nReceived;
+    LOGOG_VECTOR< char > m_vBytes;
+};
+
+void CollectDatagrams( void *pvCollector )
+{
+    SocketCollector *pCollector = (SocketCollector *)pvCollector;
+    char vDatagram[ 4096 ];
+
+    while ( pCollector->m_nReceived < pCollector->m_nExpected )
+    {
+        ssize_t nLength = recv( pCollector->m_nSocket, vDatagram, sizeof( vDatagram ), 0 );
+        if ( nLength < 0 )
+            break;
+        pCollector->m_vBytes.insert( pCollector->m_vBytes.end(), vDatagram, vDatagram + nLength );
+        pCollector->m_nReceived++;
+    }
+}
+
+UNITTEST( SocketTarget )
+{
+    int nResult = 0;
+    const char *sDatagramPath = "./collector-dgram.sock";
+    const char *sStreamPath = "./collector-stream.sock";
+    const int NUM_MESSAGES = 2000;
+    int nPort = 0;
+    char vLine[ 64 ];
+
+    LOGOG_INITIALIZE();
+    {
+        PatternFormatter pattern( _LG("%m") );
+
+        /* A collector that only starts reading once the messages are logged.  The socket fills, and the rest of
+         * the messages wait in the target's queue until they are flushed. */
+        {
+            SocketCollector collector;
+            collector.m_nSocket = BindCollector( sDatagramPath, SOCK_DGRAM, nPort );
+            collector.m_nExpected = NUM_MESSAGES;
+            collector.m_nReceived = 0;
+
+            Socket target( sDatagramPath, SOCK_DGRAM );
+            target.SetFormatter( pattern );
+
+            LOGOG_VECTOR< char > vExpected;
+
+            for ( int t = 0; t < NUM_MESSAGES; t++ )
+            {
+                INFO( _LG("datagram %d"), t );
+                sprintf( vLine, "datagram %d\n", t );
+                AppendAsLogogChars( vExpected, vLine );
+            }
+
+            if ( !target.IsConnected() || target.GetQueuedBytes() == 0 )
+            {
+                LOGOG_COUT << _LG("A slow collector did not make the Socket queue its messages") << endl;
+                nResult++;
+            }
+
+            Thread reader( (Thread::ThreadStartLocationType)CollectDatagrams, &collector );
+            reader.Start();
+
+            for ( int t = 0; t < 10 && target.Flush() != 0; t++ )
+                ;
+
+            Thread::WaitFor( reader );
+
+            if ( collector.m_nReceived != NUM_MESSAGES || collector.m_vBytes != vExpected ||
+                target.GetDroppedCount() != 0 )
+            {
+                LOGOG_COUT << _LG("The collector got ") << collector.m_nReceived << _LG(" of ") << NUM_MESSAGES
+                    << _LG(" datagrams, in order or not") << endl;
+                nResult++;
+            }
+
+            close( collector.m_nSocket );
+        }
+
+        /* A collector that isn't there when the first messages are logged. */
+        {
+            unlink( sDatagramPath );
+
+            Socket target( sDatagramPath, SOCK_DGRAM );
+            target.SetFormatter( pattern );
+
+            INFO( _LG("early %d"), 1 );
+            INFO( _LG("early %d"), 2 );
+
+            if ( target.IsConnected() || target.Flush() == 0 )
+            {
+                LOGOG_COUT << _LG("A Socket connected to a collector that doesn't exist") << endl;
+                nResult++;
+            }
+
+            SocketCollector collector;
+            collector.m_nSocket = BindCollector( sDatagramPath, SOCK_DGRAM, nPort );
+            collector.m_nExpected = 3;
+            collector.m_nReceived = 0;
+
+            /* Wait out the first retry delay. */
+            Condition sleeper;
+            sleeper.Lock();
+            sleeper.Wait( LOGOG_SOCKET_RETRY_MIN * 2 );
+            sleeper.Unlock();
+
+            INFO( _LG("on time") );
+            CollectDatagrams( &collector );
+
+            LOGOG_VECTOR< char > vExpected;
+            AppendAsLogogChars( vExpected, "early 1\nearly 2\non time\n" );
+
+            if ( !target.IsConnected() || collector.m_vBytes != vExpected )
+            {
+                LOGOG_COUT << _LG("A Socket did not reconnect and send its queue") << endl;
+                nResult++;
+            }
+
+            close( collector.m_nSocket );
+            unlink( sDatagramPath );
+        }
+
+        /* A stream to a Unix domain socket. */
+        {
+            int nListener = BindCollector( sStreamPath, SOCK_STREAM, nPort );
+
+            Socket target( sStreamPath, SOCK_STREAM );
+            target.SetFormatter( pattern );
+
+            LOGOG_VECTOR< char > vExpected, vReceived;
+
+            for ( int t = 0; t < 100; t++ )
+            {
+                INFO( _LG("streamed %d"), t );
+                sprintf( vLine, "streamed %d\n", t );
+                AppendAsLogogChars( vExpected, vLine );
+            }
+
+            int nStream = accept( nListener, NULL, NULL );
+            target.Flush();
+
+            while ( vReceived.size() < vExpected.size() )
+            {
+                char vChunk[ 4096 ];
+                ssize_t nLength = recv( nStream, vChunk, sizeof( vChunk ), 0 );
+                if ( nLength <= 0 )
+                    break;
+                vReceived.insert( vReceived.end(), vChunk, vChunk + nLength );
+            }
+
+            if ( vReceived != vExpected )
+            {
+                LOGOG_COUT << _LG("The stream collector got ") << vReceived.size() << _LG(" of ")
+                    << vExpected.size() << _LG(" bytes") << endl;
+                nResult++;
+            }
+
+            close( nStream );
+            close( nListener );
+            unlink( sStreamPath );
+        }
+
+        /* UDP to the loopback address. */
+        {
+            SocketCollector collector;
+            collector.m_nSocket = BindCollector( NULL, SOCK_DGRAM, nPort );
+            collector.m_nExpected = 10;
+            collector.m_nReceived = 0;
+
+            Socket target( "127.0.0.1", SOCK_DGRAM, nPort );
+            target.SetFormatter( pattern );
+
+            LOGOG_VECTOR< char > vExpected;
 
-        if ( n2.UnpublishTo( n1 ) != true )
-            nResult++;
+            for ( int t = 0; t < 10; t++ )
+            {
+                INFO( _LG("udp %d"), t );
+                sprintf( vLine, "udp %d\n", t );
+                AppendAsLogogChars( vExpected, vLine );
+            }
 
-        if ( n1.UnsubscribeTo( n2 ) != false )
-            nResult++;
-    }
+            target.Flush();
+            CollectDatagrams( &collector );
 
-    LOGOG_SHUTDOWN();
+            if ( collector.m_vBytes != vExpected )
+            {
+                LOGOG_COUT << _LG("The UDP collector got ") << collector.m_nReceived << _LG(" of 10 datagrams")
+                    << endl;
+                nResult++;
+            }
 
-//! [Subscription]
+            close( collector.m_nSocket );
+        }
+    }
+    LOGOG_SHUTDOWN();
 
     return nResult;
 }
 
-UNITTEST( GlobalNodelist )
+UNITTEST( SyslogTarget )
 {
+    int nResult = 0;
+    const char *sPath = "./syslog-test.sock";
+    const int NUM_MESSAGES = 5;
+    int nPort = 0;
+    char vExpected[ 256 ];
+
+    /* Facility local0 is 16, so the priorities are 128 plus the severities. */
+    static const char *vPriorities[ NUM_MESSAGES ] = { "<128>1 ", "<131>1 ", "<132>1 ", "<134>1 ", "<135>1 " };
+    static const char *vData[ NUM_MESSAGES ] = {
+        "[logog@32473 group=\"Graphics\" category=\"Unrecoverable\" file=\"",
+        "[logog@32473 group=\"Graphics\" category=\"odd \\\"name\\] \\\\ here\" file=\"",
+        "[logog@32473 file=\"",
+        "[logog@32473 file=\"",
+        "[logog@32473 file=\""
+    };
+    static const char *vMessages[ NUM_MESSAGES ] = {
+        "] the card is gone", "] escaped", "] warning 3", "] info", "] debugging"
+    };
+
+    int nCollector = BindCollector( sPath, SOCK_DGRAM, nPort );
+
     LOGOG_INITIALIZE();
+    {
+        Syslog target( sPath, 16, "logog test" );
 
-    const int MAX_NODES = 10 * TEST_STRESS_LEVEL;
+#undef LOGOG_GROUP
+#undef LOGOG_CATEGORY
+#define LOGOG_GROUP "Graphics"
+#define LOGOG_CATEGORY "Unrecoverable"
 
-    LOGOG_VECTOR< Topic *> vTopics;
+        EMERGENCY( _LG("the card is gone") );
 
-    for (int t = 0; t < MAX_NODES; t++ )
-        vTopics.push_back( new Topic );
+#undef LOGOG_CATEGORY
+#define LOGOG_CATEGORY "odd \"name] \\ here"
 
-    for ( int i = 0; i < MAX_NODES; i++ )
-        for ( int j = i + 1; j < MAX_NODES; j++ )
-            vTopics.at( i )->SubscribeTo( *vTopics.at( j ) );
+        ERR( _LG("escaped") );
 
-    LockableNodesType *pNodes = ( LockableNodesType * )Static().s_pAllNodes;
+#undef LOGOG_CATEGORY
+#undef LOGOG_GROUP
+#define LOGOG_CATEGORY NULL
+#define LOGOG_GROUP NULL
 
-    // For this test we assume that the default Filter has always been created.
-    if ( pNodes->size() != ( MAX_NODES + 1))
-    {
-        LOGOG_COUT << _LG("Incorrect number of nodes!") << endl;
-        return 1;
-    }
+        WARN( _LG("warning %d"), 3 );
+        INFO( _LG("info") );
+        DBUG( _LG("debugging") );
 
-    // Try having that master node send a message to all other nodes!
-    vTopics.at( MAX_NODES - 1)->Transmit();
+        target.Flush();
 
-    // Let's try leaving all the nodes allocated and let logog clean them all up.
-    LOGOG_SHUTDOWN();
+        sprintf( vExpected, " logog_test %d - ", (int)getpid() );
 
-    if ( Static().s_pAllNodes != NULL )
-    {
-        LOGOG_COUT << _LG("Could not delete all nodes!") << endl;
-        return 1;
-    }
+        for ( int t = 0; t < NUM_MESSAGES; t++ )
+        {
+            char vDatagram[ 1024 ];
+            ssize_t nLength = recv( nCollector, vDatagram, sizeof( vDatagram ) - 1, 0 );
 
-    return 0;
-}
+            if ( nLength <= 0 )
+            {
+                LOGOG_COUT << _LG("The syslog collector got ") << t << _LG(" of ") << NUM_MESSAGES
+                    << _LG(" messages") << endl;
+                nResult++;
+                break;
+            }
 
+            vDatagram[ nLength ] = '\0';
+            const char *pMessage = vDatagram + nLength - strlen( vMessages[ t ] );
 
-UNITTEST( TimerTest )
-{
-    const int NUM_TRIALS = 10 * TEST_STRESS_LEVEL;
-    const int WAIT_TIME = 1000000 * TEST_STRESS_LEVEL;
+            if ( strncmp( vDatagram, vPriorities[ t ], strlen( vPriorities[ t ] )) != 0 ||
+                strstr( vDatagram, vExpected ) == NULL || strstr( vDatagram, vData[ t ] ) == NULL ||
+                strstr( vDatagram, "\" line=\"" ) == NULL ||
+                pMessage < vDatagram || strcmp( pMessage, vMessages[ t ] ) != 0 )
+            {
+                LOGOG_COUT << _LG("Unexpected syslog message ") << t << _LG(": ") << vDatagram << endl;
+                nResult++;
+            }
+        }
 
-    Timer time;
-    LOGOG_TIME fCurrent = time.Get();
+        /* A negative line number keeps its sign. */
+        FormatterSyslog syslogFormatter( 16, "logog test" );
+        MemoryTarget memory;
+        Topic negative( LOGOG_LEVEL_WARN, _LG("negative.cpp"), -3 );
 
-    for ( int t = 0; t < NUM_TRIALS; t++  )
-    {
-        /* do busy work */
-        int k = 0;
-        for ( int i = 0; i < WAIT_TIME; i++ )
-            k = k + 1;  // fixes a lint warning
+        memory.SetFormatter( syslogFormatter );
+        negative.PublishTo( memory );
+        negative.BeginFormat().append( _LG("before the start") );
+        negative.Transmit();
 
-        if ( time.Get() < fCurrent )
+        if ( memory.CountRecordsContaining( _LG(" line=\"-3\"] before the start") ) != 1 )
         {
-            LOGOG_COUT << _LG("Timer error!  Non monotonic timer behavior") << endl;
-            return 1;
+            LOGOG_COUT << _LG("FormatterSyslog rendered a negative line number as ")
+                << ( memory.GetRecordCount() ? memory.GetRecord( 0 ) : _LG("nothing") ) << endl;
+            nResult++;
         }
-        fCurrent = time.Get();
-        LOGOG_COUT << _LG("Current reported time: ") << fCurrent << endl;
     }
+    LOGOG_SHUTDOWN();
 
-    return 0;
+    close( nCollector );
+    unlink( sPath );
+
+    return nResult;
 }
 
-UNITTEST( TopicTest1 )
+/* Does a record hold exactly the narrow string s? */
+static bool RecordEquals( const LOGOG_CHAR *pRecord, const char *s )
 {
-    LOGOG_INITIALIZE();
+    if ( pRecord == NULL )
+        return false;
 
-    {
-        Topic t1( LOGOG_LEVEL_WARN,
-                  _LG( "file1.cpp" ), 50 );
-        Topic t2( LOGOG_LEVEL_WARN );
-        Topic t3( LOGOG_LEVEL_ERROR,
-                  _LG( "file2.cpp" ), 100 );
-        Topic t4( LOGOG_LEVEL_WARN, NULL, 0,
-                  _LG( "Group" ),
-                  _LG( "Category" ),
-                  _LG( "Message" ),
-                  30.0f);
-        Topic t5( LOGOG_LEVEL_CRITICAL, NULL, 0,
-                  _LG( "GroupGROUP" ),
-                  _LG( "Important Category" ),
-                  _LG( "Your Message Here"),
-                  150.0f);
+    for ( ; *s != '\0'; s++, pRecord++ )
+        if ( *pRecord != (LOGOG_CHAR)*s )
+            return false;
 
-        if (t1.CanSubscribeTo( t2 ) == true)
+    return ( *pRecord == (LOGOG_CHAR)NULL );
+}
+
+UNITTEST( SocketServerMergesStreams )
+{
+    int nResult = 0;
+    const char *sServerPath = "./server-test.sock";
+    const char *sProducerPath = "./producer-test.sock";
+    const int NUM_PRODUCERS = 3;
+    const int NUM_MESSAGES = 30;
+    char vLine[ 64 ];
+
+    LOGOG_INITIALIZE();
+    {
+        PatternFormatter pattern( _LG("%m") );
+        FormatterLogfmt logfmt;
+
+        /* Remote messages are routed like local ones: this filter passes only the Audio group to routed. */
+        Filter audio( LOGOG_LEVEL_ALL, NULL, 0, _LG("Audio") );
+        MemoryTarget memory;
+        memory.SetFormatter( pattern );
+        memory.UnsubscribeTo( audio );
+        MemoryTarget routed;
+        routed.SetFormatter( logfmt );
+        routed.UnsubscribeToMultiple( AllFilters() );
+        audio.PublishTo( routed );
+
+        SocketServer server;
+        server.SetMergeWindow( 5000 );
+
+        if ( server.Listen( sServerPath ) != 0 )
         {
-            LOGOG_COUT << _LG("Subscription test failed; t1 can subscribe to t2") << endl;
-            return 1;
+            LOGOG_COUT << _LG("SocketServer could not listen") << endl;
+            nResult++;
         }
 
-        if (t2.CanSubscribeTo( t1 ) == false )
+        /* Each producer renders its stream as a separate process would, with messages interleaved in time. */
+        int vProducers[ NUM_PRODUCERS ];
+        BinaryFormatter vFormatters[ NUM_PRODUCERS ];
+        LOGOG_VECTOR< char > vStreams[ NUM_PRODUCERS ];
+        Topic graphics( LOGOG_LEVEL_INFO, _LG("producer.cpp"), 10, _LG("Graphics") );
+        Topic audioTopic( LOGOG_LEVEL_INFO, _LG("producer.cpp"), 20, _LG("Audio") );
+
+        for ( int t = 0; t < NUM_MESSAGES; t++ )
         {
-            LOGOG_COUT << _LG("Subscription test failed; t2 can't subscribe to t1") << endl;
-            return 1;
+            int nProducer = t % NUM_PRODUCERS;
+            Topic &topic = ( nProducer == 1 ) ? audioTopic : graphics;
+            FieldSet fields;
+
+            fields.AddValue( _LG("status"), 200 + t );
+            sprintf( vLine, "message %d", t );
+            LOGOG_STRING &sMessage = topic.BeginFormat();
+            for ( const char *p = vLine; *p != '\0'; p++ )
+                sMessage.append( (LOGOG_CHAR)*p );
+            topic.Fields( &fields );
+
+            const LOGOG_STRING &sRecord = vFormatters[ nProducer ].Format( topic, memory );
+            const char *pRecord = (const char *)sRecord.c_str();
+            vStreams[ nProducer ].insert( vStreams[ nProducer ].end(), pRecord,
+                pRecord + sRecord.size() * sizeof( LOGOG_CHAR ));
+
+            topic.Fields( NULL );
         }
 
-        if ( t1.CanSubscribeTo( t3 ) == true )
+        for ( int t = 0; t < NUM_PRODUCERS; t++ )
         {
-            LOGOG_COUT << _LG("Subscription test failed; t1 can subscribe to t3") << endl;
-            return 1;
+            struct sockaddr_un address;
+            memset( &address, 0, sizeof( address ));
+            address.sun_family = AF_UNIX;
+            strcpy( address.sun_path, sServerPath );
+
+            vProducers[ t ] = socket( AF_UNIX, SOCK_STREAM, 0 );
+            if ( connect( vProducers[ t ], (struct sockaddr *)&address, sizeof( address )) != 0 )
+                nResult++;
         }
 
-        if (t2.CanSubscribeTo( t3 ) == false )
+        server.Poll( 100 );
+
+        if ( server.GetConnectionCount() != NUM_PRODUCERS )
         {
-            LOGOG_COUT << _LG("Subscription test failed; t2 can't subscribe to t3") << endl;
-            return 1;
+            LOGOG_COUT << _LG("SocketServer accepted ") << server.GetConnectionCount() << _LG(" connections") << endl;
+            nResult++;
         }
 
-        if (t4.CanSubscribeTo( t5 ) == false )
+        /* The streams arrive last producer first, and a few bytes at a time at first. */
+        for ( int t = NUM_PRODUCERS - 1; t >= 0; t-- )
         {
-            LOGOG_COUT << _LG("Subscription test failed; t4 can't subscribe to t5") << endl;
-            return 1;
+            size_t nSent = 0;
+
+            for ( ; nSent < 7 && nSent < vStreams[ t ].size(); nSent++ )
+            {
+                if ( send( vProducers[ t ], &vStreams[ t ][ nSent ], 1, 0 ) != 1 )
+                    nResult++;
+                server.Poll( 0 );
+            }
+
+            if ( send( vProducers[ t ], &vStreams[ t ][ nSent ], vStreams[ t ].size() - nSent, 0 ) !=
+                (ssize_t)( vStreams[ t ].size() - nSent ))
+                nResult++;
+            server.Poll( 0 );
+
+            /* Nothing may go out until the first producer, with the oldest message, has been heard from. */
+            if (( t > 0 ) && ( memory.GetRecordCount() != 0 ))
+            {
+                LOGOG_COUT << _LG("SocketServer transmitted ") << memory.GetRecordCount()
+                    << _LG(" messages before every stream had caught up") << endl;
+                nResult++;
+            }
         }
 
-        if ( t5.CanSubscribeTo( t4 ) == true )
+        /* The last two messages wait, since the first producer, whose stream is used up, is still connected. */
+        if ( memory.GetRecordCount() != NUM_MESSAGES - 2 )
         {
-            LOGOG_COUT << _LG("Subscription test failed; t5 can subscribe to t4") << endl;
-            return 1;
+            LOGOG_COUT << _LG("SocketServer transmitted ") << memory.GetRecordCount()
+                << _LG(" messages once every stream had caught up") << endl;
+            nResult++;
         }
-    }
-
-    LOGOG_SHUTDOWN();
-
-    return 0;
-}
 
-UNITTEST( Checkpoint1 )
-{
-    LOGOG_INITIALIZE();
+        for ( int t = 0; t < NUM_PRODUCERS; t++ )
+            close( vProducers[ t ] );
 
-    {
-        Checkpoint check( LOGOG_LEVEL_ALL, _LG( __FILE__ ), __LINE__,
-                          _LG("Group"), _LG("Category"), _LG("Message"), 1.0f );
+        LOGOG_UINT64 nDeadline = GetMonotonicNanoseconds() + 5000000000ULL;
+        while ( server.GetMessageCount() < NUM_MESSAGES && GetMonotonicNanoseconds() < nDeadline )
+            server.Poll( 100 );
 
-        Topic t;
+        bool bInOrder = ( memory.GetRecordCount() == NUM_MESSAGES );
+        for ( int t = 0; bInOrder && t < NUM_MESSAGES; t++ )
+        {
+            sprintf( vLine, "message %d\n", t );
+            bInOrder = RecordEquals( memory.GetRecord( t ), vLine );
+        }
 
-        Cerr cerrobj;
-        Cerr cerrgnu;
-        OutputDebug outdebug;
+        if ( !bInOrder )
+        {
+            LOGOG_COUT << _LG("SocketServer transmitted ") << memory.GetRecordCount() << _LG(" of ")
+                << NUM_MESSAGES << _LG(" messages, in order or not") << endl;
+            nResult++;
+        }
 
-        FormatterGCC f;
-        cerrgnu.SetFormatter( f );
+        if ( routed.GetRecordCount() != NUM_MESSAGES / NUM_PRODUCERS ||
+            routed.CountRecordsContaining( _LG(" group=Audio ") ) != NUM_MESSAGES / NUM_PRODUCERS ||
+            routed.CountRecordsContaining( _LG("message=\"message 1\" status=201\n") ) != 1 )
+        {
+            LOGOG_COUT << _LG("The Audio filter routed ") << routed.GetRecordCount() << _LG(" remote messages") << endl;
+            nResult++;
+        }
 
-        check.PublishTo( t );
-        t.PublishToMultiple( AllTargets() );
+        if ( server.GetConnectionCount() != 0 )
+        {
+            LOGOG_COUT << _LG("SocketServer kept closed connections") << endl;
+            nResult++;
+        }
 
-        LOGOG_COUT << _LG("Setup complete; ready to transmit ") << endl;
-        check.Transmit();
-    }
+        /* A BinarySocket starts its stream with a header, which a reader fed from the socket can read. */
+        {
+            int nPort = 0;
+            int nListener = BindCollector( sProducerPath, SOCK_STREAM, nPort );
+            BinarySocket producer( sProducerPath );
 
-    LOGOG_SHUTDOWN();
+            for ( int t = 0; t < 5; t++ )
+                INFO( _LG("produced %d"), t );
 
-    return 0;
-}
+            int nStream = accept( nListener, NULL, NULL );
+            producer.Flush();
 
-UNITTEST( FormatString1 )
-{
-    LOGOG_INITIALIZE();
-    {
-        String s;
+            LOGOG_VECTOR< unsigned char > vReceived;
+            BinaryLogReader reader;
+            BinaryLogRecord record;
+            int nRecords = 0;
 
-        s.format( _LG("This is a test message.\n"));
-        LOGOG_COUT << s.c_str();
+            while ( nRecords < 5 )
+            {
+                unsigned char vChunk[ 4096 ];
+                ssize_t nLength = recv( nStream, vChunk, sizeof( vChunk ), 0 );
+                if ( nLength <= 0 )
+                    break;
+                vReceived.insert( vReceived.end(), vChunk, vChunk + nLength );
+
+                reader.SetBuffer( &vReceived[ 0 ], vReceived.size() );
+                while ( reader.Next( record ))
+                {
+                    sprintf( vLine, "produced %d", nRecords );
+                    if ( strcmp( record.m_sMessage, vLine ) != 0 )
+                        nResult++;
+                    nRecords++;
+                }
+                vReceived.erase( vReceived.begin(), vReceived.begin() + (ptrdiff_t)reader.GetBufferPosition() );
+            }
 
-        s.format( _LG("This is a test message: %d %x %f\n"), 1234, 0xf00d, 1.234f );
-        LOGOG_COUT << s.c_str();
+            if ( nRecords != 5 || reader.IsCorrupt() || reader.GetSkippedCount() != 0 )
+            {
+                LOGOG_COUT << _LG("Read ") << nRecords << _LG(" messages from a BinarySocket") << endl;
+                nResult++;
+            }
 
-        const LOGOG_CHAR *p = _LG("Here is a string");
+            /* Messages that continue a lost stream are dropped on reconnecting, rather than sent to be skipped. */
+            close( nStream );
 
-#ifdef LOGOG_UNICODE
-        s.format( _LG("Here are six strings: %ls %ls %ls %ls %ls %ls \n"), p,p,p,p,p,p );
-#else // LOGOG_UNICODE
-        s.format( _LG("Here are six strings: %s %s %s %s %s %s \n"), p,p,p,p,p,p );
-#endif
+            INFO( _LG("lost 0") );
+            INFO( _LG("lost 1") );
 
-        LOGOG_COUT << s.c_str();
-    }
+            Condition sleeper;
+            sleeper.Lock();
+            sleeper.Wait( LOGOG_SOCKET_RETRY_MIN * 2 );
+            sleeper.Unlock();
 
-    LOGOG_SHUTDOWN();
+            producer.Flush();
+            nStream = accept( nListener, NULL, NULL );
 
-    return 0;
-}
+            for ( int t = 0; t < 3; t++ )
+                INFO( _LG("resumed %d"), t );
+            producer.Flush();
+            shutdown( nStream, SHUT_WR );
 
-UNITTEST( FormatTopic1 )
-{
-    LOGOG_INITIALIZE();
-    {
-        Cout out;
-        LogFile f( "log.txt");
-        Message m;
+            BinaryLogReader resumed;
+            vReceived.clear();
+            nRecords = 0;
 
-        m.PublishToMultiple( AllTargets() );
+            for ( ;; )
+            {
+                unsigned char vChunk[ 4096 ];
+                ssize_t nLength = recv( nStream, vChunk, sizeof( vChunk ), MSG_DONTWAIT );
+                if ( nLength <= 0 )
+                    break;
+                vReceived.insert( vReceived.end(), vChunk, vChunk + nLength );
+            }
 
-        m.Format( _LG("This is a test message: %d %x %f"), 1234, 0xf00d, 1.234f );
-        m.Transmit();
+            if ( !vReceived.empty() )
+            {
+                resumed.SetBuffer( &vReceived[ 0 ], vReceived.size() );
+                while ( resumed.Next( record ))
+                {
+                    sprintf( vLine, "resumed %d", nRecords );
+                    if ( strcmp( record.m_sMessage, vLine ) != 0 )
+                        nResult++;
+                    nRecords++;
+                }
+            }
 
-        const char *p = "Here is a string";
+            if ( nRecords != 3 || resumed.IsCorrupt() || resumed.GetSkippedCount() != 0 || producer.GetDroppedCount() != 2 )
+            {
+                LOGOG_COUT << _LG("After reconnecting, read ") << nRecords << _LG(" messages from a BinarySocket, which dropped ")
+                           << producer.GetDroppedCount() << endl;
+                nResult++;
+            }
 
-        m.Format( _LG("Here are six strings: %s %s %s %s %s %s"), p,p,p,p,p,p );
-        m.Transmit();
+            close( nStream );
+            close( nListener );
+            unlink( sProducerPath );
+        }
     }
-
     LOGOG_SHUTDOWN();
 
-    return 0;
+    return nResult;
 }
+#endif // LOGOG_FLAVOR_POSIX
 
-UNITTEST( ThreadLocking )
+#ifdef LOGOG_HAS_TYPED_FORMAT
+static int CompareFormatted( const LOGOG_STRING &sTyped, const LOGOG_STRING &sPrintf )
 {
-    LOGOG_INITIALIZE();
-    {
-        Cout out; // only one of these please
+    const LOGOG_CHAR *pTyped = sTyped.c_str();
+    const LOGOG_CHAR *pPrintf = sPrintf.c_str();
 
-        const int NUM_THREADS = 10 * TEST_STRESS_LEVEL;
+    while ( *pTyped != '\0' && *pTyped == *pPrintf )
+    {
+        pTyped++;
+        pPrintf++;
+    }
 
-        LOGOG_VECTOR< Thread *> vpThreads;
-        Mutex mSharedMutex;
+    if ( *pTyped == *pPrintf )
+        return 0;
 
-        for ( int t = 0; t < NUM_THREADS; t++ )
-            vpThreads.push_back( new Thread( (Thread::ThreadStartLocationType) LockingThread,&mSharedMutex ));
+    LOGOG_COUT << _LG("TypedFormat rendered \"") << sTyped.c_str() << _LG("\" but printf rendered \"")
+        << sPrintf.c_str() << _LG("\"") << endl;
+    return 1;
+}
 
-        for ( int t = 0; t < NUM_THREADS; t++ )
-            vpThreads[ t ]->Start();
+/* Renders the same format and arguments with TypedFormat() and with String::format(), and compares them. */
+#define CHECK_TYPED_FORMAT( formatstring, ... ) \
+    { \
+        LOGOG_FORMAT_STRING( CheckedFormat, formatstring ); \
+        LOGOG_STRING sTyped, sPrintf; \
+        TypedFormat< CheckedFormat >( sTyped, ##__VA_ARGS__ ); \
+        sPrintf.format( formatstring, ##__VA_ARGS__ ); \
+        nResult += CompareFormatted( sTyped, sPrintf ); \
+    }
 
-        for ( int t = 0; t < NUM_THREADS; t++ )
-            Thread::WaitFor( *vpThreads[ t ]);
+/* TypedFormat() rejects these calls with a static_assert on the same check; printf would read the wrong type. */
+static_assert( !FormatArgumentsMatch< int >( _LG("%f") ), "An int was accepted for %f" );
+static_assert( !FormatArgumentsMatch< long long >( _LG("%.2e") ), "A long long was accepted for %e" );
+static_assert( !FormatArgumentsMatch< double, int >( _LG("%d %g") ), "Mismatched arguments were accepted" );
+static_assert( !FormatArgumentsMatch< double >( _LG("%d") ), "A double was accepted for %d" );
+static_assert( FormatArgumentsMatch< double, float, long double, int >( _LG("%f %a %Lg %d") ),
+    "Matching arguments were rejected" );
 
-		for ( int t = 0; t < NUM_THREADS; t++ )
-			delete vpThreads[t];
+UNITTEST( TypedFormatMatchesPrintf )
+{
+    int nResult = 0;
 
+    LOGOG_INITIALIZE();
+    {
+        CHECK_TYPED_FORMAT( _LG("No conversions at all") );
+        CHECK_TYPED_FORMAT( _LG("%d|%5d|%-5d|%05d|%+d|% d|%.3d|%8.3d"), 42, 42, 42, 42, 42, 42, 42, -42 );
+        CHECK_TYPED_FORMAT( _LG("%d %i %d %+d"), -17, -2147483647 - 1, 0, 0 );
+        CHECK_TYPED_FORMAT( _LG("%u %x %X %#x %o %#o %#X %.0d|"), 3000000000u, 255, 255, 255, 8, 8, 0, 0 );
+        CHECK_TYPED_FORMAT( _LG("%ld %lld %hd %lu %zu %llx"), 123456789L, -1234567890123LL, (short)-5, 99UL,
+            (size_t)77, 0xFEDCBA9876543210ULL );
+        CHECK_TYPED_FORMAT( _LG("[%c%c%c] [%3c] [%-3c]"), 'a', 'b', 'c', 'd', 'e' );
+        CHECK_TYPED_FORMAT( _LG("%s|%10s|%-10s|%.2s|%ls"), "str", "right", "left", "truncate", L"wide" );
+        CHECK_TYPED_FORMAT( _LG("%f %.2f %10.3f %-10.1f| %e %E %g %G %+.1f %#.0f %08.3f"), 3.14159, 2.71828,
+            1.5, -1.25, 12345.678, 0.000123, 100000.0, 1e-10, 7.0, 1.0, -3.5 );
+        CHECK_TYPED_FORMAT( _LG("%Lf %f"), 2.5L, 0.1f );
+        CHECK_TYPED_FORMAT( _LG("100%% done, %d%%"), 7 );
+        CHECK_TYPED_FORMAT( _LG("%p %10p"), (void *)0x1234, (void *)0xabcd );
+        CHECK_TYPED_FORMAT( _LG("%f"), 1e300 );
+        CHECK_TYPED_FORMAT( _LG("A long line that will not fit in the initial buffer: %300d|%-300s|"), 1, "x" );
+
+        /* Strings and enumerations, which printf can't take directly. */
+        LOGOG_FORMAT_STRING( StringFormat, _LG("[%s] [%8s] [%d]") );
+        LOGOG_STRING sArgument( _LG("logog") );
+        LOGOG_STRING sTyped;
+        TypedFormat< StringFormat >( sTyped, sArgument, sArgument, LOGOG_LEVEL_WARN );
+
+        LOGOG_STRING sExpected;
+        sExpected.format( _LG("[logog] [   logog] [%d]"), LOGOG_LEVEL_WARN );
+        nResult += CompareFormatted( sTyped, sExpected );
     }
-
     LOGOG_SHUTDOWN();
 
-    return _s_ThreadLockingTest;
+    return nResult;
 }
+#endif // LOGOG_HAS_TYPED_FORMAT
 
 //! [FormatterCustom1]
 class FormatterCustom : public FormatterMSVC
@@ -803,6 +3480,8 @@ UNITTEST( ImmediateLogging )
 #ifdef LOGOG_UNICODE
 UNITTEST( UnicodeLogFile )
 {
+    int nResult = 0;
+
     LOGOG_INITIALIZE();
 
     {
@@ -812,11 +3491,25 @@ UNITTEST( UnicodeLogFile )
         INFO(L"\x043a\x043e\x0448\x043a\x0430 \x65e5\x672c\x56fd");
         WARN(L"\x043a\x043e\x0448\x043a\x0430 \x65e5\x672c\x56fd");
         ERR(L"\x043a\x043e\x0448\x043a\x0430 \x65e5\x672c\x56fd");
+
+        /* Binary logs and syslog messages are UTF-8; surrogates without a partner become U+FFFD. */
+        const wchar_t vWide[] = { 0x043a, 0xd800, '!', 0xdc00 };
+        const unsigned char vExpected[] = { 0xd0, 0xba, 0xef, 0xbf, 0xbd, '!', 0xef, 0xbf, 0xbd };
+        unsigned char vUTF8[ 16 ];
+        size_t nWide = sizeof( vWide ) / sizeof( vWide[ 0 ] );
+
+        if ( String::UTF8Length( vWide, nWide ) != sizeof( vExpected ) ||
+            String::EncodeUTF8( vWide, nWide, vUTF8 ) != vUTF8 + sizeof( vExpected ) ||
+            memcmp( vUTF8, vExpected, sizeof( vExpected )) != 0 )
+        {
+            LOGOG_COUT << _LG("Unpaired surrogates were not encoded as U+FFFD") << endl;
+            nResult++;
+        }
     }
 
     LOGOG_SHUTDOWN();
 
-    return 0;
+    return nResult;
 }
 #endif // LOGOG_UNICODE
 
@@ -0,0 +1,425 @@
+/*
+ * \file logog-cat.cpp Prints binary logs written by BinaryLogFile as text, decompresses logs written by
+ * CompressedLogFile, recovers the records kept by a FlightRecorder, and extracts time ranges from indexed text logs.
+ *
+ * Usage: logog-cat [--from TIME] [--to TIME] [--level LEVEL] [--core] FILE...
+ *
+ * Each message is printed on one line, in the same order as logog's default formatter:
+ *
+ *     2024-01-02T03:04:05.678901Z file.cpp(12): error: {group} [category] message key=value
+ *
+ * The file name, group and category are left out when the call site did not set them.  String field values that
+ * contain spaces, quotes or equals signs are quoted.  Compressed logs are written to standard output exactly as
+ * their formatter rendered them.
+ *
+ * --from, --to and --level select the messages written from one time to another, inclusive, at a level or more
+ * severe, such as "error".  A TIME is either seconds since 1970 or a UTC time such as 2024-01-02T03:04:05Z, with
+ * optional fractions of a second.  Binary logs are filtered message by message.  Text logs can only be filtered
+ * if they have an index (see LogFile::EnableIndex); logog-cat then seeks straight to the matching parts of the
+ * log and copies them, a whole index bucket at a time.  Compressed logs cannot be filtered.
+ *
+ * The records in a flight recorder file are written oldest first, exactly as their formatter rendered them.
+ * --core searches each file for a flight recorder at any page boundary instead, which finds the recorder in a core
+ * dump of the process that wrote it.  Flight recorders cannot be filtered.
+ *
+ * The exit status is 1 if any file could not be opened, filtered or read, and 0 otherwise.
+ */
+
+#include "logog.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+using namespace logog;
+
+static const char *s_vLevelNames[] = { "none", "emergency", "alert", "critical", "error", "warning",
+	"warning1", "warning2", "warning3", "info", "debug", "all" };
+
+static const char *LevelName( int nLevel )
+{
+	const char **vNames = s_vLevelNames;
+
+	if ( nLevel <= LOGOG_LEVEL_NONE )
+		return vNames[ 0 ];
+
+	/* Levels are spaced eight apart; round up to the nearest named level, as Formatter::ErrorDescription does. */
+	int nIndex = ( nLevel + 7 ) / 8;
+	if ( nIndex > LOGOG_LEVEL_DEBUG / 8 )
+		return "unknown";
+
+	return vNames[ nIndex ];
+}
+
+static bool ParseLevel( const char *sName, int &nLevel )
+{
+	for ( size_t t = 0; t < sizeof( s_vLevelNames ) / sizeof( s_vLevelNames[ 0 ] ); t++ )
+	{
+		if ( strcmp( sName, s_vLevelNames[ t ] ) == 0 )
+		{
+			nLevel = (int)t * 8;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/** Returns the number of days from 1970-01-01 to the given date in the proleptic Gregorian calendar. */
+static LOGOG_INT64 DaysFromCivil( int nYear, int nMonth, int nDay )
+{
+	nYear -= ( nMonth <= 2 ) ? 1 : 0;
+
+	LOGOG_INT64 nEra = ( nYear >= 0 ? nYear : nYear - 399 ) / 400;
+	LOGOG_INT64 nYearOfEra = nYear - nEra * 400;
+	LOGOG_INT64 nDayOfYear = ( 153 * ( nMonth + ( nMonth > 2 ? -3 : 9 )) + 2 ) / 5 + nDay - 1;
+	LOGOG_INT64 nDayOfEra = nYearOfEra * 365 + nYearOfEra / 4 - nYearOfEra / 100 + nDayOfYear;
+
+	return nEra * 146097 + nDayOfEra - 719468;
+}
+
+/** Parses seconds since 1970, or a UTC time in RFC 3339 form, into nanoseconds since 1970. */
+static bool ParseTime( const char *sTime, LOGOG_UINT64 &nTime )
+{
+	int nYear, nMonth, nDay, nHour, nMinute, nSecond, nConsumed = 0;
+	const char *pFraction;
+	LOGOG_INT64 nSeconds;
+
+	if (( sscanf( sTime, "%4d-%2d-%2dT%2d:%2d:%2d%n", &nYear, &nMonth, &nDay, &nHour, &nMinute, &nSecond,
+		&nConsumed ) == 6 ) && ( nConsumed > 0 ))
+	{
+		nSeconds = DaysFromCivil( nYear, nMonth, nDay ) * 86400 + nHour * 3600 + nMinute * 60 + nSecond;
+		pFraction = sTime + nConsumed;
+	}
+	else
+	{
+		char *pEnd;
+		nSeconds = (LOGOG_INT64)strtoull( sTime, &pEnd, 10 );
+		if ( pEnd == sTime )
+			return false;
+		pFraction = pEnd;
+	}
+
+	LOGOG_UINT64 nNanoseconds = 0;
+
+	if ( *pFraction == '.' )
+	{
+		LOGOG_UINT64 nScale = 100000000ULL;
+
+		for ( pFraction++; ( *pFraction >= '0' ) && ( *pFraction <= '9' ); pFraction++, nScale /= 10 )
+			nNanoseconds += (LOGOG_UINT64)( *pFraction - '0' ) * nScale;
+	}
+
+	if (( *pFraction == 'Z' ) || ( *pFraction == 'z' ))
+		pFraction++;
+
+	if (( *pFraction != '\0' ) || ( nSeconds < 0 ))
+		return false;
+
+	nTime = (LOGOG_UINT64)nSeconds * 1000000000ULL + nNanoseconds;
+	return true;
+}
+
+static void PrintTimestamp( LOGOG_UINT64 nTime )
+{
+	time_t tTime = (time_t)( nTime / 1000000000ULL );
+	struct tm tmTime;
+
+#ifdef LOGOG_FLAVOR_WINDOWS
+	gmtime_s( &tmTime, &tTime );
+#else // LOGOG_FLAVOR_WINDOWS
+	gmtime_r( &tTime, &tmTime );
+#endif // LOGOG_FLAVOR_WINDOWS
+
+	printf( "%04d-%02d-%02dT%02d:%02d:%02d.%06uZ", tmTime.tm_year + 1900, tmTime.tm_mon + 1, tmTime.tm_mday,
+		tmTime.tm_hour, tmTime.tm_min, tmTime.tm_sec, (unsigned int)(( nTime % 1000000000ULL ) / 1000 ));
+}
+
+static void PrintString( const char *sValue, size_t nLength )
+{
+	bool bQuote = ( nLength == 0 );
+
+	for ( size_t t = 0; ( t < nLength ) && !bQuote; t++ )
+		if (( sValue[ t ] == ' ' ) || ( sValue[ t ] == '"' ) || ( sValue[ t ] == '=' ) ||
+			((unsigned char)sValue[ t ] < 0x20 ))
+			bQuote = true;
+
+	if ( !bQuote )
+	{
+		fwrite( sValue, 1, nLength, stdout );
+		return;
+	}
+
+	putchar( '"' );
+
+	for ( size_t t = 0; t < nLength; t++ )
+	{
+		unsigned char c = (unsigned char)sValue[ t ];
+
+		if (( c == '"' ) || ( c == '\\' ))
+			printf( "\\%c", c );
+		else if ( c == '\n' )
+			printf( "\\n" );
+		else if ( c < 0x20 )
+			printf( "\\u%04x", c );
+		else
+			putchar( c );
+	}
+
+	putchar( '"' );
+}
+
+static bool DecompressFile( CompressedLogReader &reader )
+{
+	char vBuffer[ 16384 ];
+	size_t nRead;
+
+	while (( nRead = reader.Read( vBuffer, sizeof( vBuffer ))) > 0 )
+		fwrite( vBuffer, 1, nRead, stdout );
+
+	return !reader.IsCorrupt();
+}
+
+static void PrintRecord( const BinaryLogRecord &record )
+{
+	PrintTimestamp( record.m_nTime );
+	putchar( ' ' );
+
+	if ( *record.m_Site.m_sFileName != '\0' )
+		printf( "%s(%d): ", record.m_Site.m_sFileName, record.m_Site.m_nLineNumber );
+
+	printf( "%s: ", LevelName( record.m_Site.m_nLevel ));
+
+	if ( *record.m_Site.m_sGroup != '\0' )
+		printf( "{%s} ", record.m_Site.m_sGroup );
+
+	if ( *record.m_Site.m_sCategory != '\0' )
+		printf( "[%s] ", record.m_Site.m_sCategory );
+
+	fwrite( record.m_sMessage, 1, record.m_nMessageLength, stdout );
+
+	for ( size_t t = 0; t < record.m_nFieldCount; t++ )
+	{
+		const BinaryLogField &field = record.m_vFields[ t ];
+
+		printf( " %s=", field.m_sKey );
+
+		switch ( field.m_Type )
+		{
+		case FIELD_INTEGER:
+			printf( "%lld", (long long)field.m_nInteger );
+			break;
+		case FIELD_UNSIGNED:
+			printf( "%llu", (unsigned long long)field.m_nUnsigned );
+			break;
+		case FIELD_FLOAT:
+			printf( "%.15g", field.m_dFloat );
+			break;
+		case FIELD_BOOLEAN:
+			printf( "%s", field.m_bBoolean ? "true" : "false" );
+			break;
+		case FIELD_STRING:
+			PrintString( field.m_sString, field.m_nStringLength );
+			break;
+		}
+	}
+
+	putchar( '\n' );
+}
+
+/** Copies the parts of an indexed text log that match the filter to standard output. */
+static bool CopyIndexedRanges( const char *sFileName, LOGOG_UINT64 nFrom, LOGOG_UINT64 nTo, int nLevel )
+{
+	LogIndex index;
+	LogIndex::RangesType vRanges;
+
+	if ( !index.Open( sFileName ))
+	{
+		fprintf( stderr, "logog-cat: %s: has no index, so it cannot be filtered\n", sFileName );
+		return false;
+	}
+
+	index.Find( nFrom, nTo, nLevel, vRanges );
+
+	FILE *fp = fopen( sFileName, "rb" );
+	if ( fp == NULL )
+	{
+		fprintf( stderr, "logog-cat: %s: cannot be opened\n", sFileName );
+		return false;
+	}
+
+	char vBuffer[ 16384 ];
+	bool bOk = true;
+
+	for ( size_t t = 0; ( t < vRanges.size() ) && bOk; t++ )
+	{
+		LOGOG_UINT64 nRemaining = vRanges[ t ].m_nLength;
+
+		bOk = SeekLogFile( fp, vRanges[ t ].m_nOffset );
+
+		while ( bOk && ( nRemaining > 0 ))
+		{
+			size_t nWant = ( nRemaining < sizeof( vBuffer )) ? (size_t)nRemaining : sizeof( vBuffer );
+			size_t nRead = fread( vBuffer, 1, nWant, fp );
+
+			fwrite( vBuffer, 1, nRead, stdout );
+			nRemaining -= nRead;
+			bOk = ( nRead == nWant );
+		}
+	}
+
+	fclose( fp );
+
+	if ( !bOk )
+		fprintf( stderr, "logog-cat: %s: is shorter than its index says\n", sFileName );
+
+	return bOk;
+}
+
+static void PrintFlightRecords( FlightRecorderReader &reader )
+{
+	const unsigned char *pData;
+	size_t nLength;
+
+	while ( reader.Next( pData, nLength ))
+		fwrite( pData, 1, nLength, stdout );
+}
+
+static void Usage()
+{
+	fprintf( stderr, "Usage: logog-cat [--from TIME] [--to TIME] [--level LEVEL] [--core] FILE...\n" );
+}
+
+int main( int argc, char *argv[] )
+{
+	LOGOG_UINT64 nFrom = 0;
+	LOGOG_UINT64 nTo = (LOGOG_UINT64)-1;
+	int nLevel = LOGOG_LEVEL_ALL;
+	bool bFiltered = false;
+	bool bCore = false;
+	int nArgument = 1;
+
+	for ( ; ( nArgument < argc ) && ( strncmp( argv[ nArgument ], "--", 2 ) == 0 ); nArgument++ )
+	{
+		const char *sOption = argv[ nArgument ];
+
+		if ( strcmp( sOption, "--core" ) == 0 )
+		{
+			bCore = true;
+			continue;
+		}
+
+		const char *sValue = ( nArgument + 1 < argc ) ? argv[ ++nArgument ] : "";
+		bool bOk;
+
+		if ( strcmp( sOption, "--from" ) == 0 )
+			bOk = ParseTime( sValue, nFrom );
+		else if ( strcmp( sOption, "--to" ) == 0 )
+			bOk = ParseTime( sValue, nTo );
+		else if ( strcmp( sOption, "--level" ) == 0 )
+			bOk = ParseLevel( sValue, nLevel );
+		else
+			bOk = false;
+
+		if ( !bOk )
+		{
+			fprintf( stderr, "logog-cat: bad option %s %s\n", sOption, sValue );
+			Usage();
+			return 2;
+		}
+
+		bFiltered = true;
+	}
+
+	if ( nArgument >= argc )
+	{
+		Usage();
+		return 2;
+	}
+
+	int nResult = 0;
+
+	LOGOG_INITIALIZE();
+
+	{
+		BinaryLogReader reader;
+		BinaryLogRecord record;
+		CompressedLogReader compressed;
+		FlightRecorderReader flight;
+
+		for ( int t = nArgument; t < argc; t++ )
+		{
+			if ( flight.Open( argv[ t ], bCore ))
+			{
+				if ( bFiltered )
+				{
+					fprintf( stderr, "logog-cat: %s: flight recorders cannot be filtered\n", argv[ t ] );
+					nResult = 1;
+				}
+				else
+					PrintFlightRecords( flight );
+
+				flight.Close();
+				continue;
+			}
+
+			if ( bCore )
+			{
+				fprintf( stderr, "logog-cat: %s: no flight recorder found\n", argv[ t ] );
+				nResult = 1;
+				continue;
+			}
+
+			if ( compressed.Open( argv[ t ] ))
+			{
+				if ( bFiltered )
+				{
+					fprintf( stderr, "logog-cat: %s: compressed logs cannot be filtered\n", argv[ t ] );
+					nResult = 1;
+				}
+				else if ( !DecompressFile( compressed ))
+				{
+					fprintf( stderr, "logog-cat: %s: stopped at a corrupt or truncated block\n", argv[ t ] );
+					nResult = 1;
+				}
+
+				compressed.Close();
+				continue;
+			}
+
+			if ( reader.Open( argv[ t ] ))
+			{
+				while ( reader.Next( record ))
+				{
+					if (( record.m_nTime >= nFrom ) && ( record.m_nTime <= nTo ) && ( record.m_Site.m_nLevel <= nLevel ))
+						PrintRecord( record );
+				}
+
+				if ( reader.IsCorrupt() )
+				{
+					fprintf( stderr, "logog-cat: %s: stopped at a corrupt or truncated record\n", argv[ t ] );
+					nResult = 1;
+				}
+
+				reader.Close();
+				continue;
+			}
+
+			if ( bFiltered )
+			{
+				if ( !CopyIndexedRanges( argv[ t ], nFrom, nTo, nLevel ))
+					nResult = 1;
+
+				continue;
+			}
+
+			fprintf( stderr, "logog-cat: %s: not a binary, compressed or flight recorder log, or cannot be opened\n", argv[ t ] );
+			nResult = 1;
+		}
+	}
+
+	LOGOG_SHUTDOWN();
+
+	return nResult;
+}